@@ -0,0 +1,169 @@
+/*
+    eclipse_catalog.cpp  -  2026-10-14
+
+    Example C++ program for Astronomy Engine:
+    https://github.com/cosinekitty/astronomy
+
+    Lists every lunar eclipse and global solar eclipse
+    over a range of years, using multiple threads.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "astro_demo_common.h"
+
+static const char UsageText[] =
+"\n"
+"USAGE:\n"
+"\n"
+"eclipse_catalog [-t threads] firstYear lastYear\n"
+"\n"
+"Prints one line for each lunar eclipse and each solar eclipse\n"
+"whose peak occurs between the beginning of firstYear and\n"
+"the end of lastYear, in chronological order.\n"
+"\n"
+"The -t option selects how many threads search for eclipses.\n"
+"The default is 1. Use -t 0 to use one thread per CPU core.\n"
+"The output is identical no matter how many threads are used.\n"
+"\n";
+
+// There are never more than 5 lunar or 5 solar eclipses in a year.
+const int MaxEclipsesPerYear = 5;
+
+static const char *KindName(astro_eclipse_kind_t kind)
+{
+    switch (kind)
+    {
+    case ECLIPSE_PENUMBRAL: return "penumbral";
+    case ECLIPSE_PARTIAL:   return "partial";
+    case ECLIPSE_ANNULAR:   return "annular";
+    case ECLIPSE_TOTAL:     return "total";
+    default:                return "unknown";
+    }
+}
+
+static void PrintLunar(const astro_lunar_eclipse_t &eclipse)
+{
+    PrintTime(eclipse.peak);
+    printf(" lunar %-9s obscuration=%6.4lf sd_penum=%7.3lf sd_partial=%7.3lf sd_total=%7.3lf\n",
+        KindName(eclipse.kind),
+        eclipse.obscuration,
+        eclipse.sd_penum,
+        eclipse.sd_partial,
+        eclipse.sd_total);
+}
+
+static void PrintSolar(const astro_global_solar_eclipse_t &eclipse)
+{
+    PrintTime(eclipse.peak);
+    printf(" solar %-9s distance=%7.1lf", KindName(eclipse.kind), eclipse.distance);
+    if (eclipse.kind != ECLIPSE_PARTIAL)
+        printf(" obscuration=%6.4lf lat=%8.4lf lon=%9.4lf", eclipse.obscuration, eclipse.latitude, eclipse.longitude);
+    printf("\n");
+}
+
+// Astronomy Engine calls this function to search the chunks of each catalog.
+// Threads take the next unsearched chunk from a shared counter
+// until there are none left, so faster threads do more of the work.
+static void RunParallel(void *context, int count, astro_work_func_t work, void *workContext)
+{
+    int numThreads = *static_cast<const int *>(context);
+    std::atomic<int> nextChunk(0);
+
+    auto worker = [&]()
+    {
+        for(;;)
+        {
+            int index = nextChunk.fetch_add(1);
+            if (index >= count)
+                break;
+            work(workContext, index, 1);
+        }
+    };
+
+    if (numThreads <= 1)
+    {
+        worker();
+    }
+    else
+    {
+        std::vector<std::thread> pool;
+        for (int t = 0; t < numThreads; ++t)
+            pool.push_back(std::thread(worker));
+        for (std::thread &t : pool)
+            t.join();
+    }
+}
+
+int main(int argc, const char *argv[])
+{
+    int numThreads = 1;
+    int firstYear, lastYear;
+
+    // Parse the optional thread count.
+    if (argc >= 3 && !strcmp(argv[1], "-t"))
+    {
+        char *end;
+        long n = strtol(argv[2], &end, 10);
+        if (*end != '\0' || n < 0 || n > 1024)
+        {
+            fprintf(stderr, "ERROR: invalid thread count '%s'\n", argv[2]);
+            return 1;
+        }
+        numThreads = (int)n;
+        if (numThreads == 0)
+        {
+            numThreads = (int)std::thread::hardware_concurrency();
+            if (numThreads < 1)
+                numThreads = 1;
+        }
+        argc -= 2;
+        argv += 2;
+    }
+
+    if (argc != 3 || 1 != sscanf(argv[1], "%d", &firstYear) || 1 != sscanf(argv[2], "%d", &lastYear) || lastYear < firstYear)
+    {
+        fprintf(stderr, "%s", UsageText);
+        return 1;
+    }
+
+    astro_time_t startTime = Astronomy_MakeTime(firstYear, 1, 1, 0, 0, 0.0);
+    astro_time_t stopTime = Astronomy_MakeTime(lastYear + 1, 1, 1, 0, 0, 0.0);
+    size_t capacity = MaxEclipsesPerYear * (size_t)(lastYear - firstYear + 1);
+    size_t nlunar, nsolar;
+    astro_status_t status;
+
+    // The catalog functions split the range into chunks that do not depend
+    // on the number of threads, so the output is always the same.
+    std::vector<astro_lunar_eclipse_t> lunar(capacity);
+    status = Astronomy_LunarEclipseCatalogParallel(startTime, stopTime, RunParallel, &numThreads, lunar.data(), capacity, &nlunar);
+    if (status != ASTRO_SUCCESS)
+    {
+        fprintf(stderr, "ERROR: lunar eclipse search failed with status %d\n", status);
+        return 1;
+    }
+
+    std::vector<astro_global_solar_eclipse_t> solar(capacity);
+    status = Astronomy_GlobalSolarEclipseCatalogParallel(startTime, stopTime, RunParallel, &numThreads, solar.data(), capacity, &nsolar);
+    if (status != ASTRO_SUCCESS)
+    {
+        fprintf(stderr, "ERROR: solar eclipse search failed with status %d\n", status);
+        return 1;
+    }
+
+    // Merge the lunar and solar lists by peak time.
+    size_t i = 0, j = 0;
+    while (i < nlunar || j < nsolar)
+    {
+        if (j == nsolar || (i < nlunar && lunar[i].peak.ut < solar[j].peak.ut))
+            PrintLunar(lunar[i++]);
+        else
+            PrintSolar(solar[j++]);
+    }
+
+    return 0;
+}
@@ -116,4 +116,67 @@ namespace Imager
         const double dy = nc.y - c.y;
         nested.Move (c.x + (a*dx - b*dy), c.y + (a*dy + b*dx), nc.z);
     }
+
+    void EncloseSpheres(
+        const Vector& c1, double r1,
+        const Vector& c2, double r2,
+        Vector& center, double& radius)
+    {
+        const double d = (c2 - c1).Magnitude();
+        if (d + r2 <= r1)
+        {
+            // The first sphere already contains the second.
+            center = c1;
+            radius = r1;
+        }
+        else if (d + r1 <= r2)
+        {
+            // The second sphere already contains the first.
+            center = c2;
+            radius = r2;
+        }
+        else
+        {
+            // The enclosing sphere touches both spheres on the far sides,
+            // along the line through their centers.
+            radius = (d + r1 + r2) / 2.0;
+            center = c1 + ((radius - r1) / d)*(c2 - c1);
+        }
+    }
+
+    bool SetUnion::GetBoundingSphere(Vector& sphereCenter, double& sphereRadius) const
+    {
+        // The union is bounded only if both nested solids are bounded.
+        Vector leftCenter, rightCenter;
+        double leftRadius, rightRadius;
+        if (!Left().GetBoundingSphere(leftCenter, leftRadius))
+            return false;
+        if (!Right().GetBoundingSphere(rightCenter, rightRadius))
+            return false;
+        EncloseSpheres(leftCenter, leftRadius, rightCenter, rightRadius, sphereCenter, sphereRadius);
+        return true;
+    }
+
+    bool SetIntersection::GetBoundingSphere(Vector& sphereCenter, double& sphereRadius) const
+    {
+        // The intersection lies inside both nested solids,
+        // so either bounding sphere will do.  Pick the smaller one.
+        Vector leftCenter, rightCenter;
+        double leftRadius, rightRadius;
+        const bool leftBounded = Left().GetBoundingSphere(leftCenter, leftRadius);
+        const bool rightBounded = Right().GetBoundingSphere(rightCenter, rightRadius);
+        if (leftBounded && (!rightBounded || leftRadius <= rightRadius))
+        {
+            sphereCenter = leftCenter;
+            sphereRadius = leftRadius;
+            return true;
+        }
+        if (rightBounded)
+        {
+            sphereCenter = rightCenter;
+            sphereRadius = rightRadius;
+            return true;
+        }
+        return false;
+    }
 }
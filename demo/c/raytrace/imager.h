@@ -26,9 +26,11 @@
 #ifndef __DDC_IMAGER_H
 #define __DDC_IMAGER_H
 
+#include <algorithm>
 #include <vector>
 #include <cmath>
 #include "algebra.h"
+#include "pngwriter.h"
 
 namespace Imager
 {
@@ -325,6 +327,47 @@ namespace Imager
         const IntersectionList& list,
         Intersection& intersection);
 
+    // Finds the smallest sphere <center, radius> that encloses
+    // both of the spheres <c1, r1> and <c2, r2>.
+    void EncloseSpheres(
+        const Vector& c1, double r1,
+        const Vector& c2, double r2,
+        Vector& center, double& radius);
+
+    // Returns false if the ray starting at 'vantage' certainly misses
+    // the sphere <center, radius> before reaching vantage + maxFraction*direction.
+    // The test is conservative: it may return true for a near miss.
+    bool RayMayHitSphere(
+        const Vector& vantage,
+        const Vector& direction,
+        double maxFraction,
+        const Vector& center,
+        double radius);
+
+    // A temporary intersection list borrowed from a pool owned by
+    // the calling thread.  Const member functions use these instead of
+    // mutable member lists, so that several threads can trace rays
+    // through the same scene at once.  Lists are returned to the pool
+    // in the reverse order they were borrowed, so nested calls (for
+    // example, Contains() called while appending intersections) each
+    // get their own list.  The pool keeps the memory of each list,
+    // which avoids repeated memory allocations, just like the
+    // mutable member lists this replaces.
+    class ScratchIntersectionList
+    {
+    public:
+        ScratchIntersectionList();
+        ~ScratchIntersectionList();
+
+        IntersectionList& List() const { return *list; }
+
+    private:
+        ScratchIntersectionList(const ScratchIntersectionList&) = delete;
+        ScratchIntersectionList& operator= (const ScratchIntersectionList&) = delete;
+
+        IntersectionList* list;
+    };
+
     //------------------------------------------------------------------------
 
     class Taggable       // helps debugging; allows caller to assign names to things
@@ -389,9 +432,9 @@ namespace Imager
             const Vector& direction,
             Intersection &intersection) const
         {
-            cachedIntersectionList.clear();
-            AppendAllIntersections(vantage, direction, cachedIntersectionList);
-            return PickClosestIntersection(cachedIntersectionList, intersection);
+            ScratchIntersectionList scratch;
+            AppendAllIntersections(vantage, direction, scratch.List());
+            return PickClosestIntersection(scratch.List(), intersection);
         }
 
         // Returns true if the given point is inside this solid object.
@@ -401,6 +444,19 @@ namespace Imager
         // to override this default algorithm.
         virtual bool Contains(const Vector& point) const;
 
+        // Finds a sphere that encloses every point of this solid,
+        // so that a ray missing the sphere can be rejected without
+        // searching for intersections.  The sphere need not be tight,
+        // but it must follow the solid as it is translated and rotated.
+        // Returns false if the solid has no finite bounding sphere,
+        // in which case every ray must be tested against it.
+        virtual bool GetBoundingSphere(
+            Vector& sphereCenter,
+            double& sphereRadius) const
+        {
+            return false;
+        }
+
         // Returns the optical properties (reflection and refraction)
         // at a given point on the surface of this solid.
         // By default, the optical properties are the same everywhere,
@@ -480,13 +536,6 @@ namespace Imager
         // Many derived classes will override the Contains() method
         // and therefore make this flag irrelevant.
         const bool isFullyEnclosed;
-
-        // The following members are an optimization to minimize
-        // the overhead and fragmentation caused by repeated
-        // memory allocations creating and destroying
-        // std::vector contents.
-        mutable IntersectionList cachedIntersectionList;
-        mutable IntersectionList enclosureList;
     };
 
     //------------------------------------------------------------------------
@@ -555,11 +604,6 @@ namespace Imager
             double a,
             double b);
 
-        // The following list is for caching and filtering
-        // intersections with the left and right nested solids.
-        // It is mutable to allow modification from const methods.
-        mutable IntersectionList tempIntersectionList;
-
     private:
         SolidObject* left;
         SolidObject* right;
@@ -594,6 +638,10 @@ namespace Imager
             // it is in either of the nested solids.
             return Left().Contains(point) || Right().Contains(point);
         }
+
+        virtual bool GetBoundingSphere(
+            Vector& sphereCenter,
+            double& sphereRadius) const;
     };
 
     //------------------------------------------------------------------------
@@ -622,6 +670,10 @@ namespace Imager
             return Left().Contains(point) && Right().Contains(point);
         }
 
+        virtual bool GetBoundingSphere(
+            Vector& sphereCenter,
+            double& sphereRadius) const;
+
     private:
         void AppendOverlappingIntersections(
             const Vector& vantage,
@@ -797,6 +849,16 @@ namespace Imager
             SetTag("ThinRing");
         }
 
+        virtual bool GetBoundingSphere(
+            Vector& sphereCenter,
+            double& sphereRadius) const
+        {
+            // The ring is centered on its center of rotation.
+            sphereCenter = Center();
+            sphereRadius = r2;
+            return true;
+        }
+
     protected:
         virtual void ObjectSpace_AppendAllIntersections(
             const Vector& vantage,
@@ -819,12 +881,6 @@ namespace Imager
     private:
         double  r1;     // The radius of the hole at the center of the ring.
         double  r2;     // The outer radius of the ring.
-
-        // A temporary intersection list, cached inside this object
-        // to avoid repeated memory allocations.
-        // Marked mutable to allow const functions to cache
-        // lists whose memory may be reused as needed.
-        mutable IntersectionList tempIntersectionList;
     };
 
     //------------------------------------------------------------------------
@@ -860,6 +916,17 @@ namespace Imager
             SetTag("Spheroid");
         }
 
+        virtual bool GetBoundingSphere(
+            Vector& sphereCenter,
+            double& sphereRadius) const
+        {
+            // The longest semi-axis reaches the farthest,
+            // no matter how the spheroid is oriented.
+            sphereCenter = Center();
+            sphereRadius = std::max(a, std::max(b, c));
+            return true;
+        }
+
     protected:
         virtual void ObjectSpace_AppendAllIntersections(
             const Vector& vantage,
@@ -914,6 +981,15 @@ namespace Imager
             return (point - Center()).MagnitudeSquared() <= (r * r);
         }
 
+        virtual bool GetBoundingSphere(
+            Vector& sphereCenter,
+            double& sphereRadius) const
+        {
+            sphereCenter = Center();
+            sphereRadius = radius;
+            return true;
+        }
+
         // The nice thing about a sphere is that rotating
         // it has no effect on its appearance!
         virtual SolidObject& RotateX(double angleInDegrees) { return *this; }
@@ -988,6 +1064,13 @@ namespace Imager
             lightSourceList.push_back(lightSource);
         }
 
+        // Removes all the light sources, so that the scene
+        // can be lit differently for the next image.
+        void ClearLightSourceList()
+        {
+            lightSourceList.clear();
+        }
+
         // Renders an image of the current scene, with the camera
         // at <0, 0, 0> and looking into the +z axis, with the +y axis upward.
         // Writes the image to the specified PNG file, which should have a
@@ -1002,12 +1085,60 @@ namespace Imager
         // to increase O(N^2), so it is best to use a value between 1
         // (fastest but most "jaggy") to 4 (16 times slower but results
         // in much smoother images).
+        // numThreads is the number of threads that trace rays, or 0
+        // to use one thread per hardware thread.  The image is the same
+        // no matter how many threads are used.
         void SaveImage(
             const char *outPngFileName,
             size_t pixelsWide,
             size_t pixelsHigh,
             double zoom,
-            size_t antiAliasFactor) const;
+            size_t antiAliasFactor,
+            size_t numThreads = 1) const;
+
+        // Renders the same image as SaveImage, but traces a single ray
+        // for each pixel first, then oversamples by antiAliasFactor only
+        // the pixels at edges and other changes in color.
+        // This is much faster for images with large smooth areas,
+        // and it needs memory only for the output pixels.
+        void SaveAdaptiveImage(
+            const char *outPngFileName,
+            size_t pixelsWide,
+            size_t pixelsHigh,
+            double zoom,
+            size_t antiAliasFactor,
+            size_t numThreads = 1) const;
+
+        // RenderImage and RenderAdaptiveImage are the same as SaveImage
+        // and SaveAdaptiveImage, except that instead of writing a PNG file,
+        // they store 4 bytes (red, green, blue, alpha) for each pixel
+        // in rgbaBuffer, row by row.  Pass rgbaBuffer to SavePng
+        // to write the file.  Splitting the work this way allows an
+        // animation to encode one frame while the next frame renders.
+        void RenderImage(
+            std::vector<unsigned char>& rgbaBuffer,
+            size_t pixelsWide,
+            size_t pixelsHigh,
+            double zoom,
+            size_t antiAliasFactor,
+            size_t numThreads = 1) const;
+
+        void RenderAdaptiveImage(
+            std::vector<unsigned char>& rgbaBuffer,
+            size_t pixelsWide,
+            size_t pixelsHigh,
+            double zoom,
+            size_t antiAliasFactor,
+            size_t numThreads = 1) const;
+
+        // pngOptions selects the compression effort, filter,
+        // and number of threads for the PNG encoder.
+        static void SavePng(
+            const char *outPngFileName,
+            const std::vector<unsigned char>& rgbaBuffer,
+            size_t pixelsWide,
+            size_t pixelsHigh,
+            const PngOptions& pngOptions = PngOptions());
 
     private:
         void ClearSolidObjectList();
@@ -1021,6 +1152,40 @@ namespace Imager
             const Vector& point1,
             const Vector& point2) const;
 
+        // A node in the bounding volume hierarchy.  The sphere encloses
+        // every solid below the node.  A leaf refers to a single solid
+        // by its index in solidObjectList; an inner node has two children.
+        struct BoundingNode
+        {
+            Vector  center;
+            double  radius;
+            int     left;       // index of first child node, or -1 for a leaf
+            int     right;      // index of second child node, or -1 for a leaf
+            size_t  solidIndex; // index into solidObjectList, for a leaf only
+        };
+
+        // Builds the bounding volume hierarchy over solidObjectList.
+        // Must be called before tracing any rays, after all solids
+        // have been added and moved into place.
+        void BuildBoundingTree() const;
+
+        // Appends a subtree over leaves[begin, end) to boundingTree
+        // and returns the index of its root node.
+        int BuildBoundingNode(
+            std::vector<BoundingNode>& leaves,
+            size_t begin,
+            size_t end) const;
+
+        // Calls visitor(solidIndex) for each bounded solid whose sphere
+        // the ray may hit before vantage + maxFraction*direction.
+        // Stops and returns false as soon as the visitor returns false.
+        template <typename Visitor>
+        bool VisitBoundingTree(
+            const Vector& vantage,
+            const Vector& direction,
+            double maxFraction,
+            Visitor visitor) const;
+
         Color TraceRay(
             const Vector& vantage,
             const Vector& direction,
@@ -1035,8 +1200,41 @@ namespace Imager
 
         Color CalculateMatte(const Intersection& intersection) const;
 
+        // Define types needed to hold a list of pixel coordinates.
+        struct PixelCoordinates
+        {
+            size_t i;
+            size_t j;
+
+            PixelCoordinates(size_t _i, size_t _j)
+                : i(_i)
+                , j(_j)
+            {
+            }
+        };
+        typedef std::vector<PixelCoordinates> PixelList;
+
+        // Traces the rays for the rectangle of oversampled pixels
+        // with columns [iBegin, iEnd) and rows [jBegin, jEnd).
+        // Appends any ambiguous pixels to ambiguousPixelList.
+        void RenderTile(
+            ImageBuffer& buffer,
+            size_t iBegin,
+            size_t iEnd,
+            size_t jBegin,
+            size_t jEnd,
+            double largeZoom,
+            PixelList& ambiguousPixelList) const;
+
         void ResolveAmbiguousPixel(ImageBuffer& buffer, size_t i, size_t j) const;
 
+        bool TraceCameraRay(const Vector& direction, Color& color) const;
+
+        static void ConvertToRgba(
+            const ImageBuffer& buffer,
+            size_t antiAliasFactor,
+            std::vector<unsigned char>& rgbaBuffer);
+
         // Convert a floating point color component value,
         // based on the maximum component value,
         // to a byte RGB value in the range 0x00 to 0xff.
@@ -1068,29 +1266,19 @@ namespace Imager
         typedef std::vector<SolidObject*> SolidObjectList;
         typedef std::vector<LightSource> LightSourceList;
 
-        // Define types needed to hold a list of pixel coordinates.
-        struct PixelCoordinates
-        {
-            size_t i;
-            size_t j;
-
-            PixelCoordinates(size_t _i, size_t _j)
-                : i(_i)
-                , j(_j)
-            {
-            }
-        };
-        typedef std::vector<PixelCoordinates> PixelList;
-
         // A list of all the solid objects in the scene.
         SolidObjectList solidObjectList;
 
         // A list of all the point light sources in the scene.
         LightSourceList lightSourceList;
 
-        // Help performance by avoiding constant construction/destruction
-        // of intersection lists.
-        mutable IntersectionList cachedIntersectionList;
+        // The bounding volume hierarchy, with the root at index 0,
+        // and the indexes of solids that have no bounding sphere.
+        // SaveImage rebuilds them before any threads trace rays,
+        // so they are read-only while rendering.
+        mutable std::vector<BoundingNode> boundingTree;
+        mutable std::vector<size_t> unboundedSolids;
+
         Aimer *aimer;
     };
 
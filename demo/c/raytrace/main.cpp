@@ -7,6 +7,9 @@
 #include <iostream>
 #include <stdio.h>
 #include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
 #include "algebra.h"
 #include "imager.h"
 #include "astro_demo_common.h"
@@ -29,6 +32,12 @@ static const char UsageText[] =
 "    -f       =  flip the image (match inverted telescope view)\n"
 "    -s<ang>  =  spin the image by the specified angle in degrees\n"
 "    -z<fac>  =  zoom in by the given multiplication factor\n"
+"    -t<num>  =  number of rendering threads (default 0 = one per CPU core)\n"
+"    -a       =  adaptive antialiasing: oversample only edges and color changes\n"
+"    -n<num>  =  render an animation of num frames, named outfile_0000.png, ...\n"
+"    -d<min>  =  minutes of time between animation frames (default 1)\n"
+"    -p<lev>  =  PNG compression effort: 0 = none, 1 = fast, 2 = normal, 3 = best\n"
+"                (default: the standard lodepng encoder, single-threaded)\n"
 "\n";
 
 const double KM_SCALE = 1000.0;
@@ -243,102 +252,189 @@ static Imager::SolidObject* CreateSaturnRings()
 }
 
 
-static void AddMoonToScene(
-    Imager::Scene &scene,
-    astro_vector_t geo_planet,
-    astro_state_vector_t moon,
-    double radius_km,
-    const char *name)
+// The positions and orientations needed to render one image.
+struct FrameGeometry
 {
-    using namespace Imager;
+    astro_vector_t geo_planet;      // geocentric planet, at the time light left it
+    astro_vector_t sun;             // geocentric Sun
+    astro_axis_t axis;              // orientation of the planet's rotation axis
+    astro_jupiter_moons_t moons;    // jovicentric moons, used only for Jupiter
+};
 
-    if (moon.status != ASTRO_SUCCESS)
+
+static int CalcGeometry(astro_body_t body, astro_time_t time, FrameGeometry &geo)
+{
+    // Calculate the geocentric position of the planet, corrected for light travel time.
+    // We use Astronomy_BackdatePosition instead of Astronomy_GeoVector because it
+    // returns the time light left the planet, not the time of observation.
+    // This backdated time is needed to calculate the apparent positions of Jupiter's moons.
+    geo.geo_planet = Astronomy_BackdatePosition(time, BODY_EARTH, body, ABERRATION);
+    if (geo.geo_planet.status != ASTRO_SUCCESS)
     {
-        fprintf(stderr, "FATAL(main.cpp ! AddMoonToScene): moon status = %d\n", (int)moon.status);
-        exit(1);
+        fprintf(stderr, "Error %d calculating planet geocentric position\n", geo.geo_planet.status);
+        return 1;
     }
 
-    Vector center(
-        geo_planet.x + moon.x,
-        geo_planet.y + moon.y,
-        geo_planet.z + moon.z
-    );
+    // Calculate the geocentric position of the Sun, as our light source.
+    geo.sun = Astronomy_GeoVector(BODY_SUN, time, ABERRATION);
+    if (geo.sun.status != ASTRO_SUCCESS)
+    {
+        fprintf(stderr, "Error %d calculating Sun geocentric position\n", geo.sun.status);
+        return 1;
+    }
 
-    Sphere *sphere = new Sphere(center/AU_SCALE, radius_km/KM_SCALE);
-    scene.AddSolidObject(sphere);
-    sphere->SetFullMatte(Color(1.0, 1.0, 1.0));     // ??? Actual moon colors ???
-    sphere->SetTag(name);
+    // Calculate the orientation of the planet's rotation axis.
+    geo.axis = Astronomy_RotationAxis(body, &geo.geo_planet.t);
+    if (geo.axis.status != ASTRO_SUCCESS)
+    {
+        fprintf(stderr, "Error %d calculating planet's rotation axis.\n", geo.axis.status);
+        return 1;
+    }
+
+    return 0;
 }
 
 
-static void AddJupiterMoons(
-    Imager::Scene &scene,
-    astro_vector_t geo_planet)
+static int CalcJupiterMoons(std::vector<FrameGeometry> &frames)
 {
-    using namespace Imager;
+    // Calculate the positions of Jupiter's moons at the backdated
+    // times of all the frames with a single batch call.
+    const size_t n = frames.size();
+    std::vector<astro_time_t> times(n);
+    for (size_t k = 0; k < n; ++k)
+        times[k] = frames[k].geo_planet.t;
+
+    std::vector<double> buffer(4 * 6 * n);
+    astro_state_arrays_t arrays[4];
+    for (int m = 0; m < 4; ++m)
+    {
+        double *base = &buffer[6 * n * m];
+        arrays[m].x  = base;
+        arrays[m].y  = base + n;
+        arrays[m].z  = base + 2*n;
+        arrays[m].vx = base + 3*n;
+        arrays[m].vy = base + 4*n;
+        arrays[m].vz = base + 5*n;
+    }
 
-    // Calculate the position of Jupiter's moons at the backdated time.
-    astro_jupiter_moons_t jm = Astronomy_JupiterMoons(geo_planet.t);
+    astro_status_t status = Astronomy_JupiterMoonsBatch(times.data(), n, arrays);
+    if (status != ASTRO_SUCCESS)
+    {
+        fprintf(stderr, "Error %d calculating Jupiter's moons.\n", status);
+        return 1;
+    }
 
-    // Add Jupiter's moons to the scene.
-    AddMoonToScene(scene, geo_planet, jm.io,       IO_RADIUS_KM,       "Io"      );
-    AddMoonToScene(scene, geo_planet, jm.europa,   EUROPA_RADIUS_KM,   "Europa"  );
-    AddMoonToScene(scene, geo_planet, jm.ganymede, GANYMEDE_RADIUS_KM, "Ganymede");
-    AddMoonToScene(scene, geo_planet, jm.callisto, CALLISTO_RADIUS_KM, "Callisto");
+    for (size_t k = 0; k < n; ++k)
+    {
+        astro_state_vector_t *moon[4] =
+        {
+            &frames[k].moons.io,
+            &frames[k].moons.europa,
+            &frames[k].moons.ganymede,
+            &frames[k].moons.callisto
+        };
+
+        for (int m = 0; m < 4; ++m)
+        {
+            moon[m]->status = ASTRO_SUCCESS;
+            moon[m]->t  = times[k];
+            moon[m]->x  = arrays[m].x[k];
+            moon[m]->y  = arrays[m].y[k];
+            moon[m]->z  = arrays[m].z[k];
+            moon[m]->vx = arrays[m].vx[k];
+            moon[m]->vy = arrays[m].vy[k];
+            moon[m]->vz = arrays[m].vz[k];
+        }
+    }
+
+    return 0;
 }
 
 
-int PlanetImage(
-    astro_body_t body,
-    const char *filename,
-    int width,
-    int height,
-    astro_time_t time,
-    int flip,
-    double spin,
-    double zoom)
+// The scene graph for a planet, and for Jupiter's moons.
+// It is built once and then updated for each frame of an animation,
+// by moving and reorienting the solids that are already in the scene.
+class PlanetScene
 {
-    using namespace Imager;
-
-    // Calculate the geocentric position of the planet, corrected for light travel time.
-    // We use Astronomy_BackdatePosition instead of Astronomy_GeoVector because it
-    // returns the time light left the planet, not the time of observation.
-    // This backdated time is needed to calculate the apparent positions of Jupiter's moons.
-    astro_vector_t geo_planet = Astronomy_BackdatePosition(time, BODY_EARTH, body, ABERRATION);
-    if (geo_planet.status != ASTRO_SUCCESS)
+public:
+    explicit PlanetScene(astro_body_t _body)
+        : body(_body)
+        , scene(Imager::Color(0.0, 0.0, 0.0))
+        , planet(nullptr)
+        , numMoons(0)
+        , oriented(false)
+        , aimer(Astronomy_IdentityMatrix(), 0, 0.0)
     {
-        fprintf(stderr, "Error %d calculating planet geocentric position\n", geo_planet.status);
-        return 1;
     }
 
-    // Calculate the geocentric position of the Sun, as our light source.
-    astro_vector_t sun = Astronomy_GeoVector(BODY_SUN, time, ABERRATION);
-    if (sun.status != ASTRO_SUCCESS)
-    {
-        fprintf(stderr, "Error %d calculating Sun geocentric position\n", sun.status);
-        return 1;
-    }
+    int Build();
+    int Update(const FrameGeometry &geo, int flip, double spin, double zoom, double &frameZoom);
 
-    double planet_distance_au = Astronomy_VectorLength(geo_planet);
+    const Imager::Scene& GetScene() const { return scene; }
 
-    // Calculate the orientation of the planet's rotation axis.
-    astro_axis_t axis = Astronomy_RotationAxis(body, &geo_planet.t);
-    if (axis.status != ASTRO_SUCCESS)
+private:
+    void AddMoon(double radius_km, const char *name);
+    void MoveMoon(int index, astro_vector_t geo_planet, astro_state_vector_t moon);
+
+    const astro_body_t body;
+    Imager::Scene scene;
+    Imager::SolidObject *planet;
+    Imager::Sphere *moons[4];
+    int numMoons;
+    double equ_radius;
+
+    // The rotation axis the planet is currently oriented to, if any.
+    bool oriented;
+    astro_axis_t axis;
+
+    RotationMatrixAimer aimer;
+};
+
+
+void PlanetScene::AddMoon(double radius_km, const char *name)
+{
+    using namespace Imager;
+
+    Sphere *sphere = new Sphere(Vector(), radius_km/KM_SCALE);
+    scene.AddSolidObject(sphere);
+    sphere->SetFullMatte(Color(1.0, 1.0, 1.0));     // ??? Actual moon colors ???
+    sphere->SetTag(name);
+    moons[numMoons++] = sphere;
+}
+
+
+void PlanetScene::MoveMoon(int index, astro_vector_t geo_planet, astro_state_vector_t moon)
+{
+    using namespace Imager;
+
+    if (moon.status != ASTRO_SUCCESS)
     {
-        fprintf(stderr, "Error %d calculating planet's rotation axis.\n", axis.status);
-        return 1;
+        fprintf(stderr, "FATAL(main.cpp ! MoveMoon): moon status = %d\n", (int)moon.status);
+        exit(1);
     }
 
-    Scene scene(Color(0.0, 0.0, 0.0));
+    Vector center(
+        geo_planet.x + moon.x,
+        geo_planet.y + moon.y,
+        geo_planet.z + moon.z
+    );
+
+    moons[index]->Move(center/AU_SCALE);
+}
+
+
+int PlanetScene::Build()
+{
+    using namespace Imager;
 
-    const double equ_radius = BodyEquatorialRadiusKm(body) / KM_SCALE;
+    equ_radius = BodyEquatorialRadiusKm(body) / KM_SCALE;
     const double pol_radius = BodyPolarRadiusKm(body) / KM_SCALE;
     if (equ_radius < 0.0 || pol_radius < 0.0)
     {
         fprintf(stderr, "Error: cannot find radius data for requested body.\n");
         return 1;
     }
-    SolidObject *planet = new Spheroid(equ_radius, equ_radius, pol_radius);
+    planet = new Spheroid(equ_radius, equ_radius, pol_radius);
     planet->SetFullMatte(BodyColor(body));
 
     switch (body)
@@ -349,7 +445,11 @@ int PlanetImage(
         break;
 
     case BODY_JUPITER:
-        AddJupiterMoons(scene, geo_planet);
+        // Add Jupiter's moons to the scene.
+        AddMoon(IO_RADIUS_KM,       "Io"      );
+        AddMoon(EUROPA_RADIUS_KM,   "Europa"  );
+        AddMoon(GANYMEDE_RADIUS_KM, "Ganymede");
+        AddMoon(CALLISTO_RADIUS_KM, "Callisto");
         break;
 
     default:
@@ -357,15 +457,44 @@ int PlanetImage(
     }
 
     scene.AddSolidObject(planet);
-    planet->Move(Vector(geo_planet.x, geo_planet.y, geo_planet.z) / AU_SCALE);
     planet->SetTag(Astronomy_BodyName(body));
+    return 0;
+}
+
+
+int PlanetScene::Update(const FrameGeometry &geo, int flip, double spin, double zoom, double &frameZoom)
+{
+    using namespace Imager;
+
+    const astro_vector_t &geo_planet = geo.geo_planet;
+    double planet_distance_au = Astronomy_VectorLength(geo_planet);
+
+    if (numMoons == 4)
+    {
+        MoveMoon(0, geo_planet, geo.moons.io);
+        MoveMoon(1, geo_planet, geo.moons.europa);
+        MoveMoon(2, geo_planet, geo.moons.ganymede);
+        MoveMoon(3, geo_planet, geo.moons.callisto);
+    }
+
+    // Undo the previous frame's orientation of the planet, in reverse order.
+    if (oriented)
+    {
+        planet->RotateZ(-15.0 * axis.ra);
+        planet->RotateY(-(90.0 - axis.dec));
+    }
+
+    planet->Move(Vector(geo_planet.x, geo_planet.y, geo_planet.z) / AU_SCALE);
 
     // Reorient the planet's rotation axis to match the calculated orientation.
+    axis = geo.axis;
+    oriented = true;
     planet->RotateY(90.0 - axis.dec);
     planet->RotateZ(15.0 * axis.ra);
 
     // Add the Sun as the point light source.
-    scene.AddLightSource(LightSource(Vector(sun.x, sun.y, sun.z) / AU_SCALE, Color(1.0, 1.0, 1.0)));
+    scene.ClearLightSourceList();
+    scene.AddLightSource(LightSource(Vector(geo.sun.x, geo.sun.y, geo.sun.z) / AU_SCALE, Color(1.0, 1.0, 1.0)));
 
     // Aim the camera at the planet's center.
     // Start with an identity matrix, which leaves the camera pointing in the -z direction,
@@ -430,7 +559,7 @@ int PlanetImage(
         if (Verbose) printf("Auto-spin angle = %0.3lf degrees\n", spin);
     }
 
-    RotationMatrixAimer aimer(rotation, flip, spin);
+    aimer = RotationMatrixAimer(rotation, flip, spin);
     // Verify that the aimer redirects the vector <0, 0, -1> directly
     // toward the center of the planet.
     Vector aimTest = aimer.Aim(Vector(0.0, 0.0, -1.0));
@@ -460,16 +589,131 @@ int PlanetImage(
     double diameter_radians = (2.0 * equ_radius) / (planet_distance_au / AU_SCALE);
     double factor = 0.9 / diameter_radians;
     if (zoom == AUTO_ZOOM)
-        zoom = factor;
+        frameZoom = factor;
     else
-        zoom *= factor;
+        frameZoom = zoom * factor;
 
-    scene.SaveImage(filename, (size_t)width, (size_t)height, zoom, 4);
 
     return 0;
 }
 
 
+// Returns the name of the PNG file for the given frame of an animation:
+// "jupiter.png" becomes "jupiter_0000.png", "jupiter_0001.png", ...
+// A single image keeps the name the caller gave.
+static std::string FrameFileName(const char *filename, int frame, int numFrames)
+{
+    if (numFrames <= 1)
+        return filename;
+
+    std::string name = filename;
+    size_t dot = name.rfind('.');
+    size_t slash = name.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        dot = name.length();
+
+    char suffix[20];
+    snprintf(suffix, sizeof(suffix), "_%04d", frame);
+    return name.substr(0, dot) + suffix + name.substr(dot);
+}
+
+
+int PlanetImage(
+    astro_body_t body,
+    const char *filename,
+    int width,
+    int height,
+    astro_time_t time,
+    int flip,
+    double spin,
+    double zoom,
+    int numThreads,
+    int adaptive,
+    int numFrames,
+    double frameMinutes,
+    int pngEffort)
+{
+    using namespace Imager;
+
+    // Calculate where everything is for every frame before rendering any of them.
+    std::vector<FrameGeometry> frames(numFrames);
+    for (int k = 0; k < numFrames; ++k)
+    {
+        astro_time_t frameTime = Astronomy_AddDays(time, k * frameMinutes / (24.0 * 60.0));
+        if (CalcGeometry(body, frameTime, frames[k]))
+            return 1;
+    }
+
+    if (body == BODY_JUPITER && CalcJupiterMoons(frames))
+        return 1;
+
+    PlanetScene planetScene(body);
+    if (planetScene.Build())
+        return 1;
+
+    // Each frame is encoded as PNG on a separate thread
+    // while the next frame is being traced.
+    std::vector<unsigned char> rgbaBuffer;
+    std::vector<unsigned char> encodeBuffer;
+    std::string encodeError;
+    std::thread encoder;
+
+    // When the PNG encoder is asked to work harder than storing,
+    // it deflates strips of the image with as many threads as rendering does.
+    PngOptions pngOptions;
+    pngOptions.effort = (PngEffort)pngEffort;
+    pngOptions.numThreads = (size_t)numThreads;
+
+    auto finishEncoding = [&]()
+    {
+        if (encoder.joinable())
+            encoder.join();
+
+        if (!encodeError.empty())
+        {
+            fprintf(stderr, "ERROR: %s\n", encodeError.c_str());
+            return 1;
+        }
+        return 0;
+    };
+
+    for (int k = 0; k < numFrames; ++k)
+    {
+        double frameZoom;
+        if (planetScene.Update(frames[k], flip, spin, zoom, frameZoom))
+        {
+            finishEncoding();
+            return 1;
+        }
+
+        if (adaptive)
+            planetScene.GetScene().RenderAdaptiveImage(rgbaBuffer, (size_t)width, (size_t)height, frameZoom, 4, (size_t)numThreads);
+        else
+            planetScene.GetScene().RenderImage(rgbaBuffer, (size_t)width, (size_t)height, frameZoom, 4, (size_t)numThreads);
+
+        if (finishEncoding())
+            return 1;
+
+        encodeBuffer.swap(rgbaBuffer);
+        std::string frameFileName = FrameFileName(filename, k, numFrames);
+        if (Verbose) printf("Writing %s\n", frameFileName.c_str());
+        encoder = std::thread([&, frameFileName]()
+        {
+            try
+            {
+                Scene::SavePng(frameFileName.c_str(), encodeBuffer, (size_t)width, (size_t)height, pngOptions);
+            }
+            catch (const ImagerException &ex)
+            {
+                encodeError = ex.GetMessage();
+            }
+        });
+    }
+
+    return finishEncoding();
+}
+
+
 int main(int argc, const char *argv[])
 {
     using namespace std;
@@ -479,6 +723,11 @@ int main(int argc, const char *argv[])
         int flip = 0;
         double spin = AUTO_SPIN;
         double zoom = AUTO_ZOOM;
+        int numThreads = 0;
+        int adaptive = 0;
+        int numFrames = 1;
+        double frameMinutes = 1.0;
+        int pngEffort = PNG_EFFORT_LODEPNG;
 
         for (int i = 6; i < argc; ++i)
         {
@@ -486,6 +735,10 @@ int main(int argc, const char *argv[])
             {
                 flip = 1;
             }
+            else if (!strcmp(argv[i], "-a"))
+            {
+                adaptive = 1;
+            }
             else if (!strcmp(argv[i], "-v"))
             {
                 Verbose = true;
@@ -506,6 +759,38 @@ int main(int argc, const char *argv[])
                     return 1;
                 }
             }
+            else if (argv[i][0] == '-' && argv[i][1] == 't')
+            {
+                if (1 != sscanf(&argv[i][2], "%d", &numThreads) || numThreads < 0 || numThreads > 1024)
+                {
+                    fprintf(stderr, "ERROR: invalid thread count after '-t'\n");
+                    return 1;
+                }
+            }
+            else if (argv[i][0] == '-' && argv[i][1] == 'n')
+            {
+                if (1 != sscanf(&argv[i][2], "%d", &numFrames) || numFrames < 1 || numFrames > 100000)
+                {
+                    fprintf(stderr, "ERROR: invalid frame count after '-n'\n");
+                    return 1;
+                }
+            }
+            else if (argv[i][0] == '-' && argv[i][1] == 'd')
+            {
+                if (1 != sscanf(&argv[i][2], "%lf", &frameMinutes) || !isfinite(frameMinutes) || fabs(frameMinutes) > 1.0e+6)
+                {
+                    fprintf(stderr, "ERROR: invalid frame interval after '-d'\n");
+                    return 1;
+                }
+            }
+            else if (argv[i][0] == '-' && argv[i][1] == 'p')
+            {
+                if (1 != sscanf(&argv[i][2], "%d", &pngEffort) || pngEffort < PNG_EFFORT_STORE || pngEffort > PNG_EFFORT_BEST)
+                {
+                    fprintf(stderr, "ERROR: invalid PNG compression effort after '-p'\n");
+                    return 1;
+                }
+            }
             else
             {
                 fprintf(stderr, "ERROR: Unknown option: %s\n", argv[i]);
@@ -540,7 +825,7 @@ int main(int argc, const char *argv[])
             return 1;
         }
 
-        return PlanetImage(body, filename, width, height, time, flip, spin, zoom);
+        return PlanetImage(body, filename, width, height, time, flip, spin, zoom, numThreads, adaptive, numFrames, frameMinutes, pngEffort);
     }
 
     fprintf(stderr, "%s", UsageText);
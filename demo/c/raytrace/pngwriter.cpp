@@ -0,0 +1,813 @@
+/*
+    pngwriter.cpp  -  Configurable PNG output for the C++ demo programs.
+    https://github.com/cosinekitty/astronomy
+
+    A PNG file holds its pixels as a single zlib stream.  To deflate
+    the image in parallel, we split it into horizontal strips and deflate
+    each strip on its own with lodepng_deflate.  Each strip is small enough
+    that lodepng emits it as one deflate block.  Then we join the strips
+    into one stream: clear the BFINAL bit of every strip except the last,
+    and append each strip's bits directly after the previous strip's
+    end-of-block code.  Matches never reach back past the start of a strip,
+    which costs a little compression but makes the strips independent.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "lodepng.h"
+#include "pngwriter.h"
+
+// Error codes of our own, beyond the range lodepng uses.
+const unsigned PNGWRITER_ERROR_DEFLATE_SCAN = 1000;
+const unsigned PNGWRITER_ERROR_FILE_WRITE   = 1001;
+
+// lodepng deflates up to this many bytes as a single block.
+const size_t MAX_STRIP_BYTES = 65536;
+
+const unsigned ADLER_BASE = 65521;
+
+
+static unsigned Adler32(const unsigned char *data, size_t length)
+{
+    unsigned s1 = 1;
+    unsigned s2 = 0;
+    while (length > 0)
+    {
+        // 5552 is the most bytes we can add before s2 could overflow 32 bits.
+        size_t n = std::min(length, (size_t)5552);
+        length -= n;
+        while (n-- > 0)
+        {
+            s1 += *data++;
+            s2 += s1;
+        }
+        s1 %= ADLER_BASE;
+        s2 %= ADLER_BASE;
+    }
+    return s1 | (s2 << 16);
+}
+
+
+// Returns the Adler-32 checksum of two byte sequences joined together,
+// given the checksum of each, and the length of the second one.
+static unsigned Adler32Combine(unsigned adler1, unsigned adler2, size_t length2)
+{
+    const unsigned rem = (unsigned)(length2 % ADLER_BASE);
+    unsigned sum1 = adler1 & 0xffff;
+    unsigned sum2 = (unsigned)(((unsigned long long)rem * sum1) % ADLER_BASE);
+    sum1 += (adler2 & 0xffff) + ADLER_BASE - 1;
+    sum2 += (adler1 >> 16) + (adler2 >> 16) + ADLER_BASE - rem;
+    if (sum1 >= ADLER_BASE) sum1 -= ADLER_BASE;
+    if (sum1 >= ADLER_BASE) sum1 -= ADLER_BASE;
+    if (sum2 >= 2*ADLER_BASE) sum2 -= 2*ADLER_BASE;
+    if (sum2 >= ADLER_BASE) sum2 -= ADLER_BASE;
+    return sum1 | (sum2 << 16);
+}
+
+
+//------------------------------------------------------------------------
+// Just enough of a deflate decoder to find where a stream ends.
+
+class BitReader
+{
+public:
+    BitReader(const unsigned char *_data, size_t _size)
+        : pos(0)
+        , data(_data)
+        , numBits(8 * _size)
+    {
+    }
+
+    // Reads 'count' bits, least significant bit first.
+    bool Read(int count, unsigned &value)
+    {
+        value = 0;
+        for (int k = 0; k < count; ++k)
+        {
+            if (pos >= numBits)
+                return false;
+            value |= Bit(pos++) << k;
+        }
+        return true;
+    }
+
+    unsigned Bit(size_t index) const
+    {
+        return (data[index >> 3] >> (index & 7)) & 1;
+    }
+
+    size_t NumBits() const { return numBits; }
+
+    size_t pos;
+
+private:
+    const unsigned char *data;
+    const size_t numBits;
+};
+
+
+struct Huffman
+{
+    unsigned short count[16];       // number of codes of each length
+    unsigned short symbol[288];     // symbols ordered by their codes
+};
+
+
+static void BuildHuffman(Huffman &h, const unsigned char *length, int n)
+{
+    unsigned short offset[16];
+
+    memset(h.count, 0, sizeof(h.count));
+    for (int s = 0; s < n; ++s)
+        ++h.count[length[s]];
+
+    offset[1] = 0;
+    for (int len = 1; len < 15; ++len)
+        offset[len + 1] = offset[len] + h.count[len];
+
+    for (int s = 0; s < n; ++s)
+        if (length[s] != 0)
+            h.symbol[offset[length[s]]++] = s;
+}
+
+
+static int Decode(BitReader &in, const Huffman &h)
+{
+    // Huffman codes are packed starting with their most significant bit.
+    int code = 0;
+    int first = 0;
+    int index = 0;
+    for (int len = 1; len <= 15; ++len)
+    {
+        unsigned bit;
+        if (!in.Read(1, bit))
+            return -1;
+        code |= bit;
+        const int count = h.count[len];
+        if (code - count < first)
+            return h.symbol[index + (code - first)];
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+
+// Returns the canonical Huffman code for 'sym', given the code lengths of all n symbols.
+static unsigned CanonicalCode(const unsigned char *length, int n, int sym)
+{
+    unsigned count[16] = {0};
+    for (int s = 0; s < n; ++s)
+        if (length[s] != 0)
+            ++count[length[s]];
+
+    unsigned code = 0;
+    for (int len = 1; len < length[sym]; ++len)
+        code = (code + count[len]) << 1;
+
+    for (int s = 0; s < sym; ++s)
+        if (length[s] == length[sym])
+            ++code;
+
+    return code;
+}
+
+
+// Finds the bit offset of the final block's header in a raw deflate
+// stream, and the number of bits in the stream up to the end of that block.
+static bool ScanDeflate(const unsigned char *data, size_t size, size_t &finalHeaderBit, size_t &endBit)
+{
+    static const unsigned char LENGTH_EXTRA[29] =
+        { 0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2,3,3,3,3,4,4,4,4,5,5,5,5,0 };
+
+    static const unsigned char DIST_EXTRA[30] =
+        { 0,0,0,0,1,1,2,2,3,3,4,4,5,5,6,6,7,7,8,8,9,9,10,10,11,11,12,12,13,13 };
+
+    static const unsigned char ORDER[19] =
+        { 16,17,18,0,8,7,9,6,10,5,11,4,12,3,13,2,14,1,15 };
+
+    BitReader in(data, size);
+    Huffman lencode, distcode;
+    unsigned char length[288 + 32];
+    unsigned final, type, value;
+    int nlen, ndist;
+
+    for(;;)
+    {
+        const size_t headerBit = in.pos;
+        if (!in.Read(1, final) || !in.Read(2, type))
+            return false;
+
+        if (type == 0)
+        {
+            // A stored block: skip to a byte boundary, then over the bytes.
+            unsigned len, nlenCheck;
+            in.pos = (in.pos + 7) & ~(size_t)7;
+            if (!in.Read(16, len) || !in.Read(16, nlenCheck) || (len ^ 0xffff) != nlenCheck)
+                return false;
+            in.pos += 8 * (size_t)len;
+            if (in.pos > in.NumBits())
+                return false;
+        }
+        else
+        {
+            if (type == 1)
+            {
+                nlen = 288;
+                ndist = 30;
+                memset(length, 8, 144);
+                memset(length + 144, 9, 112);
+                memset(length + 256, 7, 24);
+                memset(length + 280, 8, 8);
+                memset(length + 288, 5, 30);
+            }
+            else if (type == 2)
+            {
+                unsigned hlit, hdist, hclen;
+                unsigned char clen[19] = {0};
+                Huffman clencode;
+
+                if (!in.Read(5, hlit) || !in.Read(5, hdist) || !in.Read(4, hclen))
+                    return false;
+                nlen = hlit + 257;
+                ndist = hdist + 1;
+                if (nlen > 286 || ndist > 30)
+                    return false;
+
+                for (unsigned k = 0; k < hclen + 4; ++k)
+                {
+                    if (!in.Read(3, value))
+                        return false;
+                    clen[ORDER[k]] = (unsigned char)value;
+                }
+                BuildHuffman(clencode, clen, 19);
+
+                int index = 0;
+                while (index < nlen + ndist)
+                {
+                    int sym = Decode(in, clencode);
+                    if (sym < 0)
+                        return false;
+                    if (sym < 16)
+                    {
+                        length[index++] = (unsigned char)sym;
+                        continue;
+                    }
+
+                    unsigned char repeated = 0;
+                    unsigned count;
+                    if (sym == 16)
+                    {
+                        if (index == 0 || !in.Read(2, count))
+                            return false;
+                        repeated = length[index - 1];
+                        count += 3;
+                    }
+                    else if (sym == 17)
+                    {
+                        if (!in.Read(3, count))
+                            return false;
+                        count += 3;
+                    }
+                    else
+                    {
+                        if (!in.Read(7, count))
+                            return false;
+                        count += 11;
+                    }
+
+                    if (index + (int)count > nlen + ndist)
+                        return false;
+                    while (count-- > 0)
+                        length[index++] = repeated;
+                }
+            }
+            else
+            {
+                return false;
+            }
+
+            if (final && type == 2 && length[256] != 0)
+            {
+                // Only zero padding follows the end-of-block code of the final block.
+                // Its code is packed most significant bit first, so its low-order
+                // zero bits come after the last 1 bit in the stream.
+                // If the code has no 1 bits, decode the block the slow way.
+                const unsigned eob = CanonicalCode(length, nlen, 256);
+                if (eob != 0)
+                {
+                    size_t last = in.NumBits();
+                    while (last > in.pos && !in.Bit(last - 1))
+                        --last;
+
+                    int trailingZeros = 0;
+                    while (!((eob >> trailingZeros) & 1))
+                        ++trailingZeros;
+
+                    finalHeaderBit = headerBit;
+                    endBit = last + trailingZeros;
+                    return endBit <= in.NumBits();
+                }
+            }
+
+            BuildHuffman(lencode, length, nlen);
+            BuildHuffman(distcode, length + nlen, ndist);
+            for(;;)
+            {
+                int sym = Decode(in, lencode);
+                if (sym < 0)
+                    return false;
+                if (sym < 256)
+                    continue;
+                if (sym == 256)
+                    break;
+                sym -= 257;
+                if (sym >= 29 || !in.Read(LENGTH_EXTRA[sym], value))
+                    return false;
+                sym = Decode(in, distcode);
+                if (sym < 0 || sym >= 30 || !in.Read(DIST_EXTRA[sym], value))
+                    return false;
+            }
+        }
+
+        if (final)
+        {
+            finalHeaderBit = headerBit;
+            endBit = in.pos;
+            return true;
+        }
+    }
+}
+
+
+//------------------------------------------------------------------------
+
+// Appends strings of bits to a byte buffer, least significant bit first,
+// the way deflate packs them.
+class BitWriter
+{
+public:
+    BitWriter()
+        : pending(0)
+        , pendingBits(0)
+    {
+    }
+
+    void Append(std::vector<unsigned char> &out, const unsigned char *data, size_t numBits)
+    {
+        const size_t numBytes = numBits / 8;
+        const unsigned rest = numBits % 8;
+
+        if (pendingBits == 0)
+        {
+            out.insert(out.end(), data, data + numBytes);
+        }
+        else
+        {
+            for (size_t i = 0; i < numBytes; ++i)
+            {
+                out.push_back((unsigned char)(pending | (data[i] << pendingBits)));
+                pending = data[i] >> (8 - pendingBits);
+            }
+        }
+
+        if (rest != 0)
+        {
+            pending |= (data[numBytes] & ((1u << rest) - 1)) << pendingBits;
+            pendingBits += rest;
+            if (pendingBits >= 8)
+            {
+                out.push_back((unsigned char)pending);
+                pending >>= 8;
+                pendingBits -= 8;
+            }
+        }
+    }
+
+    void Flush(std::vector<unsigned char> &out)
+    {
+        if (pendingBits > 0)
+            out.push_back((unsigned char)pending);
+        pending = 0;
+        pendingBits = 0;
+    }
+
+private:
+    unsigned pending;
+    unsigned pendingBits;
+};
+
+
+//------------------------------------------------------------------------
+
+struct ImageLayout
+{
+    const unsigned char *rgba;
+    unsigned width;
+    unsigned height;
+    unsigned bytesPerPixel;     // 3 for RGB, 4 for RGBA
+    size_t rowBytes;
+    PngFilter filter;
+    LodePNGCompressSettings settings;
+};
+
+
+struct Strip
+{
+    unsigned firstRow;
+    unsigned numRows;
+    size_t filteredSize;
+    unsigned adler;
+    std::vector<unsigned char> deflated;
+    size_t finalHeaderBit;
+    size_t endBit;
+    unsigned error;
+    bool done;
+};
+
+
+static void ReadRow(const ImageLayout &image, unsigned y, unsigned char *row)
+{
+    const unsigned char *source = image.rgba + 4 * (size_t)image.width * y;
+    if (image.bytesPerPixel == 4)
+    {
+        memcpy(row, source, image.rowBytes);
+    }
+    else
+    {
+        for (unsigned x = 0; x < image.width; ++x)
+        {
+            *row++ = source[0];
+            *row++ = source[1];
+            *row++ = source[2];
+            source += 4;
+        }
+    }
+}
+
+
+static unsigned char Paeth(int a, int b, int c)
+{
+    const int p = a + b - c;
+    const int pa = abs(p - a);
+    const int pb = abs(p - b);
+    const int pc = abs(p - c);
+    if (pa <= pb && pa <= pc)
+        return (unsigned char)a;
+    if (pb <= pc)
+        return (unsigned char)b;
+    return (unsigned char)c;
+}
+
+
+// Applies one of the 5 standard PNG filters to a row.
+// 'prev' is the unfiltered row above, or all zeros for the top row.
+// Writes the filter type byte followed by the filtered bytes.
+static void FilterRow(int type, const unsigned char *row, const unsigned char *prev, size_t rowBytes, unsigned bpp, unsigned char *out)
+{
+    *out++ = (unsigned char)type;
+    size_t i;
+    switch (type)
+    {
+    case PNG_FILTER_NONE:
+        memcpy(out, row, rowBytes);
+        break;
+
+    case PNG_FILTER_SUB:
+        for (i = 0; i < bpp; ++i)
+            out[i] = row[i];
+        for (; i < rowBytes; ++i)
+            out[i] = row[i] - row[i - bpp];
+        break;
+
+    case PNG_FILTER_UP:
+        for (i = 0; i < rowBytes; ++i)
+            out[i] = row[i] - prev[i];
+        break;
+
+    case PNG_FILTER_AVERAGE:
+        for (i = 0; i < bpp; ++i)
+            out[i] = row[i] - (prev[i] >> 1);
+        for (; i < rowBytes; ++i)
+            out[i] = row[i] - ((row[i - bpp] + prev[i]) >> 1);
+        break;
+
+    case PNG_FILTER_PAETH:
+        for (i = 0; i < bpp; ++i)
+            out[i] = row[i] - prev[i];
+        for (; i < rowBytes; ++i)
+            out[i] = row[i] - Paeth(row[i - bpp], prev[i], prev[i - bpp]);
+        break;
+    }
+}
+
+
+static void FilterStrip(const ImageLayout &image, const Strip &strip, std::vector<unsigned char> &filtered)
+{
+    const size_t rowBytes = image.rowBytes;
+    std::vector<unsigned char> row(rowBytes);
+    std::vector<unsigned char> prev(rowBytes, 0);
+    std::vector<unsigned char> trial;
+
+    if (strip.firstRow > 0)
+        ReadRow(image, strip.firstRow - 1, prev.data());
+
+    if (image.filter == PNG_FILTER_ADAPTIVE)
+        trial.resize(rowBytes + 1);
+
+    filtered.resize(strip.numRows * (rowBytes + 1));
+    for (unsigned r = 0; r < strip.numRows; ++r)
+    {
+        unsigned char *out = &filtered[r * (rowBytes + 1)];
+        ReadRow(image, strip.firstRow + r, row.data());
+        if (image.filter == PNG_FILTER_ADAPTIVE)
+        {
+            // Keep the filter whose output bytes are closest to zero,
+            // treating them as signed.  This is lodepng's default strategy.
+            unsigned long bestSum = 0;
+            for (int type = PNG_FILTER_NONE; type <= PNG_FILTER_PAETH; ++type)
+            {
+                FilterRow(type, row.data(), prev.data(), rowBytes, image.bytesPerPixel, trial.data());
+                unsigned long sum = 0;
+                for (size_t i = 1; i <= rowBytes; ++i)
+                    sum += (trial[i] < 128) ? trial[i] : (256 - trial[i]);
+                if (type == PNG_FILTER_NONE || sum < bestSum)
+                {
+                    bestSum = sum;
+                    memcpy(out, trial.data(), rowBytes + 1);
+                }
+            }
+        }
+        else
+        {
+            FilterRow(image.filter, row.data(), prev.data(), rowBytes, image.bytesPerPixel, out);
+        }
+        row.swap(prev);
+    }
+}
+
+
+static void DeflateStrip(const ImageLayout &image, Strip &strip)
+{
+    std::vector<unsigned char> filtered;
+    FilterStrip(image, strip, filtered);
+    strip.filteredSize = filtered.size();
+    strip.adler = Adler32(filtered.data(), filtered.size());
+
+    unsigned char *out = nullptr;
+    size_t outSize = 0;
+    strip.error = lodepng_deflate(&out, &outSize, filtered.data(), filtered.size(), &image.settings);
+    if (strip.error == 0)
+    {
+        strip.deflated.assign(out, out + outSize);
+        if (!ScanDeflate(out, outSize, strip.finalHeaderBit, strip.endBit))
+            strip.error = PNGWRITER_ERROR_DEFLATE_SCAN;
+    }
+    free(out);
+}
+
+
+static void AppendBigEndian(std::vector<unsigned char> &out, unsigned value)
+{
+    out.push_back((unsigned char)(value >> 24));
+    out.push_back((unsigned char)(value >> 16));
+    out.push_back((unsigned char)(value >> 8));
+    out.push_back((unsigned char)value);
+}
+
+
+// Writes a chunk whose first 4 bytes in 'typeAndData' are the chunk type.
+static bool WriteChunk(FILE *outfile, const std::vector<unsigned char> &typeAndData)
+{
+    std::vector<unsigned char> length;
+    std::vector<unsigned char> crc;
+    AppendBigEndian(length, (unsigned)(typeAndData.size() - 4));
+    AppendBigEndian(crc, lodepng_crc32(typeAndData.data(), typeAndData.size()));
+    return
+        fwrite(length.data(), 1, 4, outfile) == 4 &&
+        fwrite(typeAndData.data(), 1, typeAndData.size(), outfile) == typeAndData.size() &&
+        fwrite(crc.data(), 1, 4, outfile) == 4;
+}
+
+
+static void StartChunk(std::vector<unsigned char> &chunk, const char *type)
+{
+    chunk.assign(type, type + 4);
+}
+
+
+static unsigned WriteStrips(FILE *outfile, ImageLayout &image, size_t numThreads, unsigned char zlibLevelFlag)
+{
+    static const unsigned char SIGNATURE[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+    if (fwrite(SIGNATURE, 1, 8, outfile) != 8)
+        return PNGWRITER_ERROR_FILE_WRITE;
+
+    std::vector<unsigned char> chunk;
+    StartChunk(chunk, "IHDR");
+    AppendBigEndian(chunk, image.width);
+    AppendBigEndian(chunk, image.height);
+    chunk.push_back(8);                                     // bit depth
+    chunk.push_back(image.bytesPerPixel == 4 ? 6 : 2);      // color type RGBA or RGB
+    chunk.push_back(0);                                     // compression method
+    chunk.push_back(0);                                     // filter method
+    chunk.push_back(0);                                     // no interlace
+    if (!WriteChunk(outfile, chunk))
+        return PNGWRITER_ERROR_FILE_WRITE;
+
+    const size_t rowsPerStrip = std::max((size_t)1, MAX_STRIP_BYTES / (image.rowBytes + 1));
+    const size_t numStrips = (image.height + rowsPerStrip - 1) / rowsPerStrip;
+    std::vector<Strip> strips(numStrips);
+    for (size_t k = 0; k < numStrips; ++k)
+    {
+        strips[k].firstRow = (unsigned)(k * rowsPerStrip);
+        strips[k].numRows = (unsigned)std::min(rowsPerStrip, image.height - k * rowsPerStrip);
+        strips[k].error = 0;
+        strips[k].done = false;
+    }
+
+    // Worker threads deflate strips in any order, while this thread
+    // joins them into IDAT chunks in order, as soon as each is ready.
+    std::atomic<size_t> nextStrip(0);
+    std::mutex mutex;
+    std::condition_variable stripDone;
+
+    auto worker = [&]()
+    {
+        for(;;)
+        {
+            const size_t k = nextStrip.fetch_add(1);
+            if (k >= numStrips)
+                break;
+            DeflateStrip(image, strips[k]);
+            std::lock_guard<std::mutex> lock(mutex);
+            strips[k].done = true;
+            stripDone.notify_all();
+        }
+    };
+
+    if (numThreads == 0)
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    if (numThreads > numStrips)
+        numThreads = numStrips;
+
+    std::vector<std::thread> pool;
+    if (numThreads > 1)
+        for (size_t t = 0; t < numThreads; ++t)
+            pool.push_back(std::thread(worker));
+
+    unsigned error = 0;
+    unsigned adler = 1;
+    BitWriter bits;
+    StartChunk(chunk, "IDAT");
+    chunk.push_back(0x78);      // deflate with a 32K window
+    chunk.push_back(zlibLevelFlag);
+    for (size_t k = 0; k < numStrips; ++k)
+    {
+        Strip &strip = strips[k];
+        if (pool.empty())
+        {
+            DeflateStrip(image, strip);
+        }
+        else
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            stripDone.wait(lock, [&strip]() { return strip.done; });
+        }
+
+        if (error == 0)
+            error = strip.error;
+
+        if (error == 0)
+        {
+            if (k + 1 < numStrips)
+                strip.deflated[strip.finalHeaderBit / 8] &= ~(1 << (strip.finalHeaderBit % 8));
+
+            bits.Append(chunk, strip.deflated.data(), strip.endBit);
+            adler = (k == 0) ? strip.adler : Adler32Combine(adler, strip.adler, strip.filteredSize);
+            if (k + 1 == numStrips)
+            {
+                bits.Flush(chunk);
+                AppendBigEndian(chunk, adler);
+            }
+
+            if (!WriteChunk(outfile, chunk))
+                error = PNGWRITER_ERROR_FILE_WRITE;
+            StartChunk(chunk, "IDAT");
+        }
+
+        // Release the memory of each strip once it has been written.
+        std::vector<unsigned char>().swap(strip.deflated);
+    }
+
+    for (std::thread &t : pool)
+        t.join();
+
+    if (error == 0)
+    {
+        StartChunk(chunk, "IEND");
+        if (!WriteChunk(outfile, chunk))
+            error = PNGWRITER_ERROR_FILE_WRITE;
+    }
+
+    return error;
+}
+
+
+unsigned WritePngFile(
+    const char *filename,
+    const unsigned char *rgba,
+    unsigned pixelsWide,
+    unsigned pixelsHigh,
+    const PngOptions &options)
+{
+    if (options.effort == PNG_EFFORT_LODEPNG)
+        return lodepng::encode(filename, rgba, pixelsWide, pixelsHigh);
+
+    if (pixelsWide == 0 || pixelsHigh == 0)
+        return 93;      // lodepng: zero width or height is invalid
+
+    ImageLayout image;
+    image.rgba = rgba;
+    image.width = pixelsWide;
+    image.height = pixelsHigh;
+
+    // Drop the alpha channel if every pixel is opaque.
+    image.bytesPerPixel = 3;
+    const size_t numPixels = (size_t)pixelsWide * pixelsHigh;
+    for (size_t i = 0; i < numPixels; ++i)
+    {
+        if (rgba[4*i + 3] != 255)
+        {
+            image.bytesPerPixel = 4;
+            break;
+        }
+    }
+    image.rowBytes = (size_t)pixelsWide * image.bytesPerPixel;
+
+    lodepng_compress_settings_init(&image.settings);
+    unsigned char zlibLevelFlag;
+    PngFilter autoFilter;
+    switch (options.effort)
+    {
+    case PNG_EFFORT_STORE:
+        image.settings.btype = 0;
+        autoFilter = PNG_FILTER_NONE;
+        zlibLevelFlag = 0x01;
+        break;
+
+    case PNG_EFFORT_FAST:
+        image.settings.windowsize = 1024;
+        image.settings.nicematch = 32;
+        image.settings.lazymatching = 0;
+        autoFilter = PNG_FILTER_UP;
+        zlibLevelFlag = 0x5e;
+        break;
+
+    case PNG_EFFORT_BEST:
+        image.settings.windowsize = 32768;
+        image.settings.nicematch = 258;
+        autoFilter = PNG_FILTER_ADAPTIVE;
+        zlibLevelFlag = 0xda;
+        break;
+
+    default:
+        autoFilter = PNG_FILTER_ADAPTIVE;
+        zlibLevelFlag = 0x9c;
+        break;
+    }
+    image.filter = (options.filter == PNG_FILTER_AUTO) ? autoFilter : options.filter;
+
+    FILE *outfile = fopen(filename, "wb");
+    if (outfile == nullptr)
+        return 79;      // lodepng: failed to open file for writing
+
+    unsigned error = WriteStrips(outfile, image, options.numThreads, zlibLevelFlag);
+    if (fclose(outfile) != 0 && error == 0)
+        error = PNGWRITER_ERROR_FILE_WRITE;
+    return error;
+}
+
+
+const char *PngErrorText(unsigned error)
+{
+    switch (error)
+    {
+    case PNGWRITER_ERROR_DEFLATE_SCAN:
+        return "could not find the end of a deflate strip";
+
+    case PNGWRITER_ERROR_FILE_WRITE:
+        return "failed to write the PNG file";
+
+    default:
+        return lodepng_error_text(error);
+    }
+}
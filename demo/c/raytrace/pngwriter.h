@@ -0,0 +1,70 @@
+/*
+    pngwriter.h  -  Configurable PNG output for the C++ demo programs.
+    https://github.com/cosinekitty/astronomy
+
+    By default, images are encoded by lodepng::encode, exactly as before.
+    The other effort levels filter and deflate horizontal strips of the
+    image in parallel and write them straight to the file, so that
+    large images need no full-size copies of their pixels.
+*/
+
+#ifndef __DDC_PNGWRITER_H
+#define __DDC_PNGWRITER_H
+
+#include <cstddef>
+
+// How much work the PNG writer does to make the file smaller.
+enum PngEffort
+{
+    PNG_EFFORT_LODEPNG = -1,    // lodepng::encode with its default settings
+    PNG_EFFORT_STORE   =  0,    // no compression: fastest, but very large files
+    PNG_EFFORT_FAST    =  1,    // short match searches and a fixed filter
+    PNG_EFFORT_NORMAL  =  2,    // lodepng's default deflate settings, in parallel
+    PNG_EFFORT_BEST    =  3,    // the full 32K window and the longest matches
+};
+
+// The filter applied to each row of pixels before deflate.
+// The values 0..4 are the filter types defined by the PNG standard.
+enum PngFilter
+{
+    PNG_FILTER_AUTO     = -1,   // pick the filter that suits the effort level
+    PNG_FILTER_NONE     =  0,
+    PNG_FILTER_SUB      =  1,
+    PNG_FILTER_UP       =  2,
+    PNG_FILTER_AVERAGE  =  3,
+    PNG_FILTER_PAETH    =  4,
+    PNG_FILTER_ADAPTIVE =  5,   // try all 5 filters on each row and keep the best one
+};
+
+struct PngOptions
+{
+    PngEffort effort;
+    PngFilter filter;
+
+    // The number of threads that deflate strips of the image,
+    // or 0 for one per hardware thread.  The file is the same
+    // no matter how many threads are used.
+    size_t numThreads;
+
+    PngOptions()
+        : effort(PNG_EFFORT_LODEPNG)
+        , filter(PNG_FILTER_AUTO)
+        , numThreads(1)
+    {
+    }
+};
+
+// Writes an image given as 4 bytes (red, green, blue, alpha) per pixel,
+// row by row, to a PNG file.  If every alpha value is 255,
+// the file stores only red, green, and blue.
+// Returns 0 on success, or an error code that PngErrorText describes.
+unsigned WritePngFile(
+    const char *filename,
+    const unsigned char *rgba,
+    unsigned pixelsWide,
+    unsigned pixelsHigh,
+    const PngOptions &options = PngOptions());
+
+const char *PngErrorText(unsigned error);
+
+#endif // __DDC_PNGWRITER_H
@@ -44,8 +44,9 @@ namespace Imager
             // of times we enter and exit this solid.
             const Vector direction(0.0, 0.0, 1.0);
 
-            enclosureList.clear();
-            AppendAllIntersections(point, direction, enclosureList);
+            ScratchIntersectionList scratch;
+            const IntersectionList& enclosureList = scratch.List();
+            AppendAllIntersections(point, direction, scratch.List());
 
             int enterCount = 0;     // number of times we enter the solid
             int exitCount  = 0;     // number of times we exit the solid
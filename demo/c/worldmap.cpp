@@ -10,16 +10,21 @@
 */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
 #include <vector>
 #include "astro_demo_common.h"
-#include "lodepng.h"
+#include "pngwriter.h"
 
 static const char UsageText[] =
 "\n"
 "USAGE:\n"
 "\n"
-"worldmap outfile.png [yyyy-mm-ddThh:mm:ssZ]\n"
+"worldmap [-t threads] [-p effort] outfile.png [yyyy-mm-ddThh:mm:ssZ]\n"
 "\n"
 "Draws a Mercator projection of the Earth showing areas\n"
 "where the Sun or Moon are visible. Writes the result to\n"
@@ -27,6 +32,15 @@ static const char UsageText[] =
 "\n"
 "If the observation time is not specified on the command line,\n"
 "this program uses the computer's current date and time.\n"
+"\n"
+"The -t option selects how many threads render the image.\n"
+"The default is 1. Use -t 0 to use one thread per CPU core.\n"
+"The image is identical no matter how many threads are used.\n"
+"\n"
+"The -p option selects how hard the PNG encoder works to compress\n"
+"the image: 0 = none, 1 = fast, 2 = normal, 3 = best.  These levels\n"
+"encode strips of the image in parallel, using the -t thread count.\n"
+"By default, the standard single-threaded lodepng encoder is used.\n"
 "\n";
 
 typedef unsigned char   byte;
@@ -74,7 +88,10 @@ const int MaxLongitude = +180;
 const int PixelsWide = (MaxLongitude - MinLongitude) * PixelsPerDegree;
 const int PixelsHigh = (MaxLatitude - MinLatitude) * PixelsPerDegree;
 
-int Render(Image &image, astro_time_t time);
+// Each tile is a horizontal band of this many pixel rows.
+const int TileRows = 16;
+
+int Render(Image &image, astro_time_t time, int numThreads);
 
 
 int main(int argc, const char *argv[])
@@ -82,6 +99,45 @@ int main(int argc, const char *argv[])
     const char *outFileName;
     const char *timeString;
     astro_time_t time;
+    int numThreads = 1;
+
+    // Parse the optional thread count.
+    if (argc >= 3 && !strcmp(argv[1], "-t"))
+    {
+        char *end;
+        long n = strtol(argv[2], &end, 10);
+        if (*end != '\0' || n < 0 || n > 1024)
+        {
+            fprintf(stderr, "ERROR: invalid thread count '%s'\n", argv[2]);
+            return 1;
+        }
+        numThreads = (int)n;
+        if (numThreads == 0)
+        {
+            numThreads = (int)std::thread::hardware_concurrency();
+            if (numThreads < 1)
+                numThreads = 1;
+        }
+        argc -= 2;
+        argv += 2;
+    }
+
+    // Parse the optional PNG compression effort.
+    PngOptions pngOptions;
+    if (argc >= 3 && !strcmp(argv[1], "-p"))
+    {
+        char *end;
+        long n = strtol(argv[2], &end, 10);
+        if (*end != '\0' || n < PNG_EFFORT_STORE || n > PNG_EFFORT_BEST)
+        {
+            fprintf(stderr, "ERROR: invalid PNG compression effort '%s'\n", argv[2]);
+            return 1;
+        }
+        pngOptions.effort = (PngEffort)n;
+        argc -= 2;
+        argv += 2;
+    }
+    pngOptions.numThreads = (size_t)numThreads;
 
     // Parse the command line parameters.
     switch (argc)
@@ -107,15 +163,15 @@ int main(int argc, const char *argv[])
 
     // Create a world map image in memory for the given time.
     Image image(PixelsWide, PixelsHigh);
-    if (0 != Render(image, time))
+    if (0 != Render(image, time, numThreads))
         return 1;
 
     // Write the memory image to a PNG file.
     const unsigned char *firstBytePtr = &image.pixel(0, 0).red;
-    unsigned error = lodepng::encode(outFileName, firstBytePtr, PixelsWide, PixelsHigh);
+    unsigned error = WritePngFile(outFileName, firstBytePtr, PixelsWide, PixelsHigh, pngOptions);
     if (error != 0)
     {
-        fprintf(stderr, "FATAL: lodepng::encode returned %u\n", error);
+        fprintf(stderr, "FATAL: WritePngFile returned %u: %s\n", error, PngErrorText(error));
         return 1;
     }
 
@@ -175,12 +231,78 @@ void PrintZenithPoint(const char *name, astro_vector_t geovec)
 }
 
 
-int Render(Image &image, astro_time_t time)
+struct SharedScene
+{
+    astro_time_t    time;           // observation time, with sidereal time already cached
+    astro_vector_t  geo_sun_eqd;
+    astro_vector_t  geo_moon_eqd;
+    std::vector<double> longitude;  // one per pixel column
+};
+
+
+int RenderTile(Image &image, const SharedScene &scene, int firstRow, int numRows)
+{
+    // Each thread needs its own copy of the time, because
+    // Astronomy Engine caches values inside astro_time_t.
+    astro_time_t time = scene.time;
+
+    const int ncols = (int)scene.longitude.size();
+    std::vector<double> latitude(numRows);
+    std::vector<astro_vector_t> ovec(numRows * ncols);
+    std::vector<astro_rotation_t> rot(numRows * ncols);
+
+    for (int r = 0; r < numRows; ++r)
+        latitude[r] = ((PixelsHigh - (firstRow + r + 1)) / (double)PixelsPerDegree) + MinLatitude;
+
+    // Calculate the observer vectors and horizontal rotation matrices
+    // for all the pixels in this tile with a single call.
+    astro_status_t status = Astronomy_ObserverGrid(
+        &time,
+        latitude.data(), latitude.size(),
+        scene.longitude.data(), scene.longitude.size(),
+        0.0, EQUATOR_OF_DATE,
+        ovec.data(), rot.data());
+
+    if (status != ASTRO_SUCCESS)
+    {
+        fprintf(stderr, "ERROR: Astronomy_ObserverGrid returned %d\n", status);
+        return 1;
+    }
+
+    for (int r = 0; r < numRows; ++r)
+    {
+        for (int i = 0; i < ncols; ++i)
+        {
+            int k = r*ncols + i;
+            astro_vector_t sun  = scene.geo_sun_eqd;
+            astro_vector_t moon = scene.geo_moon_eqd;
+
+            // Use the rotation matrix and observer vector to calculate
+            // a vertical component value in the range -1.0 .. +1.0.
+            // This number tells whether the Sun/Moon are above that observer's
+            // horizon, and if so, how high it appears in the sky.
+            double sunVert  = VerticalComponent(rot[k], ovec[k], sun);
+            double moonVert = VerticalComponent(rot[k], ovec[k], moon);
+
+            // Add yellow for sunlight intensity for this pixel.
+            ColorPixel(image.pixel(i, firstRow + r), sunVert,  1.0, 1.0, 0.0);
+
+            // Add blue for moonlight intensity for this pixel.
+            ColorPixel(image.pixel(i, firstRow + r), moonVert, 0.0, 0.0, 0.5);
+        }
+    }
+
+    return 0;
+}
+
+
+int Render(Image &image, astro_time_t time, int numThreads)
 {
     // To minimize the work for each pixel, we calculate the
     // geocentric positions of the Sun and Moon only once.
     // We convert them to equator-of-date coordinates (EQD)
     // to make it very easy to find an altitude angle for each pixel.
+    // All threads share these values read-only.
 
     // We do not need aberration correction for the Sun,
     // because 22 arcseconds is too small to notice on a map.
@@ -190,46 +312,56 @@ int Render(Image &image, astro_time_t time)
 
     // Align the Sun/Moon vectors with the Earth's axis at the time of observation.
     astro_rotation_t rot = Astronomy_Rotation_EQJ_EQD(&time);
-    astro_vector_t geo_sun_eqd  = Astronomy_RotateVector(rot, geo_sun_eqj);
-    astro_vector_t geo_moon_eqd = Astronomy_RotateVector(rot, geo_moon_eqj);
+
+    SharedScene scene;
+    scene.geo_sun_eqd  = Astronomy_RotateVector(rot, geo_sun_eqj);
+    scene.geo_moon_eqd = Astronomy_RotateVector(rot, geo_moon_eqj);
 
     // Just for fun, find the geographic locations where the Sun/Moon
     // appear directly overhead (at the zenith = straight up).
-    PrintZenithPoint("Sun",  geo_sun_eqd);
-    PrintZenithPoint("Moon", geo_moon_eqd);
-
-    astro_observer_t observer;
-    observer.height = 0.0;
+    PrintZenithPoint("Sun",  scene.geo_sun_eqd);
+    PrintZenithPoint("Moon", scene.geo_moon_eqd);
 
-    for (int i = 0; i < PixelsWide; ++i)
-    {
-        observer.longitude = (i / (double)PixelsPerDegree) + MinLongitude;
-        for (int j = 0; j < PixelsHigh; ++j)
-        {
-            observer.latitude = ((PixelsHigh - (j + 1)) / (double)PixelsPerDegree) + MinLatitude;
+    // Cache sidereal time before sharing the time with the threads.
+    Astronomy_SiderealTime(&time);
+    scene.time = time;
 
-            // Calculate a vector from the center of the Earth to the observer's
-            // geographic location that corresponds to this pixel.
-            astro_vector_t ovec = Astronomy_ObserverVector(&time, observer, EQUATOR_OF_DATE);
+    scene.longitude.resize(image.width);
+    for (int i = 0; i < image.width; ++i)
+        scene.longitude[i] = (i / (double)PixelsPerDegree) + MinLongitude;
 
-            // Create a rotation matrix that converts equator-of-date vectors
-            // into horizontal vectors for this pixel's location on the Earth.
-            astro_rotation_t rot = Astronomy_Rotation_EQD_HOR(&time, observer);
+    // Threads take the next unrendered tile from a shared counter
+    // until there are none left, so faster threads do more of the work.
+    const int numTiles = (image.height + TileRows - 1) / TileRows;
+    std::atomic<int> nextTile(0);
+    std::atomic<int> failures(0);
 
-            // Use the rotation matrix and observer vector to calculate
-            // a vertical component value in the range -1.0 .. +1.0.
-            // This number tells whether the Sun/Moon are above that observer's
-            // horizon, and if so, how high it appears in the sky.
-            double sunVert  = VerticalComponent(rot, ovec, geo_sun_eqd);
-            double moonVert = VerticalComponent(rot, ovec, geo_moon_eqd);
-
-            // Add yellow for sunlight intensity for this pixel.
-            ColorPixel(image.pixel(i, j), sunVert,  1.0, 1.0, 0.0);
-
-            // Add blue for moonlight intensity for this pixel.
-            ColorPixel(image.pixel(i, j), moonVert, 0.0, 0.0, 0.5);
+    auto worker = [&]()
+    {
+        for(;;)
+        {
+            int tile = nextTile.fetch_add(1);
+            if (tile >= numTiles)
+                break;
+            int firstRow = tile * TileRows;
+            int numRows = std::min(TileRows, image.height - firstRow);
+            if (0 != RenderTile(image, scene, firstRow, numRows))
+                failures.fetch_add(1);
         }
+    };
+
+    if (numThreads <= 1)
+    {
+        worker();
+    }
+    else
+    {
+        std::vector<std::thread> pool;
+        for (int t = 0; t < numThreads; ++t)
+            pool.push_back(std::thread(worker));
+        for (std::thread &t : pool)
+            t.join();
     }
 
-    return 0;
+    return (failures.load() == 0) ? 0 : 1;
 }
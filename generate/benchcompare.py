@@ -0,0 +1,44 @@
+#!/usr/bin/env python3
+#
+#   benchcompare.py  -  Don Cross <cosinekitty@gmail.com>
+#
+#   Compares two JSON result files written by 'benchmark -o'.
+#   Prints the change in median latency for each benchmark found in both files,
+#   and exits with status 1 if any benchmark became slower than the threshold.
+#
+import sys
+import json
+
+def Load(filename):
+    with open(filename, 'rt') as infile:
+        data = json.load(infile)
+    return data, {b['name']: b for b in data['benchmarks']}
+
+def Compare(oldFileName, newFileName, threshold):
+    oldData, oldBench = Load(oldFileName)
+    newData, newBench = Load(newFileName)
+    print('{:<24s} {:>12s} {:>12s} {:>8s}'.format('benchmark', 'old p50 ns', 'new p50 ns', 'change'))
+    regressions = 0
+    for name, new in newBench.items():
+        old = oldBench.get(name)
+        if old is None:
+            print('{:<24s} {:>12s} {:>12.4g}'.format(name, '-', new['latency_ns']['p50']))
+            continue
+        oldLatency = old['latency_ns']['p50']
+        newLatency = new['latency_ns']['p50']
+        change = (newLatency - oldLatency) / oldLatency
+        flag = ''
+        if change > threshold:
+            flag = '  REGRESSION'
+            regressions += 1
+        print('{:<24s} {:>12.4g} {:>12.4g} {:>+7.1f}%{}'.format(name, oldLatency, newLatency, 100.0*change, flag))
+    print('old version {}, new version {}: {} regression(s) over {:.0f}%.'.format(
+        oldData.get('version'), newData.get('version'), regressions, 100.0*threshold))
+    return 1 if regressions > 0 else 0
+
+if __name__ == '__main__':
+    if len(sys.argv) not in [3, 4]:
+        print('USAGE: benchcompare.py old.json new.json [threshold_percent]')
+        sys.exit(1)
+    threshold = float(sys.argv[3]) / 100.0 if len(sys.argv) == 4 else 0.10
+    sys.exit(Compare(sys.argv[1], sys.argv[2], threshold))
@@ -0,0 +1,479 @@
+/*
+    benchmark.c  -  Don Cross <cosinekitty@gmail.com>
+
+    Performance benchmarks for the C version of Astronomy Engine.
+    https://github.com/cosinekitty/astronomy
+
+    Each benchmark calls one kind of Astronomy Engine function over and over,
+    with inputs that change from call to call. The harness warms up each
+    benchmark, then times a series of batches of calls, and reports
+    calls per second and percentiles of the average latency per call
+    within each batch. Run "benchbuild" to build this program.
+
+    The -o option writes the results as JSON. Two JSON files can be
+    compared with benchcompare.py to find regressions between versions.
+*/
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 199309L
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "astronomy.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#ifndef BENCH_VERSION
+#define BENCH_VERSION   "unknown"
+#endif
+
+#define DEFAULT_REPETITIONS     200         /* number of timed batches per benchmark */
+#define DEFAULT_WARMUP_SECONDS  0.2         /* untimed calls before the timed batches */
+#define MAX_BENCH_SECONDS       3.0         /* stop early when a benchmark takes longer than this */
+#define MIN_BATCH_SECONDS       50.0e-6     /* batch enough calls to make timer overhead negligible */
+#define MAX_BATCH_CALLS         100000
+
+static double Now(void)
+{
+    /* Returns a monotonic clock reading in seconds. */
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER count;
+    if (freq.QuadPart == 0)
+        QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (double)count.QuadPart / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + 1.0e-9 * (double)ts.tv_nsec;
+#endif
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+/*
+    Benchmark bodies. Each call function performs one operation for the given call index
+    and returns 0 on success. The index makes the inputs different on every call,
+    so that results cached by Astronomy Engine do not make the benchmark meaningless.
+*/
+
+static astro_time_t IndexTime(int index, double stepDays, int period)
+{
+    /* A time that moves forward from the year 2000 by stepDays per call, wrapping every `period` calls. */
+    return Astronomy_TimeFromDays(stepDays * (index % period));
+}
+
+static double Fraction(int index, unsigned salt)
+{
+    /* Returns a pseudo-random number in [0, 1) that depends only on `index` and `salt`. */
+    unsigned x = (unsigned)index * 2654435761u + salt * 40503u;
+    x ^= x >> 15;
+    x *= 2246822519u;
+    x ^= x >> 13;
+    return (x & 0xffffff) / 16777216.0;
+}
+
+static int Bench_TimeMake(int index)
+{
+    astro_time_t time = Astronomy_MakeTime(1900 + index % 300, 1 + index % 12, 1 + index % 28, index % 24, index % 60, 0.5);
+    return (time.tt == 0.0) ? 1 : 0;
+}
+
+static int Bench_TimeUtc(int index)
+{
+    astro_utc_t utc = Astronomy_UtcFromTime(IndexTime(index, 3.7, 30000));
+    return (utc.year < 1900 || utc.year > 2400) ? 1 : 0;
+}
+
+static int Bench_VsopEarth(int index)
+{
+    return Astronomy_HelioVector(BODY_EARTH, IndexTime(index, 0.37, 100000)).status;
+}
+
+static int Bench_VsopJupiter(int index)
+{
+    return Astronomy_HelioVector(BODY_JUPITER, IndexTime(index, 0.37, 100000)).status;
+}
+
+static int Bench_Moon(int index)
+{
+    return Astronomy_GeoMoon(IndexTime(index, 0.037, 1000000)).status;
+}
+
+static int Bench_Pluto(int index)
+{
+    return Astronomy_HelioVector(BODY_PLUTO, IndexTime(index, 0.37, 100000)).status;
+}
+
+static int Bench_SearchMoonPhase(int index)
+{
+    return Astronomy_SearchMoonPhase(90.0 * (index % 4), IndexTime(index, 7.3, 5000), 40.0).status;
+}
+
+static int Bench_SearchSunLongitude(int index)
+{
+    /* Aim a few days past the start, using the Sun's mean longitude, so the search window brackets one solution. */
+    astro_time_t time = IndexTime(index, 31.0, 1000);
+    double target = fmod(280.46 + 0.9856474*time.tt + 5.0, 360.0);
+    return Astronomy_SearchSunLongitude(target, time, 20.0).status;
+}
+
+static int Bench_RiseSet(int index)
+{
+    astro_observer_t observer;
+    observer.latitude = 120.0*Fraction(index, 1) - 60.0;
+    observer.longitude = 360.0*Fraction(index, 2) - 180.0;
+    observer.height = 0.0;
+    return Astronomy_SearchRiseSet(BODY_SUN, observer, DIRECTION_RISE, IndexTime(index, 1.1, 30000), 2.0).status;
+}
+
+static int Bench_MoonRiseSet(int index)
+{
+    astro_observer_t observer;
+    observer.latitude = 120.0*Fraction(index, 3) - 60.0;
+    observer.longitude = 360.0*Fraction(index, 4) - 180.0;
+    observer.height = 0.0;
+    return Astronomy_SearchRiseSet(BODY_MOON, observer, DIRECTION_SET, IndexTime(index, 1.1, 30000), 2.0).status;
+}
+
+static int Bench_LunarEclipse(int index)
+{
+    return Astronomy_SearchLunarEclipse(IndexTime(index, 53.0, 1000)).status;
+}
+
+static int Bench_GlobalSolarEclipse(int index)
+{
+    return Astronomy_SearchGlobalSolarEclipse(IndexTime(index, 53.0, 1000)).status;
+}
+
+static int Bench_LocalSolarEclipse(int index)
+{
+    astro_observer_t observer;
+    observer.latitude = 120.0*Fraction(index, 5) - 60.0;
+    observer.longitude = 360.0*Fraction(index, 6) - 180.0;
+    observer.height = 0.0;
+    return Astronomy_SearchLocalSolarEclipse(IndexTime(index, 53.0, 1000), observer).status;
+}
+
+static int Bench_Constellation(int index)
+{
+    double ra = 24.0 * Fraction(index, 7);
+    double dec = asin(2.0*Fraction(index, 8) - 1.0) * (180.0 / 3.14159265358979323846);
+    return Astronomy_Constellation(ra, dec).status;
+}
+
+#define GRAVSIM_BODIES  5
+static astro_grav_sim_t *BenchSim;
+static astro_time_t BenchSimTime;
+
+static int Setup_GravSim(void)
+{
+    astro_state_vector_t state[GRAVSIM_BODIES];
+    astro_time_t time = Astronomy_MakeTime(2000, 1, 1, 0, 0, 0.0);
+    int i;
+
+    /* Small bodies on orbits near the asteroid belt, with a little eccentricity. */
+    for (i = 0; i < GRAVSIM_BODIES; ++i)
+    {
+        double r = 2.2 + 0.2*i;
+        double speed = 1.05 * sqrt(2.959122082855911e-4 / r);
+        double angle = 1.3 * i;
+        state[i].status = ASTRO_SUCCESS;
+        state[i].t = time;
+        state[i].x = r * cos(angle);
+        state[i].y = r * sin(angle);
+        state[i].z = 0.01 * i;
+        state[i].vx = -speed * sin(angle);
+        state[i].vy = +speed * cos(angle);
+        state[i].vz = 0.0;
+    }
+
+    BenchSimTime = time;
+    return Astronomy_GravSimInit(&BenchSim, BODY_SUN, time, GRAVSIM_BODIES, state);
+}
+
+static int Bench_GravSim(int index)
+{
+    astro_state_vector_t state[GRAVSIM_BODIES];
+    (void)index;
+    BenchSimTime = Astronomy_AddDays(BenchSimTime, 1.0);
+    return Astronomy_GravSimUpdate(BenchSim, BenchSimTime, GRAVSIM_BODIES, state);
+}
+
+static void Teardown_GravSim(void)
+{
+    Astronomy_GravSimFree(BenchSim);
+    BenchSim = NULL;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+typedef struct
+{
+    const char *name;
+    int (*setup)(void);
+    int (*call)(int index);
+    void (*teardown)(void);
+}
+bench_t;
+
+static const bench_t BenchTable[] =
+{
+    {"time_make",               NULL,           Bench_TimeMake,             NULL},
+    {"time_utc",                NULL,           Bench_TimeUtc,              NULL},
+    {"vsop_earth",              NULL,           Bench_VsopEarth,            NULL},
+    {"vsop_jupiter",            NULL,           Bench_VsopJupiter,          NULL},
+    {"moon",                    NULL,           Bench_Moon,                 NULL},
+    {"pluto",                   NULL,           Bench_Pluto,                NULL},
+    {"search_moon_phase",       NULL,           Bench_SearchMoonPhase,      NULL},
+    {"search_sun_longitude",    NULL,           Bench_SearchSunLongitude,   NULL},
+    {"rise_set_sun",            NULL,           Bench_RiseSet,              NULL},
+    {"rise_set_moon",           NULL,           Bench_MoonRiseSet,          NULL},
+    {"eclipse_lunar",           NULL,           Bench_LunarEclipse,         NULL},
+    {"eclipse_global_solar",    NULL,           Bench_GlobalSolarEclipse,   NULL},
+    {"eclipse_local_solar",     NULL,           Bench_LocalSolarEclipse,    NULL},
+    {"constellation",           NULL,           Bench_Constellation,        NULL},
+    {"gravsim",                 Setup_GravSim,  Bench_GravSim,              Teardown_GravSim},
+};
+
+#define NUM_BENCHMARKS  ((int)(sizeof(BenchTable) / sizeof(BenchTable[0])))
+
+typedef struct
+{
+    int     calls;
+    int     batch;
+    int     repetitions;
+    double  seconds;
+    double  min, p50, p90, p99, max;    /* latency per call in nanoseconds */
+}
+bench_result_t;
+
+static int CompareDouble(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x < y) ? -1 : (x > y) ? +1 : 0;
+}
+
+static double Percentile(const double *sorted, int n, double p)
+{
+    /* Nearest-rank percentile of an ascending array. */
+    int k = (int)ceil(p/100.0 * n) - 1;
+    if (k < 0)
+        k = 0;
+    if (k >= n)
+        k = n - 1;
+    return sorted[k];
+}
+
+static int RunBatch(const bench_t *bench, int *index, int count)
+{
+    int i, status;
+    for (i = 0; i < count; ++i)
+    {
+        status = bench->call((*index)++);
+        if (status != 0)
+        {
+            fprintf(stderr, "benchmark %s: call %d failed with status %d\n", bench->name, *index - 1, status);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int RunBenchmark(const bench_t *bench, int repetitions, double warmupSeconds, bench_result_t *result)
+{
+    int error = 1;
+    int index = 0;
+    int batch, rep;
+    double start, elapsed, begin;
+    double *latency = NULL;
+
+    memset(result, 0, sizeof(bench_result_t));
+
+    /* Start each benchmark from the same empty caches, so results do not depend on order. */
+    Astronomy_Reset();
+    if (bench->setup && bench->setup())
+    {
+        fprintf(stderr, "benchmark %s: setup failed\n", bench->name);
+        return 1;
+    }
+
+    latency = (double *) calloc((size_t)repetitions, sizeof(double));
+    if (latency == NULL)
+    {
+        fprintf(stderr, "benchmark %s: out of memory\n", bench->name);
+        goto fail;
+    }
+
+    /* Warm up, and find how many calls a batch needs to take at least MIN_BATCH_SECONDS. */
+    batch = 1;
+    begin = Now();
+    for(;;)
+    {
+        start = Now();
+        if (RunBatch(bench, &index, batch))
+            goto fail;
+        elapsed = Now() - start;
+        if (elapsed < MIN_BATCH_SECONDS && batch < MAX_BATCH_CALLS)
+            batch *= 2;
+        else if (Now() - begin >= warmupSeconds)
+            break;
+    }
+
+    /* Timed batches. */
+    begin = Now();
+    for (rep = 0; rep < repetitions; ++rep)
+    {
+        start = Now();
+        if (RunBatch(bench, &index, batch))
+            goto fail;
+        elapsed = Now() - start;
+        latency[rep] = 1.0e9 * elapsed / batch;
+        result->seconds += elapsed;
+        result->calls += batch;
+        if (rep >= 9 && Now() - begin > MAX_BENCH_SECONDS)
+        {
+            ++rep;
+            break;
+        }
+    }
+
+    qsort(latency, (size_t)rep, sizeof(double), CompareDouble);
+    result->batch = batch;
+    result->repetitions = rep;
+    result->min = latency[0];
+    result->p50 = Percentile(latency, rep, 50.0);
+    result->p90 = Percentile(latency, rep, 90.0);
+    result->p99 = Percentile(latency, rep, 99.0);
+    result->max = latency[rep-1];
+    error = 0;
+
+fail:
+    if (bench->teardown)
+        bench->teardown();
+    free(latency);
+    return error;
+}
+
+static void PrintJson(FILE *outfile, int repetitions, double warmupSeconds, const int *selected, const bench_result_t *results)
+{
+    int i, first = 1;
+
+    fprintf(outfile, "{\n");
+    fprintf(outfile, "    \"version\": \"%s\",\n", BENCH_VERSION);
+#ifdef __VERSION__
+    fprintf(outfile, "    \"compiler\": \"%s\",\n", __VERSION__);
+#endif
+    fprintf(outfile, "    \"repetitions\": %d,\n", repetitions);
+    fprintf(outfile, "    \"warmup_seconds\": %g,\n", warmupSeconds);
+    fprintf(outfile, "    \"benchmarks\": [");
+    for (i = 0; i < NUM_BENCHMARKS; ++i)
+    {
+        const bench_result_t *r = &results[i];
+        if (!selected[i])
+            continue;
+        fprintf(outfile, "%s\n        {\"name\": \"%s\", \"calls\": %d, \"batch\": %d, \"repetitions\": %d, \"calls_per_sec\": %.6g, "
+            "\"latency_ns\": {\"min\": %.6g, \"p50\": %.6g, \"p90\": %.6g, \"p99\": %.6g, \"max\": %.6g}}",
+            first ? "" : ",",
+            BenchTable[i].name, r->calls, r->batch, r->repetitions, r->calls / r->seconds,
+            r->min, r->p50, r->p90, r->p99, r->max);
+        first = 0;
+    }
+    fprintf(outfile, "\n    ]\n}\n");
+}
+
+static const char UsageText[] =
+"\n"
+"USAGE:\n"
+"\n"
+"benchmark list\n"
+"    Print the names of all benchmarks.\n"
+"\n"
+"benchmark [-o file.json] [-r repetitions] [-w warmup_seconds] [name ...]\n"
+"    Run the named benchmarks, or all of them if no names are given.\n"
+"    Prints a table of results, and writes JSON to file.json with -o.\n"
+"\n";
+
+int main(int argc, const char *argv[])
+{
+    int repetitions = DEFAULT_REPETITIONS;
+    double warmupSeconds = DEFAULT_WARMUP_SECONDS;
+    const char *jsonFileName = NULL;
+    int selected[NUM_BENCHMARKS];
+    bench_result_t results[NUM_BENCHMARKS];
+    int i, k, any = 0;
+    FILE *outfile;
+
+    if (argc == 2 && !strcmp(argv[1], "list"))
+    {
+        for (i = 0; i < NUM_BENCHMARKS; ++i)
+            printf("%s\n", BenchTable[i].name);
+        return 0;
+    }
+
+    memset(selected, 0, sizeof(selected));
+    for (k = 1; k < argc; ++k)
+    {
+        if (!strcmp(argv[k], "-o") && k+1 < argc)
+            jsonFileName = argv[++k];
+        else if (!strcmp(argv[k], "-r") && k+1 < argc && 1 == sscanf(argv[k+1], "%d", &repetitions) && repetitions > 0)
+            ++k;
+        else if (!strcmp(argv[k], "-w") && k+1 < argc && 1 == sscanf(argv[k+1], "%lf", &warmupSeconds) && warmupSeconds >= 0.0)
+            ++k;
+        else
+        {
+            for (i = 0; i < NUM_BENCHMARKS; ++i)
+                if (!strcmp(argv[k], BenchTable[i].name))
+                    break;
+            if (i == NUM_BENCHMARKS)
+            {
+                fprintf(stderr, "%s", UsageText);
+                return 1;
+            }
+            selected[i] = any = 1;
+        }
+    }
+
+    if (!any)
+        for (i = 0; i < NUM_BENCHMARKS; ++i)
+            selected[i] = 1;
+
+    printf("%-24s %12s %10s %10s %10s %10s\n", "benchmark", "calls/sec", "p50 ns", "p90 ns", "p99 ns", "max ns");
+    for (i = 0; i < NUM_BENCHMARKS; ++i)
+    {
+        if (!selected[i])
+            continue;
+        if (RunBenchmark(&BenchTable[i], repetitions, warmupSeconds, &results[i]))
+            return 1;
+        printf("%-24s %12.5g %10.4g %10.4g %10.4g %10.4g\n",
+            BenchTable[i].name, results[i].calls / results[i].seconds,
+            results[i].p50, results[i].p90, results[i].p99, results[i].max);
+        fflush(stdout);
+    }
+
+    if (jsonFileName != NULL)
+    {
+        outfile = fopen(jsonFileName, "wt");
+        if (outfile == NULL)
+        {
+            fprintf(stderr, "benchmark: cannot open output file: %s\n", jsonFileName);
+            return 1;
+        }
+        PrintJson(outfile, repetitions, warmupSeconds, selected, results);
+        if (fclose(outfile))
+        {
+            fprintf(stderr, "benchmark: error writing output file: %s\n", jsonFileName);
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -995,15 +995,16 @@ static int OptAddSolC(cg_context_t *context, const double *data)
 {
     int i;
 
-    fprintf(context->outfile, "    AddSol(ctx");
+    /* Emit one row of the MoonTerms table. */
+    fprintf(context->outfile, "    {");
 
     for (i=0; i < 4; ++i)
-        fprintf(context->outfile, ",%11.4lf", data[i]);
+        fprintf(context->outfile, "%s%11.4lf", (i > 0) ? "," : "", data[i]);
 
     for(; i < 8; ++i)
         fprintf(context->outfile, ",%2.0lf", data[i]);
 
-    fprintf(context->outfile, ");\n");
+    fprintf(context->outfile, " },\n");
     return 0;
 }
 
@@ -8,9 +8,17 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
 #include <math.h>
 #include <ctype.h>
+#include <time.h>
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/wait.h>
+#include <pthread.h>
+#endif
 #include "astronomy.h"
+#include "textfile.h"
 
 char *ReadLine(char *s, int n, FILE *f, const char *filename, int lnum)
 {
@@ -189,7 +197,7 @@ static int LoadStateVectors(state_vector_batch_t *batch, const char *filename);
 static int Test_AstroTime(void);
 static int AstroCheck(void);
 static int Diff(double tolerance, const char *a_filename, const char *b_filename);
-static int DiffLine(int lnum, const char *aline, const char *bline, maxdiff_column_t column[]);
+static int DiffLine(int lnum, const text_line_t *aline, const text_line_t *bline, maxdiff_column_t column[]);
 static int SeasonsTest(void);
 static int SeasonsIssue187(void);
 static int MoonPhase(void);
@@ -199,6 +207,7 @@ static int MoonVector(void);
 static int MoonEcliptic(void);
 static int RiseSet(void);
 static int RiseSetReverse(void);
+static int RiseSetPolarTest(void);
 static int LunarApsis(void);
 static int EarthApsis(void);
 static int PlanetApsis(void);
@@ -224,6 +233,8 @@ static int LocalSolarEclipseTest(void);
 static int LocalSolarEclipseTest1(void);
 static int LocalSolarEclipseTest2(void);
 static int Transit(void);
+static int ShadowInterpTest(void);
+static int EclipseSeasonTest(void);
 static int DistancePlot(astro_body_t body, double ut1, double ut2, const char *filename);
 static int GeoidTest(void);
 static int JupiterMoonsTest(void);
@@ -233,8 +244,11 @@ static int BaryStateTest(void);
 static int HelioStateTest(void);
 static int LagrangeTest(void);
 static int LagrangeJplAnalysis(void);
+static int LagrangeBatchTest(void);
 static int TopoStateTest(void);
+static int TrackerTest(void);
 static int Twilight(void);
+static int TwilightSearchTest(void);
 static int LibrationTest(void);
 static int DE405_Check(void);
 static int AxisTest(void);
@@ -242,10 +256,66 @@ static int SiderealTimeTest(void);
 static int DatesIssue250(void);
 static int StarRiseSetCulm(void);
 static int MapPerformanceTest(void);
+static int MapGridPerformanceTest(void);
+static int ObserverGridTest(void);
+static int RiseSetBatchTest(void);
+static int AlmanacTest(void);
+static int EclipseCatalogTest(void);
+static int EclipseCatalogParallelTest(void);
+static int LocalEclipseBatchTest(void);
+static int ConstellationStarsTest(void);
+static int ConstellationBatchTest(void);
+static int StarCatalogTest(void);
+static int GravSimParallelTest(void);
+static int GravSimHermiteTest(void);
+static int GravSimEphemTest(void);
+static int GravSimSnapshotTest(void);
+static int AllocatorTest(void);
+static int JupiterMoonsBatchTest(void);
+static int TimeStepperTest(void);
+static int LightTimeWarmTest(void);
+static int SolarSystemSnapshotTest(void);
+static int LunarEventCacheTest(void);
+static int SeasonsCacheTest(void);
+static int PlanetApsisTableTest(void);
+static int PlanetPrecisionTest(void);
+static int HorizonFloatTest(void);
+static int HorizonVectorsFloatTest(void);
+static int TerseTest(void);
+static int TextFileTest(void);
+static int ProfileTest(void);
+static int SearchMethodTest(void);
+static int SearchStateTest(void);
+static int SearchStatsTest(void);
 static int GeoMoonPerformance(void);
+static int GeoMoonBatchTest(void);
+static int DeltaTTableTest(void);
+static int TimeTextTest(void);
+static int IlluminationBatchTest(void);
+static int MoonGeometryTest(void);
+static int RiseSetSequenceTest(void);
 static int NutationPerformance(void);
 static int EclipticTest(void);
 static int HourAngleTest(void);
+static int HourAngleBatchTest(void);
+static int HelioVectorBatchTest(void);
+static int StepperTest(void);
+static int EphemCacheTest(void);
+static int EphemFileTest(void);
+static int PlutoCheckpointTest(void);
+static int PlutoCacheFileTest(void);
+static int PlutoSegmentTest(void);
+static int PlutoSeriesTest(void);
+static int PlutoThreadTest(void);
+static int ContextTest(void);
+static int FrameBundleTest(void);
+static int FrameInterpolationTest(void);
+static int MoonCacheTest(void);
+static int GeoMoonCachePerformance(void);
+static int VectorObserverBatch(void);
+static int KernelTest(void);
+static int CatalogParallelTest(void);
+static int RunTestsInParallel(int njobs);
 
 typedef int (* unit_test_func_t) (void);
 
@@ -262,55 +332,116 @@ unit_test_t;
 static unit_test_t UnitTests[] =
 {
     {"aberration",              AberrationTest},
+    {"allocator",               AllocatorTest},
+    {"almanac",                 AlmanacTest},
     {"axis",                    AxisTest},
     {"barystate",               BaryStateTest},
+    {"catalog_parallel",        CatalogParallelTest},
     {"check",                   AstroCheck},
     {"constellation",           ConstellationTest},
+    {"constellation_batch",     ConstellationBatchTest},
+    {"constellation_stars",     ConstellationStarsTest},
+    {"context",                 ContextTest},
     {"dates250",                DatesIssue250},
     {"de405",                   DE405_Check},
+    {"deltat_table",            DeltaTTableTest},
     {"earth_apsis",             EarthApsis},
+    {"eclipse_catalog",         EclipseCatalogTest},
+    {"eclipse_catalog_parallel", EclipseCatalogParallelTest},
+    {"eclipse_season",          EclipseSeasonTest},
     {"ecliptic",                EclipticTest},
     {"elongation",              ElongationTest},
+    {"ephem_cache",             EphemCacheTest},
+    {"ephem_file",              EphemFileTest},
+    {"frame",                   FrameBundleTest},
+    {"frame_interp",            FrameInterpolationTest},
     {"geoid",                   GeoidTest},
+    {"geomoon_batch",           GeoMoonBatchTest},
     {"global_solar_eclipse",    GlobalSolarEclipseTest},
     {"gravsim",                 GravitySimulatorTest},
+    {"gravsim_ephem",           GravSimEphemTest},
+    {"gravsim_hermite",         GravSimHermiteTest},
+    {"gravsim_parallel",        GravSimParallelTest},
+    {"gravsim_snapshot",        GravSimSnapshotTest},
+    {"helio_batch",             HelioVectorBatchTest},
     {"heliostate",              HelioStateTest},
+    {"horizon_float",           HorizonFloatTest},
+    {"horizon_vectors_float",   HorizonVectorsFloatTest},
     {"hour_angle",              HourAngleTest},
+    {"hour_angle_batch",        HourAngleBatchTest},
+    {"illumination_batch",      IlluminationBatchTest},
     {"issue_103",               Issue103},
     {"jupiter_moons",           JupiterMoonsTest},
+    {"jupiter_moons_batch",     JupiterMoonsBatchTest},
+    {"kernel",                  KernelTest},
     {"lagrange",                LagrangeTest},
+    {"lagrange_batch",          LagrangeBatchTest},
     {"lagrange_jpl",            LagrangeJplAnalysis},
     {"libration",               LibrationTest},
+    {"light_time_warm",         LightTimeWarmTest},
+    {"local_eclipse_batch",     LocalEclipseBatchTest},
     {"local_solar_eclipse",     LocalSolarEclipseTest},
     {"lunar_eclipse",           LunarEclipseTest},
     {"lunar_eclipse_78",        LunarEclipseIssue78},
+    {"lunar_event_cache",       LunarEventCacheTest},
     {"lunar_fraction",          LunarFractionTest},
     {"magnitude",               MagnitudeTest},
     {"map",                     MapPerformanceTest,     EXCLUDE_FROM_AUTOMATED_TESTS},
+    {"map_grid",                MapGridPerformanceTest, EXCLUDE_FROM_AUTOMATED_TESTS},
     {"moon",                    MoonTest},
     {"moon_apsis",              LunarApsis},
+    {"moon_cache",              MoonCacheTest},
+    {"moon_cache_performance",  GeoMoonCachePerformance, EXCLUDE_FROM_AUTOMATED_TESTS},
     {"moon_ecm",                MoonEcliptic},
+    {"moon_geometry",           MoonGeometryTest},
     {"moon_nodes",              MoonNodes},
     {"moon_performance",        GeoMoonPerformance,     EXCLUDE_FROM_AUTOMATED_TESTS},
     {"moon_phase",              MoonPhase},
     {"moon_reverse",            MoonReverse},
     {"moon_vector",             MoonVector},
     {"nutation",                NutationPerformance,    EXCLUDE_FROM_AUTOMATED_TESTS},
+    {"observer_grid",           ObserverGridTest},
     {"planet_apsis",            PlanetApsis},
+    {"planet_apsis_table",      PlanetApsisTableTest},
+    {"planet_precision",        PlanetPrecisionTest},
     {"pluto",                   PlutoCheck},
+    {"pluto_cache_file",        PlutoCacheFileTest},
+    {"pluto_checkpoint",        PlutoCheckpointTest},
+    {"pluto_segment",           PlutoSegmentTest},
+    {"pluto_series",            PlutoSeriesTest},
+    {"pluto_threads",           PlutoThreadTest},
+    {"profile",                 ProfileTest},
     {"refraction",              RefractionTest},
     {"riseset",                 RiseSet},
+    {"riseset_batch",           RiseSetBatchTest},
+    {"riseset_polar",           RiseSetPolarTest},
     {"riseset_reverse",         RiseSetReverse},
+    {"riseset_sequence",        RiseSetSequenceTest},
     {"rotation",                RotationTest},
+    {"search_method",           SearchMethodTest},
+    {"search_state",            SearchStateTest},
+    {"search_stats",            SearchStatsTest},
     {"seasons",                 SeasonsTest},
     {"seasons187",              SeasonsIssue187},
+    {"seasons_cache",           SeasonsCacheTest},
+    {"shadow_interp",           ShadowInterpTest},
     {"sidereal",                SiderealTimeTest},
     {"solar_fraction",          SolarFractionTest},
+    {"solar_system_snapshot",   SolarSystemSnapshotTest},
+    {"star_catalog",            StarCatalogTest},
     {"star_risesetculm",        StarRiseSetCulm},
+    {"stepper",                 StepperTest},
+    {"terse",                   TerseTest},
+    {"text_file",               TextFileTest},
     {"time",                    Test_AstroTime},
+    {"time_stepper",            TimeStepperTest},
+    {"time_text",               TimeTextTest},
     {"topostate",               TopoStateTest},
+    {"tracker",                 TrackerTest},
     {"transit",                 Transit},
-    {"twilight",                Twilight}
+    {"twilight",                Twilight},
+    {"twilight_search",         TwilightSearchTest},
+    {"vector_observer_batch",   VectorObserverBatch}
 };
 
 #define NUM_UNIT_TESTS    (sizeof(UnitTests) / sizeof(UnitTests[0]))
@@ -319,6 +450,7 @@ int main(int argc, const char *argv[])
 {
     int error = 1;
     int i;
+    int njobs = -1;     /* -1 = run "all" tests serially in this process */
 
     if (argc > 1 && !strcmp(argv[1], "-v"))
     {
@@ -327,10 +459,20 @@ int main(int argc, const char *argv[])
         Verbose = 1;
     }
 
+    if (argc > 2 && !strcmp(argv[1], "-j"))
+    {
+        char *end;
+        njobs = (int)strtol(argv[2], &end, 10);
+        if (*end != '\0' || njobs < 0)
+            FAIL("ctest: Invalid number of jobs after -j: '%s'\n", argv[2]);
+        argv += 2;
+        argc -= 2;
+    }
+
     if (argc == 1)
     {
         /* List available commands. */
-        printf("Run `ctest all` to run all tests.\n");
+        printf("Run `ctest all` to run all tests, or `ctest -j N all` to run and time them in N processes.\n");
         printf("Or run `ctest <name>` for a specific named test:\n");
         for (i = 0; i < NUM_UNIT_TESTS; ++i)
             printf("    %s\n", UnitTests[i].name);
@@ -344,6 +486,11 @@ int main(int argc, const char *argv[])
         {
             if (!strcmp(verb, "all"))
             {
+                if (njobs >= 0)
+                {
+                    CHECK(RunTestsInParallel(njobs));
+                    goto success;
+                }
                 for (i=0; i < NUM_UNIT_TESTS; ++i)
                     if (!UnitTests[i].exclude && UnitTests[i].func())
                         FAIL("ctest: Unit test failed: %s\n", UnitTests[i].name);
@@ -418,6 +565,175 @@ fail:
     return error;
 }
 
+#ifdef _WIN32
+
+static int RunTestsInParallel(int njobs)
+{
+    (void)njobs;
+    printf("ctest: The -j option is not supported on Windows. Use `ctest all` instead.\n");
+    return 1;
+}
+
+#else
+
+typedef struct
+{
+    int test;           /* index into UnitTests[] */
+    pid_t pid;          /* the worker process running the test */
+    FILE *output;       /* everything the test printed */
+    double start;
+    double elapsed;     /* wall time in seconds */
+    int done;
+    int failed;
+}
+parallel_test_t;
+
+static double WallClockSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1.0e-9 * ts.tv_nsec;
+}
+
+static int CompareElapsed(const void *a, const void *b)
+{
+    const parallel_test_t *pa = a;
+    const parallel_test_t *pb = b;
+    if (pa->elapsed > pb->elapsed) return -1;
+    if (pa->elapsed < pb->elapsed) return +1;
+    return pa->test - pb->test;
+}
+
+/*
+    Runs each of the automated unit tests in its own child process, up to njobs at a time.
+    Because every test has a process to itself, tests that change global state,
+    such as Astronomy_SetDeltaTFunction or the internal caches, cannot affect each other.
+    Each test's output is printed when it finishes, in the same order as `ctest all`,
+    followed by a list of the tests sorted by how long they took.
+*/
+static int RunTestsInParallel(int njobs)
+{
+    int error = 1;
+    parallel_test_t job[NUM_UNIT_TESTS];
+    int ntests = 0, nstarted = 0, nrunning = 0, nprinted = 0, nfailed = 0;
+    int i, c, wstatus;
+    pid_t pid;
+    double total_start, total_elapsed, sum_elapsed;
+
+    if (njobs == 0)
+        njobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (njobs < 1)
+        njobs = 1;
+
+    for (i = 0; i < NUM_UNIT_TESTS; ++i)
+    {
+        if (!UnitTests[i].exclude)
+        {
+            memset(&job[ntests], 0, sizeof(job[ntests]));
+            job[ntests++].test = i;
+        }
+    }
+
+    total_start = WallClockSeconds();
+    while (nprinted < ntests)
+    {
+        /* Keep up to njobs worker processes busy. */
+        while (nrunning < njobs && nstarted < ntests)
+        {
+            parallel_test_t *j = &job[nstarted];
+            j->output = tmpfile();
+            if (j->output == NULL)
+                FAIL("ctest: Cannot create temporary output file for test %s\n", UnitTests[j->test].name);
+
+            fflush(stdout);
+            fflush(stderr);
+            j->start = WallClockSeconds();
+            pid = fork();
+            if (pid < 0)
+                FAIL("ctest: Cannot start a process for test %s\n", UnitTests[j->test].name);
+
+            if (pid == 0)
+            {
+                /* This is the worker process: run the test, capturing its output. */
+                dup2(fileno(j->output), STDOUT_FILENO);
+                dup2(fileno(j->output), STDERR_FILENO);
+                error = UnitTests[j->test].func();
+                Astronomy_Reset();
+                fflush(stdout);
+                fflush(stderr);
+                _exit(error ? 1 : 0);
+            }
+
+            j->pid = pid;
+            ++nstarted;
+            ++nrunning;
+        }
+
+        /* Wait for any one of the worker processes to finish. */
+        pid = waitpid(-1, &wstatus, 0);
+        if (pid < 0)
+            FAIL("ctest: waitpid failed while running tests in parallel.\n");
+
+        for (i = nprinted; i < nstarted; ++i)
+        {
+            if (job[i].pid == pid && !job[i].done)
+            {
+                job[i].elapsed = WallClockSeconds() - job[i].start;
+                job[i].done = 1;
+                job[i].failed = !WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != 0;
+                if (WIFSIGNALED(wstatus))
+                    fprintf(job[i].output, "ctest: Test process was terminated by signal %d\n", WTERMSIG(wstatus));
+                --nrunning;
+                break;
+            }
+        }
+
+        /* Print the output of finished tests in table order, so the log does not depend on timing. */
+        while (nprinted < nstarted && job[nprinted].done)
+        {
+            parallel_test_t *j = &job[nprinted++];
+            fflush(j->output);
+            rewind(j->output);
+            while (EOF != (c = fgetc(j->output)))
+                putchar(c);
+            fclose(j->output);
+            j->output = NULL;
+            if (j->failed)
+            {
+                printf("ctest: Unit test failed: %s\n", UnitTests[j->test].name);
+                ++nfailed;
+            }
+        }
+    }
+    total_elapsed = WallClockSeconds() - total_start;
+
+    qsort(job, (size_t)ntests, sizeof(job[0]), CompareElapsed);
+    sum_elapsed = 0.0;
+    printf("\nctest: Wall time of each test, using %d parallel process%s:\n", njobs, (njobs == 1) ? "" : "es");
+    for (i = 0; i < ntests; ++i)
+    {
+        printf("%10.3lf s  %s%s\n", job[i].elapsed, UnitTests[job[i].test].name, job[i].failed ? "  (FAILED)" : "");
+        sum_elapsed += job[i].elapsed;
+    }
+    printf("ctest: Ran %d tests in %0.3lf s of wall time (%0.3lf s total test time).\n", ntests, total_elapsed, sum_elapsed);
+
+    if (nfailed > 0)
+        FAIL("ctest: %d unit test%s failed.\n", nfailed, (nfailed == 1) ? "" : "s");
+
+    return 0;
+
+fail:
+    /* Do not leave any orphaned worker processes behind. */
+    while (nrunning > 0 && waitpid(-1, NULL, 0) > 0)
+        --nrunning;
+    for (i = 0; i < ntests; ++i)
+        if (job[i].output != NULL)
+            fclose(job[i].output);
+    return error;
+}
+
+#endif
+
 
 static int CheckTimeFormat(
     astro_time_t time,
@@ -725,38 +1041,35 @@ static int Diff(double tolerance, const char *a_filename, const char *b_filename
     int error = 1;
     int lnum;
     int i;
-    FILE *afile = NULL;
-    FILE *bfile = NULL;
-    char aline[300];
-    char bline[300];
-    char *aread;
-    char *bread;
+    text_file_t afile, bfile;
+    text_line_t aline, bline;
+    int aread, bread;
     maxdiff_column_t columns[NUM_DIFF_COLUMNS];
     double score = 0.0;
 
     memset(columns, 0, sizeof(columns));
 
-    afile = fopen(a_filename, "rt");
-    if (afile == NULL)
+    memset(&bfile, 0, sizeof(bfile));
+
+    if (TextFileOpen(&afile, a_filename))
         FFAIL("Cannot open input file: %s\n", a_filename);
 
-    bfile = fopen(b_filename, "rt");
-    if (bfile == NULL)
+    if (TextFileOpen(&bfile, b_filename))
         FFAIL("Cannot open input file: %s\n", b_filename);
 
     lnum = 0;
     for(;;)
     {
-        aread = ReadLine(aline, sizeof(aline), afile, a_filename, lnum);
-        bread = ReadLine(bline, sizeof(bline), bfile, b_filename, lnum);
-        if (aread==NULL && bread==NULL)
+        aread = TextFileReadLine(&afile, &aline);
+        bread = TextFileReadLine(&bfile, &bline);
+        if (!aread && !bread)
             break;      /* normal end of both files */
 
-        if (aread==NULL || bread==NULL)
+        if (!aread || !bread)
             FFAIL("Files do not have same number of lines: %s and %s\n", a_filename, b_filename);
 
         ++lnum;
-        CHECK(DiffLine(lnum, aline, bline, columns));
+        CHECK(DiffLine(lnum, &aline, &bline, columns));
     }
 
     error = 0;
@@ -796,12 +1109,12 @@ static int Diff(double tolerance, const char *a_filename, const char *b_filename
     printf("----------------------------------------------------------------------------------------------------\n\n");
 
 fail:
-    if (afile != NULL) fclose(afile);
-    if (bfile != NULL) fclose(bfile);
+    TextFileClose(&afile);
+    TextFileClose(&bfile);
     return error;
 }
 
-static int DiffLine(int lnum, const char *aline, const char *bline, maxdiff_column_t columns[])
+static int DiffLine(int lnum, const text_line_t *aline, const text_line_t *bline, maxdiff_column_t columns[])
 {
     int error = 1;
     char abody[10];
@@ -813,24 +1126,26 @@ static int DiffLine(int lnum, const char *aline, const char *bline, maxdiff_colu
     int colbase = -1;
     int mindex_a, mindex_b;     /* index of Jupiter's moon: 0..3 */
     maxdiff_column_t *col;
+    char atype = (aline->text < aline->end) ? aline->text[0] : '\0';
+    char btype = (bline->text < bline->end) ? bline->text[0] : '\0';
 
     /* be paranoid: make sure we can't possibly have a fake match. */
     memset(adata, 0xdc, sizeof(adata));
     memset(bdata, 0xce, sizeof(bdata));
 
     /* Make sure the two data records are the same type. */
-    if (aline[0] != bline[0])
-        FFAIL("Line %d mismatch record type: '%c' vs '%c'.\n", lnum, aline[0], bline[0]);
+    if (atype != btype)
+        FFAIL("Line %d mismatch record type: '%c' vs '%c'.\n", lnum, atype, btype);
 
     abody[0] = bbody[0] = '\0';     /* default to no body name */
 
-    switch (aline[0])
+    switch (atype)
     {
     case 'o':       /* observer */
-        na = sscanf(aline, "o %lf %lf %lf", &adata[0], &adata[1], &adata[2]);
+        na = TextScan(aline, 0, "o %lf %lf %lf", &adata[0], &adata[1], &adata[2]);
         if (na != 3)
             FFAIL("Bad observer on line %d of first file\n", lnum);
-        nb = sscanf(bline, "o %lf %lf %lf", &bdata[0], &bdata[1], &bdata[2]);
+        nb = TextScan(bline, 0, "o %lf %lf %lf", &bdata[0], &bdata[1], &bdata[2]);
         if (nb != 3)
             FFAIL("Bad observer on line %d of second file\n", lnum);
         if (adata[0] != bdata[0] || adata[1] != bdata[1] || adata[2] != bdata[2])
@@ -839,23 +1154,23 @@ static int DiffLine(int lnum, const char *aline, const char *bline, maxdiff_colu
 
     case 'v':       /* heliocentric vector: tt x y z */
         colbase = 0;
-        na = sscanf(aline, "v %9[A-Za-z] %lf %lf %lf %lf", abody, &adata[0], &adata[1], &adata[2], &adata[3]);
-        nb = sscanf(bline, "v %9[A-Za-z] %lf %lf %lf %lf", bbody, &bdata[0], &bdata[1], &bdata[2], &bdata[3]);
+        na = TextScan(aline, 0, "v %9[A-Za-z] %lf %lf %lf %lf", abody, &adata[0], &adata[1], &adata[2], &adata[3]);
+        nb = TextScan(bline, 0, "v %9[A-Za-z] %lf %lf %lf %lf", bbody, &bdata[0], &bdata[1], &bdata[2], &bdata[3]);
         nrequired = 5;
         break;
 
     case 's':       /* sky coords: ecliptic and horizontal */
         /* Astronomy_BodyName(body), [0] time.tt, [1] time.ut, [2] j2000.ra, [3] j2000.dec, [4] j2000.dist, [5] hor.azimuth, [6] hor.altitude */
         colbase = NUM_V_COLUMNS;
-        na = sscanf(aline, "s %9[A-Za-z] %lf %lf %lf %lf %lf %lf %lf", abody, &adata[0], &adata[1], &adata[2], &adata[3], &adata[4], &adata[5], &adata[6]);
-        nb = sscanf(bline, "s %9[A-Za-z] %lf %lf %lf %lf %lf %lf %lf", bbody, &bdata[0], &bdata[1], &bdata[2], &bdata[3], &bdata[4], &bdata[5], &bdata[6]);
+        na = TextScan(aline, 0, "s %9[A-Za-z] %lf %lf %lf %lf %lf %lf %lf", abody, &adata[0], &adata[1], &adata[2], &adata[3], &adata[4], &adata[5], &adata[6]);
+        nb = TextScan(bline, 0, "s %9[A-Za-z] %lf %lf %lf %lf %lf %lf %lf", bbody, &bdata[0], &bdata[1], &bdata[2], &bdata[3], &bdata[4], &bdata[5], &bdata[6]);
         nrequired = 8;
         break;
 
     case 'j':       /* Jupiter's moons:   j moon[0..3] tt ut x y z vx vy vz */
         colbase = NUM_V_COLUMNS + NUM_S_COLUMNS;
-        na = sscanf(aline, "j %d %lf %lf %lf %lf %lf %lf %lf %lf", &mindex_a, &adata[0], &adata[1], &adata[2], &adata[3], &adata[4], &adata[5], &adata[6], &adata[7]);
-        nb = sscanf(bline, "j %d %lf %lf %lf %lf %lf %lf %lf %lf", &mindex_b, &bdata[0], &bdata[1], &bdata[2], &bdata[3], &bdata[4], &bdata[5], &bdata[6], &bdata[7]);
+        na = TextScan(aline, 0, "j %d %lf %lf %lf %lf %lf %lf %lf %lf", &mindex_a, &adata[0], &adata[1], &adata[2], &adata[3], &adata[4], &adata[5], &adata[6], &adata[7]);
+        nb = TextScan(bline, 0, "j %d %lf %lf %lf %lf %lf %lf %lf %lf", &mindex_b, &bdata[0], &bdata[1], &bdata[2], &bdata[3], &bdata[4], &bdata[5], &bdata[6], &bdata[7]);
         nrequired = 9;
         if (mindex_a < 0 || mindex_a >= 4 || mindex_a != mindex_b)
             FFAIL("Bad Jupiter moon index in line %d: mindex_a=%d, mindex_b=%d\n", lnum, mindex_a, mindex_b);
@@ -865,20 +1180,20 @@ static int DiffLine(int lnum, const char *aline, const char *bline, maxdiff_colu
 
     case 'n':   /* nutation angles */
         colbase = NUM_V_COLUMNS + NUM_S_COLUMNS + NUM_J_COLUMNS;
-        na = sscanf(aline, "n %lf %lf", &adata[0], &adata[1]);
-        nb = sscanf(bline, "n %lf %lf", &bdata[0], &bdata[1]);
+        na = TextScan(aline, 0, "n %lf %lf", &adata[0], &adata[1]);
+        nb = TextScan(bline, 0, "n %lf %lf", &bdata[0], &bdata[1]);
         nrequired = 2;
         break;
 
     case 'm':   /* EclipticGeoMoon */
         colbase = NUM_V_COLUMNS + NUM_S_COLUMNS + NUM_J_COLUMNS + NUM_N_COLUMNS;
-        na = sscanf(aline, "m %lf %lf %lf", &adata[0], &adata[1], &adata[2]);
-        nb = sscanf(bline, "m %lf %lf %lf", &bdata[0], &bdata[1], &bdata[2]);
+        na = TextScan(aline, 0, "m %lf %lf %lf", &adata[0], &adata[1], &adata[2]);
+        nb = TextScan(bline, 0, "m %lf %lf %lf", &bdata[0], &bdata[1], &bdata[2]);
         nrequired = 3;
         break;
 
     default:
-        FFAIL("Line %d type '%c' is not a valid record type.\n", lnum, aline[0]);
+        FFAIL("Line %d type '%c' is not a valid record type.\n", lnum, atype);
     }
 
     if (na != nb)
@@ -1791,6 +2106,97 @@ fail:
 
 /*-----------------------------------------------------------------------------------------------------------*/
 
+static int RiseSetPolarTest(void)
+{
+    /*
+        Near the poles, the Sun and Moon can rise and set within a short time of each other,
+        barely grazing the horizon. Start each search at several different times before
+        each such event in the test data, and verify that every search finds the same event.
+        This verifies that FindAscent does not prune a brief ascent that it should have found,
+        no matter how the sample intervals happen to line up with the event.
+    */
+    const char *filename = "riseset/riseset.txt";
+    const int nstarts = 64;
+    int error = 1;
+    FILE *infile = NULL;
+    char line[100];
+    char name[20];
+    char kind[2];
+    double longitude, latitude, prev_longitude = NAN, prev_latitude = NAN;
+    double prev_ut[2], gap, diff, max_minutes = 0.0;
+    int year, month, day, hour, minute;
+    int lnum, nscanned, k, d, count = 0;
+    astro_body_t body, prev_body = BODY_INVALID;
+    astro_observer_t observer;
+    astro_time_t correct_date;
+    astro_search_result_t evt;
+
+    infile = fopen(filename, "rt");
+    if (infile == NULL)
+        FFAIL("cannot open input file: %s\n", filename);
+
+    lnum = 0;
+    while (ReadLine(line, sizeof(line), infile, filename, lnum))
+    {
+        ++lnum;
+        nscanned = sscanf(line, "%9[A-Za-z] %lf %lf %d-%d-%dT%d:%dZ %1[rs]",
+            name, &longitude, &latitude, &year, &month, &day, &hour, &minute, kind);
+        if (nscanned != 9)
+            FLNFAIL("invalid format\n");
+
+        if (fabs(latitude) < 80.0)
+            continue;
+
+        body = Astronomy_BodyCode(name);
+        if (body == BODY_INVALID)
+            FLNFAIL("invalid body name '%s'", name);
+
+        if (body != prev_body || latitude != prev_latitude || longitude != prev_longitude)
+        {
+            prev_body = body;
+            prev_latitude = latitude;
+            prev_longitude = longitude;
+            prev_ut[0] = prev_ut[1] = NAN;
+            observer = Astronomy_MakeObserver(latitude, longitude, 0.0);
+        }
+
+        d = (kind[0] == 'r') ? 0 : 1;
+        correct_date = Astronomy_MakeTime(year, month, day, hour, minute, 0.0);
+
+        /*
+            Start between the previous event of the same kind (or a day earlier) and this event,
+            allowing for the test data being rounded to the nearest minute.
+        */
+        gap = correct_date.ut - prev_ut[d];
+        if (!(gap < 1.0))
+            gap = 1.0;
+        gap -= 2.4 / MINUTES_PER_DAY;
+        prev_ut[d] = correct_date.ut;
+
+        for (k = 0; gap > 0.0 && k < nstarts; ++k)
+        {
+            evt = Astronomy_SearchRiseSet(
+                body, observer, d ? DIRECTION_SET : DIRECTION_RISE,
+                Astronomy_AddDays(correct_date, -(1.2/MINUTES_PER_DAY + (k + 0.5)*gap/nstarts)), 2.0);
+            if (evt.status != ASTRO_SUCCESS)
+                FLNFAIL("search %d did not find the event: status = %d\n", k, evt.status);
+            diff = MINUTES_PER_DAY * ABS(evt.time.ut - correct_date.ut);
+            if (diff > max_minutes)
+                max_minutes = diff;
+            if (diff > 1.18)
+                FLNFAIL("search %d found an event %0.3lf minutes away\n", k, diff);
+            ++count;
+        }
+    }
+
+    FPASSA("%d searches, max error = %0.4lf minutes\n", count, max_minutes);
+fail:
+    if (infile != NULL) fclose(infile);
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
 static int RiseSetSlot(double ut1, double ut2, astro_direction_t dir, astro_observer_t observer)
 {
     int error = 1;
@@ -2059,12 +2465,12 @@ coord_sys_t;
 static int MoonVectorFile(const char *filename, coord_sys_t coords, double rms_angle_limit, double rms_length_limit)
 {
     int error = 1;
-    FILE *infile = NULL;
+    text_file_t infile;
     int lnum = 0;
     int count = 0;      /* number of test cases processed */
     int toggle = 0;
     int found_start = 0;
-    char line[200];
+    text_line_t line;
     double jd = 0.0;
     astro_vector_t expected;
     astro_vector_t calculated;
@@ -2078,27 +2484,28 @@ static int MoonVectorFile(const char *filename, coord_sys_t coords, double rms_a
     double max_length = 0.0, max_angle = 0.0;
     astro_rotation_t rot;
 
+    memset(&infile, 0, sizeof(infile));
+
     rot = Astronomy_Rotation_EQJ_ECL();
     CHECK_STATUS(rot);
 
-    infile = fopen(filename, "rt");
-    if (infile == NULL)
+    if (TextFileOpen(&infile, filename))
         FFAIL("cannot open file: %s\n", filename);
 
-    while (ReadLine(line, sizeof(line), infile, filename, lnum))
+    while (TextFileReadLine(&infile, &line))
     {
-        ++lnum;
+        lnum = infile.lnum;
         if (!found_start)
         {
-            if (strlen(line) > 5 && !memcmp(line, "$$SOE", 5))
+            if (TextLineStartsWith(&line, "$$SOE"))
                 found_start = 1;
         }
         else
         {
-            if (strlen(line) > 5 && !memcmp(line, "$$EOE", 5))
+            if (TextLineStartsWith(&line, "$$EOE"))
                 break;
 
-            if (strlen(line) < 62)
+            if (TextLineLength(&line) < 61)
                 FLNFAIL("line is too short.\n");
 
             /*
@@ -2107,14 +2514,14 @@ static int MoonVectorFile(const char *filename, coord_sys_t coords, double rms_a
             */
             if (toggle == 0)
             {
-                if (1 != sscanf(line, "%lf", &jd))
+                if (1 != TextScan(&line, 0, "%lf", &jd))
                     FLNFAIL("cannot parse julian date.\n");
                 V(jd);
             }
             else
             {
                 /* Complete the expected Moon position vector for this time. */
-                if (3 != sscanf(line, " X =%lf Y =%lf Z =%lf", &expected.x, &expected.y, &expected.z))
+                if (3 != TextScan(&line, 0, " X =%lf Y =%lf Z =%lf", &expected.x, &expected.y, &expected.z))
                     FLNFAIL("cannot parse position vector.\n");
                 expected.t = Astronomy_TerrestrialTime(jd - JD_2000);
                 expected.status = ASTRO_SUCCESS;
@@ -2181,7 +2588,7 @@ static int MoonVectorFile(const char *filename, coord_sys_t coords, double rms_a
 
     error = 0;
 fail:
-    if (infile != NULL) fclose(infile);
+    TextFileClose(&infile);
     return error;
 }
 
@@ -2198,12 +2605,12 @@ fail:
 static int MoonEcliptic(void)
 {
     int error = 1;
-    FILE *infile = NULL;
+    text_file_t infile;
     int lnum = 0;
     int count = 0;
     int found_start = 0;
     const char *filename = "moonphase/moon_ecm.txt";
-    char line[100];
+    text_line_t line;
     double jdut, tt, deltat, lon, lat;
     double diff_lat, diff_lon, max_lat = 0.0, max_lon = 0.0;
     astro_time_t time;
@@ -2211,31 +2618,30 @@ static int MoonEcliptic(void)
 
     /* Verify Moon's ecliptic coordinates relative to mean equator of date. */
 
-    infile = fopen(filename, "rt");
-    if (infile == NULL)
+    if (TextFileOpen(&infile, filename))
         FFAIL("Cannot open input file: %s\n", filename);
 
-    while (ReadLine(line, sizeof(line), infile, filename, lnum))
+    while (TextFileReadLine(&infile, &line))
     {
-        ++lnum;
+        lnum = infile.lnum;
         if (!found_start)
         {
-            if (strlen(line) > 5 && !memcmp(line, "$$SOE", 5))
+            if (TextLineStartsWith(&line, "$$SOE"))
                 found_start = 1;
         }
         else
         {
-            if (strlen(line) > 5 && !memcmp(line, "$$EOE", 5))
+            if (TextLineStartsWith(&line, "$$EOE"))
                 break;
 
-            if (strlen(line) < 79)
+            if (TextLineLength(&line) < 78)
                 FLNFAIL("line is too short.\n");
 
             /* Parse reference data from JPL Horizons. */
 
             /* " Date__(UT)__HR:MN Date_________JDUT           TDB-UT     ObsEcLon    ObsEcLat" */
             /* " 1900-Jan-01 00:00 2415020.500000000        -1.944461  272.4162663   1.1082671" */
-            if (4 != sscanf(&line[19], "%lf %lf %lf %lf", &jdut, &deltat, &lon, &lat))
+            if (4 != TextScan(&line, 19, "%lf %lf %lf %lf", &jdut, &deltat, &lon, &lat))
                 FLNFAIL("cannot parse data.\n");
             V(jdut);
             V(deltat);
@@ -2275,7 +2681,7 @@ static int MoonEcliptic(void)
 
     FPASSA("count=%d, max lat=%0.3lf arcsec, max lon=%0.3lf arcsec.\n", count, max_lat, max_lon);
 fail:
-    if (infile != NULL) fclose(infile);
+    TextFileClose(&infile);
     return error;
 }
 
@@ -4815,106 +5221,525 @@ fail:
 
 /*-----------------------------------------------------------------------------------------------------------*/
 
-static int DistancePlot(astro_body_t body, double ut1, double ut2, const char *filename)
+/*
+    The eclipse and transit searches find their contact times from a Chebyshev fit
+    of the shadow geometry around each peak. The functions below recalculate the same
+    geometry exactly, from the public API, and repeat the contact searches on it.
+*/
+
+typedef enum
 {
-    const int npoints = 100000;
-    int error = 1;
-    int i;
-    double ut;
-    astro_time_t time, j2000;
-    astro_func_result_t dist;
-    FILE *outfile = NULL;
+    SHADOW_LUNAR,
+    SHADOW_SOLAR,
+    SHADOW_TRANSIT,
+    SHADOW_LOCAL_PARTIAL,
+    SHADOW_LOCAL_TOTAL
+}
+exact_shadow_kind_t;
 
-    outfile = fopen(filename, "wt");
-    if (outfile == NULL)
-        FFAIL("Cannot open output file: %s\n", filename);
+typedef struct
+{
+    exact_shadow_kind_t kind;
+    astro_body_t body;
+    double radius_km;
+    astro_observer_t observer;
+    double radius_limit;
+    double direction;
+}
+exact_shadow_context_t;
 
-    j2000 = Astronomy_MakeTime(2000, 1, 1, 12, 0, 0.0);
+static void ExactShadow(double body_radius_km, astro_vector_t target, astro_vector_t dir, double *r, double *k, double *p)
+{
+    double u, dx, dy, dz;
 
-    fprintf(outfile, "\"tt\",\"distance\"\n");
-    for (i=0; i < npoints; ++i)
+    u = (dir.x*target.x + dir.y*target.y + dir.z*target.z) / (dir.x*dir.x + dir.y*dir.y + dir.z*dir.z);
+    dx = (u * dir.x) - target.x;
+    dy = (u * dir.y) - target.y;
+    dz = (u * dir.z) - target.z;
+    *r = KM_PER_AU * sqrt(dx*dx + dy*dy + dz*dz);
+    *k = +SUN_RADIUS_KM - (1.0 + u)*(SUN_RADIUS_KM - body_radius_km);
+    *p = -SUN_RADIUS_KM + (1.0 + u)*(SUN_RADIUS_KM + body_radius_km);
+}
+
+static astro_status_t ExactShadowAt(const exact_shadow_context_t *context, astro_time_t time, double *r, double *k, double *p)
+{
+    astro_vector_t s, g, m, o;
+
+    s = Astronomy_GeoVector(BODY_SUN, time, ABERRATION);
+    if (s.status != ASTRO_SUCCESS)
+        return s.status;
+
+    switch (context->kind)
     {
-        ut = ut1 + (((double)i)/((double)(npoints-1)) * (ut2 - ut1));
-        time = Astronomy_AddDays(j2000, ut);
-        dist = Astronomy_HelioDistance(body, time);
-        CHECK_STATUS(dist);
-        fprintf(outfile, "%0.16lf,%0.16lg\n", time.tt, dist.value);
-    }
+    case SHADOW_LUNAR:
+        /* Earth's shadow on the geocentric Moon, along the sunlight heading toward the Earth. */
+        m = Astronomy_GeoMoon(time);
+        s.x = -s.x;
+        s.y = -s.y;
+        s.z = -s.z;
+        ExactShadow(6371.0 + 88.0, m, s, r, k, p);
+        return ASTRO_SUCCESS;
+
+    case SHADOW_SOLAR:
+        /* The Moon's shadow on the Earth's center. */
+        m = Astronomy_GeoMoon(time);
+        o.status = ASTRO_SUCCESS;
+        o.t = time;
+        o.x = -m.x;
+        o.y = -m.y;
+        o.z = -m.z;
+        m.x -= s.x;
+        m.y -= s.y;
+        m.z -= s.z;
+        ExactShadow(1737.4, o, m, r, k, p);
+        return ASTRO_SUCCESS;
+
+    case SHADOW_TRANSIT:
+        /* The planet's shadow on the Earth's center. */
+        g = Astronomy_GeoVector(context->body, time, ABERRATION);
+        if (g.status != ASTRO_SUCCESS)
+            return g.status;
+        s.x = g.x - s.x;
+        s.y = g.y - s.y;
+        s.z = g.z - s.z;
+        g.x = -g.x;
+        g.y = -g.y;
+        g.z = -g.z;
+        ExactShadow(context->radius_km, g, s, r, k, p);
+        return ASTRO_SUCCESS;
 
-    error = 0;
-fail:
-    if (outfile != NULL) fclose(outfile);
-    return error;
+    default:
+        /* The Moon's shadow on an observer at the Earth's surface. */
+        o = Astronomy_ObserverVector(&time, context->observer, EQUATOR_J2000);
+        if (o.status != ASTRO_SUCCESS)
+            return o.status;
+        m = Astronomy_GeoMoon(time);
+        o.x -= m.x;
+        o.y -= m.y;
+        o.z -= m.z;
+        m.x -= s.x;
+        m.y -= s.y;
+        m.z -= s.z;
+        ExactShadow(1737.4, o, m, r, k, p);
+        return ASTRO_SUCCESS;
+    }
 }
 
-/*-----------------------------------------------------------------------------------------------------------*/
+static astro_func_result_t ExactShadowFunc(void *context, astro_time_t time)
+{
+    const exact_shadow_context_t *c = (const exact_shadow_context_t *) context;
+    astro_func_result_t result;
+    double r, k, p;
 
-static int PlutoCheckDate(double ut, double arcmin_tolerance, double x, double y, double z)
+    result.status = ExactShadowAt(c, time, &r, &k, &p);
+    if (result.status != ASTRO_SUCCESS)
+    {
+        result.value = NAN;
+        return result;
+    }
+
+    switch (c->kind)
+    {
+    case SHADOW_LUNAR:          result.value = c->direction * (r - c->radius_limit);  break;
+    case SHADOW_TRANSIT:        result.value = c->direction * (r - p);                break;
+    case SHADOW_LOCAL_PARTIAL:  result.value = c->direction * (p - r);                break;
+    default:                    result.value = c->direction * (fabs(k) - r);        break;
+    }
+    return result;
+}
+
+static astro_status_t ExactContact(
+    exact_shadow_context_t *context,
+    double direction,
+    astro_time_t t1,
+    astro_time_t t2,
+    astro_time_t *contact)
 {
-    int error = 1;
-    astro_time_t time;
-    astro_vector_t vector;
-    double dx, dy, dz, diff, dist, arcmin;
+    astro_search_result_t search;
 
-    time = Astronomy_TimeFromDays(ut);
+    context->direction = direction;
+    search = Astronomy_Search(ExactShadowFunc, context, t1, t2, 1.0);
+    *contact = search.time;
+    return search.status;
+}
 
-    DEBUG("C %s: ", __func__);
-    if (Verbose) PrintTime(time);
-    DEBUG(" = %0.6lf UT = %0.6lf TT\n", time.ut, time.tt);
+static astro_status_t ExactSemiDuration(exact_shadow_context_t *context, astro_time_t peak, double radius_limit, double window_minutes, double *minutes)
+{
+    astro_status_t status;
+    astro_time_t t1, t2;
+    double window = window_minutes / MINUTES_PER_DAY;
 
-    vector = Astronomy_HelioVector(BODY_PLUTO, time);
-    if (vector.status != ASTRO_SUCCESS)
-        FFAIL("FAIL - Astronomy_HelioVector returned status = %d\n", vector.status);
+    context->radius_limit = radius_limit;
+    status = ExactContact(context, -1.0, Astronomy_AddDays(peak, -window), peak, &t1);
+    if (status != ASTRO_SUCCESS)
+        return status;
+    status = ExactContact(context, +1.0, peak, Astronomy_AddDays(peak, +window), &t2);
+    if (status != ASTRO_SUCCESS)
+        return status;
+    *minutes = (t2.ut - t1.ut) * (MINUTES_PER_DAY / 2.0);
+    return ASTRO_SUCCESS;
+}
 
-    dx = V(vector.x) - x;
-    dy = V(vector.y) - y;
-    dz = V(vector.z) - z;
-    diff = sqrt(dx*dx + dy*dy + dz*dz);
-    dist = (sqrt(x*x + y*y + z*z) - 1.0);       /* worst-case distance between Pluto and Earth */
-    arcmin = (diff / dist) * (180.0 * 60.0 / PI);
-    FDEBUG("calc pos = [%20.16lf, %20.16lf, %20.16lf]\n", vector.x, vector.y, vector.z);
-    FDEBUG("ref  pos = [%20.16lf, %20.16lf, %20.16lf]\n", x, y, z);
-    FDEBUG("del  pos = [%20.16lf, %20.16lf, %20.16lf]\n", vector.x - x, vector.y - y, vector.z - z);
-    FDEBUG("diff = %le AU, %0.3lf arcmin\n", diff, arcmin);
-    DEBUG("\n");
+static int ShadowInterpLunar(int count, double *maxdiff)
+{
+    int error, i;
+    astro_lunar_eclipse_t eclipse;
+    exact_shadow_context_t context;
+    double r, k, p, penum, partial, total, diff;
 
-    if (V(arcmin) > arcmin_tolerance)
-        FFAIL("EXCESSIVE ERROR\n");
+    memset(&context, 0, sizeof(context));
+    context.kind = SHADOW_LUNAR;
+    *maxdiff = 0.0;
 
+    eclipse = Astronomy_SearchLunarEclipse(Astronomy_MakeTime(1900, 1, 1, 0, 0, 0.0));
+    for (i = 0; i < count; ++i)
+    {
+        CHECK_STATUS(eclipse);
+        CHECK(ExactShadowAt(&context, eclipse.peak, &r, &k, &p));
+        CHECK(ExactSemiDuration(&context, eclipse.peak, p + 1737.4, 200.0, &penum));
+        diff = SECONDS_PER_DAY / MINUTES_PER_DAY * fabs(penum - eclipse.sd_penum);
+        if (eclipse.kind != ECLIPSE_PENUMBRAL)
+        {
+            CHECK(ExactSemiDuration(&context, eclipse.peak, k + 1737.4, penum, &partial));
+            diff = fmax(diff, SECONDS_PER_DAY / MINUTES_PER_DAY * fabs(partial - eclipse.sd_partial));
+            if (eclipse.kind == ECLIPSE_TOTAL)
+            {
+                CHECK(ExactSemiDuration(&context, eclipse.peak, k - 1737.4, partial, &total));
+                diff = fmax(diff, SECONDS_PER_DAY / MINUTES_PER_DAY * fabs(total - eclipse.sd_total));
+            }
+        }
+        if (diff > *maxdiff)
+            *maxdiff = diff;
+        eclipse = Astronomy_NextLunarEclipse(eclipse.peak);
+    }
     error = 0;
 fail:
     return error;
 }
 
-
-static int PlutoCheck(void)
+static int ShadowInterpTransit(astro_body_t body, double radius_km, int year, int count, double *maxdiff)
 {
-    int error;
-    CHECK(PlutoCheckDate(  +18250.0, 0.089, +37.4377303523676090, -10.2466292454075898, -14.4773101310875809));
-    CHECK(PlutoCheckDate( -856493.0, 4.067, +23.4292113199166252, +42.1452685817740829,  +6.0580908436642940));
-    CHECK(PlutoCheckDate( +435633.0, 0.016, -27.3178902095231813, +18.5887022581070305, +14.0493896259306936));
-    CHECK(PlutoCheckDate(       0.0, 8.e-9,  -9.8753673425269000, -27.9789270580402771,  -5.7537127596369588));
-    CHECK(PlutoCheckDate( +800916.0, 2.286, -29.5266052645301365, +12.0554287322176474, +12.6878484911631091));
+    int error, i;
+    astro_transit_t transit;
+    exact_shadow_context_t context;
+    astro_time_t start, finish;
+    double diff;
 
-    FPASS();
+    memset(&context, 0, sizeof(context));
+    context.kind = SHADOW_TRANSIT;
+    context.body = body;
+    context.radius_km = radius_km;
+    *maxdiff = 0.0;
+
+    transit = Astronomy_SearchTransit(body, Astronomy_MakeTime(year, 1, 1, 0, 0, 0.0));
+    for (i = 0; i < count; ++i)
+    {
+        CHECK_STATUS(transit);
+        CHECK(ExactContact(&context, -1.0, Astronomy_AddDays(transit.peak, -1.0), transit.peak, &start));
+        CHECK(ExactContact(&context, +1.0, transit.peak, Astronomy_AddDays(transit.peak, +1.0), &finish));
+        diff = SECONDS_PER_DAY * fmax(fabs(start.ut - transit.start.ut), fabs(finish.ut - transit.finish.ut));
+        if (diff > *maxdiff)
+            *maxdiff = diff;
+        transit = Astronomy_NextTransit(body, transit.finish);
+    }
+    error = 0;
 fail:
     return error;
 }
 
-/*-----------------------------------------------------------------------------------------------------------*/
-
-static int GeoidTestCase(FILE *outfile, astro_time_t time, astro_observer_t observer, astro_equator_date_t equdate)
+static int ShadowInterpLocal(astro_observer_t observer, int count, double *maxdiff)
 {
-    int error;
-    astro_state_vector_t state;
-    astro_vector_t surface;
-    astro_vector_t geo_moon;
-    astro_equatorial_t topo_moon;
-    double dx, dy, dz, diff, lat_diff, lon_diff, h_diff;
-    astro_observer_t vobs;
+    int error, i;
+    astro_local_solar_eclipse_t eclipse;
+    exact_shadow_context_t context;
+    astro_time_t peak, t1, t2;
+    double diff;
 
-    topo_moon = Astronomy_Equator(BODY_MOON, &time, observer, equdate, NO_ABERRATION);
-    CHECK_STATUS(topo_moon);
+    memset(&context, 0, sizeof(context));
+    context.observer = observer;
+    *maxdiff = 0.0;
+
+    eclipse = Astronomy_SearchLocalSolarEclipse(Astronomy_MakeTime(1900, 1, 1, 0, 0, 0.0), observer);
+    for (i = 0; i < count; ++i)
+    {
+        CHECK_STATUS(eclipse);
+
+        /* The library reports the peak of the shadow geometry as the time of eclipse.peak. */
+        peak = eclipse.peak.time;
+        context.kind = SHADOW_LOCAL_PARTIAL;
+        CHECK(ExactContact(&context, +1.0, Astronomy_AddDays(peak, -0.2), peak, &t1));
+        CHECK(ExactContact(&context, -1.0, peak, Astronomy_AddDays(peak, +0.2), &t2));
+        diff = fmax(fabs(t1.ut - eclipse.partial_begin.time.ut), fabs(t2.ut - eclipse.partial_end.time.ut));
+        if (eclipse.kind != ECLIPSE_PARTIAL)
+        {
+            context.kind = SHADOW_LOCAL_TOTAL;
+            CHECK(ExactContact(&context, +1.0, Astronomy_AddDays(peak, -0.01), peak, &t1));
+            CHECK(ExactContact(&context, -1.0, peak, Astronomy_AddDays(peak, +0.01), &t2));
+            diff = fmax(diff, fmax(fabs(t1.ut - eclipse.total_begin.time.ut), fabs(t2.ut - eclipse.total_end.time.ut)));
+        }
+        diff *= SECONDS_PER_DAY;
+        if (diff > *maxdiff)
+            *maxdiff = diff;
+        eclipse = Astronomy_NextLocalSolarEclipse(eclipse.peak.time, observer);
+    }
+    error = 0;
+fail:
+    return error;
+}
+
+static int ShadowInterpTest(void)
+{
+    int error;
+    double lunar, mercury, venus, local1, local2;
+
+    CHECK(ShadowInterpLunar(500, &lunar));
+    CHECK(ShadowInterpTransit(BODY_MERCURY, 2439.7, 1800, 50, &mercury));
+    CHECK(ShadowInterpTransit(BODY_VENUS, 6051.8, 1600, 6, &venus));
+    CHECK(ShadowInterpLocal(Astronomy_MakeObserver(+29.0, -82.0, 0.0), 100, &local1));
+    CHECK(ShadowInterpLocal(Astronomy_MakeObserver(-64.0, +145.0, 0.0), 100, &local2));
+
+    DEBUG("C ShadowInterpTest: max contact error [seconds]: lunar = %0.3le, Mercury = %0.3le, Venus = %0.3le, local = %0.3le, %0.3le\n",
+        lunar, mercury, venus, local1, local2);
+
+    /*
+        The fit differs from the exact geometry by far less than the 1-second search tolerance,
+        but that is enough to move where each search stops by a few microseconds.
+    */
+    if (lunar > 1.0e-5)
+        FFAIL("excessive lunar eclipse semi-duration error: %le seconds\n", lunar);
+
+    if (mercury > 1.0e-4 || venus > 1.0e-4)
+        FFAIL("excessive transit contact error: Mercury %le, Venus %le seconds\n", mercury, venus);
+
+    if (local1 > 3.4e-3 || local2 > 3.4e-3)
+        FFAIL("excessive local solar eclipse contact error: %le, %le seconds\n", local1, local2);
+
+    FPASS();
+fail:
+    return error;
+}
+
+static astro_func_result_t ExactShadowSlope(void *context, astro_time_t time)
+{
+    const double dt = 1.0 / SECONDS_PER_DAY;
+    const exact_shadow_context_t *c = (const exact_shadow_context_t *) context;
+    astro_func_result_t result;
+    double r1, r2, k, p;
+
+    result.status = ExactShadowAt(c, Astronomy_AddDays(time, -dt), &r1, &k, &p);
+    if (result.status == ASTRO_SUCCESS)
+        result.status = ExactShadowAt(c, Astronomy_AddDays(time, +dt), &r2, &k, &p);
+    result.value = (result.status == ASTRO_SUCCESS) ? (r2 - r1) / dt : NAN;
+    return result;
+}
+
+static int EclipseSeasonScan(exact_shadow_context_t *context, int year, int nyears, int *count)
+{
+    /*
+        Visit every full moon (lunar eclipses) or new moon (solar eclipses) in the given years,
+        without skipping any lunation, and compare the eclipses found there with the
+        library's search, which skips the lunations far from the lunar nodes.
+    */
+    int error, nfound = 0;
+    astro_time_t time, stop;
+    astro_search_result_t phase, peak;
+    astro_spherical_t moon;
+    astro_lunar_eclipse_t lunar;
+    astro_global_solar_eclipse_t solar;
+    double r, k, p, limit, library_ut;
+    const int is_lunar = (context->kind == SHADOW_LUNAR);
+
+    time = Astronomy_MakeTime(year, 1, 1, 0, 0, 0.0);
+    stop = Astronomy_MakeTime(year + nyears, 1, 1, 0, 0, 0.0);
+
+    if (is_lunar)
+    {
+        lunar = Astronomy_SearchLunarEclipse(time);
+        CHECK_STATUS(lunar);
+        library_ut = lunar.peak.ut;
+    }
+    else
+    {
+        solar = Astronomy_SearchGlobalSolarEclipse(time);
+        CHECK_STATUS(solar);
+        library_ut = solar.peak.ut;
+    }
+
+    for(;;)
+    {
+        phase = Astronomy_SearchMoonPhase(is_lunar ? 180.0 : 0.0, time, 40.0);
+        CHECK_STATUS(phase);
+        if (phase.time.ut >= stop.ut)
+            break;
+
+        moon = Astronomy_EclipticGeoMoon(phase.time);
+        CHECK_STATUS(moon);
+        if (fabs(moon.lat) < 1.8)
+        {
+            peak = Astronomy_Search(ExactShadowSlope, context, Astronomy_AddDays(phase.time, -0.03), Astronomy_AddDays(phase.time, +0.03), 1.0);
+            CHECK_STATUS(peak);
+            CHECK(ExactShadowAt(context, peak.time, &r, &k, &p));
+            limit = p + (is_lunar ? 1737.4 : 6371.0);
+            if (r < limit)
+            {
+                /* The library must find this same eclipse next. */
+                if (fabs(peak.time.ut - library_ut) * SECONDS_PER_DAY > 1.0)
+                    FFAIL("%s eclipse at ut=%0.6lf, but the library found ut=%0.6lf\n", is_lunar ? "lunar" : "solar", peak.time.ut, library_ut);
+
+                ++nfound;
+                if (is_lunar)
+                {
+                    lunar = Astronomy_NextLunarEclipse(lunar.peak);
+                    CHECK_STATUS(lunar);
+                    library_ut = lunar.peak.ut;
+                }
+                else
+                {
+                    solar = Astronomy_NextGlobalSolarEclipse(solar.peak);
+                    CHECK_STATUS(solar);
+                    library_ut = solar.peak.ut;
+                }
+            }
+        }
+        time = Astronomy_AddDays(phase.time, 10.0);
+    }
+
+    /* The library must not find any eclipse the full scan missed. */
+    if (library_ut < stop.ut)
+        FFAIL("library found an extra %s eclipse at ut=%0.6lf\n", is_lunar ? "lunar" : "solar", library_ut);
+
+    *count = nfound;
+    error = 0;
+fail:
+    return error;
+}
+
+static int EclipseSeasonTest(void)
+{
+    int error, n, nlunar = 0, nsolar = 0;
+    exact_shadow_context_t context;
+
+    memset(&context, 0, sizeof(context));
+    context.kind = SHADOW_LUNAR;
+    CHECK(EclipseSeasonScan(&context, -1500, 300, &n));
+    nlunar += n;
+    CHECK(EclipseSeasonScan(&context, 1700, 600, &n));
+    nlunar += n;
+
+    context.kind = SHADOW_SOLAR;
+    CHECK(EclipseSeasonScan(&context, -1500, 300, &n));
+    nsolar += n;
+    CHECK(EclipseSeasonScan(&context, 1700, 600, &n));
+    nsolar += n;
+
+    DEBUG("C EclipseSeasonTest: %d lunar and %d solar eclipses match the unpruned search.\n", nlunar, nsolar);
+    FPASS();
+fail:
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int DistancePlot(astro_body_t body, double ut1, double ut2, const char *filename)
+{
+    const int npoints = 100000;
+    int error = 1;
+    int i;
+    double ut;
+    astro_time_t time, j2000;
+    astro_func_result_t dist;
+    FILE *outfile = NULL;
+
+    outfile = fopen(filename, "wt");
+    if (outfile == NULL)
+        FFAIL("Cannot open output file: %s\n", filename);
+
+    j2000 = Astronomy_MakeTime(2000, 1, 1, 12, 0, 0.0);
+
+    fprintf(outfile, "\"tt\",\"distance\"\n");
+    for (i=0; i < npoints; ++i)
+    {
+        ut = ut1 + (((double)i)/((double)(npoints-1)) * (ut2 - ut1));
+        time = Astronomy_AddDays(j2000, ut);
+        dist = Astronomy_HelioDistance(body, time);
+        CHECK_STATUS(dist);
+        fprintf(outfile, "%0.16lf,%0.16lg\n", time.tt, dist.value);
+    }
+
+    error = 0;
+fail:
+    if (outfile != NULL) fclose(outfile);
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int PlutoCheckDate(double ut, double arcmin_tolerance, double x, double y, double z)
+{
+    int error = 1;
+    astro_time_t time;
+    astro_vector_t vector;
+    double dx, dy, dz, diff, dist, arcmin;
+
+    time = Astronomy_TimeFromDays(ut);
+
+    DEBUG("C %s: ", __func__);
+    if (Verbose) PrintTime(time);
+    DEBUG(" = %0.6lf UT = %0.6lf TT\n", time.ut, time.tt);
+
+    vector = Astronomy_HelioVector(BODY_PLUTO, time);
+    if (vector.status != ASTRO_SUCCESS)
+        FFAIL("FAIL - Astronomy_HelioVector returned status = %d\n", vector.status);
+
+    dx = V(vector.x) - x;
+    dy = V(vector.y) - y;
+    dz = V(vector.z) - z;
+    diff = sqrt(dx*dx + dy*dy + dz*dz);
+    dist = (sqrt(x*x + y*y + z*z) - 1.0);       /* worst-case distance between Pluto and Earth */
+    arcmin = (diff / dist) * (180.0 * 60.0 / PI);
+    FDEBUG("calc pos = [%20.16lf, %20.16lf, %20.16lf]\n", vector.x, vector.y, vector.z);
+    FDEBUG("ref  pos = [%20.16lf, %20.16lf, %20.16lf]\n", x, y, z);
+    FDEBUG("del  pos = [%20.16lf, %20.16lf, %20.16lf]\n", vector.x - x, vector.y - y, vector.z - z);
+    FDEBUG("diff = %le AU, %0.3lf arcmin\n", diff, arcmin);
+    DEBUG("\n");
+
+    if (V(arcmin) > arcmin_tolerance)
+        FFAIL("EXCESSIVE ERROR\n");
+
+    error = 0;
+fail:
+    return error;
+}
+
+
+static int PlutoCheck(void)
+{
+    int error;
+    CHECK(PlutoCheckDate(  +18250.0, 0.089, +37.4377303523676090, -10.2466292454075898, -14.4773101310875809));
+    CHECK(PlutoCheckDate( -856493.0, 4.067, +23.4292113199166252, +42.1452685817740829,  +6.0580908436642940));
+    CHECK(PlutoCheckDate( +435633.0, 0.016, -27.3178902095231813, +18.5887022581070305, +14.0493896259306936));
+    CHECK(PlutoCheckDate(       0.0, 8.e-9,  -9.8753673425269000, -27.9789270580402771,  -5.7537127596369588));
+    CHECK(PlutoCheckDate( +800916.0, 2.286, -29.5266052645301365, +12.0554287322176474, +12.6878484911631091));
+
+    FPASS();
+fail:
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int GeoidTestCase(FILE *outfile, astro_time_t time, astro_observer_t observer, astro_equator_date_t equdate)
+{
+    int error;
+    astro_state_vector_t state;
+    astro_vector_t surface;
+    astro_vector_t geo_moon;
+    astro_equatorial_t topo_moon;
+    double dx, dy, dz, diff, lat_diff, lon_diff, h_diff;
+    astro_observer_t vobs;
+
+    topo_moon = Astronomy_Equator(BODY_MOON, &time, observer, equdate, NO_ABERRATION);
+    CHECK_STATUS(topo_moon);
 
     surface = Astronomy_ObserverVector(&time, observer, equdate);
     CHECK_STATUS(surface);
@@ -5983,6 +6808,75 @@ fail:
     return error;
 }
 
+static int LagrangeBatchCase(astro_body_t major_body, astro_body_t minor_body)
+{
+    enum { NTIMES = 1600 };
+    static astro_time_t times[NTIMES];
+    static astro_lagrange_points_t batch[NTIMES];
+    int error, i, p;
+    astro_lagrange_points_t all;
+    astro_state_vector_t single;
+    double pos[3], vel[3], dpos, dvel, maxpos = 0.0, maxvel = 0.0;
+
+    for (i = 0; i < NTIMES; ++i)
+        times[i] = Astronomy_AddDays(Astronomy_MakeTime(2027, 3, 1, 0, 0, 0.0), 0.25 * i);
+
+    CHECK(Astronomy_LagrangePointsBatch(times, NTIMES, major_body, minor_body, batch));
+
+    for (i = 0; i < NTIMES; i += 7)
+    {
+        all = Astronomy_LagrangePoints(times[i], major_body, minor_body);
+        CHECK_STATUS(all);
+        for (p = 0; p < 5; ++p)
+        {
+            single = Astronomy_LagrangePoint(p+1, times[i], major_body, minor_body);
+            CHECK_STATUS(single);
+            if (single.x != all.point[p].x || single.y != all.point[p].y || single.z != all.point[p].z ||
+                single.vx != all.point[p].vx || single.vy != all.point[p].vy || single.vz != all.point[p].vz)
+                FFAIL("Astronomy_LagrangePoints(%d, %d) L%d differs at i=%d\n", major_body, minor_body, p+1, i);
+
+            pos[0] = single.x;   vel[0] = single.vx;
+            pos[1] = single.y;   vel[1] = single.vy;
+            pos[2] = single.z;   vel[2] = single.vz;
+            dpos = StateVectorDiff(1, pos, batch[i].point[p].x, batch[i].point[p].y, batch[i].point[p].z);
+            dvel = StateVectorDiff(1, vel, batch[i].point[p].vx, batch[i].point[p].vy, batch[i].point[p].vz);
+            if (dpos > maxpos) maxpos = dpos;
+            if (dvel > maxvel) maxvel = dvel;
+        }
+    }
+
+    DEBUG("C LagrangeBatchCase(%d, %d): max relative error: pos = %0.3le, vel = %0.3le\n", major_body, minor_body, maxpos, maxvel);
+    if (maxpos > 1.0e-13 || maxvel > 1.0e-13)
+        FFAIL("excessive batch error for bodies (%d, %d)\n", major_body, minor_body);
+
+    error = 0;
+fail:
+    return error;
+}
+
+
+static int LagrangeBatchTest(void)
+{
+    int error;
+    astro_time_t time = Astronomy_MakeTime(2027, 3, 1, 0, 0, 0.0);
+    astro_lagrange_points_t points;
+
+    CHECK(LagrangeBatchCase(BODY_SUN, BODY_EMB));
+    CHECK(LagrangeBatchCase(BODY_EARTH, BODY_MOON));
+    CHECK(LagrangeBatchCase(BODY_SUN, BODY_JUPITER));
+
+    points = Astronomy_LagrangePoints(time, BODY_SUN, BODY_INVALID);
+    if (points.status != ASTRO_INVALID_BODY || points.point[0].status != ASTRO_INVALID_BODY)
+        FFAIL("expected ASTRO_INVALID_BODY, but found %d\n", (int)points.status);
+
+    if (Astronomy_LagrangePointsBatch(&time, 1, BODY_SUN, BODY_EARTH, NULL) != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for NULL output\n");
+
+    FPASS();
+fail:
+    return error;
+}
+
 /*-----------------------------------------------------------------------------------------------------------*/
 
 static int LoadStateVectors(
@@ -5993,24 +6887,22 @@ static int LoadStateVectors(
     int found_begin = 0;
     int found_end = 0;
     int part = 0;
-    FILE *infile = NULL;
-    char line[100];
+    text_file_t infile;
+    text_line_t line;
     double jd;
     astro_state_vector_t state;
 
     memset(&state, 0, sizeof(state));
 
-    infile = fopen(filename, "rt");
-    if (infile == NULL)
+    if (TextFileOpen(&infile, filename))
         FFAIL("Cannot open input file: %s\n", filename);
 
-    lnum = 0;
-    while (!found_end && ReadLine(line, sizeof(line), infile, filename, lnum))
+    while (!found_end && TextFileReadLine(&infile, &line))
     {
-        ++lnum;
+        lnum = infile.lnum;
         if (!found_begin)
         {
-            if (strlen(line) >= 5 && !memcmp(line, "$$SOE", 5))
+            if (TextLineStartsWith(&line, "$$SOE"))
                 found_begin = 1;
         }
         else
@@ -6028,13 +6920,13 @@ static int LoadStateVectors(
             switch (part)
             {
             case 0:
-                if (strlen(line) >= 5 && !memcmp(line, "$$EOE", 5))
+                if (TextLineStartsWith(&line, "$$EOE"))
                 {
                     found_end = 1;
                 }
                 else
                 {
-                    nscanned = sscanf(line, "%lf", &jd);
+                    nscanned = TextScan(&line, 0, "%lf", &jd);
                     if (nscanned != 1)
                         FAIL("C LoadStateVectors(%s line %d) ERROR reading Julian date.\n", filename, lnum);
                     V(jd);
@@ -6045,7 +6937,7 @@ static int LoadStateVectors(
                 break;
 
             case 1:
-                nscanned = sscanf(line, " X =%lf Y =%lf Z =%lf", &state.x, &state.y, &state.z);
+                nscanned = TextScan(&line, 0, " X =%lf Y =%lf Z =%lf", &state.x, &state.y, &state.z);
                 if (nscanned != 3)
                     FAIL("C LoadStateVectors(%s line %d) ERROR reading position vector.\n", filename, lnum);
                 V(state.x);
@@ -6054,7 +6946,7 @@ static int LoadStateVectors(
                 break;
 
             case 2:
-                nscanned = sscanf(line, " VX=%lf VY=%lf VZ=%lf", &state.vx, &state.vy, &state.vz);
+                nscanned = TextScan(&line, 0, " VX=%lf VY=%lf VZ=%lf", &state.vx, &state.vy, &state.vz);
                 if (nscanned != 3)
                     FAIL("C LoadStateVectors(%s line %d) ERROR reading velocity vector.\n", filename, lnum);
                 V(state.vx);
@@ -6074,7 +6966,7 @@ static int LoadStateVectors(
 
     error = 0;
 fail:
-    if (infile != NULL) fclose(infile);
+    TextFileClose(&infile);
     return error;
 }
 
@@ -6857,6 +7749,149 @@ fail:
 
 /*-----------------------------------------------------------------------------------------------------------*/
 
+static int KernelTest(void)
+{
+    enum { NTIMES = 101, NMOON = 19, NGRAV = 3 };
+    static const double gm[NGRAV] = { 2.9591220828559115e-04, 2.8253458420837781e-07, 8.9970116036316091e-10 };
+    static const double gx[NGRAV] = { 0.0, 5.2, -0.3 };
+    static const double gy[NGRAV] = { 0.0, 0.4, 0.9 };
+    static const double gz[NGRAV] = { 0.0, -0.1, 0.02 };
+    astro_vsop_table_t table;
+    astro_gravity_field_t field;
+    astro_rotation_t rot;
+    astro_vector_t vec, rvec;
+    astro_spherical_t sphere;
+    astro_time_t time;
+    double tt[NTIMES], x[NTIMES], y[NTIMES], z[NTIMES], ax[NTIMES], ay[NTIMES], az[NTIMES];
+    double lon[NMOON], lat[NMOON], dist[NMOON];
+    double dx, dy, dz, r2, pull, sx, sy, sz, dlon, max_arcsec;
+    int error, body, i, j;
+
+    memset(&table, 0, sizeof(table));
+
+    for (i = 0; i < NTIMES; ++i)
+        tt[i] = -36525.0 + 730.5*i;
+
+    /* The flat tables must reproduce the planets' positions exactly. */
+    for (body = BODY_MERCURY; body <= BODY_NEPTUNE; ++body)
+    {
+        CHECK(Astronomy_VsopTableInit(&table, (astro_body_t)body));
+        if (table.formula_start[0] != 0 || table.formula_start[3] != table.nseries || table.series_start[table.nseries] != table.nterms)
+            FFAIL("body %d: inconsistent table offsets\n", body);
+
+        CHECK(Astronomy_KernelVsop(&table, NTIMES, tt, x, y, z));
+        for (i = 0; i < NTIMES; ++i)
+        {
+            vec = Astronomy_HelioVector((astro_body_t)body, Astronomy_TerrestrialTime(tt[i]));
+            CHECK_STATUS(vec);
+            if (vec.x != x[i] || vec.y != y[i] || vec.z != z[i])
+                FFAIL("body %d, tt = %lf: kernel does not match Astronomy_HelioVector\n", body, tt[i]);
+        }
+
+        Astronomy_VsopTableFree(&table);
+        if (table.amplitude != NULL)
+            FFAIL("Astronomy_VsopTableFree did not reset the table\n");
+    }
+
+    if (Astronomy_VsopTableInit(&table, BODY_PLUTO) != ASTRO_INVALID_BODY)
+        FFAIL("expected ASTRO_INVALID_BODY for BODY_PLUTO\n");
+
+    if (Astronomy_KernelVsop(&table, NTIMES, tt, x, y, z) != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for an empty table\n");
+
+    /* The Moon kernel omits only the nutation that Astronomy_EclipticGeoMoon adds. */
+    CHECK(Astronomy_KernelMoon(NMOON, tt, lon, lat, dist));
+    max_arcsec = 0.0;
+    for (i = 0; i < NMOON; ++i)
+    {
+        time = Astronomy_TerrestrialTime(tt[i]);
+        sphere = Astronomy_EclipticGeoMoon(time);
+        CHECK_STATUS(sphere);
+        if (fabs(sphere.dist - dist[i]) > 1.0e-14)
+            FFAIL("tt = %lf: Moon distance mismatch = %le AU\n", tt[i], sphere.dist - dist[i]);
+        dlon = fmod(sphere.lon - RAD2DEG*lon[i] + 540.0, 360.0) - 180.0;
+        dlon = 3600.0 * fabs(dlon);
+        if (dlon > max_arcsec)
+            max_arcsec = dlon;
+        if (3600.0 * fabs(sphere.lat - RAD2DEG*lat[i]) > 1.0)
+            FFAIL("tt = %lf: Moon latitude mismatch\n", tt[i]);
+    }
+    DEBUG("C KernelTest: max Moon longitude difference = %0.3lf arcsec\n", max_arcsec);
+    if (max_arcsec > 20.0)
+        FFAIL("excessive Moon longitude difference = %lf arcsec\n", max_arcsec);
+
+    /* Rotations must match Astronomy_RotateVector exactly, even in place. */
+    rot = Astronomy_Rotation_EQJ_ECL();
+    for (i = 0; i < NTIMES; ++i)
+    {
+        x[i] = cos(0.1*i);
+        y[i] = sin(0.3*i);
+        z[i] = 0.01*i;
+    }
+    CHECK(Astronomy_KernelRotate(&rot, NTIMES, x, y, z, ax, ay, az));
+    CHECK(Astronomy_KernelRotate(&rot, NTIMES, x, y, z, x, y, z));
+    for (i = 0; i < NTIMES; ++i)
+    {
+        vec.status = ASTRO_SUCCESS;
+        vec.t = time;
+        vec.x = cos(0.1*i);
+        vec.y = sin(0.3*i);
+        vec.z = 0.01*i;
+        rvec = Astronomy_RotateVector(rot, vec);
+        CHECK_STATUS(rvec);
+        if (rvec.x != ax[i] || rvec.y != ay[i] || rvec.z != az[i])
+            FFAIL("element %d: Astronomy_KernelRotate does not match Astronomy_RotateVector\n", i);
+        if (rvec.x != x[i] || rvec.y != y[i] || rvec.z != z[i])
+            FFAIL("element %d: in-place Astronomy_KernelRotate mismatch\n", i);
+    }
+
+    rot.status = ASTRO_INVALID_PARAMETER;
+    if (Astronomy_KernelRotate(&rot, NTIMES, x, y, z, ax, ay, az) != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for an invalid rotation\n");
+
+    /* The accelerations must match a direct sum of the pulls in the same order. */
+    field.count = NGRAV;
+    field.gm = gm;
+    field.x = gx;
+    field.y = gy;
+    field.z = gz;
+    for (i = 0; i < NTIMES; ++i)
+    {
+        x[i] = 1.0 + 0.05*i;
+        y[i] = -0.5 + 0.01*i;
+        z[i] = 0.002*i;
+    }
+    CHECK(Astronomy_KernelAccelerations(&field, NTIMES, x, y, z, ax, ay, az));
+    for (i = 0; i < NTIMES; ++i)
+    {
+        sx = sy = sz = 0.0;
+        for (j = 0; j < NGRAV; ++j)
+        {
+            dx = gx[j] - x[i];
+            dy = gy[j] - y[i];
+            dz = gz[j] - z[i];
+            r2 = dx*dx + dy*dy + dz*dz;
+            pull = gm[j] / (r2 * sqrt(r2));
+            sx += dx * pull;
+            sy += dy * pull;
+            sz += dz * pull;
+        }
+        if (sx != ax[i] || sy != ay[i] || sz != az[i])
+            FFAIL("element %d: Astronomy_KernelAccelerations mismatch\n", i);
+    }
+
+    field.count = -1;
+    if (Astronomy_KernelAccelerations(&field, NTIMES, x, y, z, ax, ay, az) != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for a negative count\n");
+
+    FPASS();
+fail:
+    Astronomy_VsopTableFree(&table);
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
 static int MapPerformanceTest(void)
 {
     int error;
@@ -7557,3 +8592,5174 @@ fail:
 }
 
 /*-----------------------------------------------------------------------------------------------------------*/
+
+static int HelioVectorBatchTest(void)
+{
+    /* Verify that batch heliocentric vectors exactly match one-at-a-time calculations. */
+    static const astro_body_t bodies[] =
+    {
+        BODY_SUN, BODY_MERCURY, BODY_VENUS, BODY_EARTH, BODY_MOON, BODY_EMB, BODY_MARS,
+        BODY_JUPITER, BODY_SATURN, BODY_URANUS, BODY_NEPTUNE, BODY_PLUTO, BODY_SSB
+    };
+    const int nbodies = (int)(sizeof(bodies) / sizeof(bodies[0]));
+    enum { NTIMES = 77 };   /* deliberately not a multiple of the internal block size */
+    int error, b, i;
+    astro_time_t times[NTIMES];
+    astro_vector_t batch[NTIMES];
+    astro_vector_t single;
+    astro_status_t status;
+
+    for (i = 0; i < NTIMES; ++i)
+        times[i] = Astronomy_TimeFromDays(-36525.0 + 987.654321*i);
+
+    for (b = 0; b < nbodies; ++b)
+    {
+        status = Astronomy_HelioVectorBatch(bodies[b], times, NTIMES, batch);
+        if (status != ASTRO_SUCCESS)
+            FFAIL("Astronomy_HelioVectorBatch(%s) returned status %d\n", Astronomy_BodyName(bodies[b]), status);
+
+        for (i = 0; i < NTIMES; ++i)
+        {
+            CHECK_VECTOR(single, Astronomy_HelioVector(bodies[b], times[i]));
+            CHECK_STATUS(batch[i]);
+            if (batch[i].x != single.x || batch[i].y != single.y || batch[i].z != single.z || batch[i].t.tt != single.t.tt)
+                FFAIL("%s mismatch at index %d: batch=(%0.16lf, %0.16lf, %0.16lf), single=(%0.16lf, %0.16lf, %0.16lf)\n",
+                    Astronomy_BodyName(bodies[b]), i, batch[i].x, batch[i].y, batch[i].z, single.x, single.y, single.z);
+        }
+    }
+
+    status = Astronomy_HelioVectorBatch(BODY_INVALID, times, NTIMES, batch);
+    if (status != ASTRO_INVALID_BODY)
+        FFAIL("expected ASTRO_INVALID_BODY for invalid body, but got %d\n", status);
+
+    status = Astronomy_HelioVectorBatch(BODY_EARTH, NULL, 1, batch);
+    if (status != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for NULL times, but got %d\n", status);
+
+    status = Astronomy_HelioVectorBatch(BODY_EARTH, NULL, 0, NULL);
+    if (status != ASTRO_SUCCESS)
+        FFAIL("expected ASTRO_SUCCESS for empty batch, but got %d\n", status);
+
+    FPASSA("%d bodies, %d times.\n", nbodies, NTIMES);
+fail:
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int HelioStepperCase(astro_body_t body, double stepDays, int resyncSteps, int nsteps, double tolerance, double *maxdiff)
+{
+    int error, i;
+    astro_stepper_t *stepper = NULL;
+    astro_time_t time = Astronomy_MakeTime(1987, 4, 15, 7, 30, 0.0);
+    astro_vector_t a, b;
+    astro_status_t status;
+    double diff;
+
+    status = Astronomy_HelioStepperInit(&stepper, body, time, stepDays, resyncSteps);
+    if (status != ASTRO_SUCCESS)
+        FFAIL("Astronomy_HelioStepperInit(%s) returned %d\n", Astronomy_BodyName(body), status);
+
+    for (i = 0; i < nsteps; ++i)
+    {
+        CHECK_VECTOR(a, Astronomy_HelioStepperNext(stepper));
+        if (a.t.tt != time.tt + (i * stepDays))
+            FFAIL("%s: incorrect time at step %d\n", Astronomy_BodyName(body), i);
+        CHECK_VECTOR(b, Astronomy_HelioVector(body, a.t));
+        diff = sqrt((a.x-b.x)*(a.x-b.x) + (a.y-b.y)*(a.y-b.y) + (a.z-b.z)*(a.z-b.z)) / Astronomy_VectorLength(b);
+        if (diff > *maxdiff)
+            *maxdiff = diff;
+        if (diff > tolerance)
+            FFAIL("%s: EXCESSIVE relative error %0.3le at step %d\n", Astronomy_BodyName(body), diff, i);
+    }
+
+    error = 0;
+fail:
+    Astronomy_StepperFree(stepper);
+    return error;
+}
+
+static double StateDiff(astro_state_vector_t a, astro_state_vector_t b)
+{
+    double dr = sqrt((a.x-b.x)*(a.x-b.x) + (a.y-b.y)*(a.y-b.y) + (a.z-b.z)*(a.z-b.z));
+    double r  = sqrt(b.x*b.x + b.y*b.y + b.z*b.z);
+    return dr / r;
+}
+
+static int JupiterMoonsStepperCase(double stepDays, int resyncSteps, int nsteps, double tolerance, double *maxdiff)
+{
+    int error, i, m;
+    astro_stepper_t *stepper = NULL;
+    astro_time_t time = Astronomy_MakeTime(2021, 8, 1, 0, 0, 0.0);
+    astro_jupiter_moons_t a, b;
+    astro_status_t status;
+    double diff[4];
+
+    status = Astronomy_JupiterMoonsStepperInit(&stepper, time, stepDays, resyncSteps);
+    if (status != ASTRO_SUCCESS)
+        FFAIL("Astronomy_JupiterMoonsStepperInit returned %d\n", status);
+
+    for (i = 0; i < nsteps; ++i)
+    {
+        a = Astronomy_JupiterMoonsStepperNext(stepper);
+        CHECK_STATUS(a.io);
+        CHECK_STATUS(a.europa);
+        CHECK_STATUS(a.ganymede);
+        CHECK_STATUS(a.callisto);
+        b = Astronomy_JupiterMoons(a.io.t);
+        diff[0] = StateDiff(a.io, b.io);
+        diff[1] = StateDiff(a.europa, b.europa);
+        diff[2] = StateDiff(a.ganymede, b.ganymede);
+        diff[3] = StateDiff(a.callisto, b.callisto);
+        for (m = 0; m < 4; ++m)
+        {
+            if (diff[m] > *maxdiff)
+                *maxdiff = diff[m];
+            if (diff[m] > tolerance)
+                FFAIL("moon %d: EXCESSIVE relative error %0.3le at step %d\n", m, diff[m], i);
+        }
+    }
+
+    error = 0;
+fail:
+    Astronomy_StepperFree(stepper);
+    return error;
+}
+
+static int StepperTest(void)
+{
+    int error;
+    astro_body_t body;
+    astro_stepper_t *stepper;
+    astro_vector_t vec;
+    double exact = 0.0, helio = 0.0, jm = 0.0;
+    astro_time_t time = Astronomy_MakeTime(2000, 1, 1, 0, 0, 0.0);
+
+    for (body = BODY_MERCURY; body <= BODY_NEPTUNE; ++body)
+    {
+        /* Resynchronizing every step must exactly reproduce Astronomy_HelioVector. */
+        CHECK(HelioStepperCase(body, 0.1, 1, 50, 0.0, &exact));
+        CHECK(HelioStepperCase(body, 0.01, 500, 5000, 1.0e-12, &helio));
+        CHECK(HelioStepperCase(body, -3.7, 200, 2000, 1.0e-12, &helio));
+    }
+
+    CHECK(JupiterMoonsStepperCase(1.0 / MINUTES_PER_DAY, 1000, 30000, 1.0e-11, &jm));
+    CHECK(JupiterMoonsStepperCase(0.25, 100, 1000, 1.0e-11, &jm));
+
+    /* Verify parameter validation. */
+    if (ASTRO_INVALID_BODY != Astronomy_HelioStepperInit(&stepper, BODY_PLUTO, time, 1.0, 100))
+        FFAIL("expected ASTRO_INVALID_BODY for Pluto.\n");
+    if (stepper != NULL)
+        FFAIL("expected NULL stepper after failure.\n");
+    if (ASTRO_INVALID_PARAMETER != Astronomy_HelioStepperInit(&stepper, BODY_MARS, time, 0.0, 100))
+        FFAIL("expected ASTRO_INVALID_PARAMETER for zero step size.\n");
+    if (ASTRO_INVALID_PARAMETER != Astronomy_JupiterMoonsStepperInit(&stepper, time, 1.0, 0))
+        FFAIL("expected ASTRO_INVALID_PARAMETER for zero resync count.\n");
+    if (ASTRO_SUCCESS != Astronomy_JupiterMoonsStepperInit(&stepper, time, 1.0, 10))
+        FFAIL("failed to create Jupiter moons stepper.\n");
+    vec = Astronomy_HelioStepperNext(stepper);
+    Astronomy_StepperFree(stepper);
+    if (vec.status != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER from wrong kind of stepper.\n");
+
+    FPASSA("helio maxdiff = %0.3le, jupiter moons maxdiff = %0.3le\n", helio, jm);
+fail:
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int EphemCacheCase(astro_body_t body, double windowDays, double toleranceKm)
+{
+    int error, i;
+    const int nsamples = 1000;
+    astro_time_t startTime = Astronomy_MakeTime(2031, 7, 4, 0, 0, 0.0);
+    astro_time_t stopTime = Astronomy_AddDays(startTime, windowDays);
+    astro_time_t time;
+    astro_vector_t exact[1000];
+    astro_vector_t cached;
+    astro_status_t status;
+    double dx, dy, dz, diff, maxdiff = 0.0;
+
+    /* Sample at irregular times so that we don't land only on segment boundaries. Include both endpoints. */
+    for (i = 0; i < nsamples; ++i)
+    {
+        time = Astronomy_AddDays(startTime, windowDays * (i / (nsamples - 1.0)) * (i / (nsamples - 1.0)));
+        if (body == BODY_MOON)
+            exact[i] = Astronomy_GeoMoon(time);
+        else
+            exact[i] = Astronomy_HelioVector(body, time);
+        CHECK_STATUS(exact[i]);
+    }
+
+    status = Astronomy_EphemerisCacheInit(body, startTime, stopTime, toleranceKm);
+    if (status != ASTRO_SUCCESS)
+        FFAIL("Astronomy_EphemerisCacheInit(%s) returned status %d\n", Astronomy_BodyName(body), status);
+
+    for (i = 0; i < nsamples; ++i)
+    {
+        if (body == BODY_MOON)
+            CHECK_VECTOR(cached, Astronomy_GeoMoon(exact[i].t));
+        else
+            CHECK_VECTOR(cached, Astronomy_HelioVector(body, exact[i].t));
+
+        if (cached.t.tt != exact[i].t.tt)
+            FFAIL("%s: cached vector has wrong time.\n", Astronomy_BodyName(body));
+
+        dx = cached.x - exact[i].x;
+        dy = cached.y - exact[i].y;
+        dz = cached.z - exact[i].z;
+        diff = KM_PER_AU * V(sqrt(dx*dx + dy*dy + dz*dz));
+        if (diff > maxdiff)
+            maxdiff = diff;
+    }
+
+    /* Each segment is checked where its error peaks, so the tolerance must hold everywhere. */
+    if (maxdiff > toleranceKm)
+        FFAIL("%s: excessive error %lg km (tolerance %lg km)\n", Astronomy_BodyName(body), maxdiff, toleranceKm);
+
+    /* After freeing the cache, calculations must be exact again. */
+    Astronomy_EphemerisCacheFree(body);
+    if (body == BODY_MOON)
+        CHECK_VECTOR(cached, Astronomy_GeoMoon(exact[1].t));
+    else
+        CHECK_VECTOR(cached, Astronomy_HelioVector(body, exact[1].t));
+    if (cached.x != exact[1].x || cached.y != exact[1].y || cached.z != exact[1].z)
+        FFAIL("%s: result is not exact after freeing the cache.\n", Astronomy_BodyName(body));
+
+    DEBUG("C EphemCacheCase(%-7s): window = %7.1lf days, maxdiff = %0.3le km\n", Astronomy_BodyName(body), windowDays, maxdiff);
+    error = 0;
+fail:
+    Astronomy_EphemerisCacheFree(body);
+    return error;
+}
+
+
+static int EphemCacheTest(void)
+{
+    int error;
+    astro_time_t t1 = Astronomy_MakeTime(2000, 1, 1, 0, 0, 0.0);
+    astro_time_t t2 = Astronomy_AddDays(t1, 10.0);
+    astro_status_t status;
+    astro_moon_quarter_t exactQuarter, cachedQuarter;
+
+    CHECK(EphemCacheCase(BODY_MOON,      365.0, 0.001));
+    CHECK(EphemCacheCase(BODY_MERCURY,   365.0, 0.01));
+    CHECK(EphemCacheCase(BODY_VENUS,     365.0, 0.01));
+    CHECK(EphemCacheCase(BODY_EARTH,     365.0, 0.001));
+    CHECK(EphemCacheCase(BODY_MARS,     1000.0, 0.01));
+    CHECK(EphemCacheCase(BODY_JUPITER,  5000.0, 0.1));
+    CHECK(EphemCacheCase(BODY_SATURN,   5000.0, 0.1));
+    CHECK(EphemCacheCase(BODY_URANUS,  10000.0, 0.1));
+    CHECK(EphemCacheCase(BODY_NEPTUNE, 10000.0, 0.1));
+    CHECK(EphemCacheCase(BODY_PLUTO,   10000.0, 1.0));
+
+    /* A search that runs entirely inside the cached windows should find essentially the same event. */
+    CHECK_STATUS(exactQuarter = Astronomy_SearchMoonQuarter(t1));
+    CHECK(Astronomy_EphemerisCacheInit(BODY_MOON,  t1, Astronomy_AddDays(t1, 40.0), 0.001));
+    CHECK(Astronomy_EphemerisCacheInit(BODY_EARTH, t1, Astronomy_AddDays(t1, 40.0), 0.001));
+    CHECK_STATUS(cachedQuarter = Astronomy_SearchMoonQuarter(t1));
+    Astronomy_Reset();
+    if (cachedQuarter.quarter != exactQuarter.quarter || ABS(cachedQuarter.time.ut - exactQuarter.time.ut) * SECONDS_PER_DAY > 0.01)
+        FFAIL("moon quarter mismatch: exact = %0.8lf, cached = %0.8lf\n", exactQuarter.time.ut, cachedQuarter.time.ut);
+
+    /* Verify parameter checking. */
+    status = Astronomy_EphemerisCacheInit(BODY_SUN, t1, t2, 1.0);
+    if (status != ASTRO_INVALID_BODY)
+        FFAIL("expected ASTRO_INVALID_BODY for the Sun, but got %d\n", status);
+
+    status = Astronomy_EphemerisCacheInit(BODY_EMB, t1, t2, 1.0);
+    if (status != ASTRO_INVALID_BODY)
+        FFAIL("expected ASTRO_INVALID_BODY for EMB, but got %d\n", status);
+
+    status = Astronomy_EphemerisCacheInit(BODY_EARTH, t2, t1, 1.0);
+    if (status != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for reversed window, but got %d\n", status);
+
+    status = Astronomy_EphemerisCacheInit(BODY_EARTH, t1, t2, 0.0);
+    if (status != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for zero tolerance, but got %d\n", status);
+
+    /* A window that would need too much memory must be refused before anything is allocated. */
+    status = Astronomy_EphemerisCacheInit(BODY_MOON, t1, Astronomy_AddDays(t1, 600000.0), 1.0);
+    if (status != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for an excessively long window, but got %d\n", status);
+
+    status = Astronomy_MoonCacheInit(t1, Astronomy_AddDays(t1, 1.0e+30), 1.0);
+    if (status != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for a huge Moon cache window, but got %d\n", status);
+
+    FPASS();
+fail:
+    Astronomy_Reset();
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int WriteEphemFile(const char *filename, int numpoly, int nsegs, const double index[][2], const double *coeff, size_t truncate)
+{
+    /* Write a binary ephemeris file by hand, following the layout documented in generate/ephfile.h. */
+    int error;
+    int32_t header[8];
+    size_t ncoeff = (size_t)nsegs * 3 * (size_t)numpoly;
+    FILE *outfile = fopen(filename, "wb");
+    if (outfile == NULL)
+        FFAIL("cannot open output file: %s\n", filename);
+
+    header[0] = 0x01020304;     /* byte order */
+    header[1] = 1;              /* version */
+    header[2] = 3;              /* body */
+    header[3] = numpoly;
+    header[4] = nsegs;
+    header[5] = header[6] = header[7] = 0;
+
+    fwrite("AEPHBIN1", 1, 8, outfile);
+    fwrite(header, sizeof(header), 1, outfile);
+    fwrite(index, sizeof(index[0]), (size_t)nsegs, outfile);
+    fwrite(coeff, sizeof(double), ncoeff - truncate, outfile);
+    error = 0;
+fail:
+    if (outfile != NULL)
+        fclose(outfile);
+    return error;
+}
+
+
+static int EphemFileTest(void)
+{
+    const char *filename = "temp/c_ephem.bin";
+    int error, i;
+    astro_ephem_file_t *file = NULL;
+    astro_status_t status;
+    astro_vector_t vec;
+    double tt, x, y, z;
+
+    /* Three segments of linear polynomials, with a gap between the second and third. */
+    static const double index[3][2] = { {0.0, 10.0}, {10.0, 20.0}, {40.0, 10.0} };
+    static const double overlap[2][2] = { {0.0, 10.0}, {5.0, 10.0} };
+    static const double coeff[3][3][2] =
+    {
+        { {2.0,  1.0}, {0.0, 2.0}, {-4.0, 0.0} },     /* x = 1 + u, y = 2u, z = -2 */
+        { {4.0, -1.0}, {2.0, 0.0}, { 0.0, 1.0} },     /* x = 2 - u, y = 1,  z = u  */
+        { {6.0,  0.0}, {0.0, 3.0}, { 2.0, 0.5} }      /* x = 3,     y = 3u, z = 1 + u/2 */
+    };
+
+    CHECK(WriteEphemFile(filename, 2, 3, index, &coeff[0][0][0], 0));
+    status = Astronomy_EphemFileOpen(&file, filename);
+    if (status != ASTRO_SUCCESS)
+        FFAIL("Astronomy_EphemFileOpen returned status %d\n", status);
+
+    for (i = 0; i <= 500; ++i)
+    {
+        tt = i / 10.0;
+        vec = Astronomy_EphemFileVector(file, Astronomy_TerrestrialTime(tt));
+        if (tt > 30.0 && tt < 40.0)
+        {
+            if (vec.status != ASTRO_BAD_TIME)
+                FFAIL("expected ASTRO_BAD_TIME in gap at tt=%lf, but got %d\n", tt, vec.status);
+            continue;
+        }
+        CHECK_STATUS(vec);
+        if (tt < 10.0)
+        {
+            x = 1.0 + (tt/5.0 - 1.0);
+            y = 2.0 * (tt/5.0 - 1.0);
+            z = -2.0;
+        }
+        else if (tt <= 30.0)
+        {
+            x = 2.0 - (tt/10.0 - 2.0);
+            y = 1.0;
+            z = tt/10.0 - 2.0;
+        }
+        else
+        {
+            x = 3.0;
+            y = 3.0 * (tt/5.0 - 9.0);
+            z = 1.0 + (tt/5.0 - 9.0)/2.0;
+        }
+        if (ABS(vec.x - x) > 1.0e-14 || ABS(vec.y - y) > 1.0e-14 || ABS(vec.z - z) > 1.0e-14 || vec.t.tt != tt)
+            FFAIL("wrong vector at tt=%lf: (%lf, %lf, %lf), expected (%lf, %lf, %lf)\n", tt, vec.x, vec.y, vec.z, x, y, z);
+    }
+
+    vec = Astronomy_EphemFileVector(file, Astronomy_TerrestrialTime(-0.001));
+    if (vec.status != ASTRO_BAD_TIME)
+        FFAIL("expected ASTRO_BAD_TIME before the first segment, but got %d\n", vec.status);
+
+    vec = Astronomy_EphemFileVector(file, Astronomy_TerrestrialTime(50.001));
+    if (vec.status != ASTRO_BAD_TIME)
+        FFAIL("expected ASTRO_BAD_TIME after the last segment, but got %d\n", vec.status);
+
+    Astronomy_EphemFileClose(file);
+    file = NULL;
+
+    /* A truncated file must be rejected. */
+    CHECK(WriteEphemFile(filename, 2, 3, index, &coeff[0][0][0], 1));
+    status = Astronomy_EphemFileOpen(&file, filename);
+    if (status != ASTRO_BAD_FILE_FORMAT || file != NULL)
+        FFAIL("expected ASTRO_BAD_FILE_FORMAT for truncated file, but got %d\n", status);
+
+    /* Overlapping segments must be rejected. */
+    CHECK(WriteEphemFile(filename, 2, 2, overlap, &coeff[0][0][0], 0));
+    status = Astronomy_EphemFileOpen(&file, filename);
+    if (status != ASTRO_BAD_FILE_FORMAT || file != NULL)
+        FFAIL("expected ASTRO_BAD_FILE_FORMAT for overlapping segments, but got %d\n", status);
+
+    status = Astronomy_EphemFileOpen(&file, "temp/this_file_does_not_exist.bin");
+    if (status != ASTRO_FILE_ERROR || file != NULL)
+        FFAIL("expected ASTRO_FILE_ERROR for missing file, but got %d\n", status);
+
+    FPASS();
+fail:
+    Astronomy_EphemFileClose(file);
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+#define PLUTO_THREAD_COUNT      8
+#define PLUTO_THREAD_SAMPLES    400
+
+typedef struct
+{
+    int offset;     /* each thread visits the samples in a different order */
+    astro_vector_t vec[PLUTO_THREAD_SAMPLES];
+}
+pluto_thread_t;
+
+static double PlutoThreadSampleTT(int k)
+{
+    /* Spread the samples over the whole state table, years 0000..4000, a few per segment. */
+    return -730000.0 + k * (1460000.0 / PLUTO_THREAD_SAMPLES);
+}
+
+static void *PlutoThreadWorker(void *arg)
+{
+    pluto_thread_t *thread = (pluto_thread_t *) arg;
+    int i, k;
+
+    for (i = 0; i < PLUTO_THREAD_SAMPLES; ++i)
+    {
+        k = (i + thread->offset) % PLUTO_THREAD_SAMPLES;
+        thread->vec[k] = Astronomy_HelioVector(BODY_PLUTO, Astronomy_TerrestrialTime(PlutoThreadSampleTT(k)));
+    }
+    return NULL;
+}
+
+#ifdef _WIN32
+
+static int PlutoThreadTest(void)
+{
+    printf("C PlutoThreadTest: skipped, because this test uses POSIX threads.\n");
+    return 0;
+}
+
+#else
+
+static int PlutoThreadRun(pluto_thread_t thread[])
+{
+    pthread_t id[PLUTO_THREAD_COUNT];
+    int error = 1;
+    int n, nstarted = 0;
+
+    for (n = 0; n < PLUTO_THREAD_COUNT; ++n)
+    {
+        /* Pairs of threads start at the same place, so that they race for the same segments. */
+        thread[n].offset = (n / 2) * (PLUTO_THREAD_SAMPLES / (PLUTO_THREAD_COUNT / 2));
+        if (pthread_create(&id[n], NULL, PlutoThreadWorker, &thread[n]))
+            FFAIL("cannot create thread %d\n", n);
+        ++nstarted;
+    }
+
+    error = 0;
+fail:
+    for (n = 0; n < nstarted; ++n)
+        pthread_join(id[n], NULL);
+    return error;
+}
+
+static int PlutoThreadTest(void)
+{
+    /*
+        Threads racing to calculate the same missing Pluto segments
+        must all get the same results as a single thread.
+    */
+    static pluto_thread_t thread[PLUTO_THREAD_COUNT];
+    int error, n, k;
+    astro_vector_t vec;
+
+    Astronomy_Reset();      /* start with an empty Pluto cache */
+    CHECK(PlutoThreadRun(thread));
+
+    for (k = 0; k < PLUTO_THREAD_SAMPLES; ++k)
+    {
+        CHECK_VECTOR(vec, Astronomy_HelioVector(BODY_PLUTO, Astronomy_TerrestrialTime(PlutoThreadSampleTT(k))));
+        for (n = 0; n < PLUTO_THREAD_COUNT; ++n)
+        {
+            CHECK_STATUS(thread[n].vec[k]);
+            if (thread[n].vec[k].x != vec.x || thread[n].vec[k].y != vec.y || thread[n].vec[k].z != vec.z)
+                FFAIL("thread %d sample %d differs from the serial result.\n", n, k);
+        }
+    }
+
+    FPASSA("%d threads, %d samples each\n", PLUTO_THREAD_COUNT, PLUTO_THREAD_SAMPLES);
+fail:
+    return error;
+}
+
+#endif
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int PlutoCheckpointTest(void)
+{
+    /*
+        Pluto positions outside the years 0000..4000 are integrated outward from the edge
+        of the state table, leaving checkpoints behind. Verify that the results do not
+        depend on which checkpoints already exist when a calculation starts.
+    */
+    enum { NTIMES = 8 };
+    static const double tt[NTIMES] =
+    {
+        -730000.0 - 29200.0,        /* exactly on the first checkpoint before year 0000 */
+        -730000.0 - 123456.7,
+        -730000.0 - 1.5,
+        -730000.0 - 300000.25,
+        +730000.0 + 29200.0 * 2,    /* exactly on the second checkpoint after year 4000 */
+        +730000.0 + 99999.9,
+        +730000.0 + 0.5,
+        +730000.0 + 250000.0
+    };
+    int error, i, k;
+    astro_vector_t first[NTIMES];
+    astro_vector_t vec;
+
+    Astronomy_Reset();
+    for (i = NTIMES-1; i >= 0; --i)
+        CHECK_VECTOR(first[i], Astronomy_HelioVector(BODY_PLUTO, Astronomy_TerrestrialTime(tt[i])));
+
+    for (k = 0; k < 2; ++k)
+    {
+        /* k=0: checkpoints are already cached; k=1: build them again in a different order. */
+        if (k == 1)
+            Astronomy_Reset();
+
+        for (i = 0; i < NTIMES; ++i)
+        {
+            CHECK_VECTOR(vec, Astronomy_HelioVector(BODY_PLUTO, Astronomy_TerrestrialTime(tt[i])));
+            if (vec.x != first[i].x || vec.y != first[i].y || vec.z != first[i].z)
+                FFAIL("mismatch at tt=%0.2lf (pass %d): (%0.16lf, %0.16lf, %0.16lf) vs (%0.16lf, %0.16lf, %0.16lf)\n",
+                    tt[i], k, vec.x, vec.y, vec.z, first[i].x, first[i].y, first[i].z);
+        }
+    }
+
+    FPASS();
+fail:
+    Astronomy_Reset();
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int PlutoSegmentTest(void)
+{
+    /*
+        Cached Pluto segments store only what CalcPluto reads, in full double precision,
+        so that Pluto's position and velocity stay exactly what they were when each segment
+        stored a complete body_grav_calc_t for every step. These reference states were
+        calculated by that older version of the code. Any lossy encoding of the segments,
+        such as single precision floats, would miss them by more than a kilometer.
+    */
+    enum { NTIMES = 16 };
+    static const struct { double tt; double r[3]; double v[3]; } ref[NTIMES] =
+    {
+        { -696237.5000, { 4.38676837023874384e+01, 9.85170941462856931e+00, -1.01348804197369713e+01 }, { 1.00770958129856256e-04, 2.21255699578140445e-03, 6.58315046742442085e-04 } },
+        { -604987.5000, { 4.39164111749576520e+01, 1.19574844734198891e+01, -9.49415672092751173e+00 }, { -2.42426085360335783e-05, 2.18102316879500817e-03, 6.86307411516977762e-04 } },
+        { -513737.5000, { 4.38659580140872407e+01, 1.39062888995587191e+01, -8.87357503829568017e+00 }, { -1.39169885834402327e-04, 2.14622421956975774e-03, 7.10291606174354682e-04 } },
+        { -422487.5000, { 4.37071916621269310e+01, 1.57766500215021388e+01, -8.24294163077992614e+00 }, { -2.48095615840582837e-04, 2.10892672423344807e-03, 7.31683502198468040e-04 } },
+        { -331237.5000, { 4.34818717981377034e+01, 1.75014005148766607e+01, -7.63870468301595906e+00 }, { -3.48300699625184401e-04, 2.06977335086927939e-03, 7.49913626389886304e-04 } },
+        { -239987.5000, { 4.31764223721796725e+01, 1.91641028489027718e+01, -7.02775027217614401e+00 }, { -4.43882108387865946e-04, 2.02867285542014837e-03, 7.66102683660523000e-04 } },
+        { -148737.5000, { 4.28286795739282340e+01, 2.06854363138628230e+01, -6.44915698677194893e+00 }, { -5.31648622995191259e-04, 1.98697956476447720e-03, 7.79783787181883409e-04 } },
+        { -57487.5000, { 4.24246065585020418e+01, 2.21495286197846397e+01, -5.86947507626163212e+00 }, { -6.15126644140485544e-04, 1.94415583298539023e-03, 7.91771793726327644e-04 } },
+        { 33762.5000, { 4.19998310141145907e+01, 2.34693191199057090e+01, -5.32994857018072565e+00 }, { -6.90821086870381431e-04, 1.90227201807773938e-03, 8.01791946643884098e-04 } },
+        { 125012.5000, { 4.15421747668236563e+01, 2.47305001747474051e+01, -4.79688287736237484e+00 }, { -7.61911725030008243e-04, 1.86020247911551965e-03, 8.10353221101991301e-04 } },
+        { 216262.5000, { 4.10770840464269469e+01, 2.58484561847313117e+01, -4.30822829297177101e+00 }, { -8.25832882371637213e-04, 1.82027429353294294e-03, 8.17504756127973857e-04 } },
+        { 307512.5000, { 4.05949794699167725e+01, 2.69172422250726626e+01, -3.82807686494886301e+00 }, { -8.85933613300778316e-04, 1.78047365247587983e-03, 8.23469708215079097e-04 } },
+        { 398762.5000, { 4.01054024020070372e+01, 2.78623150863974232e+01, -3.38639806446688763e+00 }, { -9.40951830438944915e-04, 1.74297463107820792e-03, 8.28654174713584595e-04 } },
+        { 490012.5000, { 3.96048957430534614e+01, 2.87863893539228854e+01, -2.94569562108492367e+00 }, { -9.93765636319637793e-04, 1.70486160155296695e-03, 8.32877156994094470e-04 } },
+        { 581262.5000, { 3.90891655860561826e+01, 2.96198559689272152e+01, -2.53035738752928108e+00 }, { -1.04358674701988214e-03, 1.66828965520736394e-03, 8.36733833751475073e-04 } },
+        { 672512.5000, { 3.85682366708662983e+01, 3.04576511211870375e+01, -2.10952928095910375e+00 }, { -1.09187423151650394e-03, 1.63021948865994175e-03, 8.39589830149749575e-04 } },
+    };
+    int error, i;
+    astro_state_vector_t state;
+    double dr, dv, maxdr = 0.0, maxdv = 0.0;
+
+    Astronomy_Reset();
+    for (i = 0; i < NTIMES; ++i)
+    {
+        state = Astronomy_BaryState(BODY_PLUTO, Astronomy_TerrestrialTime(ref[i].tt));
+        CHECK_STATUS(state);
+        dr = fmax(fabs(state.x - ref[i].r[0]), fmax(fabs(state.y - ref[i].r[1]), fabs(state.z - ref[i].r[2])));
+        dv = fmax(fabs(state.vx - ref[i].v[0]), fmax(fabs(state.vy - ref[i].v[1]), fabs(state.vz - ref[i].v[2])));
+        if (dr > maxdr) maxdr = dr;
+        if (dv > maxdv) maxdv = dv;
+    }
+
+    DEBUG("C PlutoSegmentTest: max error = %0.3le AU, %0.3le AU/day\n", maxdr, maxdv);
+    if (maxdr > 1.0e-12 || maxdv > 1.0e-16)
+        FFAIL("excessive error: %le AU, %le AU/day\n", maxdr, maxdv);
+
+    FPASS();
+fail:
+    Astronomy_Reset();
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int CorruptPlutoCacheFile(const char *filename, int step, int field, double delta, astro_status_t expected)
+{
+    /*
+        Copy the first segment of a Pluto cache file to a second file, changing one of its doubles,
+        and verify the status Astronomy_PlutoCacheLoad returns for it. The layout is the one written by
+        Astronomy_PlutoCacheSave: a 24-byte header, then for each segment a 32-bit index,
+        the segment start time, and each step's position, velocity, and mean acceleration.
+    */
+    const char *badname = "temp/c_pluto_cache_bad.bin";
+    enum { HEADER_SIZE = 24, STEP_SIZE = 9 * sizeof(double) };
+    static char buffer[HEADER_SIZE + sizeof(int32_t) + sizeof(double) + 201*STEP_SIZE];
+    int error;
+    int32_t count = 1;
+    double value;
+    size_t offset = HEADER_SIZE + sizeof(int32_t) + sizeof(double) + (size_t)step*STEP_SIZE + (size_t)field*sizeof(double);
+    astro_status_t status;
+    FILE *file;
+
+    file = fopen(filename, "rb");
+    if (file == NULL)
+        FFAIL("cannot open input file: %s\n", filename);
+    if (1 != fread(buffer, sizeof(buffer), 1, file))
+    {
+        fclose(file);
+        FFAIL("cannot read first segment from: %s\n", filename);
+    }
+    fclose(file);
+
+    memcpy(&buffer[16], &count, sizeof(count));
+    memcpy(&value, &buffer[offset], sizeof(value));
+    value = isfinite(delta) ? (value + delta) : delta;
+    memcpy(&buffer[offset], &value, sizeof(value));
+
+    file = fopen(badname, "wb");
+    if (file == NULL)
+        FFAIL("cannot open output file: %s\n", badname);
+    if (1 != fwrite(buffer, sizeof(buffer), 1, file))
+    {
+        fclose(file);
+        FFAIL("cannot write: %s\n", badname);
+    }
+    fclose(file);
+
+    Astronomy_Reset();
+    status = Astronomy_PlutoCacheLoad(badname);
+    if (status != expected)
+        FFAIL("step %d field %d: expected status %d, but got %d\n", step, field, expected, status);
+
+    error = 0;
+fail:
+    return error;
+}
+
+static int PlutoCacheFileTest(void)
+{
+    const char *filename = "temp/c_pluto_cache.bin";
+    static const struct { int step; int field; double delta; } corrupt[] =
+    {
+        {   7, 0, NAN      },   /* an interior position */
+        {   7, 4, 1.0e-3   },   /* an interior velocity */
+        {   7, 8, INFINITY },   /* an interior acceleration */
+        {   7, 6, 1.0e-6   },   /* a plausible but inconsistent acceleration */
+        {   0, 3, 1.0e-15  },   /* the first velocity, which must match the table exactly */
+        { 200, 7, 1.0e-20  }    /* the last acceleration, which must be zero */
+    };
+    enum { NTIMES = 50 };
+    int error, i;
+    astro_time_t t1 = Astronomy_MakeTime(1700, 1, 1, 0, 0, 0.0);
+    astro_time_t t2 = Astronomy_MakeTime(2300, 1, 1, 0, 0, 0.0);
+    astro_time_t time[NTIMES];
+    astro_vector_t expected[NTIMES];
+    astro_vector_t vec;
+    astro_status_t status;
+    FILE *outfile;
+
+    Astronomy_Reset();
+    for (i = 0; i < NTIMES; ++i)
+    {
+        time[i] = Astronomy_AddDays(t1, (t2.ut - t1.ut) * i / (NTIMES - 1.0));
+        CHECK_VECTOR(expected[i], Astronomy_HelioVector(BODY_PLUTO, time[i]));
+    }
+
+    /* Pre-warm the range from a cold start, then save the segments to a file. */
+    Astronomy_Reset();
+    CHECK(Astronomy_PlutoCacheWarm(t1, t2));
+    CHECK(Astronomy_PlutoCacheSave(filename));
+
+    /* Load the file into a cold cache. The results must be exactly the same as calculating from scratch. */
+    Astronomy_Reset();
+    CHECK(Astronomy_PlutoCacheLoad(filename));
+    for (i = 0; i < NTIMES; ++i)
+    {
+        CHECK_VECTOR(vec, Astronomy_HelioVector(BODY_PLUTO, time[i]));
+        if (vec.x != expected[i].x || vec.y != expected[i].y || vec.z != expected[i].z)
+            FFAIL("mismatch at index %d after loading cache file.\n", i);
+    }
+
+    /* Loading again while the segments are already cached must succeed and change nothing. */
+    CHECK(Astronomy_PlutoCacheLoad(filename));
+    CHECK_VECTOR(vec, Astronomy_HelioVector(BODY_PLUTO, time[0]));
+    if (vec.x != expected[0].x || vec.y != expected[0].y || vec.z != expected[0].z)
+        FFAIL("mismatch after loading cache file twice.\n");
+
+    /* Warming a range outside the years 0000..4000 must also work. */
+    CHECK(Astronomy_PlutoCacheWarm(Astronomy_TerrestrialTime(-800000.0), Astronomy_TerrestrialTime(-700000.0)));
+
+    status = Astronomy_PlutoCacheWarm(t2, t1);
+    if (status != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for reversed range, but got %d\n", status);
+
+    status = Astronomy_PlutoCacheLoad("temp/this_file_does_not_exist.bin");
+    if (status != ASTRO_FILE_ERROR)
+        FFAIL("expected ASTRO_FILE_ERROR for missing file, but got %d\n", status);
+
+    /* An unchanged copy of a segment must load, but a segment with any corrupted field must be rejected. */
+    CHECK(CorruptPlutoCacheFile(filename, 7, 0, 0.0, ASTRO_SUCCESS));
+    for (i = 0; i < (int)(sizeof(corrupt) / sizeof(corrupt[0])); ++i)
+        CHECK(CorruptPlutoCacheFile(filename, corrupt[i].step, corrupt[i].field, corrupt[i].delta, ASTRO_BAD_FILE_FORMAT));
+
+    /* A file that is not a Pluto cache must be rejected. */
+    outfile = fopen(filename, "wb");
+    if (outfile == NULL)
+        FFAIL("cannot open output file: %s\n", filename);
+    fprintf(outfile, "This is not a Pluto cache file.\n");
+    fclose(outfile);
+    status = Astronomy_PlutoCacheLoad(filename);
+    if (status != ASTRO_BAD_FILE_FORMAT)
+        FFAIL("expected ASTRO_BAD_FILE_FORMAT for invalid file, but got %d\n", status);
+
+    FPASS();
+fail:
+    Astronomy_Reset();
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int ContextTest(void)
+{
+    int error;
+    astro_context_t *ctx = NULL;
+    astro_context_t *prev;
+    astro_time_t tdefault, tctx;
+    astro_vector_t vdefault, vctx;
+    astro_constellation_t constel;
+    astro_status_t status;
+
+    CHECK(Astronomy_ContextCreate(&ctx));
+
+    /* The Delta T model is a per-context setting. */
+    prev = Astronomy_SetThreadContext(ctx);
+    if (prev != NULL)
+        FFAIL("expected the default context to be current at start.\n");
+    Astronomy_SetDeltaTFunction(Astronomy_DeltaT_JplHorizons);
+    Astronomy_SetThreadContext(prev);
+
+    tdefault = Astronomy_MakeTime(2200, 1, 1, 0, 0, 0.0);
+    tctx = Astronomy_MakeTimeCtx(ctx, 2200, 1, 1, 0, 0, 0.0);
+    if (tdefault.ut != tctx.ut)
+        FFAIL("UT values should match: default=%lf, ctx=%lf\n", tdefault.ut, tctx.ut);
+    if (tdefault.tt == tctx.tt)
+        FFAIL("TT values should differ between Delta T models.\n");
+
+    tctx = Astronomy_TimeFromDaysCtx(ctx, tdefault.ut);
+    if (tctx.tt != Astronomy_MakeTimeCtx(ctx, 2200, 1, 1, 0, 0, 0.0).tt)
+        FFAIL("Astronomy_TimeFromDaysCtx does not match Astronomy_MakeTimeCtx.\n");
+
+    if (Astronomy_TimeFromDays(tdefault.ut).tt != tdefault.tt)
+        FFAIL("the default context's Delta T model was changed.\n");
+
+    /* Stars are defined per context. */
+    prev = Astronomy_SetThreadContext(ctx);
+    status = Astronomy_DefineStar(BODY_STAR1, 12.0, 30.0, 1000.0);
+    Astronomy_SetThreadContext(prev);
+    if (status != ASTRO_SUCCESS)
+        FFAIL("Astronomy_DefineStar returned %d\n", status);
+
+    vctx = Astronomy_HelioVectorCtx(ctx, BODY_STAR1, tdefault);
+    CHECK_STATUS(vctx);
+    vdefault = Astronomy_HelioVector(BODY_STAR1, tdefault);
+    if (vdefault.status != ASTRO_INVALID_BODY)
+        FFAIL("expected BODY_STAR1 to be undefined in the default context, but got status %d\n", vdefault.status);
+
+    /* Calculations that fill a context's caches must match the default context exactly, */
+    /* at a time when both Delta T models agree. */
+    tdefault = Astronomy_MakeTime(2010, 1, 1, 0, 0, 0.0);
+    CHECK_VECTOR(vdefault, Astronomy_HelioVector(BODY_PLUTO, tdefault));
+    CHECK_VECTOR(vctx, Astronomy_HelioVectorCtx(ctx, BODY_PLUTO, tdefault));
+    if (vdefault.x != vctx.x || vdefault.y != vctx.y || vdefault.z != vctx.z)
+        FFAIL("Pluto mismatch between contexts.\n");
+
+    CHECK_VECTOR(vdefault, Astronomy_GeoVector(BODY_MARS, tdefault, ABERRATION));
+    CHECK_VECTOR(vctx, Astronomy_GeoVectorCtx(ctx, BODY_MARS, tdefault, ABERRATION));
+    if (vdefault.x != vctx.x || vdefault.y != vctx.y || vdefault.z != vctx.z)
+        FFAIL("Mars mismatch between contexts.\n");
+
+    constel = Astronomy_ConstellationCtx(ctx, 5.5, -5.0);
+    if (constel.status != ASTRO_SUCCESS || strcmp(constel.symbol, "Ori"))
+        FFAIL("Astronomy_ConstellationCtx returned status %d, symbol %s\n", constel.status, constel.symbol ? constel.symbol : "(null)");
+
+    if (Astronomy_SetThreadContext(NULL) != NULL)
+        FFAIL("the Ctx functions did not restore the thread's context.\n");
+
+    FPASS();
+fail:
+    Astronomy_ContextFree(ctx);
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int MoonCacheTest(void)
+{
+    int error, i;
+    const double toleranceKm = 0.001;
+    astro_time_t t1 = Astronomy_MakeTime(2023, 1, 1, 0, 0, 0.0);
+    astro_time_t t2 = Astronomy_AddDays(t1, 400.0);
+    astro_time_t time;
+    astro_spherical_t exact[200], cached;
+    astro_libration_t exactLib, cachedLib;
+    astro_moon_quarter_t exactQuarter, cachedQuarter;
+    astro_status_t status;
+    double dlon, diff, maxdiff = 0.0;
+
+    for (i = 0; i < 200; ++i)
+    {
+        time = Astronomy_AddDays(t1, 1.9876 * i);
+        CHECK_STATUS(exact[i] = Astronomy_EclipticGeoMoon(time));
+    }
+    exactLib = Astronomy_Libration(t1);
+    CHECK_STATUS(exactQuarter = Astronomy_SearchMoonQuarter(t1));
+
+    CHECK(Astronomy_MoonCacheInit(t1, t2, toleranceKm));
+
+    for (i = 0; i < 200; ++i)
+    {
+        time = Astronomy_AddDays(t1, 1.9876 * i);
+        CHECK_STATUS(cached = Astronomy_EclipticGeoMoon(time));
+        dlon = ABS(cached.lon - exact[i].lon);
+        if (dlon > 180.0)
+            dlon = 360.0 - dlon;    /* longitude wrapped around */
+        dlon *= cos(DEG2RAD * exact[i].lat);
+        diff = (KM_PER_AU * exact[i].dist) * DEG2RAD * V(sqrt(dlon*dlon + (cached.lat - exact[i].lat)*(cached.lat - exact[i].lat)));
+        diff = sqrt(diff*diff + (KM_PER_AU * (cached.dist - exact[i].dist)) * (KM_PER_AU * (cached.dist - exact[i].dist)));
+        if (diff > maxdiff)
+            maxdiff = diff;
+    }
+
+    if (maxdiff > 2.0 * toleranceKm)
+        FFAIL("excessive EclipticGeoMoon error %lg km\n", maxdiff);
+
+    /* Other functions built on the lunar theory must also use the cache, and agree closely. */
+    cachedLib = Astronomy_Libration(t1);
+    if (ABS(cachedLib.dist_km - exactLib.dist_km) > 2.0 * toleranceKm || ABS(cachedLib.elon - exactLib.elon) > 1.0e-8)
+        FFAIL("Libration mismatch: dist %lf vs %lf, elon %lf vs %lf\n", cachedLib.dist_km, exactLib.dist_km, cachedLib.elon, exactLib.elon);
+
+    CHECK_STATUS(cachedQuarter = Astronomy_SearchMoonQuarter(t1));
+    if (cachedQuarter.quarter != exactQuarter.quarter || ABS(cachedQuarter.time.ut - exactQuarter.time.ut) * SECONDS_PER_DAY > 0.01)
+        FFAIL("moon quarter mismatch: exact = %0.8lf, cached = %0.8lf\n", exactQuarter.time.ut, cachedQuarter.time.ut);
+
+    Astronomy_MoonCacheFree();
+    CHECK_STATUS(cached = Astronomy_EclipticGeoMoon(t1));
+    if (cached.lon != exact[0].lon || cached.lat != exact[0].lat || cached.dist != exact[0].dist)
+        FFAIL("result is not exact after freeing the cache.\n");
+
+    status = Astronomy_MoonCacheInit(t2, t1, toleranceKm);
+    if (status != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for reversed window, but got %d\n", status);
+
+    status = Astronomy_MoonCacheInit(t1, t2, -1.0);
+    if (status != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for negative tolerance, but got %d\n", status);
+
+    FPASSA("maxdiff = %0.3le km\n", maxdiff);
+fail:
+    Astronomy_MoonCacheFree();
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int GeoMoonCachePerformance(void)
+{
+    /* The same workload as GeoMoonPerformance, but using the Moon cache. */
+
+    int error = 1;
+    int count = 0;
+    astro_time_t time = Astronomy_MakeTime(1800, 1, 1, 0, 0, 0.0);
+    astro_time_t stopTime = Astronomy_MakeTime(2200, 1, 1, 0, 0, 0.0);
+
+    CHECK(Astronomy_MoonCacheInit(time, stopTime, 0.001));
+    while (time.ut <= stopTime.ut)
+    {
+        astro_spherical_t sphere = Astronomy_EclipticGeoMoon(time);
+        if (sphere.status != ASTRO_SUCCESS)
+            FAIL("GeoMoonCachePerformance: EclipticGeoMoon returned error %d.\n", sphere.status);
+        time = Astronomy_AddDays(time, 0.01);
+        ++count;
+    }
+    printf("GeoMoonCachePerformance: PASS (called %d times)\n", count);
+    error = 0;
+fail:
+    Astronomy_MoonCacheFree();
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int FrameInterpolationTest(void)
+{
+    int error = 1;
+    int count = 0;
+    astro_status_t status;
+    astro_time_t time, exactTime, interpTime;
+    astro_rotation_t exactRot, interpRot;
+    astro_vector_t vec, exactVec, interpVec;
+    double dot, arcsec, maxarcsec = 0.0;
+    double exactGast, interpGast, reusedGast;
+    const double step = 1.0;
+
+    vec.status = ASTRO_SUCCESS;
+    vec.x = 0.6;
+    vec.y = -0.48;
+    vec.z = 0.64;
+
+    time = Astronomy_MakeTime(2000, 1, 1, 0, 0, 0.0);
+    vec.t = time;
+    for (count = 0; count < 30000; ++count)
+    {
+        time = Astronomy_AddDays(time, 0.3731);
+
+        exactTime = interpTime = time;
+        CHECK(Astronomy_SetFrameInterpolation(0.0));
+        exactRot = Astronomy_Rotation_EQJ_EQD(&exactTime);
+        CHECK_STATUS(exactRot);
+        CHECK(Astronomy_SetFrameInterpolation(step));
+        interpRot = Astronomy_Rotation_EQJ_EQD(&interpTime);
+        CHECK_STATUS(interpRot);
+
+        CHECK_VECTOR(exactVec, Astronomy_RotateVector(exactRot, vec));
+        CHECK_VECTOR(interpVec, Astronomy_RotateVector(interpRot, vec));
+        dot = (exactVec.x*interpVec.x + exactVec.y*interpVec.y + exactVec.z*interpVec.z) / (Astronomy_VectorLength(exactVec) * Astronomy_VectorLength(interpVec));
+        if (dot > 1.0)
+            dot = 1.0;
+        arcsec = (RAD2DEG * 3600.0) * acos(dot);
+        if (arcsec > maxarcsec)
+            maxarcsec = arcsec;
+    }
+
+    if (maxarcsec > 0.01)
+        FFAIL("excessive interpolation error %lg arcsec\n", maxarcsec);
+
+    /* The interpolation nodes themselves must be exact. */
+    time = Astronomy_TerrestrialTime(7000.0);
+    exactTime = interpTime = time;
+    CHECK(Astronomy_SetFrameInterpolation(0.0));
+    exactRot = Astronomy_Rotation_EQJ_EQD(&exactTime);
+    CHECK(Astronomy_SetFrameInterpolation(step));
+    interpRot = Astronomy_Rotation_EQJ_EQD(&interpTime);
+    if (memcmp(exactRot.rot, interpRot.rot, sizeof(exactRot.rot)))
+        FFAIL("rotation at an interpolation node is not exact.\n");
+
+    /* A time used while interpolating must not carry interpolated values into exact calculations. */
+    time = Astronomy_TerrestrialTime(7000.4);
+    exactTime = interpTime = time;
+    CHECK(Astronomy_SetFrameInterpolation(30.0));
+    interpGast = Astronomy_SiderealTime(&interpTime);
+    CHECK(Astronomy_SetFrameInterpolation(0.0));
+    exactGast = Astronomy_SiderealTime(&exactTime);
+    if (interpGast == exactGast)
+        FFAIL("interpolated sidereal time should differ from exact sidereal time.\n");
+    reusedGast = Astronomy_SiderealTime(&interpTime);
+    if (reusedGast != exactGast)
+        FFAIL("reused time gives sidereal time %0.16lf, expected %0.16lf\n", reusedGast, exactGast);
+
+    status = Astronomy_SetFrameInterpolation(-1.0);
+    if (status != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for negative step, but got %d\n", status);
+
+    status = Astronomy_SetFrameInterpolation(NAN);
+    if (status != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for NAN step, but got %d\n", status);
+
+    FPASSA("max error = %0.3le arcsec over %d samples\n", maxarcsec, count);
+fail:
+    Astronomy_SetFrameInterpolation(0.0);
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int FrameBundleTest(void)
+{
+    static const astro_body_t bodies[] =
+    {
+        BODY_SUN, BODY_MOON, BODY_MERCURY, BODY_VENUS, BODY_MARS,
+        BODY_JUPITER, BODY_SATURN, BODY_URANUS, BODY_NEPTUNE, BODY_PLUTO
+    };
+    static const int nbodies = sizeof(bodies) / sizeof(bodies[0]);
+    int error = 1;
+    int count = 0;
+    int day, b, lat, aber, equdate;
+    astro_time_t time, copy;
+    astro_frame_t frame;
+    astro_observer_t observer;
+    astro_vector_t vec1, vec2;
+    astro_equatorial_t equ1, equ2;
+    astro_horizon_t hor1, hor2;
+    astro_rotation_t rot;
+
+    for (day = 0; day < 400; day += 37)
+    {
+        time = Astronomy_MakeTime(1990, 1, 1, 0, 0, 0.0);
+        time = Astronomy_AddDays(time, 27.3 * day);
+        frame = Astronomy_MakeFrame(time);
+        CHECK_STATUS(frame);
+
+        copy = time;
+        rot = Astronomy_Rotation_EQJ_EQD(&copy);
+        if (memcmp(rot.rot, frame.eqj_eqd.rot, sizeof(rot.rot)))
+            FFAIL("frame EQJ/EQD rotation does not match.\n");
+        if (frame.gast != Astronomy_SiderealTime(&copy))
+            FFAIL("frame sidereal time does not match.\n");
+
+        for (b = 0; b < nbodies; ++b)
+        {
+            for (aber = 0; aber < 2; ++aber)
+            {
+                astro_aberration_t aberration = aber ? ABERRATION : NO_ABERRATION;
+                CHECK_VECTOR(vec1, Astronomy_GeoVector(bodies[b], time, aberration));
+                CHECK_VECTOR(vec2, Astronomy_GeoVectorFrame(bodies[b], &frame, aberration));
+                if (vec1.x != vec2.x || vec1.y != vec2.y || vec1.z != vec2.z)
+                    FFAIL("GeoVectorFrame mismatch for %s at day %d\n", Astronomy_BodyName(bodies[b]), day);
+
+                for (lat = -80; lat <= +80; lat += 40)
+                {
+                    observer = Astronomy_MakeObserver(lat, 17.0 * lat - 3.0, 100.0);
+                    for (equdate = 0; equdate < 2; ++equdate)
+                    {
+                        astro_equator_date_t ed = equdate ? EQUATOR_OF_DATE : EQUATOR_J2000;
+                        copy = time;
+                        equ1 = Astronomy_Equator(bodies[b], &copy, observer, ed, aberration);
+                        CHECK_STATUS(equ1);
+                        equ2 = Astronomy_EquatorFrame(bodies[b], &frame, observer, ed, aberration);
+                        CHECK_STATUS(equ2);
+                        if (equ1.ra != equ2.ra || equ1.dec != equ2.dec || equ1.dist != equ2.dist)
+                            FFAIL("EquatorFrame mismatch for %s at day %d, lat %d\n", Astronomy_BodyName(bodies[b]), day, lat);
+
+                        hor1 = Astronomy_Horizon(&copy, observer, equ1.ra, equ1.dec, REFRACTION_NORMAL);
+                        hor2 = Astronomy_HorizonFrame(&frame, observer, equ2.ra, equ2.dec, REFRACTION_NORMAL);
+                        if (hor1.azimuth != hor2.azimuth || hor1.altitude != hor2.altitude)
+                            FFAIL("HorizonFrame mismatch for %s at day %d, lat %d\n", Astronomy_BodyName(bodies[b]), day, lat);
+                        ++count;
+                    }
+                }
+            }
+        }
+    }
+
+    equ2 = Astronomy_EquatorFrame(BODY_MARS, NULL, observer, EQUATOR_OF_DATE, ABERRATION);
+    if (equ2.status != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for NULL frame, but got %d\n", equ2.status);
+
+    equ2 = Astronomy_EquatorFrame(BODY_MARS, &frame, observer, (astro_equator_date_t)7, ABERRATION);
+    if (equ2.status != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for invalid equdate, but got %d\n", equ2.status);
+
+    FPASSA("%d positions matched\n", count);
+fail:
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int ObserverGridTest(void)
+{
+    enum { NLAT = 37, NLON = 150 };
+    int error = 1;
+    int equdate;
+    size_t i, j;
+    double lat[NLAT], lon[NLON];
+    astro_vector_t *vectors = NULL;
+    astro_rotation_t *rotations = NULL;
+    astro_time_t time, copy;
+    astro_observer_t observer;
+    astro_vector_t ovec;
+    astro_rotation_t rot;
+    astro_status_t status;
+    const double height = 1234.0;
+
+    vectors = (astro_vector_t *)calloc(NLAT * NLON, sizeof(astro_vector_t));
+    rotations = (astro_rotation_t *)calloc(NLAT * NLON, sizeof(astro_rotation_t));
+    if (vectors == NULL || rotations == NULL)
+        FFAIL("out of memory\n");
+
+    for (i = 0; i < NLAT; ++i)
+        lat[i] = -90.0 + 5.0*i;
+
+    for (j = 0; j < NLON; ++j)
+        lon[j] = -180.0 + 2.4*j;
+
+    time = Astronomy_MakeTime(2022, 1, 22, 12, 30, 0.0);
+    observer.height = height;
+    for (equdate = 0; equdate < 2; ++equdate)
+    {
+        astro_equator_date_t ed = equdate ? EQUATOR_OF_DATE : EQUATOR_J2000;
+        copy = time;
+        CHECK(Astronomy_ObserverGrid(&copy, lat, NLAT, lon, NLON, height, ed, vectors, rotations));
+
+        for (i = 0; i < NLAT; ++i)
+        {
+            observer.latitude = lat[i];
+            for (j = 0; j < NLON; ++j)
+            {
+                const astro_vector_t *gvec = &vectors[i*NLON + j];
+                const astro_rotation_t *grot = &rotations[i*NLON + j];
+                observer.longitude = lon[j];
+                copy = time;
+                ovec = Astronomy_ObserverVector(&copy, observer, ed);
+                CHECK_STATUS(ovec);
+                rot = Astronomy_Rotation_EQD_HOR(&copy, observer);
+                CHECK_STATUS(rot);
+                CHECK_STATUS(*gvec);
+                CHECK_STATUS(*grot);
+                if (ovec.x != gvec->x || ovec.y != gvec->y || ovec.z != gvec->z || ovec.t.tt != gvec->t.tt)
+                    FFAIL("observer vector mismatch at lat=%lf, lon=%lf, equdate=%d\n", lat[i], lon[j], equdate);
+                if (memcmp(rot.rot, grot->rot, sizeof(rot.rot)))
+                    FFAIL("rotation mismatch at lat=%lf, lon=%lf\n", lat[i], lon[j]);
+            }
+        }
+    }
+
+    /* Either output array may be omitted. */
+    CHECK(Astronomy_ObserverGrid(&copy, lat, NLAT, lon, NLON, height, EQUATOR_OF_DATE, NULL, rotations));
+    CHECK(Astronomy_ObserverGrid(&copy, lat, NLAT, lon, NLON, height, EQUATOR_OF_DATE, vectors, NULL));
+
+    status = Astronomy_ObserverGrid(&copy, NULL, NLAT, lon, NLON, height, EQUATOR_OF_DATE, vectors, NULL);
+    if (status != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for NULL latitudes, but got %d\n", status);
+
+    status = Astronomy_ObserverGrid(&copy, lat, NLAT, lon, NLON, height, (astro_equator_date_t)5, vectors, NULL);
+    if (status != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for invalid equdate, but got %d\n", status);
+
+    FPASS();
+fail:
+    free(vectors);
+    free(rotations);
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int MapGridPerformanceTest(void)
+{
+    /* The same workload as MapPerformanceTest, using Astronomy_ObserverGrid on strips of longitude. */
+    enum { STRIP = 32 };
+    int error = 1;
+    int count = 0;
+    int i, k, nlat = 0, nlon = 0;
+    double *lat = NULL;
+    double *lon = NULL;
+    double x;
+    astro_vector_t *vectors = NULL;
+    astro_rotation_t *rotations = NULL;
+    astro_time_t time;
+
+    for (x = -85.0; x <= +85.0; x += 0.01)
+        ++nlat;
+
+    for (x = -180.0; x < +180.0; x += 0.01)
+        ++nlon;
+
+    lat = (double *)calloc(nlat, sizeof(double));
+    lon = (double *)calloc(nlon, sizeof(double));
+    vectors = (astro_vector_t *)calloc(nlat * STRIP, sizeof(astro_vector_t));
+    rotations = (astro_rotation_t *)calloc(nlat * STRIP, sizeof(astro_rotation_t));
+    if (lat == NULL || lon == NULL || vectors == NULL || rotations == NULL)
+        FFAIL("out of memory\n");
+
+    i = 0;
+    for (x = -85.0; x <= +85.0; x += 0.01)
+        lat[i++] = x;
+
+    i = 0;
+    for (x = -180.0; x < +180.0; x += 0.01)
+        lon[i++] = x;
+
+    time = Astronomy_MakeTime(2022, 1, 22, 12, 30, 0.0);
+    for (i = 0; i < nlon; i += STRIP)
+    {
+        k = (nlon - i < STRIP) ? (nlon - i) : STRIP;
+        CHECK(Astronomy_ObserverGrid(&time, lat, (size_t)nlat, &lon[i], (size_t)k, 0.0, EQUATOR_OF_DATE, vectors, rotations));
+        count += nlat * k;
+    }
+
+    /*
+        612,017,000 geographic locations, measured on the same machine:
+        MapPerformanceTest:     72.9 seconds.
+        MapGridPerformanceTest: 13.9 seconds.
+    */
+
+    printf("MapGridPerformanceTest: PASS (%d geographic locations)\n", count);
+    error = 0;
+fail:
+    free(lat);
+    free(lon);
+    free(vectors);
+    free(rotations);
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static astro_func_result_t StatsCallback(void *context, astro_time_t time)
+{
+    astro_func_result_t result;
+    int *count = (int *)context;
+    ++*count;
+    result.status = ASTRO_SUCCESS;
+    result.value = sin(time.ut);    /* ascending root at ut = 0 */
+    return result;
+}
+
+static int SearchStatsTest(void)
+{
+    int error = 1;
+    int count = 0;
+    astro_search_stats_t stats, outer;
+    astro_search_result_t search;
+    astro_moon_quarter_t mq;
+    astro_observer_t observer = Astronomy_MakeObserver(64.2, -147.7, 0.0);
+    astro_time_t time = Astronomy_MakeTime(2023, 6, 1, 0, 0, 0.0);
+
+    memset(&stats, 0, sizeof(stats));
+    memset(&outer, 0, sizeof(outer));
+
+    if (Astronomy_SetSearchStats(&stats) != NULL)
+        FFAIL("expected no previous statistics block.\n");
+
+    search = Astronomy_Search(StatsCallback, &count, Astronomy_TimeFromDays(-0.3), Astronomy_TimeFromDays(+0.5), 0.01);
+    CHECK_STATUS(search);
+    if (stats.searches != 1 || stats.failures != 0)
+        FFAIL("searches=%ld, failures=%ld\n", stats.searches, stats.failures);
+    if (stats.func_calls != count)
+        FFAIL("func_calls=%ld, but callback ran %d times\n", stats.func_calls, count);
+    if (stats.iterations < 1 || stats.iterations < stats.quad_steps + stats.bisections || stats.max_iterations != stats.iterations)
+        FFAIL("inconsistent iteration counts: iterations=%ld, quad=%ld, bisect=%ld, max=%d\n", stats.iterations, stats.quad_steps, stats.bisections, stats.max_iterations);
+
+    /* A window with no ascending root must be counted as a failure. */
+    search = Astronomy_Search(StatsCallback, &count, Astronomy_TimeFromDays(+0.5), Astronomy_TimeFromDays(+2.0), 0.01);
+    if (search.status != ASTRO_SEARCH_FAILURE)
+        FFAIL("expected ASTRO_SEARCH_FAILURE, but got %d\n", search.status);
+    if (stats.searches != 2 || stats.failures != 1)
+        FFAIL("after failure: searches=%ld, failures=%ld\n", stats.searches, stats.failures);
+
+    /* Higher-level searches are counted too, including rise/set bracketing. */
+    memset(&stats, 0, sizeof(stats));
+    CHECK_STATUS(Astronomy_SearchRiseSet(BODY_MOON, observer, DIRECTION_RISE, time, 30.0));
+    if (stats.searches < 1 || stats.ascent_calls < 1 || stats.ascent_calls > 1 + 2*stats.ascent_func_calls || stats.max_ascent_depth > 17)
+        FFAIL("rise/set: searches=%ld, ascent_calls=%ld, ascent_func_calls=%ld, depth=%d\n", stats.searches, stats.ascent_calls, stats.ascent_func_calls, stats.max_ascent_depth);
+    DEBUG("C SearchStatsTest: moonrise used %ld searches, %ld func calls, %ld ascent calls, depth %d\n", stats.searches, stats.func_calls, stats.ascent_calls, stats.max_ascent_depth);
+
+    /* Swapping in a different block must return the previous one and stop counting into it. */
+    if (Astronomy_SetSearchStats(&outer) != &stats)
+        FFAIL("expected previous statistics block to be returned.\n");
+    count = (int)stats.searches;
+    mq = Astronomy_SearchMoonQuarter(time);
+    CHECK_STATUS(mq);
+    if (stats.searches != count || outer.searches < 1)
+        FFAIL("statistics went to the wrong block.\n");
+
+    if (Astronomy_SetSearchStats(NULL) != &outer)
+        FFAIL("expected outer statistics block to be returned.\n");
+    count = (int)outer.searches;
+    mq = Astronomy_SearchMoonQuarter(time);
+    CHECK_STATUS(mq);
+    if (outer.searches != count)
+        FFAIL("statistics were collected after being disabled.\n");
+
+    FPASS();
+fail:
+    Astronomy_SetSearchStats(NULL);
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int SearchMethodTest(void)
+{
+    int error = 1;
+    int count[2];
+    int m, i;
+    astro_search_result_t result[2];
+    astro_moon_quarter_t mq[2];
+    astro_search_stats_t stats[2];
+    astro_time_t time = Astronomy_MakeTime(2023, 6, 1, 0, 0, 0.0);
+    const double tolerance_seconds = 0.1;
+
+    for (m = 0; m < 2; ++m)
+    {
+        astro_search_method_t method = m ? SEARCH_CHANDRUPATLA : SEARCH_QUADRATIC;
+
+        count[m] = 0;
+        result[m] = Astronomy_SearchEx(StatsCallback, &count[m], Astronomy_TimeFromDays(-0.3), Astronomy_TimeFromDays(+0.5), tolerance_seconds, method);
+        CHECK_STATUS(result[m]);
+        if (ABS(result[m].time.ut) * SECONDS_PER_DAY > tolerance_seconds)
+            FFAIL("method %d: root error %lf seconds exceeds tolerance.\n", m, result[m].time.ut * SECONDS_PER_DAY);
+
+        /* A window without an ascending root must fail the same way for every method. */
+        result[m] = Astronomy_SearchEx(StatsCallback, &count[m], Astronomy_TimeFromDays(+0.5), Astronomy_TimeFromDays(+2.0), tolerance_seconds, method);
+        if (result[m].status != ASTRO_SEARCH_FAILURE)
+            FFAIL("method %d: expected ASTRO_SEARCH_FAILURE, but got %d\n", m, result[m].status);
+
+        /* Astronomy_SetSearchMethod changes the algorithm used by the event searches. */
+        CHECK(Astronomy_SetSearchMethod(method));
+        memset(&stats[m], 0, sizeof(stats[m]));
+        Astronomy_SetSearchStats(&stats[m]);
+        mq[m] = Astronomy_SearchMoonQuarter(time);
+        for (i = 0; i < 50 && mq[m].status == ASTRO_SUCCESS; ++i)
+            mq[m] = Astronomy_NextMoonQuarter(mq[m]);
+        Astronomy_SetSearchStats(NULL);
+        CHECK_STATUS(mq[m]);
+    }
+
+    if (mq[0].quarter != mq[1].quarter || ABS(mq[0].time.ut - mq[1].time.ut) * SECONDS_PER_DAY > 2.0)
+        FFAIL("moon quarter mismatch: %0.8lf vs %0.8lf\n", mq[0].time.ut, mq[1].time.ut);
+
+    if (stats[1].func_calls >= stats[0].func_calls)
+        FFAIL("expected fewer function calls with Chandrupatla: %ld vs %ld\n", stats[1].func_calls, stats[0].func_calls);
+
+    result[0] = Astronomy_SearchEx(StatsCallback, &count[0], Astronomy_TimeFromDays(-0.3), Astronomy_TimeFromDays(+0.5), 1.0, (astro_search_method_t)9);
+    if (result[0].status != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for invalid method, but got %d\n", result[0].status);
+
+    if (Astronomy_SetSearchMethod((astro_search_method_t)-1) != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER from Astronomy_SetSearchMethod.\n");
+
+    FPASSA("moon quarter func calls: quadratic=%ld, chandrupatla=%ld\n", stats[0].func_calls, stats[1].func_calls);
+fail:
+    Astronomy_SetSearchMethod(SEARCH_QUADRATIC);
+    Astronomy_SetSearchStats(NULL);
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int RiseSetBatchTest(void)
+{
+    static const astro_body_t bodies[] = { BODY_SUN, BODY_MOON, BODY_VENUS, BODY_JUPITER };
+    enum { NOBS = 300 };
+    int error = 1;
+    int b, d, i, nfail = 0;
+    size_t k;
+    astro_observer_t observers[NOBS];
+    astro_search_result_t results[NOBS], exact;
+    astro_time_t startTime = Astronomy_MakeTime(2024, 3, 1, 0, 0, 0.0);
+    double diff, maxdiff = 0.0;
+    const double limitDays[] = { +2.0, -2.0 };
+
+    for (i = 0; i < NOBS; ++i)
+    {
+        /* Include polar sites, where some events do not happen at all. */
+        observers[i].latitude = -89.0 + (178.0 * i) / (NOBS - 1);
+        observers[i].longitude = fmod(37.0 * i, 360.0) - 180.0;
+        observers[i].height = 10.0 * (i % 7);
+    }
+
+    for (b = 0; b < (int)(sizeof(bodies) / sizeof(bodies[0])); ++b)
+    {
+        for (d = 0; d < 4; ++d)
+        {
+            astro_direction_t direction = (d & 1) ? DIRECTION_SET : DIRECTION_RISE;
+            double limit = limitDays[d >> 1];
+
+            CHECK(Astronomy_SearchRiseSetBatch(bodies[b], observers, NOBS, direction, startTime, limit, results));
+            for (k = 0; k < NOBS; ++k)
+            {
+                exact = Astronomy_SearchRiseSet(bodies[b], observers[k], direction, startTime, limit);
+                if (exact.status != results[k].status)
+                    FFAIL("%s observer %d direction %d: exact status %d, batch status %d\n", Astronomy_BodyName(bodies[b]), (int)k, d, exact.status, results[k].status);
+                if (exact.status == ASTRO_SUCCESS)
+                {
+                    diff = SECONDS_PER_DAY * ABS(exact.time.ut - results[k].time.ut);
+                    if (diff > maxdiff)
+                        maxdiff = diff;
+                }
+                else
+                {
+                    ++nfail;
+                }
+            }
+        }
+    }
+
+    if (maxdiff > 0.5)
+        FFAIL("excessive time difference %0.3lf seconds\n", maxdiff);
+
+    if (nfail == 0)
+        FFAIL("expected some polar observers to have no rise or set.\n");
+
+    /* Very long search windows must work, including polar observers whose next event is months away. */
+    for (d = 0; d < 4; ++d)
+    {
+        astro_direction_t direction = (d & 1) ? DIRECTION_SET : DIRECTION_RISE;
+        double limit = (d >> 1) ? 1.0e+7 : -400.0;
+
+        CHECK(Astronomy_SearchRiseSetBatch(BODY_MOON, observers, 3, direction, startTime, limit, results));
+        CHECK(Astronomy_SearchRiseSetBatch(BODY_SUN, observers + NOBS - 3, 3, direction, startTime, limit, results + 3));
+        for (k = 0; k < 6; ++k)
+        {
+            exact = Astronomy_SearchRiseSet((k < 3) ? BODY_MOON : BODY_SUN, observers[(k < 3) ? k : (NOBS - 6 + k)], direction, startTime, limit);
+            CHECK_STATUS(exact);
+            CHECK_STATUS(results[k]);
+            diff = SECONDS_PER_DAY * ABS(exact.time.ut - results[k].time.ut);
+            if (diff > 0.5)
+                FFAIL("long window %0.0lf, observer %d, direction %d: time difference %0.3lf seconds\n", limit, (int)k, d, diff);
+        }
+    }
+
+    if (Astronomy_SearchRiseSetBatch(BODY_SUN, NULL, 1, DIRECTION_RISE, startTime, 1.0, results) != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for NULL observers.\n");
+
+    FPASSA("maxdiff = %0.3lf seconds, %d searches without an event\n", maxdiff, nfail);
+fail:
+    return error;
+}
+
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+#define ALMANAC_TEST_MAX  1000
+
+typedef struct
+{
+    int count;
+    int limit;
+    astro_almanac_event_t event[ALMANAC_TEST_MAX];
+}
+almanac_test_t;
+
+static int AlmanacCallback(void *context, const astro_almanac_event_t *event)
+{
+    almanac_test_t *list = (almanac_test_t *)context;
+    if (list->count < ALMANAC_TEST_MAX)
+        list->event[list->count] = *event;
+    ++list->count;
+    return list->count >= list->limit;
+}
+
+static int AlmanacCheckKind(
+    const almanac_test_t *list,
+    astro_body_t body,
+    astro_observer_t observer,
+    astro_time_t startTime,
+    double limitDays,
+    astro_almanac_kind_t kind,
+    double twilightAltitude,
+    double *maxdiff)
+{
+    int error = 1;
+    int i, nexpected = 0;
+    astro_time_t time = startTime;
+    astro_search_result_t search;
+    astro_hour_angle_t culm;
+    double diff, stop = startTime.ut + limitDays;
+
+    i = 0;
+    for(;;)
+    {
+        /* Find the next event of this kind by chaining the individual search functions. */
+        if (kind == ALMANAC_CULMINATION)
+        {
+            culm = Astronomy_SearchHourAngleEx(body, observer, 0.0, time, +1);
+            CHECK_STATUS(culm);
+            if (culm.time.ut > stop)
+                break;
+            search.status = ASTRO_SUCCESS;
+            search.time = culm.time;
+        }
+        else if (kind == ALMANAC_RISE || kind == ALMANAC_SET)
+        {
+            search = Astronomy_SearchRiseSet(body, observer, (kind == ALMANAC_RISE) ? DIRECTION_RISE : DIRECTION_SET, time, stop - time.ut);
+        }
+        else
+        {
+            search = Astronomy_SearchAltitude(body, observer, (kind == ALMANAC_DAWN) ? DIRECTION_RISE : DIRECTION_SET, time, stop - time.ut, twilightAltitude);
+        }
+        if (search.status == ASTRO_SEARCH_FAILURE)
+            break;
+        CHECK_STATUS(search);
+        ++nexpected;
+
+        /* Find the matching event in the almanac. */
+        while (i < list->count && list->event[i].kind != kind)
+            ++i;
+        if (i == list->count)
+            FFAIL("%s kind %d: almanac is missing the event at ut %0.6lf\n", Astronomy_BodyName(body), kind, search.time.ut);
+        diff = SECONDS_PER_DAY * ABS(search.time.ut - list->event[i].time.ut);
+        if (diff > *maxdiff)
+            *maxdiff = diff;
+        if (diff > 1.0)
+            FFAIL("%s kind %d: almanac ut %0.6lf, expected %0.6lf\n", Astronomy_BodyName(body), kind, list->event[i].time.ut, search.time.ut);
+        ++i;
+        time = Astronomy_AddDays(search.time, 1.0 / SECONDS_PER_DAY);
+    }
+
+    while (i < list->count && list->event[i].kind != kind)
+        ++i;
+    if (i < list->count)
+        FFAIL("%s kind %d: almanac has an extra event at ut %0.6lf after %d expected events\n", Astronomy_BodyName(body), kind, list->event[i].time.ut, nexpected);
+
+    error = 0;
+fail:
+    return error;
+}
+
+static int AlmanacTest(void)
+{
+    static const astro_body_t bodies[] = { BODY_SUN, BODY_MOON, BODY_MARS };
+    static const astro_almanac_kind_t kinds[] = { ALMANAC_RISE, ALMANAC_SET, ALMANAC_CULMINATION, ALMANAC_DAWN, ALMANAC_DUSK };
+    static const double latitudes[] = { +38.0, -33.9, +69.6 };
+    static almanac_test_t list;
+    const int allKinds = ALMANAC_RISE | ALMANAC_SET | ALMANAC_CULMINATION | ALMANAC_DAWN | ALMANAC_DUSK;
+    const double limitDays = 90.0;
+    const double twilightAltitude = -6.0;
+    int error = 1;
+    int b, i, k, total = 0;
+    astro_observer_t observer;
+    astro_time_t startTime = Astronomy_MakeTime(2025, 4, 2, 11, 17, 0.0);
+    double maxdiff = 0.0;
+
+    for (b = 0; b < (int)(sizeof(bodies) / sizeof(bodies[0])); ++b)
+    {
+        for (i = 0; i < (int)(sizeof(latitudes) / sizeof(latitudes[0])); ++i)
+        {
+            observer = Astronomy_MakeObserver(latitudes[i], -77.0 + 90.0*i, 100.0);
+            list.count = 0;
+            list.limit = ALMANAC_TEST_MAX + 1;
+            CHECK(Astronomy_Almanac(bodies[b], observer, startTime, limitDays, allKinds, twilightAltitude, AlmanacCallback, &list));
+            if (list.count > ALMANAC_TEST_MAX)
+                FFAIL("too many events: %d\n", list.count);
+
+            for (k = 1; k < list.count; ++k)
+                if (list.event[k].time.ut < list.event[k-1].time.ut)
+                    FFAIL("%s latitude %0.1lf: events %d and %d are out of order\n", Astronomy_BodyName(bodies[b]), latitudes[i], k-1, k);
+
+            for (k = 0; k < (int)(sizeof(kinds) / sizeof(kinds[0])); ++k)
+                if (AlmanacCheckKind(&list, bodies[b], observer, startTime, limitDays, kinds[k], twilightAltitude, &maxdiff))
+                    FFAIL("%s latitude %0.1lf failed\n", Astronomy_BodyName(bodies[b]), latitudes[i]);
+
+            total += list.count;
+        }
+    }
+
+    /* The callback can stop the iteration early. */
+    list.count = 0;
+    list.limit = 5;
+    CHECK(Astronomy_Almanac(BODY_SUN, observer, startTime, limitDays, allKinds, twilightAltitude, AlmanacCallback, &list));
+    if (list.count != 5)
+        FFAIL("expected iteration to stop after 5 events, but got %d\n", list.count);
+
+    if (Astronomy_Almanac(BODY_SUN, observer, startTime, limitDays, ALMANAC_DAWN, 95.0, AlmanacCallback, &list) != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for bad twilight altitude.\n");
+
+    FPASSA("%d events, maxdiff = %0.3lf seconds\n", total, maxdiff);
+fail:
+    return error;
+}
+
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int EclipseCatalogTest(void)
+{
+    enum { MAX_ECLIPSES = 1000 };
+    static astro_lunar_eclipse_t lunar[MAX_ECLIPSES];
+    static astro_global_solar_eclipse_t solar[MAX_ECLIPSES];
+    int error = 1;
+    size_t i, nlunar, nsolar, count;
+    astro_time_t startTime = Astronomy_MakeTime(1900, 1, 1, 0, 0, 0.0);
+    astro_time_t stopTime  = Astronomy_MakeTime(2100, 1, 1, 0, 0, 0.0);
+    astro_time_t t1, t2;
+    astro_lunar_eclipse_t le;
+    astro_global_solar_eclipse_t se;
+    double diff, maxdiff = 0.0;
+    const double chunkDays = 2345.6;    /* deliberately not a whole number of lunations */
+
+    /* Build the catalogs in consecutive chunks, as a multithreaded program would. */
+    nlunar = nsolar = 0;
+    for (t1 = startTime; t1.ut < stopTime.ut; t1 = t2)
+    {
+        t2 = Astronomy_AddDays(t1, chunkDays);
+        if (t2.ut > stopTime.ut)
+            t2 = stopTime;
+        CHECK(Astronomy_LunarEclipseCatalog(t1, t2, lunar + nlunar, MAX_ECLIPSES - nlunar, &count));
+        nlunar += count;
+        CHECK(Astronomy_GlobalSolarEclipseCatalog(t1, t2, solar + nsolar, MAX_ECLIPSES - nsolar, &count));
+        nsolar += count;
+    }
+
+    /* Compare against the traditional serial search. */
+    i = 0;
+    for (le = Astronomy_SearchLunarEclipse(startTime); le.peak.ut < stopTime.ut; le = Astronomy_NextLunarEclipse(le.peak))
+    {
+        CHECK_STATUS(le);
+        if (i == nlunar)
+            FFAIL("lunar catalog is missing the eclipse at ut %0.6lf\n", le.peak.ut);
+        diff = SECONDS_PER_DAY * ABS(le.peak.ut - lunar[i].peak.ut);
+        if (diff > maxdiff)
+            maxdiff = diff;
+        if (diff > 1.0 || le.kind != lunar[i].kind)
+            FFAIL("lunar catalog entry %d: ut %0.6lf kind %d, expected ut %0.6lf kind %d\n", (int)i, lunar[i].peak.ut, lunar[i].kind, le.peak.ut, le.kind);
+        ++i;
+    }
+    if (i != nlunar)
+        FFAIL("lunar catalog has %d eclipses, expected %d\n", (int)nlunar, (int)i);
+
+    i = 0;
+    for (se = Astronomy_SearchGlobalSolarEclipse(startTime); se.peak.ut < stopTime.ut; se = Astronomy_NextGlobalSolarEclipse(se.peak))
+    {
+        CHECK_STATUS(se);
+        if (i == nsolar)
+            FFAIL("solar catalog is missing the eclipse at ut %0.6lf\n", se.peak.ut);
+        diff = SECONDS_PER_DAY * ABS(se.peak.ut - solar[i].peak.ut);
+        if (diff > maxdiff)
+            maxdiff = diff;
+        if (diff > 1.0 || se.kind != solar[i].kind)
+            FFAIL("solar catalog entry %d: ut %0.6lf kind %d, expected ut %0.6lf kind %d\n", (int)i, solar[i].peak.ut, solar[i].kind, se.peak.ut, se.kind);
+        ++i;
+    }
+    if (i != nsolar)
+        FFAIL("solar catalog has %d eclipses, expected %d\n", (int)nsolar, (int)i);
+
+    if (Astronomy_LunarEclipseCatalog(startTime, stopTime, lunar, 10, &count) != ASTRO_BUFFER_TOO_SMALL || count != 10)
+        FFAIL("expected ASTRO_BUFFER_TOO_SMALL with 10 eclipses stored.\n");
+
+    FPASSA("%d lunar, %d solar, maxdiff = %0.3lf seconds\n", (int)nlunar, (int)nsolar, maxdiff);
+fail:
+    return error;
+}
+
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int LocalEclipseEventDiff(const char *name, astro_eclipse_event_t a, astro_eclipse_event_t b, double *maxdiff)
+{
+    double diff = SECONDS_PER_DAY * ABS(a.time.ut - b.time.ut);
+    if (diff > *maxdiff)
+        *maxdiff = diff;
+    if (diff > 1.0 || ABS(a.altitude - b.altitude) > 0.01)
+    {
+        printf("C LocalEclipseEventDiff(%s): ut %0.6lf alt %0.4lf, expected ut %0.6lf alt %0.4lf\n", name, a.time.ut, a.altitude, b.time.ut, b.altitude);
+        return 1;
+    }
+    return 0;
+}
+
+static int LocalEclipseBatchTest(void)
+{
+    enum { NLAT = 14, NLON = 18, NOBS = NLAT*NLON };
+    static astro_observer_t observers[NOBS];
+    static astro_local_solar_eclipse_t results[NOBS];
+    int error = 1;
+    int e, i, j, k, nmatch = 0, nnone = 0, ncentral = 0;
+    astro_global_solar_eclipse_t global;
+    astro_local_solar_eclipse_t exact;
+    astro_time_t startTime;
+    double maxdiff = 0.0;
+
+    for (i = 0; i < NLAT; ++i)
+        for (j = 0; j < NLON; ++j)
+            observers[i*NLON + j] = Astronomy_MakeObserver(-60.0 + 10.0*i, -180.0 + 20.0*j, 0.0);
+
+    for (e = 0; e < 2; ++e)
+    {
+        startTime = (e == 0) ? Astronomy_MakeTime(2023, 10, 1, 0, 0, 0.0) : Astronomy_MakeTime(2024, 4, 1, 0, 0, 0.0);
+        global = Astronomy_SearchGlobalSolarEclipse(startTime);
+        CHECK_STATUS(global);
+        CHECK(Astronomy_LocalSolarEclipseBatch(global.peak, observers, NOBS, results));
+
+        for (k = 0; k < NOBS; ++k)
+        {
+            CHECK_STATUS(results[k]);
+            exact = Astronomy_SearchLocalSolarEclipse(startTime, observers[k]);
+            CHECK_STATUS(exact);
+            if (ABS(exact.peak.time.ut - global.peak.ut) > 1.0)
+            {
+                /* The serial search skipped this eclipse: it must be invisible to this observer. */
+                if (results[k].kind != ECLIPSE_NONE && (results[k].partial_begin.altitude > 0.0 || results[k].partial_end.altitude > 0.0))
+                    FFAIL("observer %d sees eclipse kind %d, but the serial search skipped it.\n", k, results[k].kind);
+                if (results[k].kind == ECLIPSE_NONE)
+                    ++nnone;
+                continue;
+            }
+
+            if (results[k].kind != exact.kind)
+                FFAIL("observer %d: kind %d, expected %d\n", k, results[k].kind, exact.kind);
+            if (ABS(results[k].obscuration - exact.obscuration) > 1.0e-4)
+                FFAIL("observer %d: obscuration %0.6lf, expected %0.6lf\n", k, results[k].obscuration, exact.obscuration);
+            if (LocalEclipseEventDiff("partial_begin", results[k].partial_begin, exact.partial_begin, &maxdiff)) FFAIL("observer %d\n", k);
+            if (LocalEclipseEventDiff("peak", results[k].peak, exact.peak, &maxdiff)) FFAIL("observer %d\n", k);
+            if (LocalEclipseEventDiff("partial_end", results[k].partial_end, exact.partial_end, &maxdiff)) FFAIL("observer %d\n", k);
+            if (exact.kind != ECLIPSE_PARTIAL)
+            {
+                if (LocalEclipseEventDiff("total_begin", results[k].total_begin, exact.total_begin, &maxdiff)) FFAIL("observer %d\n", k);
+                if (LocalEclipseEventDiff("total_end", results[k].total_end, exact.total_end, &maxdiff)) FFAIL("observer %d\n", k);
+                ++ncentral;
+            }
+            ++nmatch;
+        }
+    }
+
+    if (nmatch == 0 || nnone == 0)
+        FFAIL("expected both eclipsed and uneclipsed observers: nmatch=%d, nnone=%d\n", nmatch, nnone);
+
+    FPASSA("%d matches (%d central), %d without eclipse, maxdiff = %0.3lf seconds\n", nmatch, ncentral, nnone, maxdiff);
+fail:
+    return error;
+}
+
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int ConstellationStarsTest(void)
+{
+    static const struct
+    {
+        double ra;
+        double dec;
+        const char *symbol;
+    }
+    stars[] =
+    {
+        {  2.5303, +89.2641, "UMi" },   /* Polaris */
+        {  6.7525, -16.7161, "CMa" },   /* Sirius */
+        {  5.9195,  +7.4071, "Ori" },   /* Betelgeuse */
+        { 18.6156, +38.7837, "Lyr" },   /* Vega */
+        { 16.4901, -26.4320, "Sco" },   /* Antares */
+        {  6.3992, -52.6957, "Car" },   /* Canopus */
+        { 12.4433, -63.0991, "Cru" },   /* Acrux */
+        { 20.6905, +45.2803, "Cyg" },   /* Deneb */
+        {  4.5987, +16.5093, "Tau" },   /* Aldebaran */
+        { 10.1395, +11.9672, "Leo" },   /* Regulus */
+        { 13.4199, -11.1613, "Vir" },   /* Spica */
+        { 22.9608, -29.6223, "PsA" },   /* Fomalhaut */
+        {  0.0000, +90.0000, "UMi" },   /* north celestial pole */
+        { 12.0000, -90.0000, "Oct" },   /* south celestial pole */
+    };
+    int error = 1;
+    int i;
+    astro_constellation_t constel, wrapped;
+
+    for (i = 0; i < (int)(sizeof(stars) / sizeof(stars[0])); ++i)
+    {
+        constel = Astronomy_Constellation(stars[i].ra, stars[i].dec);
+        CHECK_STATUS(constel);
+        if (strcmp(constel.symbol, stars[i].symbol))
+            FFAIL("RA=%0.4lf DEC=%0.4lf: expected %s, found %s\n", stars[i].ra, stars[i].dec, stars[i].symbol, constel.symbol);
+
+        /* Right ascension wraps around. */
+        wrapped = Astronomy_Constellation(stars[i].ra - 24.0, stars[i].dec);
+        CHECK_STATUS(wrapped);
+        if (wrapped.symbol != constel.symbol)
+            FFAIL("RA=%0.4lf DEC=%0.4lf: wrapped RA found %s\n", stars[i].ra, stars[i].dec, wrapped.symbol);
+    }
+
+    constel = Astronomy_Constellation(0.0, 90.5);
+    if (constel.status != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for DEC > 90.\n");
+
+    FPASS();
+fail:
+    return error;
+}
+
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int ConstellationBatchTest(void)
+{
+    enum { NPOINTS = 10000 };
+    static double ra[NPOINTS], dec[NPOINTS];
+    static astro_constellation_t results[NPOINTS];
+    int error = 1;
+    int i, ninvalid = 0;
+    astro_constellation_t single;
+    astro_spherical_t sphere;
+    astro_vector_t vec;
+    astro_equatorial_t equ;
+    astro_rotation_t rot;
+    astro_time_t b1875 = Astronomy_TimeFromDays(-45655.74141261017);
+
+    for (i = 0; i < NPOINTS; ++i)
+    {
+        /* Scatter points over the sky, with RA values that need wrapping, */
+        /* and a few out-of-range declinations. */
+        ra[i] = fmod(i * 0.7316, 72.0) - 24.0;
+        dec[i] = 90.0 * sin(i * 1.0971);
+        if (i % 997 == 0)
+            dec[i] = 90.5;
+    }
+    ra[17] = NAN;
+
+    CHECK(Astronomy_ConstellationBatch(ra, dec, NPOINTS, results));
+
+    rot = Astronomy_Rotation_EQJ_EQD(&b1875);
+    CHECK_STATUS(rot);
+
+    for (i = 0; i < NPOINTS; ++i)
+    {
+        single = Astronomy_Constellation(ra[i], dec[i]);
+        if (single.status != results[i].status)
+            FFAIL("point %d: single status %d, batch status %d\n", i, single.status, results[i].status);
+
+        if (single.status != ASTRO_SUCCESS)
+        {
+            ++ninvalid;
+            continue;
+        }
+
+        if (single.symbol != results[i].symbol || single.ra_1875 != results[i].ra_1875 || single.dec_1875 != results[i].dec_1875)
+            FFAIL("point %d: batch result differs from single result.\n", i);
+
+        /* The B1875 coordinates must be the same as converting through the vector functions. */
+        sphere.status = ASTRO_SUCCESS;
+        sphere.lon = 15.0 * (ra[i] - 24.0*floor(ra[i] / 24.0));
+        sphere.lat = dec[i];
+        sphere.dist = 1.0;
+        vec = Astronomy_VectorFromSphere(sphere, b1875);
+        equ = Astronomy_EquatorFromVector(Astronomy_RotateVector(rot, vec));
+        CHECK_STATUS(equ);
+        if (ABS(equ.ra - results[i].ra_1875) > 1.0e-12 || ABS(equ.dec - results[i].dec_1875) > 1.0e-12)
+            FFAIL("point %d: B1875 (%0.15lf, %0.15lf), expected (%0.15lf, %0.15lf)\n", i, results[i].ra_1875, results[i].dec_1875, equ.ra, equ.dec);
+    }
+
+    if (ninvalid != 1 + (NPOINTS + 996) / 997)
+        FFAIL("unexpected number of invalid points: %d\n", ninvalid);
+
+    FPASS();
+fail:
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static double VectorAngle(astro_vector_t a, astro_vector_t b)
+{
+    /* The angle between two nearly parallel vectors in degrees, without the roundoff of acos. */
+    double ra = Astronomy_VectorLength(a);
+    double rb = Astronomy_VectorLength(b);
+    double dx = a.x/ra - b.x/rb;
+    double dy = a.y/ra - b.y/rb;
+    double dz = a.z/ra - b.z/rb;
+    return 2.0 * RAD2DEG * asin(sqrt(dx*dx + dy*dy + dz*dz) / 2.0);
+}
+
+static int StarCatalogTest(void)
+{
+    enum { NSTARS = 150 };
+    static double ra[NSTARS], dec[NSTARS], dist[NSTARS];
+    static astro_equatorial_t equ[NSTARS];
+    static astro_horizon_t hor[NSTARS];
+    static astro_search_result_t rise[NSTARS], set[NSTARS];
+    static astro_hour_angle_t culm[NSTARS];
+    int error = 1;
+    int i, k, nrise = 0;
+    astro_star_catalog_t *catalog = NULL;
+    astro_star_catalog_t *moving = NULL;
+    astro_observer_t observer = Astronomy_MakeObserver(+52.5, -1.9, 120.0);
+    astro_time_t time = Astronomy_MakeTime(2024, 3, 15, 21, 30, 0.0);
+    astro_time_t later;
+    astro_equatorial_t single;
+    astro_horizon_t shor;
+    astro_search_result_t search;
+    astro_hour_angle_t ha;
+    astro_equator_date_t equdate;
+    astro_aberration_t aberration;
+    double diff, maxdiff = 0.0, maxtime = 0.0;
+    double pmra = -798.58, pmdec = +10328.12;      /* Barnard's Star [mas/yr] */
+    double zero = 0.0;
+
+    for (i = 0; i < NSTARS; ++i)
+    {
+        ra[i] = fmod(i * 3.7913, 24.0);
+        dec[i] = 89.0 * sin(i * 0.8317);
+        dist[i] = 1.0 + fmod(i * 97.31, 2000.0);
+    }
+
+    /* Invalid stars must be rejected. */
+    ra[7] = 24.0;
+    if (ASTRO_INVALID_PARAMETER != Astronomy_StarCatalogCreate(&catalog, NSTARS, ra, dec, dist, NULL, NULL) || catalog != NULL)
+        FFAIL("catalog with an invalid star was not rejected.\n");
+    ra[7] = 2.5;
+
+    CHECK(Astronomy_StarCatalogCreate(&catalog, NSTARS, ra, dec, dist, NULL, NULL));
+    if (Astronomy_StarCatalogCount(catalog) != NSTARS)
+        FFAIL("wrong catalog count %d\n", (int)Astronomy_StarCatalogCount(catalog));
+
+    /* Positions must match Astronomy_Equator and Astronomy_Horizon for a user-defined star. */
+    for (k = 0; k < 4; ++k)
+    {
+        equdate = (k & 1) ? EQUATOR_OF_DATE : EQUATOR_J2000;
+        aberration = (k & 2) ? ABERRATION : NO_ABERRATION;
+        CHECK(Astronomy_StarCatalogEquator(catalog, &time, observer, equdate, aberration, equ));
+        for (i = 0; i < NSTARS; ++i)
+        {
+            CHECK(Astronomy_DefineStar(BODY_STAR1, ra[i], dec[i], dist[i]));
+            single = Astronomy_Equator(BODY_STAR1, &time, observer, equdate, aberration);
+            CHECK_STATUS(single);
+            CHECK_STATUS(equ[i]);
+            diff = VectorAngle(single.vec, equ[i].vec) * 3600.0;
+            if (!(diff < 1.0e-6))
+                FFAIL("star %d, equdate %d, aberration %d: equatorial error %lg arcsec\n", i, equdate, aberration, diff);
+            if (diff > maxdiff)
+                maxdiff = diff;
+        }
+    }
+
+    CHECK(Astronomy_StarCatalogHorizon(catalog, &time, observer, REFRACTION_NORMAL, hor));
+    for (i = 0; i < NSTARS; ++i)
+    {
+        CHECK(Astronomy_DefineStar(BODY_STAR1, ra[i], dec[i], dist[i]));
+        single = Astronomy_Equator(BODY_STAR1, &time, observer, EQUATOR_OF_DATE, ABERRATION);
+        CHECK_STATUS(single);
+        shor = Astronomy_Horizon(&time, observer, single.ra, single.dec, REFRACTION_NORMAL);
+        diff = ABS(shor.altitude - hor[i].altitude) + ABS(shor.azimuth - hor[i].azimuth);
+        if (!(diff < 1.0e-9))
+            FFAIL("star %d: horizontal error %lg degrees\n", i, diff);
+    }
+
+    /* Rise, set, and culmination must match the searches for a user-defined star. */
+    CHECK(Astronomy_StarCatalogSearchRiseSet(catalog, observer, DIRECTION_RISE, time, 2.0, rise));
+    CHECK(Astronomy_StarCatalogSearchRiseSet(catalog, observer, DIRECTION_SET, time, -2.0, set));
+    CHECK(Astronomy_StarCatalogSearchHourAngle(catalog, observer, 0.0, time, +1, culm));
+    for (i = 0; i < NSTARS; ++i)
+    {
+        CHECK(Astronomy_DefineStar(BODY_STAR1, ra[i], dec[i], dist[i]));
+
+        search = Astronomy_SearchRiseSet(BODY_STAR1, observer, DIRECTION_RISE, time, 2.0);
+        if (search.status != rise[i].status)
+            FFAIL("star %d: rise status %d, expected %d\n", i, rise[i].status, search.status);
+        if (search.status == ASTRO_SUCCESS)
+        {
+            ++nrise;
+            diff = ABS(search.time.ut - rise[i].time.ut) * SECONDS_PER_DAY;
+            if (diff > maxtime)
+                maxtime = diff;
+        }
+
+        search = Astronomy_SearchRiseSet(BODY_STAR1, observer, DIRECTION_SET, time, -2.0);
+        if (search.status != set[i].status)
+            FFAIL("star %d: set status %d, expected %d\n", i, set[i].status, search.status);
+        if (search.status == ASTRO_SUCCESS)
+        {
+            diff = ABS(search.time.ut - set[i].time.ut) * SECONDS_PER_DAY;
+            if (diff > maxtime)
+                maxtime = diff;
+        }
+
+        ha = Astronomy_SearchHourAngleEx(BODY_STAR1, observer, 0.0, time, +1);
+        CHECK_STATUS(ha);
+        CHECK_STATUS(culm[i]);
+        diff = ABS(ha.time.ut - culm[i].time.ut) * SECONDS_PER_DAY;
+        if (diff > maxtime)
+            maxtime = diff;
+        if (ABS(ha.hor.altitude - culm[i].hor.altitude) > 1.0e-6)
+            FFAIL("star %d: culmination altitude %0.9lf, expected %0.9lf\n", i, culm[i].hor.altitude, ha.hor.altitude);
+    }
+    if (maxtime > 0.1)
+        FFAIL("event time error %lg seconds\n", maxtime);
+    if (nrise < NSTARS/5 || nrise == NSTARS)
+        FFAIL("unexpected number of star rises: %d\n", nrise);
+
+    /* A very long time limit must find the same rises, using the exact Earth state past the cached days. */
+    for (i = k = 0; i < NSTARS; ++i)
+    {
+        if (rise[i].status == ASTRO_SUCCESS)
+        {
+            ra[k] = ra[i];
+            dec[k] = dec[i];
+            dist[k] = dist[i];
+            set[k] = rise[i];
+            ++k;
+        }
+    }
+    Astronomy_StarCatalogFree(catalog);
+    catalog = NULL;
+    CHECK(Astronomy_StarCatalogCreate(&catalog, (size_t)k, ra, dec, dist, NULL, NULL));
+    CHECK(Astronomy_StarCatalogSearchRiseSet(catalog, observer, DIRECTION_RISE, time, 1.0e+7, rise));
+    for (i = 0; i < k; ++i)
+    {
+        CHECK_STATUS(rise[i]);
+        diff = ABS(rise[i].time.ut - set[i].time.ut) * SECONDS_PER_DAY;
+        if (diff > 0.1)
+            FFAIL("star %d: long time limit changed the rise time by %lg seconds\n", i, diff);
+    }
+
+    /* Proper motion: Barnard's Star moves about 10.36 arcseconds per year. */
+    CHECK(Astronomy_StarCatalogCreate(&moving, 1, &ra[3], &dec[3], &dist[3], &pmra, &pmdec));
+    Astronomy_StarCatalogFree(catalog);
+    CHECK(Astronomy_StarCatalogCreate(&catalog, 1, &ra[3], &dec[3], &dist[3], &zero, NULL));
+    later = Astronomy_AddDays(Astronomy_MakeTime(2000, 1, 1, 12, 0, 0.0), 50.0 * 365.25);
+    CHECK(Astronomy_StarCatalogEquator(catalog, &later, observer, EQUATOR_J2000, NO_ABERRATION, &equ[0]));
+    CHECK(Astronomy_StarCatalogEquator(moving, &later, observer, EQUATOR_J2000, NO_ABERRATION, &equ[1]));
+    diff = VectorAngle(equ[0].vec, equ[1].vec) * 3600.0;
+    if (ABS(diff / (50.0 * 1.0e-3 * hypot(pmra, pmdec)) - 1.0) > 1.0e-3)
+        FFAIL("proper motion moved the star %lf arcsec in 50 years.\n", diff);
+
+    FPASSA("%d stars, max position error %0.3le arcsec, max event time error %0.3lf sec\n", NSTARS, maxdiff, maxtime);
+fail:
+    Astronomy_StarCatalogFree(catalog);
+    Astronomy_StarCatalogFree(moving);
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int ParallelCalls;
+
+static void ReverseChunks(void *context, int count, astro_work_func_t work, void *workContext)
+{
+    /* Imitate threads finishing in an arbitrary order: run uneven chunks from last to first. */
+    int chunk = *((const int *) context);
+    int first = ((count - 1) / chunk) * chunk;
+
+    ++ParallelCalls;
+    for (; first >= 0; first -= chunk)
+        work(workContext, first, (first + chunk <= count) ? chunk : (count - first));
+}
+
+static int GravSimParallelTest(void)
+{
+    enum { NBODIES = 1000, NSTEPS = 50 };
+    static astro_state_vector_t init[NBODIES], serial[NBODIES], parallel[NBODIES];
+    int error = 1;
+    int i, k, chunk = 77;
+    astro_grav_sim_t *sim1 = NULL;
+    astro_grav_sim_t *sim2 = NULL;
+    astro_time_t time = Astronomy_MakeTime(2030, 6, 1, 0, 0, 0.0);
+    double r, angle, speed;
+
+    /* Small bodies in roughly circular orbits from inside Mercury's orbit to beyond Neptune's. */
+    for (i = 0; i < NBODIES; ++i)
+    {
+        r = 0.3 + 35.0 * i / NBODIES;
+        angle = i * 2.3999632;
+        speed = sqrt(2.959122082855911e-04 / r);
+        init[i].status = ASTRO_SUCCESS;
+        init[i].t = time;
+        init[i].x = r * cos(angle);
+        init[i].y = r * sin(angle);
+        init[i].z = 0.05 * r * sin(3.0 * angle);
+        init[i].vx = -speed * sin(angle);
+        init[i].vy = +speed * cos(angle);
+        init[i].vz = 0.0;
+    }
+
+    CHECK(Astronomy_GravSimInit(&sim1, BODY_EARTH, time, NBODIES, init));
+    CHECK(Astronomy_GravSimInit(&sim2, BODY_EARTH, time, NBODIES, init));
+    Astronomy_GravSimSetParallel(sim2, ReverseChunks, &chunk);
+
+    ParallelCalls = 0;
+    for (k = 1; k <= NSTEPS; ++k)
+    {
+        time = Astronomy_AddDays(time, (k % 2) ? 3.0 : -1.0);
+        CHECK(Astronomy_GravSimUpdate(sim1, time, NBODIES, serial));
+        CHECK(Astronomy_GravSimUpdate(sim2, time, NBODIES, parallel));
+
+        /* Splitting the work must not change the results at all. */
+        for (i = 0; i < NBODIES; ++i)
+        {
+            CHECK_STATUS(parallel[i]);
+            if (serial[i].x != parallel[i].x || serial[i].y != parallel[i].y || serial[i].z != parallel[i].z ||
+                serial[i].vx != parallel[i].vx || serial[i].vy != parallel[i].vy || serial[i].vz != parallel[i].vz)
+                FFAIL("step %d, body %d: parallel state differs from serial state.\n", k, i);
+        }
+    }
+
+    if (ParallelCalls != NSTEPS)
+        FFAIL("expected %d calls to the parallel function, found %d\n", NSTEPS, ParallelCalls);
+
+    /* Removing the parallel function goes back to serial updates. */
+    Astronomy_GravSimSetParallel(sim2, NULL, NULL);
+    time = Astronomy_AddDays(time, 1.0);
+    CHECK(Astronomy_GravSimUpdate(sim2, time, NBODIES, parallel));
+    if (ParallelCalls != NSTEPS)
+        FFAIL("parallel function called after removal.\n");
+
+    FPASSA("%d bodies, %d steps\n", NBODIES, NSTEPS);
+fail:
+    Astronomy_GravSimFree(sim1);
+    Astronomy_GravSimFree(sim2);
+    return error;
+}
+
+
+static int CatalogParallelTest(void)
+{
+    enum { MAX_TRANSITS = 200, MAX_ELONG = 700 };
+    static astro_transit_t serial[MAX_TRANSITS], reverse[MAX_TRANSITS], plain[MAX_TRANSITS];
+    static astro_elongation_t eserial[MAX_ELONG], ereverse[MAX_ELONG], eplain[MAX_ELONG];
+    static const int venus_years[] = { 1631, 1639, 1761, 1769, 1874, 1882, 2004, 2012, 2117, 2125, 2247, 2255, 2360, 2368 };
+    int error, b, chunk = 5;
+    size_t i, n, nserial, nreverse, nplain;
+    astro_body_t body;
+    astro_time_t start = Astronomy_MakeTime(1600, 1, 1, 0, 0, 0.0);
+    astro_time_t stop  = Astronomy_MakeTime(2400, 1, 1, 0, 0, 0.0);
+    astro_time_t estop = Astronomy_MakeTime(1700, 1, 1, 0, 0, 0.0);
+    astro_transit_t transit;
+    astro_elongation_t evt;
+    astro_utc_t utc;
+    double diff, max_diff = 0.0;
+
+    for (b = 0; b < 2; ++b)
+    {
+        body = b ? BODY_VENUS : BODY_MERCURY;
+
+        /* Transits: chaining Astronomy_NextTransit, the serial catalog, and the parallel catalog must agree. */
+        CHECK(Astronomy_TransitCatalog(body, start, stop, serial, MAX_TRANSITS, &nserial));
+        ParallelCalls = 0;
+        CHECK(Astronomy_TransitCatalogParallel(body, start, stop, ReverseChunks, &chunk, reverse, MAX_TRANSITS, &nreverse));
+        if (ParallelCalls != 1)
+            FFAIL("%s: expected 1 call to the parallel function, found %d\n", Astronomy_BodyName(body), ParallelCalls);
+        CHECK(Astronomy_TransitCatalogParallel(body, start, stop, NULL, NULL, plain, MAX_TRANSITS, &nplain));
+        if (nserial != nreverse || nserial != nplain)
+            FFAIL("%s: transit counts differ: %d, %d, %d\n", Astronomy_BodyName(body), (int)nserial, (int)nreverse, (int)nplain);
+
+        transit = Astronomy_SearchTransit(body, start);
+        for (i = 0; i < nserial; ++i)
+        {
+            CHECK_STATUS(transit);
+            diff = SECONDS_PER_DAY * ABS(transit.peak.ut - serial[i].peak.ut);
+            if (diff > max_diff) max_diff = diff;
+            diff = SECONDS_PER_DAY * ABS(transit.peak.ut - reverse[i].peak.ut);
+            if (diff > max_diff) max_diff = diff;
+            if (reverse[i].peak.ut != plain[i].peak.ut || reverse[i].start.ut != plain[i].start.ut || reverse[i].finish.ut != plain[i].finish.ut)
+                FFAIL("%s transit %d: the parallel results depend on the order of the chunks\n", Astronomy_BodyName(body), (int)i);
+            if (body == BODY_VENUS)
+            {
+                utc = Astronomy_UtcFromTime(serial[i].peak);
+                if (i >= sizeof(venus_years)/sizeof(venus_years[0]) || utc.year != venus_years[i])
+                    FFAIL("unexpected Venus transit in %d\n", utc.year);
+            }
+            transit = Astronomy_NextTransit(body, transit.finish);
+        }
+        CHECK_STATUS(transit);
+        if (transit.peak.ut < stop.ut)
+            FFAIL("%s: the catalog missed a transit\n", Astronomy_BodyName(body));
+        DEBUG("C CatalogParallelTest: %s: %d transits\n", Astronomy_BodyName(body), (int)nserial);
+
+        /* Maximum elongations. */
+        CHECK(Astronomy_ElongationCatalog(body, start, estop, eserial, MAX_ELONG, &nserial));
+        CHECK(Astronomy_ElongationCatalogParallel(body, start, estop, ReverseChunks, &chunk, ereverse, MAX_ELONG, &nreverse));
+        CHECK(Astronomy_ElongationCatalogParallel(body, start, estop, NULL, NULL, eplain, MAX_ELONG, &nplain));
+        if (nserial != nreverse || nserial != nplain)
+            FFAIL("%s: elongation counts differ: %d, %d, %d\n", Astronomy_BodyName(body), (int)nserial, (int)nreverse, (int)nplain);
+
+        evt = Astronomy_SearchMaxElongation(body, start);
+        for (i = 0; i < nserial; ++i)
+        {
+            CHECK_STATUS(evt);
+            diff = SECONDS_PER_DAY * ABS(evt.time.ut - eserial[i].time.ut);
+            if (diff > max_diff) max_diff = diff;
+            diff = SECONDS_PER_DAY * ABS(evt.time.ut - ereverse[i].time.ut);
+            if (diff > max_diff) max_diff = diff;
+            if (ereverse[i].time.ut != eplain[i].time.ut || ereverse[i].visibility != eplain[i].visibility)
+                FFAIL("%s elongation %d: the parallel results depend on the order of the chunks\n", Astronomy_BodyName(body), (int)i);
+            if (i > 0 && eserial[i].visibility == eserial[i-1].visibility)
+                FFAIL("%s elongation %d: morning and evening elongations do not alternate\n", Astronomy_BodyName(body), (int)i);
+            evt = Astronomy_SearchMaxElongation(body, Astronomy_AddDays(evt.time, 1.0));
+        }
+        CHECK_STATUS(evt);
+        if (evt.time.ut < estop.ut)
+            FFAIL("%s: the catalog missed an elongation\n", Astronomy_BodyName(body));
+        DEBUG("C CatalogParallelTest: %s: %d maximum elongations\n", Astronomy_BodyName(body), (int)nserial);
+    }
+
+    DEBUG("C CatalogParallelTest: max time difference = %0.3lf seconds\n", max_diff);
+    if (max_diff > 1.0)
+        FFAIL("excessive time difference = %lf seconds\n", max_diff);
+
+    /* A buffer that is too small still receives the first events. */
+    if (Astronomy_ElongationCatalogParallel(BODY_VENUS, start, estop, ReverseChunks, &chunk, ereverse, 10, &n) != ASTRO_BUFFER_TOO_SMALL)
+        FFAIL("expected ASTRO_BUFFER_TOO_SMALL\n");
+    if (n != 10)
+        FFAIL("expected 10 events in a buffer that is too small, found %d\n", (int)n);
+    for (i = 0; i < n; ++i)
+        if (ereverse[i].time.ut != eplain[i].time.ut)
+            FFAIL("elongation %d is wrong in a buffer that is too small\n", (int)i);
+
+    if (Astronomy_TransitCatalogParallel(BODY_MARS, start, stop, NULL, NULL, plain, MAX_TRANSITS, &n) != ASTRO_INVALID_BODY)
+        FFAIL("expected ASTRO_INVALID_BODY for Mars\n");
+
+    if (Astronomy_TransitCatalogParallel(BODY_MERCURY, stop, start, NULL, NULL, plain, MAX_TRANSITS, &n) != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for a reversed time range\n");
+
+    FPASS();
+fail:
+    return error;
+}
+
+
+static int EclipseCatalogParallelTest(void)
+{
+    enum { MAX_ECLIPSES = 1000 };
+    static astro_lunar_eclipse_t lunar[MAX_ECLIPSES], lreverse[MAX_ECLIPSES], lplain[MAX_ECLIPSES];
+    static astro_global_solar_eclipse_t solar[MAX_ECLIPSES], sreverse[MAX_ECLIPSES], splain[MAX_ECLIPSES];
+    static const double offset[] = { -1.0e-5, 0.0, +1.0e-5 };   /* days from an eclipse peak to a chunk boundary */
+    const double chunkDays = 64 * 29.530588;    /* the chunk length used by the parallel eclipse catalogs */
+    int error, chunk = 3;
+    size_t i, k, nlunar, nsolar, nreverse, nplain, nfound;
+    astro_time_t start = Astronomy_MakeTime(1900, 1, 1, 0, 0, 0.0);
+    astro_time_t stop  = Astronomy_MakeTime(2100, 1, 1, 0, 0, 0.0);
+    astro_time_t t1, t2;
+    double peak, diff, max_diff = 0.0;
+
+    /* The serial catalog, and the parallel catalog with and without a parallel function, must agree. */
+    CHECK(Astronomy_LunarEclipseCatalog(start, stop, lunar, MAX_ECLIPSES, &nlunar));
+    ParallelCalls = 0;
+    CHECK(Astronomy_LunarEclipseCatalogParallel(start, stop, ReverseChunks, &chunk, lreverse, MAX_ECLIPSES, &nreverse));
+    if (ParallelCalls != 1)
+        FFAIL("lunar: expected 1 call to the parallel function, found %d\n", ParallelCalls);
+    CHECK(Astronomy_LunarEclipseCatalogParallel(start, stop, NULL, NULL, lplain, MAX_ECLIPSES, &nplain));
+    if (nlunar != nreverse || nlunar != nplain)
+        FFAIL("lunar eclipse counts differ: %d, %d, %d\n", (int)nlunar, (int)nreverse, (int)nplain);
+    for (i = 0; i < nlunar; ++i)
+    {
+        diff = SECONDS_PER_DAY * ABS(lunar[i].peak.ut - lreverse[i].peak.ut);
+        if (diff > max_diff) max_diff = diff;
+        if (lunar[i].kind != lreverse[i].kind)
+            FFAIL("lunar eclipse %d: kind %d, expected %d\n", (int)i, lreverse[i].kind, lunar[i].kind);
+        if (lreverse[i].peak.ut != lplain[i].peak.ut || lreverse[i].sd_penum != lplain[i].sd_penum)
+            FFAIL("lunar eclipse %d: the parallel results depend on the order of the chunks\n", (int)i);
+    }
+
+    CHECK(Astronomy_GlobalSolarEclipseCatalog(start, stop, solar, MAX_ECLIPSES, &nsolar));
+    CHECK(Astronomy_GlobalSolarEclipseCatalogParallel(start, stop, ReverseChunks, &chunk, sreverse, MAX_ECLIPSES, &nreverse));
+    CHECK(Astronomy_GlobalSolarEclipseCatalogParallel(start, stop, NULL, NULL, splain, MAX_ECLIPSES, &nplain));
+    if (nsolar != nreverse || nsolar != nplain)
+        FFAIL("solar eclipse counts differ: %d, %d, %d\n", (int)nsolar, (int)nreverse, (int)nplain);
+    for (i = 0; i < nsolar; ++i)
+    {
+        diff = SECONDS_PER_DAY * ABS(solar[i].peak.ut - sreverse[i].peak.ut);
+        if (diff > max_diff) max_diff = diff;
+        if (solar[i].kind != sreverse[i].kind)
+            FFAIL("solar eclipse %d: kind %d, expected %d\n", (int)i, sreverse[i].kind, solar[i].kind);
+        if (sreverse[i].peak.ut != splain[i].peak.ut || sreverse[i].distance != splain[i].distance)
+            FFAIL("solar eclipse %d: the parallel results depend on the order of the chunks\n", (int)i);
+    }
+
+    DEBUG("C EclipseCatalogParallelTest: %d lunar, %d solar, max time difference = %0.3lf seconds\n", (int)nlunar, (int)nsolar, max_diff);
+    if (max_diff > 1.0)
+        FFAIL("excessive time difference = %lf seconds\n", max_diff);
+
+    /* An eclipse at or next to a chunk boundary must be listed exactly once. */
+    for (k = 0; k < sizeof(offset)/sizeof(offset[0]); ++k)
+    {
+        peak = lunar[100].peak.ut;
+        t1 = Astronomy_TimeFromDays(peak + offset[k] - chunkDays);
+        t2 = Astronomy_TimeFromDays(peak + 400.0);
+        CHECK(Astronomy_LunarEclipseCatalogParallel(t1, t2, ReverseChunks, &chunk, lreverse, MAX_ECLIPSES, &nreverse));
+        for (i = nfound = 0; i < nreverse; ++i)
+            if (ABS(lreverse[i].peak.ut - peak) < 1.0)
+                ++nfound;
+        if (nfound != 1)
+            FFAIL("lunar eclipse at a chunk boundary %+0.0lf seconds away was listed %d times\n", offset[k] * SECONDS_PER_DAY, (int)nfound);
+
+        peak = solar[100].peak.ut;
+        t1 = Astronomy_TimeFromDays(peak + offset[k] - chunkDays);
+        t2 = Astronomy_TimeFromDays(peak + 400.0);
+        CHECK(Astronomy_GlobalSolarEclipseCatalogParallel(t1, t2, ReverseChunks, &chunk, sreverse, MAX_ECLIPSES, &nreverse));
+        for (i = nfound = 0; i < nreverse; ++i)
+            if (ABS(sreverse[i].peak.ut - peak) < 1.0)
+                ++nfound;
+        if (nfound != 1)
+            FFAIL("solar eclipse at a chunk boundary %+0.0lf seconds away was listed %d times\n", offset[k] * SECONDS_PER_DAY, (int)nfound);
+    }
+
+    /* A buffer that is too small still receives the first eclipses. */
+    if (Astronomy_LunarEclipseCatalogParallel(start, stop, ReverseChunks, &chunk, lreverse, 10, &nreverse) != ASTRO_BUFFER_TOO_SMALL || nreverse != 10)
+        FFAIL("expected ASTRO_BUFFER_TOO_SMALL with 10 eclipses stored.\n");
+    for (i = 0; i < nreverse; ++i)
+        if (lreverse[i].peak.ut != lplain[i].peak.ut)
+            FFAIL("lunar eclipse %d is wrong in a buffer that is too small\n", (int)i);
+
+    if (Astronomy_GlobalSolarEclipseCatalogParallel(stop, start, NULL, NULL, splain, MAX_ECLIPSES, &nplain) != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for a reversed time range\n");
+
+    FPASS();
+fail:
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int GravSimRun(
+    astro_state_vector_t init,
+    astro_gravsim_integrator_t integrator,
+    double stepFactor,
+    double days,
+    int nsteps,
+    astro_state_vector_t *final)
+{
+    int error = 1;
+    int k;
+    astro_grav_sim_t *sim = NULL;
+    astro_time_t time;
+
+    CHECK(Astronomy_GravSimInitEx(&sim, BODY_SUN, init.t, 1, &init, integrator, stepFactor));
+    for (k = 1; k <= nsteps; ++k)
+    {
+        time = Astronomy_TerrestrialTime(init.t.tt + (k * days) / nsteps);
+        CHECK(Astronomy_GravSimUpdate(sim, time, 1, final));
+    }
+    error = 0;
+fail:
+    Astronomy_GravSimFree(sim);
+    return error;
+}
+
+
+static double GravSimKmError(astro_state_vector_t a, astro_state_vector_t b)
+{
+    return KM_PER_AU * sqrt((a.x-b.x)*(a.x-b.x) + (a.y-b.y)*(a.y-b.y) + (a.z-b.z)*(a.z-b.z));
+}
+
+
+static int GravSimHermiteTest(void)
+{
+    const double days = 2000.0;
+    int error = 1;
+    int k;
+    state_vector_batch_t batch = EmptyStateVectorBatch();
+    astro_state_vector_t init, ref, mean, herm, adapt;
+    astro_state_vector_t state[2];
+    astro_grav_sim_t *sim = NULL;
+    astro_time_t time;
+    double mean_err, herm_err, adapt_err;
+
+    CHECK(LoadStateVectors(&batch, "heliostate/Ceres.txt"));
+    init = batch.array[0];
+
+    /* Reference trajectory: many small fourth-order steps. */
+    CHECK(GravSimRun(init, GRAVSIM_HERMITE, 0.0, days, 4000, &ref));
+
+    /* With the same 10-day steps, the Hermite method is far more accurate than the default method. */
+    CHECK(GravSimRun(init, GRAVSIM_MEAN_ACCELERATION, 0.0, days, 200, &mean));
+    CHECK(GravSimRun(init, GRAVSIM_HERMITE, 0.0, days, 200, &herm));
+    mean_err = GravSimKmError(ref, mean);
+    herm_err = GravSimKmError(ref, herm);
+    DEBUG("C GravSimHermiteTest: Ceres 10-day steps: mean acceleration error = %0.3lf km, Hermite error = %0.3lf km\n", mean_err, herm_err);
+    if (herm_err > 1000.0 || herm_err * 100.0 > mean_err)
+        FFAIL("Hermite error %0.3lf km is not small enough compared to %0.3lf km\n", herm_err, mean_err);
+
+    /* A single huge update with automatic substeps. */
+    CHECK(GravSimRun(init, GRAVSIM_HERMITE, 0.01, days, 1, &adapt));
+    adapt_err = GravSimKmError(ref, adapt);
+    DEBUG("C GravSimHermiteTest: Ceres one update with stepFactor 0.01: error = %0.6lf km\n", adapt_err);
+    if (adapt_err > 10.0)
+        FFAIL("excessive error with automatic substeps: %0.6lf km\n", adapt_err);
+
+    /* Swap must undo an update that was divided into substeps. */
+    CHECK(Astronomy_GravSimInitEx(&sim, BODY_SUN, init.t, 1, &init, GRAVSIM_HERMITE, 0.01));
+    for (k = 0; k < 2; ++k)
+    {
+        time = Astronomy_AddDays(init.t, 300.0 * (k + 1));
+        CHECK(Astronomy_GravSimUpdate(sim, time, 1, &state[k]));
+    }
+    Astronomy_GravSimSwap(sim);
+    time = Astronomy_GravSimTime(sim);
+    CHECK(Astronomy_GravSimUpdate(sim, time, 1, &adapt));
+    if (time.tt != state[0].t.tt || adapt.x != state[0].x || adapt.y != state[0].y || adapt.z != state[0].z)
+        FFAIL("swap did not restore the previous state.\n");
+
+    /* Invalid combinations of settings. */
+    Astronomy_GravSimFree(sim);
+    if (ASTRO_INVALID_PARAMETER != Astronomy_GravSimInitEx(&sim, BODY_SUN, init.t, 1, &init, GRAVSIM_MEAN_ACCELERATION, 0.01))
+        FFAIL("expected failure for stepFactor with GRAVSIM_MEAN_ACCELERATION\n");
+    if (ASTRO_INVALID_PARAMETER != Astronomy_GravSimInitEx(&sim, BODY_SUN, init.t, 1, &init, GRAVSIM_HERMITE, -1.0))
+        FFAIL("expected failure for negative stepFactor\n");
+    if (sim != NULL)
+        FFAIL("sim should be NULL after failure\n");
+
+    FPASSA("(mean = %0.3lf km, hermite = %0.3lf km, adaptive = %0.6lf km)\n", mean_err, herm_err, adapt_err);
+fail:
+    Astronomy_GravSimFree(sim);
+    FreeStateVectorBatch(&batch);
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int GravSimEphemTest(void)
+{
+    enum { NSIMS = 8, NSTEPS = 200 };
+    int error = 1;
+    int s, k, step, capacity;
+    state_vector_batch_t batch = EmptyStateVectorBatch();
+    astro_state_vector_t init[NSIMS], own[NSIMS], shared[NSIMS];
+    astro_grav_sim_t *ownSim[NSIMS];
+    astro_grav_sim_t *sharedSim[NSIMS];
+    astro_grav_ephem_t *ephem = NULL;
+    astro_gravsim_integrator_t integrator;
+    astro_time_t time;
+    double stepFactor;
+
+    memset(ownSim, 0, sizeof(ownSim));
+    memset(sharedSim, 0, sizeof(sharedSim));
+
+    if (ASTRO_INVALID_PARAMETER != Astronomy_GravSimEphemCreate(&ephem, 0))
+        FFAIL("expected failure for capacity 0\n");
+
+    CHECK(LoadStateVectors(&batch, "heliostate/Juno.txt"));
+
+    /* Clones of Juno with slightly different velocities. */
+    for (s = 0; s < NSIMS; ++s)
+    {
+        init[s] = batch.array[0];
+        init[s].vx *= 1.0 + 1.0e-6 * s;
+    }
+
+    /*
+        Pass 0: lockstep default updates with capacity 1.
+        Pass 1: Hermite updates with automatic substeps, capacity too small for all of them,
+        so that entries are overwritten before the other simulators could use them.
+        The sharing must never change any result.
+    */
+    for (k = 0; k < 2; ++k)
+    {
+        integrator = k ? GRAVSIM_HERMITE : GRAVSIM_MEAN_ACCELERATION;
+        stepFactor = k ? 0.05 : 0.0;
+        capacity = k ? 3 : 1;
+        CHECK(Astronomy_GravSimEphemCreate(&ephem, capacity));
+        for (s = 0; s < NSIMS; ++s)
+        {
+            CHECK(Astronomy_GravSimInitEx(&ownSim[s], BODY_SUN, init[s].t, 1, &init[s], integrator, stepFactor));
+            CHECK(Astronomy_GravSimInitEx(&sharedSim[s], BODY_SUN, init[s].t, 1, &init[s], integrator, stepFactor));
+            Astronomy_GravSimSetEphem(sharedSim[s], ephem);
+        }
+
+        time = init[0].t;
+        for (step = 1; step <= NSTEPS; ++step)
+        {
+            time = Astronomy_AddDays(time, (step % 5) ? 4.0 : -3.0);
+            for (s = 0; s < NSIMS; ++s)
+            {
+                CHECK(Astronomy_GravSimUpdate(ownSim[s], time, 1, &own[s]));
+                CHECK(Astronomy_GravSimUpdate(sharedSim[s], time, 1, &shared[s]));
+                if (own[s].x != shared[s].x || own[s].y != shared[s].y || own[s].z != shared[s].z ||
+                    own[s].vx != shared[s].vx || own[s].vy != shared[s].vy || own[s].vz != shared[s].vz)
+                    FFAIL("pass %d, step %d, sim %d: shared ephemeris changed the result.\n", k, step, s);
+            }
+        }
+
+        for (s = 0; s < NSIMS; ++s)
+        {
+            Astronomy_GravSimFree(ownSim[s]);
+            Astronomy_GravSimFree(sharedSim[s]);
+            ownSim[s] = sharedSim[s] = NULL;
+        }
+        Astronomy_GravSimEphemFree(ephem);
+        ephem = NULL;
+    }
+
+    FPASSA("%d simulators, %d steps\n", NSIMS, NSTEPS);
+fail:
+    for (s = 0; s < NSIMS; ++s)
+    {
+        Astronomy_GravSimFree(ownSim[s]);
+        Astronomy_GravSimFree(sharedSim[s]);
+    }
+    Astronomy_GravSimEphemFree(ephem);
+    FreeStateVectorBatch(&batch);
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int SameStates(int n, const astro_state_vector_t *a, const astro_state_vector_t *b)
+{
+    int i;
+    for (i = 0; i < n; ++i)
+        if (a[i].t.tt != b[i].t.tt || a[i].x != b[i].x || a[i].y != b[i].y || a[i].z != b[i].z ||
+            a[i].vx != b[i].vx || a[i].vy != b[i].vy || a[i].vz != b[i].vz)
+            return 0;
+    return 1;
+}
+
+
+static int GravSimSnapshotTest(void)
+{
+    enum { NBODIES = 40, NSTEPS = 30 };
+    int error = 1;
+    int i, k, pass;
+    astro_state_vector_t init[NBODIES], orig[NBODIES], copy[NBODIES], rest[NBODIES];
+    astro_grav_sim_t *sim = NULL;
+    astro_grav_sim_t *clone = NULL;
+    astro_grav_sim_t *restored = NULL;
+    astro_time_t time;
+    char *buffer = NULL;
+    size_t size;
+    double r, angle;
+
+    for (pass = 0; pass < 2; ++pass)
+    {
+        time = Astronomy_MakeTime(2031, 2, 3, 4, 5, 6.0);
+        for (i = 0; i < NBODIES; ++i)
+        {
+            r = 0.5 + 0.1*i;
+            angle = 0.7 * i;
+            init[i].status = ASTRO_SUCCESS;
+            init[i].t = time;
+            init[i].x = r * cos(angle);
+            init[i].y = r * sin(angle);
+            init[i].z = 0.01 * i;
+            init[i].vx = -0.0172 * sin(angle) / sqrt(r);
+            init[i].vy = +0.0172 * cos(angle) / sqrt(r);
+            init[i].vz = 0.0;
+        }
+
+        if (pass == 0)
+            CHECK(Astronomy_GravSimInit(&sim, BODY_EARTH, time, NBODIES, init));
+        else
+            CHECK(Astronomy_GravSimInitEx(&sim, BODY_SUN, time, NBODIES, init, GRAVSIM_HERMITE, 0.05));
+
+        for (k = 1; k <= NSTEPS; ++k)
+        {
+            time = Astronomy_AddDays(time, 5.0);
+            CHECK(Astronomy_GravSimUpdate(sim, time, NBODIES, orig));
+        }
+
+        /* Take a snapshot and a clone halfway through. */
+        size = Astronomy_GravSimSnapshotSize(sim);
+        buffer = (char *) malloc(size);
+        if (buffer == NULL)
+            FFAIL("out of memory\n");
+        if (ASTRO_INVALID_PARAMETER != Astronomy_GravSimSnapshot(sim, buffer, size-1))
+            FFAIL("expected failure for a buffer that is too small\n");
+        CHECK(Astronomy_GravSimSnapshot(sim, buffer, size));
+        CHECK(Astronomy_GravSimClone(&clone, sim));
+
+        if (ASTRO_BAD_FILE_FORMAT != Astronomy_GravSimRestore(&restored, buffer, size-1))
+            FFAIL("expected failure for a truncated snapshot\n");
+        buffer[0] ^= 1;
+        if (ASTRO_BAD_FILE_FORMAT != Astronomy_GravSimRestore(&restored, buffer, size))
+            FFAIL("expected failure for a corrupted snapshot\n");
+        buffer[0] ^= 1;
+        if (restored != NULL)
+            FFAIL("restored should be NULL after failure\n");
+        CHECK(Astronomy_GravSimRestore(&restored, buffer, size));
+
+        if (Astronomy_GravSimNumBodies(restored) != NBODIES || Astronomy_GravSimOrigin(restored) != Astronomy_GravSimOrigin(sim))
+            FFAIL("pass %d: restored simulator has the wrong shape\n", pass);
+
+        /* All three must continue identically, including an undo. */
+        for (k = 1; k <= NSTEPS; ++k)
+        {
+            if (k == NSTEPS/2)
+            {
+                Astronomy_GravSimSwap(sim);
+                Astronomy_GravSimSwap(clone);
+                Astronomy_GravSimSwap(restored);
+            }
+            else
+            {
+                time = Astronomy_AddDays(time, (k % 3) ? 5.0 : -2.0);
+            }
+            CHECK(Astronomy_GravSimUpdate(sim, time, NBODIES, orig));
+            CHECK(Astronomy_GravSimUpdate(clone, time, NBODIES, copy));
+            CHECK(Astronomy_GravSimUpdate(restored, time, NBODIES, rest));
+            if (!SameStates(NBODIES, orig, copy))
+                FFAIL("pass %d, step %d: clone differs from original\n", pass, k);
+            if (!SameStates(NBODIES, orig, rest))
+                FFAIL("pass %d, step %d: restored simulator differs from original\n", pass, k);
+        }
+
+        Astronomy_GravSimFree(sim);
+        Astronomy_GravSimFree(clone);
+        Astronomy_GravSimFree(restored);
+        sim = clone = restored = NULL;
+        free(buffer);
+        buffer = NULL;
+    }
+
+    FPASSA("%d bodies, snapshot size = %d bytes\n", NBODIES, (int)size);
+fail:
+    Astronomy_GravSimFree(sim);
+    Astronomy_GravSimFree(clone);
+    Astronomy_GravSimFree(restored);
+    free(buffer);
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+typedef struct
+{
+    long    count;      /* number of live allocations */
+    long    total;      /* number of allocations ever made */
+    size_t  bytes;      /* number of live bytes */
+}
+alloc_counter_t;
+
+static void *CountingAlloc(void *context, size_t size)
+{
+    alloc_counter_t *counter = (alloc_counter_t *) context;
+    size_t *block = (size_t *) malloc(16 + size);
+    if (block == NULL)
+        return NULL;
+    block[0] = size;
+    ++counter->count;
+    ++counter->total;
+    counter->bytes += size;
+    return (char *)block + 16;
+}
+
+static void CountingFree(void *context, void *ptr)
+{
+    alloc_counter_t *counter = (alloc_counter_t *) context;
+    size_t *block = (size_t *)((char *)ptr - 16);
+    --counter->count;
+    counter->bytes -= block[0];
+    free(block);
+}
+
+static int AllocatorWorkload(void)
+{
+    /* Exercise every kind of allocation made on behalf of the current context. */
+    int error = 1;
+    astro_time_t time = Astronomy_MakeTime(2041, 7, 8, 9, 10, 11.0);
+    astro_grav_sim_t *sim = NULL;
+    astro_stepper_t *stepper = NULL;
+    astro_star_catalog_t *catalog = NULL;
+    astro_state_vector_t state;
+    astro_vector_t vec;
+    astro_constellation_t constel;
+    const double ra = 6.75, dec = -16.7, dist = 8.6;
+
+    vec = Astronomy_HelioVector(BODY_PLUTO, time);
+    CHECK_STATUS(vec);
+    constel = Astronomy_Constellation(ra, dec);
+    CHECK_STATUS(constel);
+    if (strcmp(constel.symbol, "CMa"))
+        FFAIL("wrong constellation %s\n", constel.symbol);
+
+    state = Astronomy_HelioState(BODY_EARTH, time);
+    CHECK_STATUS(state);
+    CHECK(Astronomy_GravSimInit(&sim, BODY_SUN, time, 1, &state));
+    CHECK(Astronomy_HelioStepperInit(&stepper, BODY_MARS, time, 1.0, 100));
+    CHECK(Astronomy_StarCatalogCreate(&catalog, 1, &ra, &dec, &dist, NULL, NULL));
+    error = 0;
+fail:
+    Astronomy_GravSimFree(sim);
+    Astronomy_StepperFree(stepper);
+    Astronomy_StarCatalogFree(catalog);
+    return error;
+}
+
+static int AllocatorTest(void)
+{
+    int error = 1;
+    astro_context_t *ctx = NULL;
+    astro_context_t *prev = NULL;
+    astro_arena_t *arena = NULL;
+    astro_allocator_t allocator;
+    alloc_counter_t counter;
+    astro_grav_sim_t *sim = NULL;
+    astro_grav_sim_t *restored = NULL;
+    astro_state_vector_t state;
+    char *snapshot = NULL;
+    size_t used, size;
+    long total;
+
+    memset(&counter, 0, sizeof(counter));
+    allocator.alloc = CountingAlloc;
+    allocator.free = CountingFree;
+    allocator.context = &counter;
+
+    CHECK(Astronomy_ContextCreate(&ctx));
+    Astronomy_ContextSetAllocator(ctx, &allocator);
+    prev = Astronomy_SetThreadContext(ctx);
+    CHECK(AllocatorWorkload());
+
+    /* The Pluto segment and the constellation index remain in the context's caches. */
+    if (counter.count < 2 || counter.bytes < 11000)
+        FFAIL("expected cached allocations, found count=%ld, bytes=%lu\n", counter.count, (unsigned long)counter.bytes);
+
+    /* An object created with the counting allocator is released through it, even after the allocator changes. */
+    state = Astronomy_HelioState(BODY_MARS, Astronomy_MakeTime(2030, 1, 1, 0, 0, 0.0));
+    CHECK_STATUS(state);
+    CHECK(Astronomy_GravSimInit(&sim, BODY_SUN, state.t, 1, &state));
+
+    /* Restoring a snapshot of the wrong size must fail before allocating anything. */
+    size = Astronomy_GravSimSnapshotSize(sim);
+    snapshot = (char *) malloc(size + 1);
+    if (snapshot == NULL)
+        FFAIL("out of memory\n");
+    CHECK(Astronomy_GravSimSnapshot(sim, snapshot, size));
+    total = counter.total;
+    if (ASTRO_BAD_FILE_FORMAT != Astronomy_GravSimRestore(&restored, snapshot, size-1))
+        FFAIL("expected failure for a truncated snapshot\n");
+    if (ASTRO_BAD_FILE_FORMAT != Astronomy_GravSimRestore(&restored, snapshot, size+1))
+        FFAIL("expected failure for an oversized snapshot\n");
+    if (counter.total != total)
+        FFAIL("rejected snapshots made %ld allocations\n", counter.total - total);
+
+    Astronomy_ContextSetAllocator(ctx, NULL);
+    if (counter.count != 2)
+        FFAIL("expected only the simulator's 2 allocations to remain, found %ld\n", counter.count);
+    Astronomy_GravSimFree(sim);
+    sim = NULL;
+    if (counter.count != 0 || counter.bytes != 0)
+        FFAIL("leak: count=%ld, bytes=%lu\n", counter.count, (unsigned long)counter.bytes);
+
+    /* An arena collects all allocations and releases them at once. */
+    CHECK(Astronomy_ArenaCreate(&arena, 0));
+    allocator = Astronomy_ArenaAllocator(arena);
+    Astronomy_ContextSetAllocator(ctx, &allocator);
+    CHECK(AllocatorWorkload());
+    used = Astronomy_ArenaBytesUsed(arena);
+    if (used < 11000)
+        FFAIL("arena used only %lu bytes\n", (unsigned long)used);
+    Astronomy_SetThreadContext(prev);
+    Astronomy_ContextFree(ctx);
+    ctx = NULL;
+    Astronomy_ArenaReset(arena);
+    if (Astronomy_ArenaBytesUsed(arena) != 0)
+        FFAIL("arena not empty after reset\n");
+
+    /* The arena can be used again after a reset, with the same results. */
+    CHECK(Astronomy_ContextCreate(&ctx));
+    Astronomy_ContextSetAllocator(ctx, &allocator);
+    prev = Astronomy_SetThreadContext(ctx);
+    CHECK(AllocatorWorkload());
+    if (Astronomy_ArenaBytesUsed(arena) != used)
+        FFAIL("arena used %lu bytes the second time, expected %lu\n", (unsigned long)Astronomy_ArenaBytesUsed(arena), (unsigned long)used);
+
+    FPASSA("(%ld counted allocations, arena used %lu bytes)\n", counter.total, (unsigned long)used);
+fail:
+    free(snapshot);
+    Astronomy_GravSimFree(sim);
+    Astronomy_SetThreadContext(prev);
+    Astronomy_ContextFree(ctx);
+    Astronomy_ArenaFree(arena);
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int JupiterMoonsBatchTest(void)
+{
+    /* Verify that batch Jupiter moon states exactly match one-at-a-time calculations. */
+    enum { NTIMES = 77 };   /* deliberately not a multiple of the internal block size */
+    static double buffer[4][6][NTIMES];
+    int error, i, m;
+    astro_time_t times[NTIMES];
+    astro_state_arrays_t moons[4];
+    astro_jupiter_moons_t jm;
+    astro_state_vector_t single[4];
+    astro_status_t status;
+
+    for (i = 0; i < NTIMES; ++i)
+        times[i] = Astronomy_TimeFromDays(-36525.0 + 987.654321*i);
+
+    for (m = 0; m < 4; ++m)
+    {
+        moons[m].x  = buffer[m][0];
+        moons[m].y  = buffer[m][1];
+        moons[m].z  = buffer[m][2];
+        moons[m].vx = buffer[m][3];
+        moons[m].vy = buffer[m][4];
+        moons[m].vz = buffer[m][5];
+    }
+
+    status = Astronomy_JupiterMoonsBatch(times, NTIMES, moons);
+    if (status != ASTRO_SUCCESS)
+        FFAIL("Astronomy_JupiterMoonsBatch returned status %d\n", status);
+
+    for (i = 0; i < NTIMES; ++i)
+    {
+        jm = Astronomy_JupiterMoons(times[i]);
+        single[0] = jm.io;
+        single[1] = jm.europa;
+        single[2] = jm.ganymede;
+        single[3] = jm.callisto;
+        for (m = 0; m < 4; ++m)
+        {
+            CHECK_STATUS(single[m]);
+            if (moons[m].x[i]  != single[m].x  || moons[m].y[i]  != single[m].y  || moons[m].z[i]  != single[m].z ||
+                moons[m].vx[i] != single[m].vx || moons[m].vy[i] != single[m].vy || moons[m].vz[i] != single[m].vz)
+                FFAIL("moon %d mismatch at index %d: batch=(%0.16lf, %0.16lf, %0.16lf), single=(%0.16lf, %0.16lf, %0.16lf)\n",
+                    m, i, moons[m].x[i], moons[m].y[i], moons[m].z[i], single[m].x, single[m].y, single[m].z);
+        }
+    }
+
+    moons[2].vy = NULL;
+    status = Astronomy_JupiterMoonsBatch(times, NTIMES, moons);
+    if (status != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for NULL output array, but got %d\n", status);
+
+    status = Astronomy_JupiterMoonsBatch(NULL, 0, NULL);
+    if (status != ASTRO_SUCCESS)
+        FFAIL("expected ASTRO_SUCCESS for empty batch, but got %d\n", status);
+
+    FPASSA("%d times.\n", NTIMES);
+fail:
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static double FixedDeltaT(double ut)
+{
+    (void)ut;
+    return 69.0;
+}
+
+static int TimeStepperCase(double ut0, double stepDays, int resyncSteps, int nsteps, double *maxdiff)
+{
+    /*
+        Compare the stepper's times against Astronomy_TimeFromDays.
+        The ut and tt values must match exactly.
+        Report the largest sidereal time discrepancy in arcseconds.
+    */
+    int error, i;
+    astro_time_stepper_t *stepper = NULL;
+    astro_time_t t, check;
+    double diff;
+
+    *maxdiff = 0.0;
+    CHECK(Astronomy_TimeStepperInit(&stepper, Astronomy_TimeFromDays(ut0), stepDays, resyncSteps));
+    for (i = 0; i < nsteps; ++i)
+    {
+        t = Astronomy_TimeStepperNext(stepper);
+        check = Astronomy_TimeFromDays(ut0 + i*stepDays);
+        if (t.ut != check.ut || t.tt != check.tt)
+            FFAIL("step %d: ut=%0.16lf tt=%0.16lf, expected ut=%0.16lf tt=%0.16lf\n", i, t.ut, t.tt, check.ut, check.tt);
+
+        if (isnan(t.psi) || isnan(t.eps) || isnan(t.st))
+            FFAIL("step %d: nutation and sidereal time should be filled in.\n", i);
+
+        diff = 3600.0 * 15.0 * fabs(t.st - Astronomy_SiderealTime(&check));
+        if (diff > 12.0*3600.0*15.0)
+            diff = fabs(diff - 24.0*3600.0*15.0);
+        if (i % resyncSteps == 0 && diff != 0.0)
+            FFAIL("step %d: sidereal time should be exact at resync, but is off by %lg arcsec.\n", i, diff);
+        if (diff > *maxdiff)
+            *maxdiff = diff;
+    }
+    error = 0;
+fail:
+    Astronomy_TimeStepperFree(stepper);
+    return error;
+}
+
+static int TimeStepperTest(void)
+{
+    int error;
+    double diff;
+    astro_time_stepper_t *stepper = NULL;
+    astro_status_t status;
+
+    /* Crossing the 2005 boundary between two Delta T polynomials, recalculating nutation every step. */
+    CHECK(TimeStepperCase(1800.0, 1.0/24.0, 1, 2000, &diff));
+    if (diff != 0.0)
+        FFAIL("sidereal time with resyncSteps=1 should be exact, but is off by %lg arcsec.\n", diff);
+
+    /* One-minute steps with one exact nutation calculation per day. */
+    CHECK(TimeStepperCase(-9000.0, 1.0/1440.0, 1440, 5*1440, &diff));
+    DEBUG("C TimeStepperTest: one-minute steps, resync daily: max sidereal error = %lg arcsec\n", diff);
+    if (diff > 0.01)
+        FFAIL("excessive sidereal time error %lg arcsec.\n", diff);
+
+    /* Stepping backward across the 1986 boundary. */
+    CHECK(TimeStepperCase(-5000.0, -0.37, 3, 2500, &diff));
+    if (diff > 0.01)
+        FFAIL("excessive sidereal time error %lg arcsec stepping backward.\n", diff);
+
+    /* The JPL Horizons model stops changing after 2017. */
+    Astronomy_SetDeltaTFunction(Astronomy_DeltaT_JplHorizons);
+    error = TimeStepperCase(6000.0, 1.5, 1, 1000, &diff);
+    Astronomy_SetDeltaTFunction(Astronomy_DeltaT_EspenakMeeus);
+    if (error)
+        goto fail;
+
+    /* Any other Delta T model is called directly. */
+    Astronomy_SetDeltaTFunction(FixedDeltaT);
+    error = TimeStepperCase(0.0, 0.1, 10, 100, &diff);
+    Astronomy_SetDeltaTFunction(Astronomy_DeltaT_EspenakMeeus);
+    if (error)
+        goto fail;
+
+    status = Astronomy_TimeStepperInit(&stepper, Astronomy_TimeFromDays(0.0), 0.0, 1);
+    if (status != ASTRO_INVALID_PARAMETER || stepper != NULL)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for zero step size, but got %d\n", status);
+
+    status = Astronomy_TimeStepperInit(&stepper, Astronomy_TimeFromDays(0.0), 1.0, 0);
+    if (status != ASTRO_INVALID_PARAMETER || stepper != NULL)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for zero resync steps, but got %d\n", status);
+
+    if (!isnan(Astronomy_TimeStepperNext(NULL).ut))
+        FFAIL("expected NAN time from NULL stepper.\n");
+
+    FPASS();
+fail:
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+typedef struct
+{
+    astro_body_t body;
+    int ncalls;
+}
+light_time_probe_t;
+
+static astro_vector_t LightTimeProbe(void *context, astro_time_t time)
+{
+    light_time_probe_t *probe = (light_time_probe_t *)context;
+    astro_vector_t earth, pos;
+
+    ++probe->ncalls;
+    earth = Astronomy_HelioVector(BODY_EARTH, time);
+    pos = Astronomy_HelioVector(probe->body, time);
+    pos.x -= earth.x;
+    pos.y -= earth.y;
+    pos.z -= earth.z;
+    return pos;
+}
+
+static int LightTimeWarmTest(void)
+{
+    enum { NSTEPS = 1440 };
+    int error, i;
+    light_time_probe_t cold, warm;
+    astro_light_time_t lightTime;
+    astro_time_t time;
+    astro_vector_t a, b;
+    double diff, maxdiff;
+
+    cold.body = warm.body = BODY_JUPITER;
+    cold.ncalls = warm.ncalls = 0;
+    memset(&lightTime, 0, sizeof(lightTime));
+    maxdiff = 0.0;
+
+    /* One-minute steps for a day. */
+    for (i = 0; i < NSTEPS; ++i)
+    {
+        time = Astronomy_TimeFromDays(8000.0 + i/1440.0);
+        CHECK_VECTOR(a, Astronomy_CorrectLightTravel(&cold, LightTimeProbe, time));
+        CHECK_VECTOR(b, Astronomy_CorrectLightTravelEx(&warm, LightTimeProbe, time, &lightTime));
+        diff = fabs(a.t.tt - b.t.tt);
+        if (diff > maxdiff)
+            maxdiff = diff;
+    }
+
+    DEBUG("C LightTimeWarmTest: cold calls/step = %0.3lf, warm calls/step = %0.3lf, max backdate diff = %lg days\n",
+        (double)cold.ncalls / NSTEPS, (double)warm.ncalls / NSTEPS, maxdiff);
+
+    if (maxdiff > 2.0e-9)
+        FFAIL("excessive difference in backdated time: %lg days\n", maxdiff);
+
+    if (warm.ncalls > NSTEPS + 4 || 2*warm.ncalls > cold.ncalls)
+        FFAIL("expected fewer position calls: cold=%d, warm=%d\n", cold.ncalls, warm.ncalls);
+
+    /* NULL state must give exactly the same result as the original functions. */
+    time = Astronomy_TimeFromDays(8000.0);
+    CHECK_VECTOR(a, Astronomy_GeoVector(BODY_SATURN, time, ABERRATION));
+    CHECK_VECTOR(b, Astronomy_GeoVectorEx(BODY_SATURN, time, ABERRATION, NULL));
+    if (a.x != b.x || a.y != b.y || a.z != b.z)
+        FFAIL("Astronomy_GeoVectorEx with NULL state does not match Astronomy_GeoVector.\n");
+
+    /* Warm geocentric positions stay within the solver's tolerance of the cold ones. */
+    memset(&lightTime, 0, sizeof(lightTime));
+    for (i = 0; i < 100; ++i)
+    {
+        time = Astronomy_TimeFromDays(8000.0 + i/24.0);
+        CHECK_VECTOR(a, Astronomy_GeoVector(BODY_MARS, time, ABERRATION));
+        CHECK_VECTOR(b, Astronomy_GeoVectorEx(BODY_MARS, time, ABERRATION, &lightTime));
+        diff = sqrt((a.x-b.x)*(a.x-b.x) + (a.y-b.y)*(a.y-b.y) + (a.z-b.z)*(a.z-b.z)) / Astronomy_VectorLength(a);
+        if (diff > 1.0e-10)
+            FFAIL("geocentric Mars differs by %lg relative at step %d\n", diff, i);
+        CHECK_VECTOR(a, Astronomy_BackdatePosition(time, BODY_EARTH, BODY_MARS, NO_ABERRATION));
+        CHECK_VECTOR(b, Astronomy_BackdatePositionEx(time, BODY_EARTH, BODY_MARS, NO_ABERRATION, &lightTime));
+        if (fabs(a.t.tt - b.t.tt) > 2.0e-9)
+            FFAIL("backdated Mars time differs by %lg days at step %d\n", fabs(a.t.tt - b.t.tt), i);
+    }
+
+    FPASS();
+fail:
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int SnapshotStateMatch(const char *tag, astro_body_t body, astro_state_vector_t a, astro_state_vector_t b)
+{
+    int error;
+    CHECK_STATUS(a);
+    CHECK_STATUS(b);
+    if (a.x != b.x || a.y != b.y || a.z != b.z || a.vx != b.vx || a.vy != b.vy || a.vz != b.vz || a.t.tt != b.t.tt)
+        FFAIL("%s %s mismatch: snapshot=(%0.16lf, %0.16lf, %0.16lf), expected=(%0.16lf, %0.16lf, %0.16lf)\n",
+            tag, Astronomy_BodyName(body), a.x, a.y, a.z, b.x, b.y, b.z);
+    error = 0;
+fail:
+    return error;
+}
+
+static int SolarSystemSnapshotTest(void)
+{
+    int error, b, k, p;
+    astro_body_snapshot_t snap[SNAPSHOT_NUM_BODIES];
+    astro_state_vector_t earth, geo, moon;
+    astro_time_t time;
+    astro_status_t status;
+    double diff;
+    static const double days[] = { -40000.0, -1234.5, 0.0, 8765.4321, 52000.0 };
+
+    /* The snapshot must agree with the single-body functions at every planet precision. */
+    for (p = PLANET_PRECISION_FULL; p <= PLANET_PRECISION_LOW; ++p)
+    {
+        CHECK(Astronomy_SetPlanetPrecision((astro_planet_precision_t)p));
+        for (k = 0; k < (int)(sizeof(days) / sizeof(days[0])); ++k)
+        {
+            time = Astronomy_TimeFromDays(days[k]);
+            CHECK(Astronomy_SolarSystemSnapshot(time, SNAPSHOT_ALL_BODIES, snap));
+            earth = Astronomy_HelioState(BODY_EARTH, time);
+            for (b = BODY_MERCURY; b <= BODY_SSB; ++b)
+            {
+                CHECK(SnapshotStateMatch("helio", (astro_body_t)b, snap[b].helio, Astronomy_HelioState((astro_body_t)b, time)));
+                CHECK(SnapshotStateMatch("bary",  (astro_body_t)b, snap[b].bary,  Astronomy_BaryState((astro_body_t)b, time)));
+                if (b == BODY_MOON)
+                {
+                    CHECK(SnapshotStateMatch("geo", (astro_body_t)b, snap[b].geo, Astronomy_GeoMoonState(time)));
+                }
+                else
+                {
+                    CHECK_STATUS(snap[b].geo);
+                    geo = Astronomy_HelioState((astro_body_t)b, time);
+                    diff = fabs(snap[b].geo.x - (geo.x - earth.x)) + fabs(snap[b].geo.y - (geo.y - earth.y)) + fabs(snap[b].geo.z - (geo.z - earth.z));
+                    if (diff > 1.0e-15)
+                        FFAIL("geo %s differs by %lg AU\n", Astronomy_BodyName((astro_body_t)b), diff);
+                }
+            }
+        }
+    }
+    CHECK(Astronomy_SetPlanetPrecision(PLANET_PRECISION_FULL));
+
+    /* Only the requested bodies are filled in. */
+    CHECK(Astronomy_SolarSystemSnapshot(time, SNAPSHOT_BODY(BODY_MOON), snap));
+    moon = Astronomy_GeoMoonState(time);
+    CHECK(SnapshotStateMatch("geo", BODY_MOON, snap[BODY_MOON].geo, moon));
+    for (b = BODY_MERCURY; b <= BODY_SSB; ++b)
+        if (b != BODY_MOON && snap[b].helio.status != ASTRO_NOT_INITIALIZED)
+            FFAIL("%s should not have been calculated.\n", Astronomy_BodyName((astro_body_t)b));
+
+    status = Astronomy_SolarSystemSnapshot(time, SNAPSHOT_ALL_BODIES + 1, snap);
+    if (status != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for invalid mask, but got %d\n", status);
+
+    status = Astronomy_SolarSystemSnapshot(time, SNAPSHOT_ALL_BODIES, NULL);
+    if (status != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for NULL output, but got %d\n", status);
+
+    FPASS();
+fail:
+    Astronomy_SetPlanetPrecision(PLANET_PRECISION_FULL);
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+typedef struct
+{
+    int nquarters;
+    int nnodes;
+    int napsides;
+    astro_moon_quarter_t quarter[250];
+    astro_node_event_t node[130];
+    astro_apsis_t apsis[130];
+}
+lunar_event_list_t;
+
+static int LunarEventList(lunar_event_list_t *list, astro_time_t startTime, astro_time_t stopTime)
+{
+    int error;
+    astro_moon_quarter_t mq;
+    astro_node_event_t node;
+    astro_apsis_t apsis;
+
+    list->nquarters = list->nnodes = list->napsides = 0;
+
+    mq = Astronomy_SearchMoonQuarter(startTime);
+    while (mq.status == ASTRO_SUCCESS && mq.time.tt <= stopTime.tt)
+    {
+        if (list->nquarters == 250)
+            FFAIL("too many quarters\n");
+        list->quarter[list->nquarters++] = mq;
+        mq = Astronomy_NextMoonQuarter(mq);
+    }
+    CHECK_STATUS(mq);
+
+    node = Astronomy_SearchMoonNode(startTime);
+    while (node.status == ASTRO_SUCCESS && node.time.tt <= stopTime.tt)
+    {
+        if (list->nnodes == 130)
+            FFAIL("too many nodes\n");
+        list->node[list->nnodes++] = node;
+        node = Astronomy_NextMoonNode(node);
+    }
+    CHECK_STATUS(node);
+
+    apsis = Astronomy_SearchLunarApsis(startTime);
+    while (apsis.status == ASTRO_SUCCESS && apsis.time.tt <= stopTime.tt)
+    {
+        if (list->napsides == 130)
+            FFAIL("too many apsides\n");
+        list->apsis[list->napsides++] = apsis;
+        apsis = Astronomy_NextLunarApsis(apsis);
+    }
+    CHECK_STATUS(apsis);
+
+    error = 0;
+fail:
+    return error;
+}
+
+static int LunarEventListMatch(const char *tag, const lunar_event_list_t *a, const lunar_event_list_t *b)
+{
+    int error, i;
+
+    if (a->nquarters != b->nquarters || a->nnodes != b->nnodes || a->napsides != b->napsides)
+        FFAIL("%s: event counts do not match.\n", tag);
+
+    for (i = 0; i < a->nquarters; ++i)
+        if (a->quarter[i].quarter != b->quarter[i].quarter || a->quarter[i].time.tt != b->quarter[i].time.tt || a->quarter[i].time.ut != b->quarter[i].time.ut)
+            FFAIL("%s: quarter %d does not match.\n", tag, i);
+
+    for (i = 0; i < a->nnodes; ++i)
+        if (a->node[i].kind != b->node[i].kind || a->node[i].time.tt != b->node[i].time.tt || a->node[i].time.ut != b->node[i].time.ut)
+            FFAIL("%s: node %d does not match.\n", tag, i);
+
+    for (i = 0; i < a->napsides; ++i)
+        if (a->apsis[i].kind != b->apsis[i].kind || a->apsis[i].time.tt != b->apsis[i].time.tt || a->apsis[i].dist_km != b->apsis[i].dist_km)
+            FFAIL("%s: apsis %d does not match.\n", tag, i);
+
+    error = 0;
+fail:
+    return error;
+}
+
+static int LunarEventCacheTest(void)
+{
+    const char *filename = "temp/c_lunar_events.bin";
+    enum { NPROBES = 23 };
+    static lunar_event_list_t live, cached;
+    int error, i;
+    astro_time_t startTime = Astronomy_MakeTime(2020, 1, 1, 0, 0, 0.0);
+    astro_time_t stopTime = Astronomy_MakeTime(2024, 1, 1, 0, 0, 0.0);
+    astro_time_t outside = Astronomy_MakeTime(2024, 6, 1, 0, 0, 0.0);
+    astro_time_t time;
+    astro_moon_quarter_t mq[NPROBES], cmq;
+    astro_node_event_t node[NPROBES], cnode;
+    astro_apsis_t apsis[NPROBES], capsis;
+    astro_search_result_t phase[NPROBES], cphase, shortSearch, cshort;
+    astro_status_t status;
+    double diff, maxdiff = 0.0;
+    FILE *outfile;
+
+    /* Calculate the expected results without a table. */
+    Astronomy_Reset();
+    CHECK(LunarEventList(&live, startTime, stopTime));
+    for (i = 0; i < NPROBES; ++i)
+    {
+        time = Astronomy_AddDays(startTime, 3.7 + 61.3*i);
+        mq[i] = Astronomy_SearchMoonQuarter(time);
+        CHECK_STATUS(mq[i]);
+        node[i] = Astronomy_SearchMoonNode(time);
+        CHECK_STATUS(node[i]);
+        apsis[i] = Astronomy_SearchLunarApsis(time);
+        CHECK_STATUS(apsis[i]);
+        phase[i] = Astronomy_SearchMoonPhase(90.0 * (i % 4), time, 40.0);
+        CHECK_STATUS(phase[i]);
+    }
+    shortSearch = Astronomy_SearchMoonPhase(180.0, startTime, 1.0);
+    cshort = Astronomy_SearchMoonPhase(0.0, outside, 40.0);
+
+    /* Iterating through the table must give exactly the same results. */
+    CHECK(Astronomy_LunarEventCacheInit(startTime, stopTime));
+    CHECK(LunarEventList(&cached, startTime, stopTime));
+    CHECK(LunarEventListMatch("init", &live, &cached));
+
+    /* Searches from arbitrary times must find the same events within the search tolerance. */
+    for (i = 0; i < NPROBES; ++i)
+    {
+        time = Astronomy_AddDays(startTime, 3.7 + 61.3*i);
+
+        cmq = Astronomy_SearchMoonQuarter(time);
+        CHECK_STATUS(cmq);
+        diff = SECONDS_PER_DAY * ABS(cmq.time.ut - mq[i].time.ut);
+        if (cmq.quarter != mq[i].quarter || diff > 2.0)
+            FFAIL("quarter probe %d differs by %lf seconds.\n", i, diff);
+        if (diff > maxdiff) maxdiff = diff;
+
+        cnode = Astronomy_SearchMoonNode(time);
+        CHECK_STATUS(cnode);
+        diff = SECONDS_PER_DAY * ABS(cnode.time.ut - node[i].time.ut);
+        if (cnode.kind != node[i].kind || diff > 2.0)
+            FFAIL("node probe %d differs by %lf seconds.\n", i, diff);
+        if (diff > maxdiff) maxdiff = diff;
+
+        capsis = Astronomy_SearchLunarApsis(time);
+        CHECK_STATUS(capsis);
+        diff = SECONDS_PER_DAY * ABS(capsis.time.ut - apsis[i].time.ut);
+        if (capsis.kind != apsis[i].kind || diff > 2.0 || ABS(capsis.dist_km - apsis[i].dist_km) > 1.0e-3)
+            FFAIL("apsis probe %d differs by %lf seconds.\n", i, diff);
+        if (diff > maxdiff) maxdiff = diff;
+
+        cphase = Astronomy_SearchMoonPhase(90.0 * (i % 4), time, 40.0);
+        CHECK_STATUS(cphase);
+        diff = SECONDS_PER_DAY * ABS(cphase.time.ut - phase[i].time.ut);
+        if (diff > 2.0)
+            FFAIL("phase probe %d differs by %lf seconds.\n", i, diff);
+        if (diff > maxdiff) maxdiff = diff;
+    }
+    DEBUG("C LunarEventCacheTest: max probe difference = %0.3lf seconds\n", maxdiff);
+
+    /* A search whose answer is outside the table, or past its limit, must behave as if there were no table. */
+    cphase = Astronomy_SearchMoonPhase(180.0, startTime, 1.0);
+    if (cphase.status != shortSearch.status)
+        FFAIL("limited phase search status %d does not match %d.\n", cphase.status, shortSearch.status);
+    cphase = Astronomy_SearchMoonPhase(0.0, outside, 40.0);
+    if (cphase.status != cshort.status || cphase.time.tt != cshort.time.tt)
+        FFAIL("phase search outside the table does not match.\n");
+
+    /* Save the table, then load it into a fresh context. */
+    CHECK(Astronomy_LunarEventCacheSave(filename));
+    Astronomy_Reset();
+    status = Astronomy_LunarEventCacheSave(filename);
+    if (status != ASTRO_NOT_INITIALIZED)
+        FFAIL("expected ASTRO_NOT_INITIALIZED saving without a table, but got %d\n", status);
+    CHECK(Astronomy_LunarEventCacheLoad(filename));
+    CHECK(LunarEventList(&cached, startTime, stopTime));
+    CHECK(LunarEventListMatch("load", &live, &cached));
+
+    /* Freeing the table goes back to searching. */
+    Astronomy_LunarEventCacheFree();
+    Astronomy_LunarEventCacheFree();
+    CHECK(LunarEventList(&cached, startTime, stopTime));
+    CHECK(LunarEventListMatch("free", &live, &cached));
+
+    status = Astronomy_LunarEventCacheInit(stopTime, startTime);
+    if (status != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for reversed range, but got %d\n", status);
+
+    status = Astronomy_LunarEventCacheLoad("temp/this_file_does_not_exist.bin");
+    if (status != ASTRO_FILE_ERROR)
+        FFAIL("expected ASTRO_FILE_ERROR for missing file, but got %d\n", status);
+
+    outfile = fopen(filename, "wb");
+    if (outfile == NULL)
+        FFAIL("cannot open output file: %s\n", filename);
+    fprintf(outfile, "This is not a lunar event file, but it is long enough to fill the header.\n");
+    fclose(outfile);
+    status = Astronomy_LunarEventCacheLoad(filename);
+    if (status != ASTRO_BAD_FILE_FORMAT)
+        FFAIL("expected ASTRO_BAD_FILE_FORMAT for invalid file, but got %d\n", status);
+
+    FPASS();
+fail:
+    Astronomy_Reset();
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int SeasonsMatch(const char *tag, int year, astro_seasons_t a, astro_seasons_t b)
+{
+    int error;
+
+    CHECK_STATUS(a);
+    CHECK_STATUS(b);
+    if (a.mar_equinox.ut  != b.mar_equinox.ut  || a.mar_equinox.tt  != b.mar_equinox.tt  ||
+        a.jun_solstice.ut != b.jun_solstice.ut || a.jun_solstice.tt != b.jun_solstice.tt ||
+        a.sep_equinox.ut  != b.sep_equinox.ut  || a.sep_equinox.tt  != b.sep_equinox.tt  ||
+        a.dec_solstice.ut != b.dec_solstice.ut || a.dec_solstice.tt != b.dec_solstice.tt)
+        FFAIL("%s: seasons for year %d do not match.\n", tag, year);
+
+    error = 0;
+fail:
+    return error;
+}
+
+static int SeasonsSearchCount(int year, long *searches)
+{
+    int error;
+    astro_search_stats_t stats;
+    astro_search_stats_t *prev;
+    astro_seasons_t seasons;
+
+    memset(&stats, 0, sizeof(stats));
+    prev = Astronomy_SetSearchStats(&stats);
+    seasons = Astronomy_Seasons(year);
+    Astronomy_SetSearchStats(prev);
+    CHECK_STATUS(seasons);
+    *searches = stats.searches;
+    error = 0;
+fail:
+    return error;
+}
+
+static int SeasonsRefillCheck(const char *tag, int year)
+{
+    int error;
+    long searches;
+
+    /* The first call after a change must calculate again, and the second must use the refilled cache. */
+    CHECK(SeasonsSearchCount(year, &searches));
+    if (searches == 0)
+        FFAIL("%s: year %d was not calculated again.\n", tag, year);
+    CHECK(SeasonsSearchCount(year, &searches));
+    if (searches != 0)
+        FFAIL("%s: year %d was not cached again (%ld searches).\n", tag, year, searches);
+    error = 0;
+fail:
+    return error;
+}
+
+static int SeasonsCacheTest(void)
+{
+    enum { FIRST_YEAR = 1990, NYEARS = 40 };
+    static astro_seasons_t expected[NYEARS];
+    int error, i;
+    long searches;
+    astro_seasons_t seasons, jpl;
+    astro_status_t status;
+
+    Astronomy_Reset();
+    for (i = 0; i < NYEARS; ++i)
+    {
+        expected[i] = Astronomy_Seasons(FIRST_YEAR + i);
+        CHECK_STATUS(expected[i]);
+    }
+
+    /* Cached results must be identical to the original calculations, including after warming. */
+    for (i = 0; i < NYEARS; ++i)
+        CHECK(SeasonsMatch("cached", FIRST_YEAR + i, expected[i], Astronomy_Seasons(FIRST_YEAR + i)));
+
+    Astronomy_Reset();
+    CHECK(Astronomy_SeasonsCacheWarm(FIRST_YEAR, FIRST_YEAR + NYEARS - 1));
+    for (i = 0; i < NYEARS; ++i)
+        CHECK(SeasonsMatch("warm", FIRST_YEAR + i, expected[i], Astronomy_Seasons(FIRST_YEAR + i)));
+
+    /* Years that share a place in the cache must not be confused. */
+    seasons = Astronomy_Seasons(FIRST_YEAR + 256);
+    CHECK_STATUS(seasons);
+    if (seasons.mar_equinox.ut - expected[0].mar_equinox.ut < 255.0 * 365.0)
+        FFAIL("year %d returned the cached result for year %d.\n", FIRST_YEAR + 256, FIRST_YEAR);
+
+    /* Changing the Delta T model must not return results calculated with the old model. */
+    Astronomy_Reset();
+    Astronomy_SetDeltaTFunction(Astronomy_DeltaT_JplHorizons);
+    jpl = Astronomy_Seasons(2200);
+    Astronomy_Reset();
+    Astronomy_SetDeltaTFunction(Astronomy_DeltaT_EspenakMeeus);
+    seasons = Astronomy_Seasons(2200);
+    Astronomy_SetDeltaTFunction(Astronomy_DeltaT_JplHorizons);
+    CHECK(SeasonsMatch("jpl", 2200, jpl, Astronomy_Seasons(2200)));
+    Astronomy_SetDeltaTFunction(Astronomy_DeltaT_EspenakMeeus);
+    CHECK(SeasonsMatch("espenak", 2200, seasons, Astronomy_Seasons(2200)));
+    if (jpl.mar_equinox.ut == seasons.mar_equinox.ut)
+        FFAIL("Delta T models should give different results for 2200.\n");
+
+    /* A mismatched entry must be replaced, so later calls are fast again. */
+    Astronomy_Reset();
+    CHECK(SeasonsRefillCheck("first", 2024));
+    CHECK(SeasonsRefillCheck("collision", 2024 + 256));
+    CHECK(SeasonsRefillCheck("collision back", 2024));
+    Astronomy_SetDeltaTFunction(Astronomy_DeltaT_JplHorizons);
+    CHECK(SeasonsRefillCheck("delta t", 2024));
+    Astronomy_SetDeltaTFunction(Astronomy_DeltaT_EspenakMeeus);
+    CHECK(Astronomy_EphemerisCacheInit(BODY_EARTH, Astronomy_MakeTime(2024, 1, 1, 0, 0, 0.0), Astronomy_MakeTime(2025, 1, 1, 0, 0, 0.0), 1.0));
+    CHECK(SeasonsRefillCheck("ephemeris cache", 2024));
+    Astronomy_EphemerisCacheFree(BODY_EARTH);
+    CHECK(SeasonsRefillCheck("ephemeris cache free", 2024));
+    CHECK(Astronomy_MoonCacheInit(Astronomy_MakeTime(2024, 1, 1, 0, 0, 0.0), Astronomy_MakeTime(2025, 1, 1, 0, 0, 0.0), 1.0));
+    CHECK(SeasonsRefillCheck("moon cache", 2024));
+    Astronomy_MoonCacheFree();
+    CHECK(SeasonsRefillCheck("moon cache free", 2024));
+
+    /* Once 256 entries have been replaced, they stay in place until Astronomy_Reset. */
+    Astronomy_Reset();
+    for (i = 0; i < 300; ++i)
+        CHECK_STATUS(Astronomy_Seasons(1700 + 256 * (i % 2)));
+    CHECK(SeasonsSearchCount(1700, &searches));
+    if (searches != 0)
+        FFAIL("year %d should have stayed in the cache.\n", 1700);
+    CHECK(SeasonsSearchCount(1700 + 256, &searches));
+    if (searches == 0)
+        FFAIL("year %d should not replace a cached year after the retired list is full.\n", 1700 + 256);
+    Astronomy_Reset();
+    CHECK(SeasonsRefillCheck("after reset", 1700 + 256));
+
+    status = Astronomy_SeasonsCacheWarm(2000, 1999);
+    if (status != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for reversed range, but got %d\n", status);
+
+    status = Astronomy_SeasonsCacheWarm(2000, 2256);
+    if (status != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for too many years, but got %d\n", status);
+
+    FPASS();
+fail:
+    Astronomy_SetDeltaTFunction(Astronomy_DeltaT_EspenakMeeus);
+    Astronomy_Reset();
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int PlanetApsisTableTest(void)
+{
+    int error, i, k;
+    astro_body_t body;
+    astro_time_t time;
+    astro_apsis_t apsis, prev;
+    astro_func_result_t before, after;
+    double direction;
+
+    for (body = BODY_NEPTUNE; body <= BODY_PLUTO; ++body)
+    {
+        /* Every tabulated apsis must be a local extreme of the calculated distance. */
+        apsis = Astronomy_SearchPlanetApsis(body, Astronomy_MakeTime(1000, 1, 1, 0, 0, 0.0));
+        for (i = 0; i < 20 && apsis.status == ASTRO_SUCCESS; ++i)
+        {
+            direction = (apsis.kind == APSIS_PERICENTER) ? +1.0 : -1.0;
+            before = Astronomy_HelioDistance(body, Astronomy_AddDays(apsis.time, -1.0));
+            CHECK_STATUS(before);
+            after = Astronomy_HelioDistance(body, Astronomy_AddDays(apsis.time, +1.0));
+            CHECK_STATUS(after);
+            if (direction * (before.value - apsis.dist_au) <= 0.0 || direction * (after.value - apsis.dist_au) <= 0.0)
+                FFAIL("%s apsis %d is not a local extreme.\n", Astronomy_BodyName(body), i);
+
+            /* Searching from any time before the apsis, back to the previous one, must find the same apsis. */
+            prev = apsis;
+            for (k = 1; k <= 5; ++k)
+            {
+                time = Astronomy_AddDays(prev.time, -k * 0.05 * Astronomy_PlanetOrbitalPeriod(body));
+                apsis = Astronomy_SearchPlanetApsis(body, time);
+                CHECK_STATUS(apsis);
+                if (apsis.kind != prev.kind || apsis.time.tt != prev.time.tt)
+                    FFAIL("%s apsis %d is different when searching from %d steps earlier.\n", Astronomy_BodyName(body), i, k);
+            }
+
+            apsis = Astronomy_NextPlanetApsis(body, prev);
+        }
+        CHECK_STATUS(apsis);
+    }
+
+    /* A truncated planet model must not be answered from the table, which uses the full model. */
+    CHECK(Astronomy_SetPlanetPrecision(PLANET_PRECISION_LOW));
+    for (body = BODY_NEPTUNE; body <= BODY_PLUTO; ++body)
+    {
+        apsis = Astronomy_SearchPlanetApsis(body, Astronomy_MakeTime(2000, 1, 1, 0, 0, 0.0));
+        CHECK_STATUS(apsis);
+        after = Astronomy_HelioDistance(body, apsis.time);
+        CHECK_STATUS(after);
+        if (apsis.dist_au != after.value)
+            FFAIL("%s apsis distance %0.12lf does not match the low-precision model's %0.12lf.\n", Astronomy_BodyName(body), apsis.dist_au, after.value);
+    }
+
+    FPASS();
+fail:
+    Astronomy_SetPlanetPrecision(PLANET_PRECISION_FULL);
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int PlanetPrecisionTest(void)
+{
+    static const double arcmin_limit[] = { 0.0, 0.6, 3.5 };
+    static const int total_terms[] = { 466, 396, 220 };
+    int error, i, p, total;
+    astro_body_t body;
+    astro_time_t time;
+    astro_vector_t full, vec;
+    astro_state_vector_t state;
+    astro_angle_result_t angle;
+    astro_status_t status;
+    double diff, maxdiff;
+
+    for (p = PLANET_PRECISION_FULL; p <= PLANET_PRECISION_LOW; ++p)
+    {
+        total = 0;
+        for (body = BODY_MERCURY; body <= BODY_NEPTUNE; ++body)
+        {
+            total += Astronomy_PlanetTermCount(body, (astro_planet_precision_t)p);
+            if (p > 0 && Astronomy_PlanetTermCount(body, (astro_planet_precision_t)p) > Astronomy_PlanetTermCount(body, (astro_planet_precision_t)(p-1)))
+                FFAIL("%s has more terms at precision %d than at precision %d.\n", Astronomy_BodyName(body), p, p-1);
+        }
+        if (total != total_terms[p])
+            FFAIL("expected %d terms at precision %d, but found %d.\n", total_terms[p], p, total);
+    }
+
+    for (p = PLANET_PRECISION_ARCMINUTE; p <= PLANET_PRECISION_LOW; ++p)
+    {
+        maxdiff = 0.0;
+        for (body = BODY_MERCURY; body <= BODY_NEPTUNE; ++body)
+        {
+            if (body == BODY_EARTH)
+                continue;
+            for (i = 0; i < 200; ++i)
+            {
+                time = Astronomy_TimeFromDays(-36525.0 + 365.2422 * i + 0.37 * body);
+                CHECK(Astronomy_SetPlanetPrecision(PLANET_PRECISION_FULL));
+                CHECK_VECTOR(full, Astronomy_GeoVector(body, time, ABERRATION));
+                CHECK(Astronomy_SetPlanetPrecision((astro_planet_precision_t)p));
+                CHECK_VECTOR(vec, Astronomy_GeoVector(body, time, ABERRATION));
+                angle = Astronomy_AngleBetween(full, vec);
+                CHECK_STATUS(angle);
+                diff = 60.0 * angle.angle;
+                if (diff > maxdiff)
+                    maxdiff = diff;
+
+                /* The position of the state vector must come from the same truncated series. */
+                CHECK_VECTOR(vec, Astronomy_HelioVector(body, time));
+                state = Astronomy_HelioState(body, time);
+                CHECK_STATUS(state);
+                if (state.x != vec.x || state.y != vec.y || state.z != vec.z)
+                    FFAIL("HelioState and HelioVector do not match for %s at precision %d.\n", Astronomy_BodyName(body), p);
+            }
+        }
+        DEBUG("C PlanetPrecisionTest: precision %d max error = %0.3lf arcmin\n", p, maxdiff);
+        if (maxdiff > arcmin_limit[p])
+            FFAIL("precision %d error %0.3lf arcmin exceeds %0.1lf\n", p, maxdiff, arcmin_limit[p]);
+        if (maxdiff == 0.0)
+            FFAIL("precision %d did not change any positions.\n", p);
+    }
+
+    /* Going back to full precision must restore the exact original results. */
+    time = Astronomy_MakeTime(2024, 3, 1, 0, 0, 0.0);
+    CHECK(Astronomy_SetPlanetPrecision(PLANET_PRECISION_LOW));
+    CHECK_VECTOR(vec, Astronomy_GeoVector(BODY_MARS, time, ABERRATION));
+    Astronomy_Reset();
+    CHECK(Astronomy_SetPlanetPrecision(PLANET_PRECISION_FULL));
+    CHECK_VECTOR(full, Astronomy_GeoVector(BODY_MARS, time, ABERRATION));
+    CHECK(Astronomy_SetPlanetPrecision(PLANET_PRECISION_LOW));
+    CHECK(Astronomy_SetPlanetPrecision(PLANET_PRECISION_FULL));
+    CHECK_VECTOR(vec, Astronomy_GeoVector(BODY_MARS, time, ABERRATION));
+    if (vec.x != full.x || vec.y != full.y || vec.z != full.z)
+        FFAIL("full precision results changed.\n");
+
+    status = Astronomy_SetPlanetPrecision((astro_planet_precision_t)(PLANET_PRECISION_LOW + 1));
+    if (status != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for invalid precision, but got %d\n", status);
+
+    if (Astronomy_PlanetTermCount(BODY_PLUTO, PLANET_PRECISION_FULL) != -1)
+        FFAIL("expected -1 terms for Pluto.\n");
+
+    FPASS();
+fail:
+    Astronomy_SetPlanetPrecision(PLANET_PRECISION_FULL);
+    Astronomy_Reset();
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static double HorizonSeparation(double az1, double alt1, double az2, double alt2)
+{
+    /* Returns the angle in arcseconds between two horizontal directions. */
+    double dx = cos(DEG2RAD*alt1)*cos(DEG2RAD*az1) - cos(DEG2RAD*alt2)*cos(DEG2RAD*az2);
+    double dy = cos(DEG2RAD*alt1)*sin(DEG2RAD*az1) - cos(DEG2RAD*alt2)*sin(DEG2RAD*az2);
+    double dz = sin(DEG2RAD*alt1) - sin(DEG2RAD*alt2);
+    return 3600.0 * RAD2DEG * 2.0 * asin(sqrt(dx*dx + dy*dy + dz*dz) / 2.0);
+}
+
+static int HorizonFloatTest(void)
+{
+    enum { NSTARS = 5000 };
+    static float ra[NSTARS], dec[NSTARS], az[NSTARS], alt[NSTARS];
+    static float x[NSTARS], y[NSTARS], z[NSTARS];
+    int error, i;
+    astro_time_t time = Astronomy_MakeTime(2025, 11, 3, 21, 17, 8.0);
+    astro_observer_t observer = Astronomy_MakeObserver(-33.9, 18.4, 25.0);
+    astro_rotation_t rot;
+    astro_rotation_float_t frot;
+    astro_float_vectors_t vectors;
+    astro_spherical_t sphere, hor;
+    astro_vector_t vec;
+    astro_status_t status;
+    double diff, maxdiff = 0.0, maxvec = 0.0;
+    unsigned seed = 12345;
+
+    for (i = 0; i < NSTARS; ++i)
+    {
+        seed = 1103515245u*seed + 12345u;
+        ra[i] = (float)(24.0 * (seed >> 8) / 16777216.0);
+        seed = 1103515245u*seed + 12345u;
+        dec[i] = (float)(RAD2DEG * asin(2.0 * (seed >> 8) / 16777216.0 - 1.0));
+    }
+
+    rot = Astronomy_Rotation_EQJ_HOR(&time, observer);
+    CHECK_STATUS(rot);
+    CHECK(Astronomy_RotationFloat(rot, &frot));
+    CHECK(Astronomy_HorizonFloat(&frot, NSTARS, ra, dec, az, alt));
+
+    for (i = 0; i < NSTARS; ++i)
+    {
+        sphere.status = ASTRO_SUCCESS;
+        sphere.lon = 15.0 * ra[i];
+        sphere.lat = dec[i];
+        sphere.dist = 1.0;
+        CHECK_VECTOR(vec, Astronomy_VectorFromSphere(sphere, time));
+        x[i] = (float)vec.x;
+        y[i] = (float)vec.y;
+        z[i] = (float)vec.z;
+        CHECK_VECTOR(vec, Astronomy_RotateVector(rot, vec));
+        hor = Astronomy_HorizonFromVector(vec, REFRACTION_NONE);
+        CHECK_STATUS(hor);
+
+        if (!(az[i] >= 0.0f && az[i] < 360.0f))
+            FFAIL("azimuth %d is out of range: %f\n", i, az[i]);
+
+        diff = HorizonSeparation(hor.lon, hor.lat, az[i], alt[i]);
+        if (diff > maxdiff)
+            maxdiff = diff;
+
+        /* Save the rotated double precision vector's direction for comparing with the float rotation. */
+        sphere = Astronomy_SphereFromVector(vec);
+        CHECK_STATUS(sphere);
+        ra[i] = (float) sphere.lon;
+        dec[i] = (float) sphere.lat;
+    }
+
+    /* Rotate the vectors in place and compare directions. */
+    vectors.x = x;
+    vectors.y = y;
+    vectors.z = z;
+    CHECK(Astronomy_RotateVectorsFloat(&frot, NSTARS, &vectors, &vectors));
+    for (i = 0; i < NSTARS; ++i)
+    {
+        vec.status = ASTRO_SUCCESS;
+        vec.t = time;
+        vec.x = x[i];
+        vec.y = y[i];
+        vec.z = z[i];
+        sphere = Astronomy_SphereFromVector(vec);
+        CHECK_STATUS(sphere);
+        diff = HorizonSeparation(ra[i], dec[i], sphere.lon, sphere.lat);
+        if (diff > maxvec)
+            maxvec = diff;
+    }
+
+    DEBUG("C HorizonFloatTest: max error = %0.4lf arcsec (horizon), %0.4lf arcsec (rotation)\n", maxdiff, maxvec);
+    if (maxdiff > 0.25 || maxvec > 0.25)
+        FFAIL("excessive error: %lf arcsec (horizon), %lf arcsec (rotation)\n", maxdiff, maxvec);
+
+    /*
+        With the identity rotation, a star just east of RA=0 has an azimuth a tiny amount below zero.
+        Adding 360 to it rounds to exactly 360 in single precision, which must be reported as 0.
+    */
+    CHECK(Astronomy_RotationFloat(Astronomy_IdentityMatrix(), &frot));
+    ra[0] = 1.0e-7f;
+    dec[0] = 0.0f;
+    ra[1] = 23.9999f;
+    dec[1] = 0.0f;
+    CHECK(Astronomy_HorizonFloat(&frot, 2, ra, dec, az, alt));
+    if (az[0] != 0.0f)
+        FFAIL("expected azimuth 0 just past the boundary, but got %0.9f\n", az[0]);
+    if (!(az[1] >= 0.0f && az[1] < 360.0f))
+        FFAIL("azimuth just before the boundary is out of range: %0.9f\n", az[1]);
+
+    status = Astronomy_HorizonFloat(&frot, NSTARS, ra, NULL, az, alt);
+    if (status != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for NULL array, but got %d\n", status);
+
+    rot.status = ASTRO_INVALID_PARAMETER;
+    status = Astronomy_RotationFloat(rot, &frot);
+    if (status != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for invalid rotation, but got %d\n", status);
+
+    FPASS();
+fail:
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int HorizonVectorsFloatTest(void)
+{
+    enum { NSTARS = 6000, NHORIZON = 2000 };
+    static float x[NSTARS], y[NSTARS], z[NSTARS], az[NSTARS], alt[NSTARS];
+    int error, i, r;
+    astro_time_t time = Astronomy_MakeTime(2025, 11, 3, 21, 17, 8.0);
+    astro_observer_t observer = Astronomy_MakeObserver(-33.9, 18.4, 25.0);
+    astro_rotation_t rot, inv;
+    astro_rotation_float_t frot;
+    astro_float_vectors_t vectors;
+    astro_spherical_t sphere, hor;
+    astro_vector_t vec;
+    astro_status_t status;
+    double diff, maxdiff;
+    unsigned seed = 12345;
+
+    rot = Astronomy_Rotation_EQJ_HOR(&time, observer);
+    CHECK_STATUS(rot);
+    inv = Astronomy_InverseRotation(rot);
+    CHECK_STATUS(inv);
+    CHECK(Astronomy_RotationFloat(rot, &frot));
+
+    for (i = 0; i < NSTARS; ++i)
+    {
+        sphere.status = ASTRO_SUCCESS;
+        sphere.dist = 1.0 + (i % 3);
+        if (i < NHORIZON)
+        {
+            /* Crowd directions near the horizon, where refraction changes fastest. */
+            sphere.lon = 360.0 * i / NHORIZON;
+            sphere.lat = -4.0 + 10.0 * i / NHORIZON;
+            CHECK_VECTOR(vec, Astronomy_VectorFromHorizon(sphere, time, REFRACTION_NONE));
+            CHECK_VECTOR(vec, Astronomy_RotateVector(inv, vec));
+        }
+        else
+        {
+            seed = 1103515245u*seed + 12345u;
+            sphere.lon = 360.0 * (seed >> 8) / 16777216.0;
+            seed = 1103515245u*seed + 12345u;
+            sphere.lat = RAD2DEG * asin(2.0 * (seed >> 8) / 16777216.0 - 1.0);
+            CHECK_VECTOR(vec, Astronomy_VectorFromSphere(sphere, time));
+        }
+        x[i] = (float)vec.x;
+        y[i] = (float)vec.y;
+        z[i] = (float)vec.z;
+    }
+
+    vectors.x = x;
+    vectors.y = y;
+    vectors.z = z;
+    for (r = REFRACTION_NONE; r <= REFRACTION_JPLHOR; ++r)
+    {
+        CHECK(Astronomy_HorizonVectorsFloat(&frot, NSTARS, &vectors, (astro_refraction_t)r, az, alt));
+        maxdiff = 0.0;
+        for (i = 0; i < NSTARS; ++i)
+        {
+            vec.status = ASTRO_SUCCESS;
+            vec.t = time;
+            vec.x = x[i];
+            vec.y = y[i];
+            vec.z = z[i];
+            CHECK_VECTOR(vec, Astronomy_RotateVector(rot, vec));
+            hor = Astronomy_HorizonFromVector(vec, (astro_refraction_t)r);
+            CHECK_STATUS(hor);
+
+            if (!(az[i] >= 0.0f && az[i] < 360.0f))
+                FFAIL("refraction %d: azimuth %d is out of range: %f\n", r, i, az[i]);
+
+            diff = HorizonSeparation(hor.lon, hor.lat, az[i], alt[i]);
+            if (diff > maxdiff)
+                maxdiff = diff;
+        }
+
+        DEBUG("C HorizonVectorsFloatTest: refraction %d, max error = %0.4lf arcsec\n", r, maxdiff);
+        if (maxdiff > 0.25)
+            FFAIL("refraction %d: excessive error = %lf arcsec\n", r, maxdiff);
+    }
+
+    status = Astronomy_HorizonVectorsFloat(&frot, NSTARS, &vectors, (astro_refraction_t)99, az, alt);
+    if (status != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for invalid refraction, but got %d\n", status);
+
+    vectors.y = NULL;
+    status = Astronomy_HorizonVectorsFloat(&frot, NSTARS, &vectors, REFRACTION_NORMAL, az, alt);
+    if (status != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for NULL array, but got %d\n", status);
+
+    FPASS();
+fail:
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int TerseTest(void)
+{
+    enum { NTIMES = 100 };
+    static const astro_body_t bodies[] = { BODY_MARS, BODY_PLUTO, BODY_MOON, BODY_SSB };
+    static astro_time_t times[NTIMES];
+    static astro_vector_t vec[NTIMES];
+    static astro_terse_vector_t terse[NTIMES];
+    static astro_terse_state_t tstate[NTIMES];
+    static astro_terse_spherical_t tsphere[NTIMES];
+    int error, i, b;
+    astro_rotation_t rot;
+    astro_state_vector_t state;
+    astro_spherical_t sphere;
+    astro_vector_t rotated;
+    astro_status_t status;
+
+    if (sizeof(astro_terse_vector_t) != 3*sizeof(double) || sizeof(astro_terse_state_t) != 6*sizeof(double))
+        FFAIL("terse types are not densely packed.\n");
+
+    for (i = 0; i < NTIMES; ++i)
+        times[i] = Astronomy_TimeFromDays(8000.0 + 3.7*i);
+
+    for (b = 0; b < (int)(sizeof(bodies) / sizeof(bodies[0])); ++b)
+    {
+        CHECK(Astronomy_HelioVectorBatch(bodies[b], times, NTIMES, vec));
+        CHECK(Astronomy_HelioVectorTerse(bodies[b], times, NTIMES, terse));
+        CHECK(Astronomy_HelioStateTerse(bodies[b], times, NTIMES, tstate));
+        for (i = 0; i < NTIMES; ++i)
+        {
+            if (terse[i].x != vec[i].x || terse[i].y != vec[i].y || terse[i].z != vec[i].z)
+                FFAIL("%s terse position %d does not match.\n", Astronomy_BodyName(bodies[b]), i);
+
+            state = Astronomy_HelioState(bodies[b], times[i]);
+            CHECK_STATUS(state);
+            if (tstate[i].r.x != state.x || tstate[i].r.y != state.y || tstate[i].r.z != state.z ||
+                tstate[i].v.x != state.vx || tstate[i].v.y != state.vy || tstate[i].v.z != state.vz)
+                FFAIL("%s terse state %d does not match.\n", Astronomy_BodyName(bodies[b]), i);
+        }
+    }
+
+    /* Rotate in place, then convert to spherical coordinates. */
+    rot = Astronomy_Rotation_EQJ_ECL();
+    CHECK_STATUS(rot);
+    CHECK(Astronomy_RotateVectorsTerse(&rot, NTIMES, terse, terse));
+    CHECK(Astronomy_SphereFromVectorsTerse(NTIMES, terse, tsphere));
+    for (i = 0; i < NTIMES; ++i)
+    {
+        CHECK_VECTOR(rotated, Astronomy_RotateVector(rot, vec[i]));
+        if (terse[i].x != rotated.x || terse[i].y != rotated.y || terse[i].z != rotated.z)
+            FFAIL("rotated vector %d does not match.\n", i);
+        sphere = Astronomy_SphereFromVector(rotated);
+        CHECK_STATUS(sphere);
+        if (tsphere[i].lat != sphere.lat || tsphere[i].lon != sphere.lon || tsphere[i].dist != sphere.dist)
+            FFAIL("spherical coordinates %d do not match.\n", i);
+    }
+
+    /* Errors produce a single status for the batch. */
+    terse[NTIMES/2].x = terse[NTIMES/2].y = terse[NTIMES/2].z = 0.0;
+    status = Astronomy_SphereFromVectorsTerse(NTIMES, terse, tsphere);
+    if (status != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for zero vector, but got %d\n", status);
+
+    rot.status = ASTRO_INVALID_PARAMETER;
+    status = Astronomy_RotateVectorsTerse(&rot, NTIMES, terse, terse);
+    if (status != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for invalid rotation, but got %d\n", status);
+
+    status = Astronomy_HelioVectorTerse(BODY_INVALID, times, NTIMES, terse);
+    if (status != ASTRO_INVALID_BODY)
+        FFAIL("expected ASTRO_INVALID_BODY, but got %d\n", status);
+
+    FPASS();
+fail:
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int ProfileTest(void)
+{
+    int error, i;
+    astro_profile_t profile;
+    astro_time_t time;
+    astro_observer_t observer;
+    astro_equatorial_t equ;
+    astro_vector_t vec;
+
+    Astronomy_Reset();
+    Astronomy_ProfileReset();
+
+    observer = Astronomy_MakeObserver(28.5, -81.4, 30.0);
+    time = Astronomy_MakeTime(2026, 10, 14, 0, 0, 0.0);
+    for (i = 0; i < 10; ++i)
+    {
+        equ = Astronomy_Equator(BODY_MOON, &time, observer, EQUATOR_OF_DATE, ABERRATION);
+        CHECK_STATUS(equ);
+        CHECK_VECTOR(vec, Astronomy_HelioVector(BODY_MARS, time));
+        time = Astronomy_AddDays(time, 1.3);
+    }
+
+    profile = Astronomy_ProfileSnapshot();
+    if (!profile.enabled)
+    {
+        /* Without ASTRO_PROFILE, there are no counters at all. */
+        for (i = 0; i < ASTRO_PROFILE_COUNT; ++i)
+            if (profile.counter[i].calls != 0 || profile.counter[i].ticks != 0)
+                FFAIL("counter %d is not zero in a build without ASTRO_PROFILE.\n", i);
+        FPASSA("ASTRO_PROFILE is not enabled.\n");
+        goto fail;
+    }
+
+    for (i = 0; i < ASTRO_PROFILE_COUNT; ++i)
+    {
+        DEBUG("C ProfileTest: %-20s calls=%8llu ticks=%12llu\n", Astronomy_ProfileName((astro_profile_id_t)i), profile.counter[i].calls, profile.counter[i].ticks);
+        if (Astronomy_ProfileName((astro_profile_id_t)i)[0] == '\0')
+            FFAIL("counter %d has no name.\n", i);
+    }
+
+    if (profile.counter[ASTRO_PROFILE_CALC_MOON].calls < 10)
+        FFAIL("expected at least 10 CalcMoon calls, found %llu.\n", profile.counter[ASTRO_PROFILE_CALC_MOON].calls);
+
+    if (profile.counter[ASTRO_PROFILE_CALC_MOON_EXACT].calls > profile.counter[ASTRO_PROFILE_CALC_MOON].calls)
+        FFAIL("more CalcMoonExact calls than CalcMoon calls.\n");
+
+    if (profile.counter[ASTRO_PROFILE_VSOP_COORDS].calls < 10)
+        FFAIL("expected at least 10 VsopCoords calls, found %llu.\n", profile.counter[ASTRO_PROFILE_VSOP_COORDS].calls);
+
+    if (profile.counter[ASTRO_PROFILE_NUTATION_ROT].calls == 0 || profile.counter[ASTRO_PROFILE_PRECESSION_ROT].calls == 0)
+        FFAIL("precession and nutation were not counted.\n");
+
+    if (profile.counter[ASTRO_PROFILE_TERRA].calls < 10)
+        FFAIL("expected at least 10 terra calls, found %llu.\n", profile.counter[ASTRO_PROFILE_TERRA].calls);
+
+    if (Astronomy_ProfileName(ASTRO_PROFILE_COUNT)[0] != '\0')
+        FFAIL("ASTRO_PROFILE_COUNT should not have a name.\n");
+
+    Astronomy_ProfileReset();
+    profile = Astronomy_ProfileSnapshot();
+    for (i = 0; i < ASTRO_PROFILE_COUNT; ++i)
+        if (profile.counter[i].calls != 0 || profile.counter[i].ticks != 0)
+            FFAIL("counter %d is not zero after Astronomy_ProfileReset.\n", i);
+
+    FPASS();
+fail:
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int CheckParseDouble(const char *text)
+{
+    double expected, parsed;
+    char *expected_end;
+    const char *parsed_end;
+
+    expected = strtod(text, &expected_end);
+    parsed_end = TextParseDouble(text, text + strlen(text), &parsed);
+    if (expected_end == text)
+    {
+        if (parsed_end != NULL)
+            FAILRET("C CheckParseDouble: accepted invalid number '%s'\n", text);
+        return 0;
+    }
+
+    if (parsed_end != expected_end)
+        FAILRET("C CheckParseDouble(%s): parsed %d characters, but strtod parsed %d.\n", text, (int)(parsed_end - text), (int)(expected_end - text));
+
+    if (memcmp(&parsed, &expected, sizeof(double)))
+        FAILRET("C CheckParseDouble(%s): parsed %0.17lg, but strtod returned %0.17lg.\n", text, parsed, expected);
+
+    return 0;
+}
+
+
+static int TextFileTest(void)
+{
+    int error, i, n;
+    FILE *outfile = NULL;
+    text_file_t infile;
+    text_line_t line;
+    const char *filename = "temp/c_textfile.txt";
+    static const char * const numbers[] =
+    {
+        "0", "-0", "+7", "1e", "1e+", "12.5e-3x", ".5", "5.", "-.5e2", ".", "-", "e5", "nan", "-inf",
+        "2444249.500000000", "-3.314860345089456E-01", "1.7976931348623157e308", "4.9e-324",
+        "9007199254740993", "123456789012345678901234567890", "0.000000000000000000000000001234", "1e23"
+    };
+    char text[40];
+    char name[10];
+    uint32_t seed = 12345;
+    double x, y, z;
+
+    memset(&infile, 0, sizeof(infile));
+
+    /* The fast number parser must always agree exactly with strtod. */
+    for (i = 0; i < (int)(sizeof(numbers) / sizeof(numbers[0])); ++i)
+        CHECK(CheckParseDouble(numbers[i]));
+
+    for (i = 0; i < 200000; ++i)
+    {
+        seed = 1103515245*seed + 12345;
+        x = ((double)(seed >> 8) / (1 << 24) - 0.5) * pow(10.0, (int)(seed % 41) - 20);
+        switch (i % 3)
+        {
+        case 0:  snprintf(text, sizeof(text), "%0.17lg", x);  break;
+        case 1:  snprintf(text, sizeof(text), "%0.*le", (int)(seed % 20), x);  break;
+        default: snprintf(text, sizeof(text), "%0.*lf", (int)(seed % 20), x);  break;
+        }
+        CHECK(CheckParseDouble(text));
+    }
+
+    /* Lines can end with LF, CRLF, or the end of the file. */
+    outfile = fopen(filename, "wb");
+    if (outfile == NULL)
+        FFAIL("Cannot open output file: %s\n", filename);
+    fprintf(outfile, "$$SOE\n X =-3.314860345089456E-01 Y = 8.463418210972562E-01 Z = 3.667227830514760E-01\r\n\nv Jupiter 2458455.2291666665");
+    fclose(outfile);
+    outfile = NULL;
+
+    if (TextFileOpen(&infile, filename))
+        FFAIL("Cannot open input file: %s\n", filename);
+
+    if (!TextFileReadLine(&infile, &line) || !TextLineStartsWith(&line, "$$SOE") || TextLineLength(&line) != 5)
+        FFAIL("incorrect line 1\n");
+
+    if (!TextFileReadLine(&infile, &line) || TextLineLength(&line) != 78)
+        FFAIL("incorrect line 2\n");
+
+    n = TextScan(&line, 0, " X =%lf Y =%lf Z =%lf", &x, &y, &z);
+    if (n != 3 || x != -3.314860345089456E-01 || y != 8.463418210972562E-01 || z != 3.667227830514760E-01)
+        FFAIL("incorrect position vector on line 2: n=%d\n", n);
+
+    if (!TextFileReadLine(&infile, &line) || TextLineLength(&line) != 0)
+        FFAIL("incorrect line 3\n");
+
+    if (!TextFileReadLine(&infile, &line) || infile.lnum != 4)
+        FFAIL("incorrect line 4\n");
+
+    n = TextScan(&line, 0, "v %9[A-Za-z] %lf %lf", name, &x, &y);
+    if (n != 2 || strcmp(name, "Jupiter") || x != 2458455.2291666665)
+        FFAIL("incorrect scan of line 4: n=%d, name='%s'\n", n, name);
+
+    if (TextFileReadLine(&infile, &line))
+        FFAIL("expected end of file after line 4\n");
+
+    FPASS();
+fail:
+    if (outfile != NULL) fclose(outfile);
+    TextFileClose(&infile);
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int WritePlutoSeriesFile(const char *filename, const double elem[6])
+{
+    int error, f;
+    FILE *outfile;
+
+    outfile = fopen(filename, "wt");
+    if (outfile == NULL)
+        FFAIL("cannot open output file: %s\n", filename);
+
+    /* The series for other planets must be skipped. */
+    fprintf(outfile, " TOP2013ELL    PLANET 8    VARIABLE 1    T**00       1 term(s)\n");
+    fprintf(outfile, "        0    0.3011038902500000 +02    0.0000000000000000 +00\n");
+
+    /* One constant term for each elliptical element, in the weird exponent format of TOP2013. */
+    for (f = 0; f < 6; ++f)
+    {
+        fprintf(outfile, " TOP2013ELL    PLANET 9    VARIABLE %d    T**00       1 term(s)\n", f+1);
+        fprintf(outfile, "        0 %25.17lf +00 %25.17lf +00\n", elem[f], 0.0);
+
+        /* The constant term of the mean motion in T**01 duplicates TOP_FREQ_PLUTO and must be ignored. */
+        if (f == 1)
+        {
+            fprintf(outfile, " TOP2013ELL    PLANET 9    VARIABLE 2    T**01       1 term(s)\n");
+            fprintf(outfile, "        0    0.2533566020437000 +02    0.0000000000000000 +00\n");
+        }
+    }
+
+    fclose(outfile);
+    error = 0;
+fail:
+    return error;
+}
+
+
+static int PlutoSeriesTest(void)
+{
+    /*
+        Build a series model that holds Pluto's osculating orbital elements at J2000
+        as constant terms. At that moment, the series must reproduce the integrator's
+        state vector, apart from the slightly different ecliptic frame of TOP2013.
+    */
+    const char *filename = "temp/c_pluto_series.txt";
+    const double gm = 2.9591220836841438269e-04 + 2.1886997654259696800e-12;
+    int error;
+    astro_time_t time = Astronomy_TerrestrialTime(0.0);
+    astro_time_t far_time = Astronomy_TerrestrialTime(+800000.0);
+    astro_state_vector_t eqj, ecl, state, sun, bary;
+    astro_vector_t vec, far_vec, expected;
+    astro_status_t status;
+    double r[3], v[3], hv[3], ev[3];
+    double elem[6];
+    double rlen, v2, hlen, a, e, incl, node, peri, cosE, sinE, anom, dx, dy, dz, dr, dv;
+    FILE *outfile;
+
+    Astronomy_Reset();
+    eqj = Astronomy_HelioState(BODY_PLUTO, time);
+    CHECK_STATUS(eqj);
+    ecl = Astronomy_RotateState(Astronomy_Rotation_EQJ_ECL(), eqj);
+    CHECK_STATUS(ecl);
+    CHECK_VECTOR(far_vec, Astronomy_HelioVector(BODY_PLUTO, far_time));
+
+    /* Convert the ecliptic state vector to the elements a, lambda, k, h, q, p. */
+    r[0] = ecl.x;   r[1] = ecl.y;   r[2] = ecl.z;
+    v[0] = ecl.vx;  v[1] = ecl.vy;  v[2] = ecl.vz;
+    rlen = sqrt(r[0]*r[0] + r[1]*r[1] + r[2]*r[2]);
+    v2 = v[0]*v[0] + v[1]*v[1] + v[2]*v[2];
+    hv[0] = r[1]*v[2] - r[2]*v[1];
+    hv[1] = r[2]*v[0] - r[0]*v[2];
+    hv[2] = r[0]*v[1] - r[1]*v[0];
+    hlen = sqrt(hv[0]*hv[0] + hv[1]*hv[1] + hv[2]*hv[2]);
+    ev[0] = (v[1]*hv[2] - v[2]*hv[1])/gm - r[0]/rlen;
+    ev[1] = (v[2]*hv[0] - v[0]*hv[2])/gm - r[1]/rlen;
+    ev[2] = (v[0]*hv[1] - v[1]*hv[0])/gm - r[2]/rlen;
+    e = sqrt(ev[0]*ev[0] + ev[1]*ev[1] + ev[2]*ev[2]);
+    a = 1.0 / (2.0/rlen - v2/gm);
+    incl = acos(hv[2] / hlen);
+    node = atan2(hv[0], -hv[1]);
+
+    /* The longitude of perihelion is measured along the ecliptic to the node, then along the orbit. */
+    peri = node + atan2(
+        (-sin(node)*ev[0] + cos(node)*ev[1])*cos(incl) + ev[2]*sin(incl),
+        cos(node)*ev[0] + sin(node)*ev[1]);
+
+    cosE = (1.0 - rlen/a) / e;
+    sinE = (r[0]*v[0] + r[1]*v[1] + r[2]*v[2]) / (e * sqrt(gm * a));
+    anom = atan2(sinE, cosE) - e*sinE;
+
+    elem[0] = a;
+    elem[1] = fmod(anom + peri + 4.0*PI, 2.0*PI);
+    elem[2] = e * cos(peri);
+    elem[3] = e * sin(peri);
+    elem[4] = sin(incl/2.0) * cos(node);
+    elem[5] = sin(incl/2.0) * sin(node);
+    DEBUG("C PlutoSeriesTest: a=%0.6lf lambda=%0.6lf k=%0.6lf h=%0.6lf q=%0.6lf p=%0.6lf\n", elem[0], elem[1], elem[2], elem[3], elem[4], elem[5]);
+
+    CHECK(WritePlutoSeriesFile(filename, elem));
+
+    status = Astronomy_SetPlutoModel(PLUTO_MODEL_SERIES);
+    if (status != ASTRO_NOT_INITIALIZED)
+        FFAIL("expected ASTRO_NOT_INITIALIZED before loading a series, but got %d\n", status);
+
+    CHECK(Astronomy_PlutoSeriesLoad(filename));
+    CHECK(Astronomy_SetPlutoModel(PLUTO_MODEL_SERIES));
+
+    state = Astronomy_HelioState(BODY_PLUTO, time);
+    CHECK_STATUS(state);
+    dx = state.x - eqj.x;
+    dy = state.y - eqj.y;
+    dz = state.z - eqj.z;
+    dr = sqrt(dx*dx + dy*dy + dz*dz);
+    dx = state.vx - eqj.vx;
+    dy = state.vy - eqj.vy;
+    dz = state.vz - eqj.vz;
+    dv = sqrt(dx*dx + dy*dy + dz*dz);
+    DEBUG("C PlutoSeriesTest: dr=%0.3le au, dv=%0.3le au/day\n", dr, dv);
+    if (dr > 2.0e-5 || dv > 5.0e-9)
+        FFAIL("excessive error: dr=%0.3le au, dv=%0.3le au/day\n", dr, dv);
+
+    /* Barycentric coordinates must add the Sun's barycentric state to the series. */
+    bary = Astronomy_BaryState(BODY_PLUTO, time);
+    CHECK_STATUS(bary);
+    sun = Astronomy_BaryState(BODY_SUN, time);
+    CHECK_STATUS(sun);
+    dx = bary.x - sun.x - state.x;
+    dy = bary.y - sun.y - state.y;
+    dz = bary.z - sun.z - state.z;
+    dr = sqrt(dx*dx + dy*dy + dz*dz);
+    if (dr > 1.0e-12)
+        FFAIL("barycentric mismatch: dr=%0.3le au\n", dr);
+
+    /* PLUTO_MODEL_SERIES_OUTSIDE uses the integrator inside the years 0000..4000 and the series outside. */
+    CHECK_VECTOR(vec, Astronomy_HelioVector(BODY_PLUTO, far_time));
+    expected = vec;
+    if (vec.x == far_vec.x && vec.y == far_vec.y && vec.z == far_vec.z)
+        FFAIL("series did not replace the integrator at tt=%0.1lf\n", far_time.tt);
+
+    CHECK(Astronomy_SetPlutoModel(PLUTO_MODEL_SERIES_OUTSIDE));
+    state = Astronomy_HelioState(BODY_PLUTO, time);
+    CHECK_STATUS(state);
+    if (state.x != eqj.x || state.y != eqj.y || state.z != eqj.z)
+        FFAIL("PLUTO_MODEL_SERIES_OUTSIDE did not use the integrator at J2000.\n");
+    CHECK_VECTOR(vec, Astronomy_HelioVector(BODY_PLUTO, far_time));
+    if (vec.x != expected.x || vec.y != expected.y || vec.z != expected.z)
+        FFAIL("PLUTO_MODEL_SERIES_OUTSIDE did not use the series at tt=%0.1lf\n", far_time.tt);
+
+    /* Without a series, Pluto falls back to the integrator. */
+    Astronomy_PlutoSeriesFree();
+    CHECK_VECTOR(vec, Astronomy_HelioVector(BODY_PLUTO, far_time));
+    if (vec.x != far_vec.x || vec.y != far_vec.y || vec.z != far_vec.z)
+        FFAIL("integrator was not restored after Astronomy_PlutoSeriesFree.\n");
+
+    status = Astronomy_SetPlutoModel((astro_pluto_model_t) 3);
+    if (status != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for invalid model, but got %d\n", status);
+
+    status = Astronomy_PlutoSeriesLoad("temp/this_file_does_not_exist.txt");
+    if (status != ASTRO_FILE_ERROR)
+        FFAIL("expected ASTRO_FILE_ERROR for missing file, but got %d\n", status);
+
+    /* A file without Pluto's terms must be rejected. */
+    outfile = fopen(filename, "wt");
+    if (outfile == NULL)
+        FFAIL("cannot open output file: %s\n", filename);
+    fprintf(outfile, " TOP2013ELL    PLANET 8    VARIABLE 1    T**00       1 term(s)\n");
+    fprintf(outfile, "        0    0.3011038902500000 +02    0.0000000000000000 +00\n");
+    fclose(outfile);
+    status = Astronomy_PlutoSeriesLoad(filename);
+    if (status != ASTRO_BAD_FILE_FORMAT)
+        FFAIL("expected ASTRO_BAD_FILE_FORMAT for a file without Pluto, but got %d\n", status);
+
+    FPASS();
+fail:
+    Astronomy_PlutoSeriesFree();
+    Astronomy_SetPlutoModel(PLUTO_MODEL_INTEGRATOR);
+    Astronomy_Reset();
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int TwilightSearchTest(void)
+{
+    static const double altitudes[] = { -6.0, -12.0, -18.0, 95.0 };
+    static const double latitudes[] = { +38.0, -33.9, +65.5, +78.2 };
+    static const double limits[] = { +1.0, -1.0, +5.0, -5.0 };
+    enum { NALT = sizeof(altitudes) / sizeof(altitudes[0]) };
+    extern int _AltitudeDiffCallCount;
+    int error = 1;
+    int i, k, m, d, ntests = 0, nfound = 0;
+    int single_calls = 0, multi_calls = 0;
+    astro_observer_t observer;
+    astro_time_t startTime;
+    astro_search_result_t dawn[NALT], dusk[NALT], expected;
+
+    for (i = 0; i < (int)(sizeof(latitudes) / sizeof(latitudes[0])); ++i)
+    {
+        observer = Astronomy_MakeObserver(latitudes[i], -77.0 + 90.0*i, 100.0);
+        for (d = 0; d < 12; ++d)
+        {
+            startTime = Astronomy_MakeTime(2025, 1 + d, 3 + 2*d, 5 + d, 17, 0.0);
+            for (k = 0; k < (int)(sizeof(limits) / sizeof(limits[0])); ++k)
+            {
+                _AltitudeDiffCallCount = 0;
+                CHECK(Astronomy_SearchTwilight(observer, startTime, limits[k], altitudes, NALT, dawn, dusk));
+                multi_calls += _AltitudeDiffCallCount;
+
+                for (m = 0; m < NALT; ++m)
+                {
+                    _AltitudeDiffCallCount = 0;
+                    expected = Astronomy_SearchAltitude(BODY_SUN, observer, DIRECTION_RISE, startTime, limits[k], altitudes[m]);
+                    single_calls += _AltitudeDiffCallCount;
+                    if (dawn[m].status != expected.status || (expected.status == ASTRO_SUCCESS && dawn[m].time.ut != expected.time.ut))
+                        FFAIL("latitude %0.1lf, d=%d, limit %0.1lf, dawn %0.1lf: status %d ut %0.9lf, expected status %d ut %0.9lf\n",
+                            latitudes[i], d, limits[k], altitudes[m], dawn[m].status, dawn[m].time.ut, expected.status, expected.time.ut);
+
+                    _AltitudeDiffCallCount = 0;
+                    expected = Astronomy_SearchAltitude(BODY_SUN, observer, DIRECTION_SET, startTime, limits[k], altitudes[m]);
+                    single_calls += _AltitudeDiffCallCount;
+                    if (dusk[m].status != expected.status || (expected.status == ASTRO_SUCCESS && dusk[m].time.ut != expected.time.ut))
+                        FFAIL("latitude %0.1lf, d=%d, limit %0.1lf, dusk %0.1lf: status %d ut %0.9lf, expected status %d ut %0.9lf\n",
+                            latitudes[i], d, limits[k], altitudes[m], dusk[m].status, dusk[m].time.ut, expected.status, expected.time.ut);
+
+                    ntests += 2;
+                    nfound += (dawn[m].status == ASTRO_SUCCESS) + (dusk[m].status == ASTRO_SUCCESS);
+                }
+            }
+        }
+    }
+
+    if (dawn[NALT-1].status != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for altitude %0.1lf, but found %d\n", altitudes[NALT-1], dawn[NALT-1].status);
+
+    if (multi_calls >= single_calls)
+        FFAIL("expected fewer altitude calculations than separate searches, but found %d vs %d\n", multi_calls, single_calls);
+
+    /* Either array of results may be omitted. */
+    CHECK(Astronomy_SearchTwilight(observer, startTime, 1.0, altitudes, NALT, dawn, NULL));
+
+    if (Astronomy_SearchTwilight(observer, startTime, 1.0, NULL, NALT, dawn, dusk) != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for NULL altitudes.\n");
+
+    FPASSA("%d searches, %d found, altitude calls: %d vs %d separately\n", ntests, nfound, multi_calls, single_calls);
+fail:
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int HourAngleBatchTest(void)
+{
+    static const astro_body_t bodies[] =
+    {
+        BODY_SUN, BODY_MOON, BODY_MERCURY, BODY_VENUS, BODY_MARS, BODY_JUPITER,
+        BODY_SATURN, BODY_URANUS, BODY_NEPTUNE, BODY_PLUTO, BODY_STAR1, BODY_STAR2,
+        BODY_MOON, BODY_EARTH
+    };
+    enum { NBODIES = sizeof(bodies) / sizeof(bodies[0]) };
+    static const double hourAngles[] = { 0.0, 6.5, 12.0 };
+    int error = 1;
+    int i, h, d, ntests = 0;
+    astro_observer_t observer = Astronomy_MakeObserver(+29.7, -95.4, 20.0);
+    astro_time_t startTime = Astronomy_MakeTime(2025, 7, 14, 3, 45, 0.0);
+    astro_hour_angle_t results[NBODIES], expected;
+
+    CHECK(Astronomy_DefineStar(BODY_STAR1, 6.75, -16.7, 8.6));
+    CHECK(Astronomy_DefineStar(BODY_STAR2, 18.6, +38.8, 25.0));
+
+    for (d = -1; d <= +1; d += 2)
+    {
+        for (h = 0; h < (int)(sizeof(hourAngles) / sizeof(hourAngles[0])); ++h)
+        {
+            CHECK(Astronomy_SearchHourAngleBatch(bodies, NBODIES, observer, hourAngles[h], startTime, d, results));
+            for (i = 0; i < NBODIES; ++i)
+            {
+                expected = Astronomy_SearchHourAngleEx(bodies[i], observer, hourAngles[h], startTime, d);
+                if (results[i].status != expected.status)
+                    FFAIL("%s hour angle %0.1lf direction %d: status %d, expected %d\n", Astronomy_BodyName(bodies[i]), hourAngles[h], d, results[i].status, expected.status);
+                if (expected.status != ASTRO_SUCCESS)
+                    continue;
+                if (results[i].time.ut != expected.time.ut || results[i].hor.altitude != expected.hor.altitude || results[i].hor.azimuth != expected.hor.azimuth)
+                    FFAIL("%s hour angle %0.1lf direction %d: ut %0.9lf, expected %0.9lf\n", Astronomy_BodyName(bodies[i]), hourAngles[h], d, results[i].time.ut, expected.time.ut);
+                ++ntests;
+            }
+        }
+    }
+
+    if (results[NBODIES-1].status != ASTRO_EARTH_NOT_ALLOWED)
+        FFAIL("expected ASTRO_EARTH_NOT_ALLOWED for the Earth, but found %d\n", results[NBODIES-1].status);
+
+    if (Astronomy_SearchHourAngleBatch(bodies, NBODIES, observer, 24.0, startTime, +1, results) != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for hour angle 24.\n");
+
+    if (Astronomy_SearchHourAngleBatch(bodies, NBODIES, observer, 0.0, startTime, 0, results) != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for direction 0.\n");
+
+    FPASSA("%d searches\n", ntests);
+fail:
+    Astronomy_Reset();
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+typedef struct
+{
+    double  rate;           /* radians per day */
+    double  phase;          /* radians */
+    int     fail_after;     /* report an error on this call, or 0 to never fail */
+    int     calls;
+}
+search_state_func_t;
+
+static astro_func_result_t SearchStateFunc(void *context, astro_time_t time)
+{
+    search_state_func_t *p = (search_state_func_t *)context;
+    astro_func_result_t result;
+
+    if (++p->calls == p->fail_after)
+    {
+        result.status = ASTRO_BAD_TIME;
+        result.value = NAN;
+    }
+    else
+    {
+        result.status = ASTRO_SUCCESS;
+        result.value = sin(p->rate*time.ut - p->phase) + 0.1*sin(3.7*time.ut);
+    }
+    return result;
+}
+
+static int SearchStateTest(void)
+{
+    enum { NSEARCH = 500 };
+    static search_state_func_t funcs[NSEARCH];
+    static astro_search_state_t *states[NSEARCH];
+    int error = 1;
+    int i, m, pending, rounds, nfound;
+    astro_time_t t1[NSEARCH], t2[NSEARCH], request;
+    astro_search_result_t expected, result;
+    astro_search_stats_t stats[2];
+    astro_func_result_t value;
+
+    memset(states, 0, sizeof(states));
+
+    for (m = 0; m < 2; ++m)
+    {
+        astro_search_method_t method = m ? SEARCH_CHANDRUPATLA : SEARCH_QUADRATIC;
+
+        memset(&stats[0], 0, sizeof(stats[0]));
+        Astronomy_SetSearchStats(&stats[0]);
+        for (i = 0; i < NSEARCH; ++i)
+        {
+            funcs[i].rate = 0.5 + 0.01*i;
+            funcs[i].phase = 0.37*i;
+            funcs[i].fail_after = (i % 97 == 5) ? 4 : 0;
+            funcs[i].calls = 0;
+            t1[i] = Astronomy_TimeFromDays(0.01*i);
+            t2[i] = Astronomy_TimeFromDays(0.01*i + 0.5 + (i % 13)*0.25);
+            CHECK(Astronomy_SearchStateInit(&states[i], t1[i], t2[i], 0.1, method));
+        }
+
+        /* Drive all the searches together, one round of function values at a time. */
+        for (rounds = 0; ; ++rounds)
+        {
+            pending = 0;
+            for (i = 0; i < NSEARCH; ++i)
+            {
+                if (Astronomy_SearchStatePending(states[i], &request))
+                {
+                    ++pending;
+                    CHECK(Astronomy_SearchStateResume(states[i], SearchStateFunc(&funcs[i], request)));
+                }
+            }
+            if (pending == 0)
+                break;
+        }
+        Astronomy_SetSearchStats(NULL);
+
+        /* Every search must have the same outcome, and do the same work, as Astronomy_SearchEx. */
+        memset(&stats[1], 0, sizeof(stats[1]));
+        Astronomy_SetSearchStats(&stats[1]);
+        nfound = 0;
+        for (i = 0; i < NSEARCH; ++i)
+        {
+            funcs[i].calls = 0;
+            expected = Astronomy_SearchEx(SearchStateFunc, &funcs[i], t1[i], t2[i], 0.1, method);
+            result = Astronomy_SearchStateResult(states[i]);
+            if (result.status != expected.status || (expected.status == ASTRO_SUCCESS && result.time.ut != expected.time.ut))
+                FFAIL("method %d search %d: status %d ut %0.12lf, expected status %d ut %0.12lf\n", m, i, result.status, result.time.ut, expected.status, expected.time.ut);
+            if (expected.status == ASTRO_SUCCESS)
+                ++nfound;
+            else if (funcs[i].fail_after > 0 && funcs[i].calls >= funcs[i].fail_after && expected.status != ASTRO_BAD_TIME)
+                FFAIL("method %d search %d: expected the function's error, but found %d\n", m, i, expected.status);
+        }
+        Astronomy_SetSearchStats(NULL);
+
+        if (memcmp(&stats[0], &stats[1], sizeof(stats[0])))
+            FFAIL("method %d: statistics differ: func_calls %ld vs %ld, iterations %ld vs %ld\n", m, stats[0].func_calls, stats[1].func_calls, stats[0].iterations, stats[1].iterations);
+
+        if (nfound == 0 || nfound == NSEARCH)
+            FFAIL("method %d: expected a mix of successes and failures, but found %d of %d\n", m, nfound, NSEARCH);
+
+        DEBUG("C SearchStateTest: method %d found %d of %d roots in %d rounds, %ld function values\n", m, nfound, NSEARCH, rounds, stats[0].func_calls);
+
+        /* A finished search does not accept more values. */
+        value.status = ASTRO_SUCCESS;
+        value.value = 0.0;
+        if (Astronomy_SearchStateResume(states[0], value) != ASTRO_INVALID_PARAMETER)
+            FFAIL("expected ASTRO_INVALID_PARAMETER when resuming a finished search.\n");
+
+        for (i = 0; i < NSEARCH; ++i)
+        {
+            Astronomy_SearchStateFree(states[i]);
+            states[i] = NULL;
+        }
+    }
+
+    if (Astronomy_SearchStateInit(&states[0], t1[0], t2[0], 0.1, (astro_search_method_t)9) != ASTRO_INVALID_PARAMETER || states[0] != NULL)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for invalid method.\n");
+
+    if (Astronomy_SearchStateResult(NULL).status != ASTRO_INVALID_PARAMETER || Astronomy_SearchStatePending(NULL, &request))
+        FFAIL("expected NULL state to be rejected.\n");
+
+    FPASS();
+fail:
+    Astronomy_SetSearchStats(NULL);
+    for (i = 0; i < NSEARCH; ++i)
+        Astronomy_SearchStateFree(states[i]);
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static double TrackerArcsec(double dlon, double lat, double dlat)
+{
+    /* The angle in arcseconds between two nearby directions, given their differences in degrees. */
+    if (dlon > +180.0)
+        dlon -= 360.0;
+    else if (dlon < -180.0)
+        dlon += 360.0;
+    return 3600.0 * hypot(dlon * cos(DEG2RAD * lat), dlat);
+}
+
+static int TrackerTest(void)
+{
+    static const astro_body_t bodies[] = { BODY_MOON, BODY_SUN, BODY_MARS, BODY_STAR1 };
+    const int nticks = 12000;
+    const double tick = 0.1 / SECONDS_PER_DAY;
+    int error = 1;
+    int b, i;
+    astro_tracker_t *tracker = NULL;
+    astro_observer_t observer = Astronomy_MakeObserver(+31.9, -111.6, 2096.0);
+    astro_time_t startTime = Astronomy_MakeTime(2025, 3, 14, 5, 58, 0.0);
+    astro_time_t time;
+    astro_equatorial_t equ, exact;
+    astro_horizon_t hor, hexact;
+    double diff, equ_max = 0.0, hor_max = 0.0;
+
+    CHECK(Astronomy_DefineStar(BODY_STAR1, 5.92, +7.4, 500.0));
+
+    for (b = 0; b < (int)(sizeof(bodies) / sizeof(bodies[0])); ++b)
+    {
+        CHECK(Astronomy_TrackerInit(&tracker, bodies[b], observer, REFRACTION_NORMAL, 60.0));
+
+        /* Track forward at 10 Hz, then jump backward, as a mount loop might after a restart. */
+        for (i = 0; i < nticks + 100; ++i)
+        {
+            time = Astronomy_TimeFromDays(startTime.ut + tick*((i < nticks) ? i : (nticks - 30*i)));
+            CHECK(Astronomy_TrackerUpdate(tracker, time, &equ, &hor));
+            exact = Astronomy_Equator(bodies[b], &time, observer, EQUATOR_OF_DATE, ABERRATION);
+            CHECK_STATUS(exact);
+            hexact = Astronomy_Horizon(&time, observer, exact.ra, exact.dec, REFRACTION_NORMAL);
+
+            diff = TrackerArcsec(15.0*(equ.ra - exact.ra), exact.dec, equ.dec - exact.dec);
+            if (diff > equ_max)
+                equ_max = diff;
+            if (diff > 1.0e-3)
+                FFAIL("%s tick %d: equatorial error %0.3le arcsec\n", Astronomy_BodyName(bodies[b]), i, diff);
+
+            diff = TrackerArcsec(hor.azimuth - hexact.azimuth, hexact.altitude, hor.altitude - hexact.altitude);
+            if (diff > hor_max)
+                hor_max = diff;
+            if (diff > 1.0e-3)
+                FFAIL("%s tick %d: horizontal error %0.3le arcsec\n", Astronomy_BodyName(bodies[b]), i, diff);
+
+            if (ABS(equ.dist - exact.dist) > 1.0e-10 * exact.dist)
+                FFAIL("%s tick %d: distance error %0.3le AU\n", Astronomy_BodyName(bodies[b]), i, equ.dist - exact.dist);
+        }
+
+        Astronomy_TrackerFree(tracker);
+        tracker = NULL;
+    }
+
+    if (Astronomy_TrackerInit(&tracker, BODY_EARTH, observer, REFRACTION_NONE, 60.0) != ASTRO_EARTH_NOT_ALLOWED || tracker != NULL)
+        FFAIL("expected ASTRO_EARTH_NOT_ALLOWED for the Earth.\n");
+
+    if (Astronomy_TrackerInit(&tracker, BODY_MOON, observer, REFRACTION_NONE, 0.0) != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for a zero refresh interval.\n");
+
+    FPASSA("max error: equatorial %0.3le arcsec, horizontal %0.3le arcsec\n", equ_max, hor_max);
+fail:
+    Astronomy_TrackerFree(tracker);
+    Astronomy_Reset();
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int GeoMoonBatchTest(void)
+{
+    enum { NTIMES = 1003 };
+    static astro_time_t times[NTIMES];
+    static astro_vector_t vec[NTIMES];
+    int error = 1;
+    int i;
+    astro_vector_t expected;
+
+    for (i = 0; i < NTIMES; ++i)
+        times[i] = Astronomy_TimeFromDays(-36525.0 + 73.1*i + 0.37*(i % 7));
+
+    /* Repeat a few times so that the batch sees some of them in the ephemeris cache. */
+    times[500] = times[10];
+    times[501] = times[11];
+
+    CHECK(Astronomy_GeoMoonBatch(times, NTIMES, vec));
+
+    for (i = 0; i < NTIMES; ++i)
+    {
+        expected = Astronomy_GeoMoon(times[i]);
+        CHECK_STATUS(expected);
+        CHECK_STATUS(vec[i]);
+        if (vec[i].x != expected.x || vec[i].y != expected.y || vec[i].z != expected.z || vec[i].t.tt != expected.t.tt)
+            FFAIL("time %d (tt=%0.6lf): batch (%0.16le, %0.16le, %0.16le) differs from (%0.16le, %0.16le, %0.16le)\n",
+                i, times[i].tt, vec[i].x, vec[i].y, vec[i].z, expected.x, expected.y, expected.z);
+    }
+
+    CHECK(Astronomy_GeoMoonBatch(times, 0, vec));
+
+    if (Astronomy_GeoMoonBatch(NULL, NTIMES, vec) != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for NULL times.\n");
+
+    if (Astronomy_GeoMoonBatch(times, NTIMES, NULL) != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for NULL output.\n");
+
+    FPASSA("%d vectors\n", NTIMES);
+fail:
+    Astronomy_Reset();
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static double SmoothDeltaT(double ut)
+{
+    return 64.0 + ut/1500.0 + 0.5*sin(ut/400.0);
+}
+
+static int DeltaTTableTest(void)
+{
+    static const double limits[] = { 1860, 1900, 1920, 1941, 1961, 1986, 2005, 2050 };
+    const char *filename = "temp/c_deltat_table.txt";
+    static char text[100000];
+    FILE *outfile = NULL;
+    int error = 1;
+    int i, k, year, month, length;
+    double ut, dt, expected, diff, maxdiff;
+    astro_time_t time;
+
+    /* Sample the Espenak/Meeus model once a year, and make sure the table reproduces it. */
+    length = 0;
+    for (year = 1810; year <= 2100; ++year)
+    {
+        ut = 14 + (year - 2000)*365.24217;
+        length += snprintf(text + length, sizeof(text) - length, "%d.0 %0.9lf 0.1\n", year, Astronomy_DeltaT_EspenakMeeus(ut));
+    }
+    CHECK(Astronomy_DeltaTTableLoadBuffer(text, (size_t)length));
+
+    /* Skip the years where the Espenak/Meeus polynomials meet, because they do not join smoothly. */
+    maxdiff = 0.0;
+    for (i = 0; i <= 100000; ++i)
+    {
+        double y = 1810.0 + 0.0029*i;
+        for (k = 0; k < (int)(sizeof(limits) / sizeof(limits[0])); ++k)
+            if (fabs(y - limits[k]) < 2.5)
+                break;
+        if (k < (int)(sizeof(limits) / sizeof(limits[0])))
+            continue;
+        ut = 14 + (y - 2000)*365.24217;
+        diff = fabs(Astronomy_DeltaT_Table(ut) - Astronomy_DeltaT_EspenakMeeus(ut));
+        if (diff > maxdiff)
+            maxdiff = diff;
+    }
+    if (maxdiff > 0.002)
+        FFAIL("yearly table differs from Espenak/Meeus by %0.6lf seconds.\n", maxdiff);
+
+    /* Outside the table, follow Espenak/Meeus without a jump at either end. */
+    for (year = 1810; year <= 2100; year += 290)
+    {
+        ut = 14 + (year - 2000)*365.24217;
+        diff = fabs(Astronomy_DeltaT_Table(ut - 1.0e-6) - Astronomy_DeltaT_Table(ut + 1.0e-6));
+        if (diff > 1.0e-6)
+            FFAIL("jump of %0.9lf seconds at the end of the table in year %d.\n", diff, year);
+    }
+
+    /* A table with monthly samples, in the format of the USNO file deltat.data, with a heading. */
+    outfile = fopen(filename, "wt");
+    if (outfile == NULL)
+        FFAIL("cannot open output file: %s\n", filename);
+    fprintf(outfile, "  Year Month Day   Delta T\n\n");
+    for (year = 1973; year <= 2025; ++year)
+        for (month = 1; month <= 12; ++month)
+            fprintf(outfile, " %4d %2d  1  %8.4lf\n", year, month, SmoothDeltaT(Astronomy_MakeTime(year, month, 1, 0, 0, 0.0).ut));
+    fclose(outfile);
+    outfile = NULL;
+
+    CHECK(Astronomy_DeltaTTableLoadFile(filename));
+    Astronomy_SetDeltaTFunction(Astronomy_DeltaT_Table);
+
+    time = Astronomy_MakeTime(1973, 1, 1, 0, 0, 0.0);
+    for (i = 0; i < 52*365; ++i)
+    {
+        dt = (time.tt - time.ut) * 86400.0;
+        expected = SmoothDeltaT(time.ut);
+        if (fabs(dt - expected) > 1.0e-4)
+            FFAIL("ut=%0.1lf: Delta T = %0.6lf, expected %0.6lf\n", time.ut, dt, expected);
+        time = Astronomy_AddDays(time, 1.0);
+    }
+
+    /* A failed load keeps the previous table. */
+    if (Astronomy_DeltaTTableLoadBuffer("2000.0 64\n2001.0 64\n2002.0 64\n", 36) != ASTRO_BAD_FILE_FORMAT)
+        FFAIL("expected ASTRO_BAD_FILE_FORMAT for only 3 samples.\n");
+
+    if (Astronomy_DeltaTTableLoadBuffer("2000.0 64\n2002.0 64\n2001.0 64\n2003.0 64\n", 40) != ASTRO_BAD_FILE_FORMAT)
+        FFAIL("expected ASTRO_BAD_FILE_FORMAT for samples out of order.\n");
+
+    if (Astronomy_DeltaTTableLoadBuffer("2000.0 64\n2001.0\n2002.0 64\n2003.0 64\n", 38) != ASTRO_BAD_FILE_FORMAT)
+        FFAIL("expected ASTRO_BAD_FILE_FORMAT for a missing value.\n");
+
+    if (Astronomy_DeltaTTableLoadFile("temp/c_deltat_missing.txt") != ASTRO_FILE_ERROR)
+        FFAIL("expected ASTRO_FILE_ERROR for a missing file.\n");
+
+    time = Astronomy_MakeTime(2000, 1, 1, 0, 0, 0.0);
+    dt = (time.tt - time.ut) * 86400.0;
+    if (fabs(dt - SmoothDeltaT(time.ut)) > 1.0e-4)
+        FFAIL("after failed loads, Delta T = %0.6lf\n", dt);
+
+    Astronomy_DeltaTTableFree();
+    ut = 1234.5;
+    if (Astronomy_DeltaT_Table(ut) != Astronomy_DeltaT_EspenakMeeus(ut))
+        FFAIL("without a table, expected the Espenak/Meeus value.\n");
+
+    FPASSA("max yearly interpolation error = %0.3le seconds\n", maxdiff);
+fail:
+    if (outfile != NULL) fclose(outfile);
+    Astronomy_SetDeltaTFunction(Astronomy_DeltaT_EspenakMeeus);
+    Astronomy_Reset();
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+/* The way Astronomy_FormatTime used to format times with snprintf. */
+static void TimeTextReference(astro_time_t time, astro_time_format_t format, char *text, size_t size)
+{
+    static const double rounding[] = { 0.0, 0.5/1440.0, 0.5/86400.0, 0.5/86400000.0 };
+    char ytext[20];
+    astro_utc_t utc;
+
+    time.ut += rounding[format];
+    utc = Astronomy_UtcFromTime(time);
+
+    if (utc.year < 0)
+        snprintf(ytext, sizeof(ytext), "-%06d", -utc.year);
+    else if (utc.year <= 9999)
+        snprintf(ytext, sizeof(ytext), "%04d", utc.year);
+    else
+        snprintf(ytext, sizeof(ytext), "+%06d", utc.year);
+
+    switch (format)
+    {
+    case TIME_FORMAT_DAY:
+        snprintf(text, size, "%s-%02d-%02d", ytext, utc.month, utc.day);
+        break;
+    case TIME_FORMAT_MINUTE:
+        snprintf(text, size, "%s-%02d-%02dT%02d:%02dZ", ytext, utc.month, utc.day, utc.hour, utc.minute);
+        break;
+    case TIME_FORMAT_SECOND:
+        snprintf(text, size, "%s-%02d-%02dT%02d:%02d:%02.0lfZ", ytext, utc.month, utc.day, utc.hour, utc.minute, floor(utc.second));
+        break;
+    default:
+        snprintf(text, size, "%s-%02d-%02dT%02d:%02d:%06.3lfZ", ytext, utc.month, utc.day, utc.hour, utc.minute, floor(1000.0 * utc.second) / 1000.0);
+        break;
+    }
+}
+
+static int TimeTextTest(void)
+{
+    enum { NTIMES = 20000 };
+    static astro_time_t times[NTIMES];
+    static astro_time_t parsed[NTIMES];
+    static char text[NTIMES * TIME_TEXT_BYTES];
+    static const char *ptr[NTIMES];
+    static const char *bad[] =
+    {
+        "", "2021-02-29", "2020-13-01", "2020-1-01", "2020-01-01T24:00Z", "2020-01-01T12:60Z",
+        "2020-01-01T12:00:00.", "2020-01-01Z", "2020-01-01T12:00Zx", "12020-01-01", "+2020-01-01"
+    };
+    int error = 1;
+    int i, f;
+    char expected[100];
+    astro_time_t time;
+    double diff, maxdiff = 0.0;
+
+    for (i = 0; i < NTIMES; ++i)
+    {
+        /* Mostly recent times at odd fractions of a day, plus some far from year 2000. */
+        if (i % 10 == 0)
+            times[i] = Astronomy_TimeFromDays(-2.4e+6 + 2500.12345679*i);
+        else
+            times[i] = Astronomy_TimeFromDays(-40000.0 + 4.0000123457*i);
+        ptr[i] = text + i*TIME_TEXT_BYTES;
+    }
+    /* Halfway to the next millisecond, second, and minute. */
+    times[1] = Astronomy_MakeTime(2020, 12, 31, 23, 59, 59.4995);
+    times[2] = Astronomy_MakeTime(2020, 12, 31, 23, 59, 59.5);
+    times[3] = Astronomy_MakeTime(2020, 12, 31, 23, 59, 30.0);
+
+    for (f = TIME_FORMAT_DAY; f <= TIME_FORMAT_MILLI; ++f)
+    {
+        CHECK(Astronomy_FormatTimeBatch(times, NTIMES, (astro_time_format_t)f, text));
+        for (i = 0; i < NTIMES; ++i)
+        {
+            TimeTextReference(times[i], (astro_time_format_t)f, expected, sizeof(expected));
+            if (strcmp(ptr[i], expected))
+                FFAIL("format %d, time %d: '%s', expected '%s'\n", f, i, ptr[i], expected);
+        }
+
+        CHECK(Astronomy_ParseTimeBatch(ptr, NTIMES, parsed));
+        if (f == TIME_FORMAT_MILLI)
+        {
+            /* Far from the year 2000, `ut` itself has less precision than a millisecond. */
+            for (i = 1; i < NTIMES; ++i)
+            {
+                if (i % 10 == 0)
+                    continue;
+                diff = ABS(parsed[i].ut - times[i].ut) * 86400.0;
+                if (diff > maxdiff)
+                    maxdiff = diff;
+            }
+            if (maxdiff > 0.0006)     /* rounding to the millisecond, plus precision lost converting to a calendar date */
+                FFAIL("round trip error %0.6lf seconds\n", maxdiff);
+        }
+    }
+
+    CHECK(Astronomy_ParseTime("2018-12-02T18:30:12.543Z", &time));
+    if (time.ut != Astronomy_MakeTime(2018, 12, 2, 18, 30, 12.543).ut)
+        FFAIL("parsed ut=%0.12lf differs from Astronomy_MakeTime\n", time.ut);
+
+    CHECK(Astronomy_ParseTime("2018-12-02 18:30", &time));
+    if (time.ut != Astronomy_MakeTime(2018, 12, 2, 18, 30, 0.0).ut)
+        FFAIL("parsed ut=%0.12lf for a space separator\n", time.ut);
+
+    CHECK(Astronomy_ParseTime("-000044-03-15", &time));
+    if (time.ut != Astronomy_MakeTime(-44, 3, 15, 0, 0, 0.0).ut)
+        FFAIL("parsed ut=%0.12lf for a negative year\n", time.ut);
+
+    CHECK(Astronomy_ParseTime("2024-02-29T00:00:00Z", &time));
+
+    for (i = 0; i < (int)(sizeof(bad) / sizeof(bad[0])); ++i)
+        if (Astronomy_ParseTime(bad[i], &time) != ASTRO_INVALID_PARAMETER || !isnan(time.ut))
+            FFAIL("expected ASTRO_INVALID_PARAMETER for '%s'\n", bad[i]);
+
+    times[0].ut = 1.0e+9;
+    if (Astronomy_FormatTimeBatch(times, 2, TIME_FORMAT_DAY, text) != ASTRO_BAD_TIME || text[0] != '\0' || text[TIME_TEXT_BYTES] == '\0')
+        FFAIL("expected ASTRO_BAD_TIME for a year out of range\n");
+
+    times[0].ut = -2.46e+6;     /* before the year -4713 */
+    if (Astronomy_FormatTime(times[0], TIME_FORMAT_DAY, text, TIME_TEXT_BYTES) != ASTRO_BAD_TIME)
+        FFAIL("expected ASTRO_BAD_TIME for a time before the year -4713\n");
+
+    FPASSA("max round trip error = %0.3le seconds\n", maxdiff);
+fail:
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int SameIllum(const char *name, int i, astro_illum_t a, astro_illum_t b)
+{
+    if (a.status != b.status || a.time.tt != b.time.tt || a.mag != b.mag || a.phase_angle != b.phase_angle ||
+        a.phase_fraction != b.phase_fraction || a.helio_dist != b.helio_dist || a.ring_tilt != b.ring_tilt)
+    {
+        printf("C IlluminationBatchTest(%s #%d): status %d/%d, mag %0.16lf/%0.16lf, phase %0.16lf/%0.16lf, helio_dist %0.16lf/%0.16lf\n",
+            name, i, (int)a.status, (int)b.status, a.mag, b.mag, a.phase_angle, b.phase_angle, a.helio_dist, b.helio_dist);
+        return 0;
+    }
+    return 1;
+}
+
+static int IlluminationBatchTest(void)
+{
+    static const astro_body_t bodies[] =
+    {
+        BODY_SUN, BODY_MOON, BODY_MERCURY, BODY_VENUS, BODY_MARS,
+        BODY_JUPITER, BODY_SATURN, BODY_URANUS, BODY_NEPTUNE, BODY_PLUTO
+    };
+    enum { NBODIES = sizeof(bodies) / sizeof(bodies[0]), NTIMES = 201 };
+    static astro_time_t times[NTIMES];
+    static astro_illum_t illum[NTIMES];
+    astro_illum_t each[NBODIES];
+    astro_illum_t expected;
+    int error = 1;
+    int i, b;
+
+    for (i = 0; i < NTIMES; ++i)
+        times[i] = Astronomy_TimeFromDays(-20000.0 + 197.3*i + 0.61*(i % 5));
+
+    for (b = 0; b < NBODIES; ++b)
+    {
+        const char *name = Astronomy_BodyName(bodies[b]);
+        CHECK(Astronomy_IlluminationBatch(bodies[b], times, NTIMES, illum));
+        for (i = 0; i < NTIMES; ++i)
+        {
+            expected = Astronomy_Illumination(bodies[b], times[i]);
+            CHECK_STATUS(expected);
+            if (!SameIllum(name, i, illum[i], expected))
+                FFAIL("batch result differs from Astronomy_Illumination.\n");
+        }
+    }
+
+    for (i = 0; i < NTIMES; i += 10)
+    {
+        CHECK(Astronomy_IlluminationBodies(bodies, NBODIES, times[i], each));
+        for (b = 0; b < NBODIES; ++b)
+        {
+            expected = Astronomy_Illumination(bodies[b], times[i]);
+            if (!SameIllum(Astronomy_BodyName(bodies[b]), i, each[b], expected))
+                FFAIL("Astronomy_IlluminationBodies result differs from Astronomy_Illumination.\n");
+        }
+    }
+
+    if (Astronomy_IlluminationBatch(BODY_EARTH, times, NTIMES, illum) != ASTRO_EARTH_NOT_ALLOWED)
+        FFAIL("expected ASTRO_EARTH_NOT_ALLOWED for the Earth.\n");
+
+    if (Astronomy_IlluminationBatch(BODY_VENUS, NULL, NTIMES, illum) != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for NULL times.\n");
+
+    if (Astronomy_IlluminationBodies(bodies, NBODIES, times[0], NULL) != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for NULL output.\n");
+
+    FPASSA("%d bodies, %d times\n", (int)NBODIES, (int)NTIMES);
+fail:
+    Astronomy_Reset();
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int MoonGeometryTest(void)
+{
+    int error = 1;
+    int i;
+    astro_time_t time;
+    astro_moon_geometry_t geo;
+    astro_vector_t vec;
+    astro_spherical_t ecl;
+    astro_libration_t lib;
+    astro_illum_t illum;
+
+    for (i = 0; i < 500; ++i)
+    {
+        time = Astronomy_TimeFromDays(-30000.0 + 123.45*i);
+        geo = Astronomy_MoonGeometry(time, MOON_GEOMETRY_ALL);
+        CHECK_STATUS(geo);
+
+        vec = Astronomy_GeoMoon(time);
+        ecl = Astronomy_EclipticGeoMoon(time);
+        lib = Astronomy_Libration(time);
+        illum = Astronomy_Illumination(BODY_MOON, time);
+
+        if (geo.vec.status != vec.status || geo.vec.x != vec.x || geo.vec.y != vec.y || geo.vec.z != vec.z)
+            FFAIL("#%d: vector differs from Astronomy_GeoMoon.\n", i);
+
+        if (geo.ecliptic.status != ecl.status || geo.ecliptic.lat != ecl.lat || geo.ecliptic.lon != ecl.lon || geo.ecliptic.dist != ecl.dist)
+            FFAIL("#%d: ecliptic coordinates differ from Astronomy_EclipticGeoMoon.\n", i);
+
+        if (geo.libration.elat != lib.elat || geo.libration.elon != lib.elon || geo.libration.mlat != lib.mlat ||
+            geo.libration.mlon != lib.mlon || geo.libration.dist_km != lib.dist_km || geo.libration.diam_deg != lib.diam_deg)
+            FFAIL("#%d: libration differs from Astronomy_Libration.\n", i);
+
+        if (geo.illum.status != illum.status || geo.illum.mag != illum.mag || geo.illum.phase_angle != illum.phase_angle ||
+            geo.illum.phase_fraction != illum.phase_fraction || geo.illum.helio_dist != illum.helio_dist)
+            FFAIL("#%d: illumination differs from Astronomy_Illumination.\n", i);
+    }
+
+    geo = Astronomy_MoonGeometry(time, MOON_GEOMETRY_LIBRATION);
+    CHECK_STATUS(geo);
+    if (geo.vec.status != ASTRO_NOT_INITIALIZED || geo.ecliptic.status != ASTRO_NOT_INITIALIZED || geo.illum.status != ASTRO_NOT_INITIALIZED)
+        FFAIL("fields that were not requested should have status ASTRO_NOT_INITIALIZED.\n");
+    if (geo.libration.diam_deg != lib.diam_deg)
+        FFAIL("libration-only diameter differs.\n");
+
+    geo = Astronomy_MoonGeometry(time, MOON_GEOMETRY_ILLUMINATION);
+    CHECK_STATUS(geo);
+    if (geo.vec.status != ASTRO_NOT_INITIALIZED || geo.illum.mag != illum.mag)
+        FFAIL("illumination-only result is wrong.\n");
+
+    geo = Astronomy_MoonGeometry(time, 0x100);
+    if (geo.status != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for unknown flags, but found %d.\n", (int)geo.status);
+
+    FPASS();
+fail:
+    return error;
+}
+
+/*-----------------------------------------------------------------------------------------------------------*/
+
+static int RiseSetSequenceCase(astro_body_t body, double latitude, astro_direction_t direction, int *seqCalls, int *fullCalls)
+{
+    extern int _AltitudeDiffCallCount;
+    const int NEVENTS = 200;
+    int error = 1;
+    int i, calls;
+    astro_rise_set_sequence_t *seq = NULL;
+    astro_observer_t observer = Astronomy_MakeObserver(latitude, -75.0, 0.0);
+    astro_time_t start = Astronomy_MakeTime(2025, 1, 1, 5, 0, 0.0);
+    astro_search_result_t expected, result;
+    double diff, maxdiff = 0.0;
+
+    CHECK(Astronomy_RiseSetSequenceInit(&seq, body, observer, direction, start));
+    *seqCalls = *fullCalls = 0;
+    for (i = 0; i < NEVENTS; ++i)
+    {
+        calls = _AltitudeDiffCallCount;
+        expected = Astronomy_SearchRiseSet(body, observer, direction, start, 2.0);
+        *fullCalls += _AltitudeDiffCallCount - calls;
+
+        calls = _AltitudeDiffCallCount;
+        result = Astronomy_RiseSetSequenceNext(seq, 2.0);
+        *seqCalls += _AltitudeDiffCallCount - calls;
+
+        if (result.status != expected.status)
+            FFAIL("%s latitude %0.1lf direction %d event #%d: status %d, expected %d\n",
+                Astronomy_BodyName(body), latitude, (int)direction, i, (int)result.status, (int)expected.status);
+
+        if (expected.status == ASTRO_SUCCESS)
+        {
+            diff = SECONDS_PER_DAY * ABS(result.time.ut - expected.time.ut);
+            if (diff > maxdiff)
+                maxdiff = diff;
+            start = Astronomy_AddDays(expected.time, 1.0 / SECONDS_PER_DAY);
+        }
+        else if (expected.status == ASTRO_SEARCH_FAILURE)
+        {
+            start = Astronomy_AddDays(start, 2.0);
+        }
+        else
+        {
+            FFAIL("%s latitude %0.1lf event #%d: unexpected status %d\n", Astronomy_BodyName(body), latitude, i, (int)expected.status);
+        }
+    }
+
+    DEBUG("C RiseSetSequenceTest: %-7s latitude %5.1lf direction %+d: max diff = %0.3lf seconds, calls %d sequence, %d full\n",
+        Astronomy_BodyName(body), latitude, (int)direction, maxdiff, *seqCalls, *fullCalls);
+
+    /* Both searches have a tolerance of 0.1 second. */
+    if (maxdiff > 0.2)
+        FFAIL("%s latitude %0.1lf: excessive time difference %0.3lf seconds\n", Astronomy_BodyName(body), latitude, maxdiff);
+
+    error = 0;
+fail:
+    Astronomy_RiseSetSequenceFree(seq);
+    return error;
+}
+
+
+static int RiseSetSequenceTest(void)
+{
+    int error = 1;
+    int seqCalls, fullCalls;
+    astro_rise_set_sequence_t *seq = NULL;
+    astro_observer_t observer = Astronomy_MakeObserver(40.0, -75.0, 0.0);
+    astro_time_t start = Astronomy_MakeTime(2025, 1, 1, 5, 0, 0.0);
+    astro_search_result_t result;
+
+    /* At middle latitudes, the predictions should save most of the altitude calculations. */
+    CHECK(RiseSetSequenceCase(BODY_SUN, 40.0, DIRECTION_RISE, &seqCalls, &fullCalls));
+    if (3*seqCalls > fullCalls)
+        FFAIL("expected far fewer altitude calculations: %d sequence, %d full\n", seqCalls, fullCalls);
+
+    CHECK(RiseSetSequenceCase(BODY_MOON, -33.9, DIRECTION_SET, &seqCalls, &fullCalls));
+    CHECK(RiseSetSequenceCase(BODY_VENUS, 52.0, DIRECTION_SET, &seqCalls, &fullCalls));
+
+    /* Near the poles, many predictions fail and the sequence falls back to full searches. */
+    CHECK(RiseSetSequenceCase(BODY_SUN, 71.0, DIRECTION_SET, &seqCalls, &fullCalls));
+    CHECK(RiseSetSequenceCase(BODY_MOON, 67.0, DIRECTION_RISE, &seqCalls, &fullCalls));
+
+    if (Astronomy_RiseSetSequenceInit(&seq, BODY_EARTH, observer, DIRECTION_RISE, start) != ASTRO_EARTH_NOT_ALLOWED)
+        FFAIL("expected ASTRO_EARTH_NOT_ALLOWED\n");
+
+    if (seq != NULL)
+        FFAIL("expected NULL sequence after failure\n");
+
+    if (Astronomy_RiseSetSequenceInit(&seq, BODY_SUN, observer, (astro_direction_t)0, start) != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for invalid direction\n");
+
+    CHECK(Astronomy_RiseSetSequenceInit(&seq, BODY_SUN, observer, DIRECTION_RISE, start));
+    result = Astronomy_RiseSetSequenceNext(seq, -1.0);
+    if (result.status != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for negative limitDays, but found %d\n", (int)result.status);
+
+    FPASS();
+fail:
+    Astronomy_RiseSetSequenceFree(seq);
+    return error;
+}
+
+
+static int VectorObserverBatch(void)
+{
+    enum { NPOINTS = 5000 };
+    static double x[NPOINTS], y[NPOINTS], z[NPOINTS];
+    static astro_observer_t batch[NPOINTS];
+    int error, i, e;
+    astro_time_t time = Astronomy_MakeTime(2031, 6, 14, 3, 41, 27.0);
+    astro_vector_t vec;
+    astro_observer_t single;
+    astro_equator_date_t equdate;
+    double radius, dlon, maxLat, maxLon, maxHeight;
+    unsigned seed = 24680;
+
+    for (i = 0; i < NPOINTS; ++i)
+    {
+        seed = 1103515245u*seed + 12345u;
+        vec.x = 2.0 * (seed >> 8) / 16777216.0 - 1.0;
+        seed = 1103515245u*seed + 12345u;
+        vec.y = 2.0 * (seed >> 8) / 16777216.0 - 1.0;
+        seed = 1103515245u*seed + 12345u;
+        vec.z = 2.0 * (seed >> 8) / 16777216.0 - 1.0;
+        seed = 1103515245u*seed + 12345u;
+        if (i < NPOINTS/2)
+            radius = 6300.0 + 200.0 * (seed >> 8) / 16777216.0;     /* near the surface */
+        else
+            radius = 1000.0 + 400000.0 * pow((seed >> 8) / 16777216.0, 3.0);   /* deep inside out to lunar distance */
+        radius /= KM_PER_AU * sqrt(vec.x*vec.x + vec.y*vec.y + vec.z*vec.z);
+        x[i] = radius * vec.x;
+        y[i] = radius * vec.y;
+        z[i] = radius * vec.z;
+    }
+
+    /* Points on the axis and at the center exercise the iterative fallback. */
+    x[0] = y[0] = 0.0;  z[0] = 6400.0 / KM_PER_AU;
+    x[1] = y[1] = 0.0;  z[1] = -6300.0 / KM_PER_AU;
+    x[2] = y[2] = z[2] = 0.0;
+
+    for (e = 0; e < 2; ++e)
+    {
+        equdate = e ? EQUATOR_OF_DATE : EQUATOR_J2000;
+        CHECK(Astronomy_VectorObserverBatch(&time, equdate, NPOINTS, x, y, z, batch));
+
+        maxLat = maxLon = maxHeight = 0.0;
+        for (i = 0; i < NPOINTS; ++i)
+        {
+            vec.status = ASTRO_SUCCESS;
+            vec.t = time;
+            vec.x = x[i];
+            vec.y = y[i];
+            vec.z = z[i];
+            single = Astronomy_VectorObserver(&vec, equdate);
+
+            dlon = fabs(single.longitude - batch[i].longitude);
+            if (dlon > 180.0)
+                dlon = 360.0 - dlon;
+            dlon *= cos(DEG2RAD * single.latitude);
+            if (dlon > maxLon)
+                maxLon = dlon;
+            if (fabs(single.latitude - batch[i].latitude) > maxLat)
+                maxLat = fabs(single.latitude - batch[i].latitude);
+            if (fabs(single.height - batch[i].height) > maxHeight)
+                maxHeight = fabs(single.height - batch[i].height);
+
+            if (!(batch[i].longitude > -180.0 && batch[i].longitude <= +180.0))
+                FFAIL("equdate %d, point %d: longitude out of range: %lf\n", e, i, batch[i].longitude);
+        }
+
+        DEBUG("C VectorObserverBatch: equdate %d: maxLat = %0.3le deg, maxLon = %0.3le deg, maxHeight = %0.3le m\n", e, maxLat, maxLon, maxHeight);
+        if (maxLat > 2.0e-9 || maxLon > 2.0e-9)
+            FFAIL("equdate %d: excessive angular error: lat = %le, lon = %le\n", e, maxLat, maxLon);
+        if (maxHeight > 1.0e-4)
+            FFAIL("equdate %d: excessive height error: %le meters\n", e, maxHeight);
+    }
+
+    if (Astronomy_VectorObserverBatch(&time, (astro_equator_date_t)3, NPOINTS, x, y, z, batch) != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for invalid equdate\n");
+
+    if (Astronomy_VectorObserverBatch(&time, EQUATOR_J2000, NPOINTS, x, y, NULL, batch) != ASTRO_INVALID_PARAMETER)
+        FFAIL("expected ASTRO_INVALID_PARAMETER for NULL array\n");
+
+    FPASS();
+fail:
+    return error;
+}
@@ -35,6 +35,7 @@ int EphFileOpen(eph_file_reader_t *reader, const char *filename)
     char *value;
 
     memset(reader, 0, sizeof(eph_file_reader_t));
+    reader->current = -1;
     reader->infile = fopen(filename, "rt");
     if (reader->infile == NULL)
         return 1;   /* cannot open file */
@@ -46,7 +47,12 @@ int EphFileOpen(eph_file_reader_t *reader, const char *filename)
         /* parse "key=value" from line */
         for (key=line; *key != '\0' && isspace(*key); ++key);
         if (*key == '\0')
-            return 0;   /* found end of header */
+        {
+            /* found end of header */
+            reader->dataOffset = ftell(reader->infile);
+            reader->dataLine = reader->lnum;
+            return 0;
+        }
 
         /* search for '=' separating key and value */
         for (value=key+1; *value != '\0' && *value != '='; ++value);
@@ -107,6 +113,151 @@ int EphReadRecord(eph_file_reader_t *reader, eph_record_t *record)
     return 1;   /* success */
 }
 
+static int EphBuildIndex(eph_file_reader_t *reader)
+{
+    int error = 0;
+    int capacity = 0;
+    long offset;
+    int lnum;
+    eph_index_entry_t *grow;
+    eph_index_entry_t *entry;
+    eph_record_t *record = &reader->record;
+
+    reader->nindex = 0;
+    reader->current = -1;
+    if (fseek(reader->infile, reader->dataOffset, SEEK_SET))
+    {
+        error = EPH_ERROR_IO;
+        goto fail;
+    }
+    reader->lnum = reader->dataLine;
+
+    for(;;)
+    {
+        offset = ftell(reader->infile);
+        lnum = reader->lnum;
+        if (!EphReadRecord(reader, record))
+            break;
+
+        if (record->jdDelta <= 0.0)
+        {
+            error = EPH_ERROR_ORDER;
+            goto fail;
+        }
+
+        if (reader->nindex > 0)
+        {
+            entry = &reader->index[reader->nindex - 1];
+            if (record->jdStart < entry->jdStart + entry->jdDelta)
+            {
+                error = EPH_ERROR_ORDER;
+                goto fail;
+            }
+        }
+
+        if (reader->nindex == capacity)
+        {
+            capacity = (capacity == 0) ? 1024 : 2*capacity;
+            grow = realloc(reader->index, (size_t)capacity * sizeof(eph_index_entry_t));
+            if (grow == NULL)
+            {
+                error = EPH_ERROR_IO;
+                goto fail;
+            }
+            reader->index = grow;
+        }
+
+        entry = &reader->index[reader->nindex++];
+        entry->jdStart = record->jdStart;
+        entry->jdDelta = record->jdDelta;
+        entry->offset = offset;
+        entry->lnum = lnum;
+    }
+
+    if (record->error)
+        error = record->error;
+    else if (reader->nindex == 0)
+        error = EPH_ERROR_EMPTY;
+
+fail:
+    /* Any failure leaves no index, so the next EphSeek tries again from scratch. */
+    if (error)
+        reader->nindex = 0;
+
+    return error;
+}
+
+/*
+    Loads the record whose time span contains jd into reader->record.
+    The first call reads the whole file once to build an index of where
+    each record starts. After that, each call does a binary search of the index
+    and reads only the one record it needs, or nothing at all if the record
+    is already loaded. Afterward, EphReadRecord continues with the next record.
+    Returns 0 on success, or an error code.
+*/
+int EphSeek(eph_file_reader_t *reader, double jd)
+{
+    int lo, hi, mid, error;
+    const eph_index_entry_t *entry;
+
+    if (reader->nindex == 0)
+    {
+        error = EphBuildIndex(reader);
+        if (error)
+            return error;
+    }
+
+    if (jd < reader->index[0].jdStart)
+        return EPH_ERROR_RANGE;
+
+    /* Find the last record that starts at or before jd. */
+    lo = 0;
+    hi = reader->nindex - 1;
+    while (lo < hi)
+    {
+        mid = (lo + hi + 1) / 2;
+        if (reader->index[mid].jdStart <= jd)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+
+    entry = &reader->index[lo];
+    if (jd > entry->jdStart + entry->jdDelta)
+        return EPH_ERROR_RANGE;     /* after the last record, or in a gap between records */
+
+    if (reader->current != lo)
+    {
+        reader->current = -1;
+        if (fseek(reader->infile, entry->offset, SEEK_SET))
+            return EPH_ERROR_IO;
+        reader->lnum = entry->lnum;
+        if (!EphReadRecord(reader, &reader->record))
+            return reader->record.error ? reader->record.error : EPH_ERROR_CHANGED;
+        reader->current = lo;
+    }
+
+    return 0;
+}
+
+/*
+    Calculates the position vector at the given time from
+    the Chebyshev polynomials in the record that contains it.
+    Returns 0 on success, or an error code from EphSeek.
+*/
+int EphEvaluate(eph_file_reader_t *reader, double jd, double pos[3])
+{
+    int error;
+    const eph_record_t *record = &reader->record;
+
+    error = EphSeek(reader, jd);
+    if (error)
+        return error;
+
+    ChebApprox(record->numpoly, 3, record->coeff, ChebScale(record->jdStart, record->jdStart + record->jdDelta, jd), pos);
+    return 0;
+}
+
 void EphFileClose(eph_file_reader_t *reader)
 {
     if (reader->infile)
@@ -114,4 +265,131 @@ void EphFileClose(eph_file_reader_t *reader)
         fclose(reader->infile);
         reader->infile = NULL;
     }
+    free(reader->index);
+    reader->index = NULL;
+    reader->nindex = 0;
+    reader->current = -1;
+}
+
+int EphWriteBinary(const char *inFileName, const char *outFileName)
+{
+    int error, k;
+    eph_file_reader_t reader;
+    eph_record_t record;
+    eph_binary_header_t header;
+    double index[2];
+    double prevStop = 0.0;
+    double coeff[3][CHEB_MAX_POLYS];
+    FILE *outfile = NULL;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, EPH_BINARY_MAGIC, sizeof(header.magic));
+    header.byte_order = EPH_BINARY_BYTE_ORDER;
+    header.version = EPH_BINARY_VERSION;
+
+    /* The first pass counts the records and finds the largest number of polynomials. */
+    error = EphFileOpen(&reader, inFileName);
+    if (error)
+    {
+        fprintf(stderr, "EphWriteBinary: error %d opening input file: %s\n", error, inFileName);
+        return error;
+    }
+    header.body = reader.body;
+
+    while (EphReadRecord(&reader, &record))
+    {
+        if (record.jdDelta <= 0.0 || (header.nsegs > 0 && record.jdStart < prevStop))
+        {
+            fprintf(stderr, "EphWriteBinary(%s line %d): records must have positive duration and be in ascending order.\n", inFileName, reader.lnum);
+            error = 5;
+            goto fail;
+        }
+        prevStop = record.jdStart + record.jdDelta;
+        if (record.numpoly > header.numpoly)
+            header.numpoly = record.numpoly;
+        ++header.nsegs;
+    }
+
+    if (record.error)
+    {
+        fprintf(stderr, "EphWriteBinary(%s line %d): error %d reading record.\n", inFileName, reader.lnum, record.error);
+        error = record.error;
+        goto fail;
+    }
+
+    if (header.nsegs == 0)
+    {
+        fprintf(stderr, "EphWriteBinary: no records found in file: %s\n", inFileName);
+        error = 6;
+        goto fail;
+    }
+    EphFileClose(&reader);
+
+    outfile = fopen(outFileName, "wb");
+    if (outfile == NULL)
+    {
+        fprintf(stderr, "EphWriteBinary: cannot open output file: %s\n", outFileName);
+        error = 7;
+        goto fail;
+    }
+
+    if (1 != fwrite(&header, sizeof(header), 1, outfile))
+        goto write_error;
+
+    /* The second pass writes the segment index. */
+    if (EphFileOpen(&reader, inFileName))
+        goto read_error;
+
+    while (EphReadRecord(&reader, &record))
+    {
+        index[0] = record.jdStart - 2451545.0;
+        index[1] = record.jdDelta;
+        if (1 != fwrite(index, sizeof(index), 1, outfile))
+            goto write_error;
+    }
+    EphFileClose(&reader);
+
+    /* The third pass writes the coefficients, padded with zeros to a uniform record size. */
+    if (EphFileOpen(&reader, inFileName))
+        goto read_error;
+
+    while (EphReadRecord(&reader, &record))
+    {
+        memset(coeff, 0, sizeof(coeff));
+        for (k=0; k < record.numpoly; ++k)
+        {
+            coeff[0][k] = record.coeff[0][k];
+            coeff[1][k] = record.coeff[1][k];
+            coeff[2][k] = record.coeff[2][k];
+        }
+        for (k=0; k < 3; ++k)
+            if ((size_t)header.numpoly != fwrite(coeff[k], sizeof(double), (size_t)header.numpoly, outfile))
+                goto write_error;
+    }
+
+    if (fclose(outfile))
+    {
+        outfile = NULL;
+        goto write_error;
+    }
+    outfile = NULL;
+
+    printf("EphWriteBinary: wrote %d segments of %d polynomials to %s\n", header.nsegs, header.numpoly, outFileName);
+    error = 0;
+    goto fail;
+
+read_error:
+    fprintf(stderr, "EphWriteBinary: error re-reading input file: %s\n", inFileName);
+    error = 8;
+    goto fail;
+
+write_error:
+    fprintf(stderr, "EphWriteBinary: error writing output file: %s\n", outFileName);
+    error = 9;
+
+fail:
+    EphFileClose(&reader);
+    if (outfile != NULL)
+        fclose(outfile);
+    return error;
 }
@@ -25,16 +25,9 @@
 #define __DDC_EPH_READER
 
 #include <stdio.h>
+#include <stdint.h>
 #include "chebyshev.h"
 
-typedef struct
-{
-    FILE *infile;
-    int lnum;
-    int body;
-}
-eph_file_reader_t;
-
 typedef struct
 {
     int error;
@@ -45,8 +38,70 @@ typedef struct
 }
 eph_record_t;
 
+/* Where one record starts in the text file, so EphSeek can go straight to it. */
+typedef struct
+{
+    double jdStart;
+    double jdDelta;
+    long offset;
+    int lnum;
+}
+eph_index_entry_t;
+
+typedef struct
+{
+    FILE *infile;
+    int lnum;
+    int body;
+    long dataOffset;            /* file offset of the first record, just after the header */
+    int dataLine;               /* number of lines in the header */
+    int nindex;                 /* number of records in index[], once it has been built */
+    eph_index_entry_t *index;   /* built by the first call to EphSeek */
+    int current;                /* which record is loaded in 'record', or -1 */
+    eph_record_t record;
+}
+eph_file_reader_t;
+
 int EphFileOpen(eph_file_reader_t *reader, const char *filename);
 int EphReadRecord(eph_file_reader_t *reader, eph_record_t *record);
+int EphSeek(eph_file_reader_t *reader, double jd);
+int EphEvaluate(eph_file_reader_t *reader, double jd, double pos[3]);
 void EphFileClose(eph_file_reader_t *reader);
 
+/* Error codes returned by EphSeek and EphEvaluate, besides the eph_record_t error codes 1..4. */
+#define EPH_ERROR_ORDER         5   /* records overlap or are not in ascending order */
+#define EPH_ERROR_EMPTY         6   /* the file contains no records */
+#define EPH_ERROR_RANGE         7   /* jd is not inside any record */
+#define EPH_ERROR_IO            8   /* memory allocation or file positioning failed */
+#define EPH_ERROR_CHANGED       9   /* an indexed record is no longer where the index says it is */
+
+/*
+    Binary ephemeris files are read by Astronomy_EphemFileOpen in astronomy.c.
+    All values are stored in the native byte order of the producing machine:
+
+        header          eph_binary_header_t (40 bytes)
+        index           double[nsegs][2] = {tt, dt}: segment start [TT days since J2000] and duration [days]
+        coefficients    double[nsegs][3][numpoly]
+
+    Segments are sorted by start time and do not overlap.
+    Records with fewer than 'numpoly' polynomials are padded with zero coefficients.
+*/
+#define EPH_BINARY_MAGIC        "AEPHBIN1"
+#define EPH_BINARY_BYTE_ORDER   0x01020304
+#define EPH_BINARY_VERSION      1
+
+typedef struct
+{
+    char    magic[8];
+    int32_t byte_order;
+    int32_t version;
+    int32_t body;
+    int32_t numpoly;
+    int32_t nsegs;
+    int32_t reserved[3];
+}
+eph_binary_header_t;
+
+int EphWriteBinary(const char *inFileName, const char *outFileName);
+
 #endif /* __DDC_EPH_READER */
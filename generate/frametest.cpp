@@ -0,0 +1,158 @@
+/*
+    frametest.cpp  -  Don Cross <cosinekitty@gmail.com>
+
+    Unit tests for the C++17 typed-frame layer in astronomy_frames.hpp.
+    The results must agree with the C rotation functions in astronomy.h.
+
+    Building with -DFRAMETEST_MISMATCH must fail to compile,
+    because it tries to rotate a vector that is in the wrong frame.
+*/
+
+#include <stdio.h>
+#include <math.h>
+#include "astronomy_frames.hpp"
+
+using namespace astronomy;
+
+#define CHECK(x)        do{if(0 != (error = (x))) goto fail;}while(0)
+#define FFAIL(...)      do{printf("C++ %s: ", __func__); printf(__VA_ARGS__); error = 1; goto fail;}while(0)
+#define FPASS()         do{printf("C++ %s: PASS\n", __func__); error = 0;}while(0)
+
+/* The composite constant rotations must be usable at compile time. */
+constexpr Rotation<GAL, ECL> ECL_GAL = ConstantRotation<GAL, ECL>();
+constexpr Rotation<ECL, GAL> GAL_ECL = ConstantRotation<ECL, GAL>();
+constexpr Vector<GAL> ECL_POLE_GAL = ECL_GAL * Vector<ECL> { 0.0, 0.0, 1.0 };
+static_assert(ECL_POLE_GAL.z > 0.0 && ECL_POLE_GAL.z < 1.0, "ecliptic pole must be north of the galactic plane");
+static_assert(ConstantRotation<EQJ, EQJ>().rot[1][1] == 1.0, "identity rotation");
+
+#ifdef FRAMETEST_MISMATCH
+constexpr Vector<GAL> MISMATCH = ECL_GAL * Vector<EQJ> { 0.0, 0.0, 1.0 };
+#endif
+
+
+static double MatrixDiff(const astro_rotation_t &a, const astro_rotation_t &b)
+{
+    double diff = 0.0;
+    int i, j;
+
+    for (i = 0; i < 3; ++i)
+        for (j = 0; j < 3; ++j)
+            diff = fmax(diff, fabs(a.rot[i][j] - b.rot[i][j]));
+    return diff;
+}
+
+
+template <FrameTag To, FrameTag From>
+static int CompareRotation(const char *name, const Rotation<To, From> &typed, astro_rotation_t expected, double tolerance)
+{
+    double diff;
+
+    if (expected.status != ASTRO_SUCCESS)
+    {
+        printf("C++ CompareRotation(%s): expected rotation has status %d\n", name, expected.status);
+        return 1;
+    }
+
+    diff = MatrixDiff(typed.ToC(), expected);
+    if (diff > tolerance)
+    {
+        printf("C++ CompareRotation(%s): EXCESSIVE diff = %lg\n", name, diff);
+        return 1;
+    }
+    return 0;
+}
+
+
+static int ConstantTest(void)
+{
+    int error;
+
+    CHECK(CompareRotation("EQJ_ECL", ConstantRotation<ECL, EQJ>(), Astronomy_Rotation_EQJ_ECL(), 0.0));
+    CHECK(CompareRotation("ECL_EQJ", ConstantRotation<EQJ, ECL>(), Astronomy_Rotation_ECL_EQJ(), 0.0));
+    CHECK(CompareRotation("EQJ_GAL", ConstantRotation<GAL, EQJ>(), Astronomy_Rotation_EQJ_GAL(), 0.0));
+    CHECK(CompareRotation("GAL_EQJ", ConstantRotation<EQJ, GAL>(), Astronomy_Rotation_GAL_EQJ(), 0.0));
+    CHECK(CompareRotation("ECL_GAL", ECL_GAL, Astronomy_CombineRotation(Astronomy_Rotation_ECL_EQJ(), Astronomy_Rotation_EQJ_GAL()), 1.0e-15));
+    CHECK(CompareRotation("GAL_ECL", GAL_ECL, Astronomy_CombineRotation(Astronomy_Rotation_GAL_EQJ(), Astronomy_Rotation_EQJ_ECL()), 1.0e-15));
+
+    FPASS();
+fail:
+    return error;
+}
+
+
+static int TimeTest(void)
+{
+    int error;
+    astro_time_t time = Astronomy_MakeTime(2026, 10, 14, 3, 30, 0.0);
+    astro_observer_t observer = Astronomy_MakeObserver(35.0, -77.0, 100.0);
+    Rotation<HOR, EQJ> eqj_hor;
+    Rotation<HOR, ECL> ecl_hor;
+    Rotation<GAL, HOR> hor_gal;
+    Rotation<ECT, EQD> eqd_ect;
+    Rotation<ECL, ECT> ect_ecl;
+
+    CHECK(MakeRotation(eqj_hor, &time, observer));
+    CHECK(CompareRotation("EQJ_HOR", eqj_hor, Astronomy_Rotation_EQJ_HOR(&time, observer), 0.0));
+
+    CHECK(MakeRotation(ecl_hor, &time, observer));
+    CHECK(CompareRotation("ECL_HOR", ecl_hor, Astronomy_Rotation_ECL_HOR(&time, observer), 0.0));
+
+    CHECK(MakeRotation(hor_gal, &time, observer));
+    CHECK(CompareRotation("HOR_GAL", hor_gal, Astronomy_CombineRotation(Astronomy_Rotation_HOR_EQJ(&time, observer), Astronomy_Rotation_EQJ_GAL()), 1.0e-15));
+
+    CHECK(MakeRotation(eqd_ect, &time));
+    CHECK(CompareRotation("EQD_ECT", eqd_ect, Astronomy_Rotation_EQD_ECT(&time), 0.0));
+
+    CHECK(MakeRotation(ect_ecl, &time));
+    CHECK(CompareRotation("ECT_ECL", ect_ecl, Astronomy_CombineRotation(Astronomy_Rotation_ECT_EQJ(&time), Astronomy_Rotation_EQJ_ECL()), 1.0e-15));
+
+    FPASS();
+fail:
+    return error;
+}
+
+
+static int VectorTest(void)
+{
+    enum { COUNT = 50 };
+    int error, i;
+    astro_time_t time = Astronomy_MakeTime(2026, 10, 14, 3, 30, 0.0);
+    astro_observer_t observer = Astronomy_MakeObserver(-33.9, 18.4, 10.0);
+    astro_rotation_t crot;
+    astro_vector_t cvec, expected;
+    Rotation<HOR, GAL> gal_hor;
+    Vector<GAL> input[COUNT];
+    Vector<HOR> output[COUNT];
+
+    CHECK(MakeRotation(gal_hor, &time, observer));
+    crot = gal_hor.ToC();
+
+    for (i = 0; i < COUNT; ++i)
+        input[i] = Vector<GAL> { cos(0.3*i), sin(0.7*i), 0.01*i - 0.25 };
+
+    Rotate(gal_hor, COUNT, input, output);
+
+    for (i = 0; i < COUNT; ++i)
+    {
+        cvec.status = ASTRO_SUCCESS;
+        cvec.t = time;
+        cvec.x = input[i].x;
+        cvec.y = input[i].y;
+        cvec.z = input[i].z;
+        expected = Astronomy_RotateVector(crot, cvec);
+        if (output[i].x != expected.x || output[i].y != expected.y || output[i].z != expected.z)
+            FFAIL("vector %d does not match Astronomy_RotateVector.\n", i);
+    }
+
+    FPASS();
+fail:
+    return error;
+}
+
+
+int main()
+{
+    if (ConstantTest() || TimeTest() || VectorTest())
+        return 1;
+    return 0;
+}
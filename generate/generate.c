@@ -28,8 +28,11 @@
 #ifdef _WIN32
 #include <io.h>
 #define unlink _unlink
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
 #else
 #include <unistd.h>
+#include <pthread.h>
 #endif
 
 #include "eph_manager.h"
@@ -43,6 +46,7 @@
 #include "novas_body.h"
 #include "vsop.h"
 #include "top2013.h"
+#include "textfile.h"
 
 const double PLUTO_TOLERANCE_ARCMIN = 1.4;
 
@@ -69,6 +73,46 @@ typedef struct
 }
 sample_context_t;
 
+/*
+    The NOVAS positions that every truncated VSOP model for a body is compared against.
+    They do not depend on the truncation threshold, so SearchVsop calculates them
+    once per body instead of once per candidate model.
+*/
+typedef struct
+{
+    int body;
+    int count;
+    double jdStart;
+    double jdStop;
+    double *jd;
+    double (*npos)[3];      /* NOVAS heliocentric position of the body */
+    double (*epos)[3];      /* NOVAS position of the EMB, the vantage point for measuring angular error */
+}
+vsop_reference_t;
+
+/* One thread's share of the NOVAS samples to be calculated for a vsop_reference_t. */
+typedef struct
+{
+    vsop_reference_t *ref;
+    int start;
+    int stop;
+    int error;
+}
+vsop_reference_work_t;
+
+/* One thread's share of the sample dates in a vsop_reference_t. */
+typedef struct
+{
+    const vsop_model_t *model;
+    const vsop_reference_t *ref;
+    int start;
+    int stop;
+    double max_arcmin;
+}
+vsop_test_work_t;
+
+#define MAX_WORKER_THREADS 64
+
 static double jd_begin;
 static double jd_end;
 static short int de_number;
@@ -81,21 +125,31 @@ static int TopCalc(const char *name, const char *date);
 static int GenerateApsisTestData(void);
 static int OptimizeJupiterMoons(const char *inFileName, const char *outFileName);
 static int GenerateSource(void);
-static int TestVsopModel(vsop_model_t *model, int body, double threshold, double *max_arcmin, int *trunc_terms);
+static int TestVsopModel(vsop_model_t *model, const vsop_reference_t *ref, double threshold, double *max_arcmin, int *trunc_terms);
+static int LoadVsopReference(vsop_reference_t *ref, int body);
+static void VsopReferenceWorker(void *item);
+static void FreeVsopReference(vsop_reference_t *ref);
+static int WorkerThreadCount(void);
+static int RunWorkers(int count, void *items, size_t item_size, void (*func)(void *item));
 static int SaveVsopFile(const vsop_model_t *model);
 static int PositionArcminError(int body, double jd, const double a[3], const double b[3], double *arcmin);
+static double EmbArcminError(const double a[3], const double b[3]);
+static double ArcminSeenFrom(const double a[3], const double b[3], const double epos[3]);
 static double VectorLength(const double v[3]);
 static int CheckTestOutput(const char *filename);
 static vsop_body_t LookupBody(const char *name);
-static int CheckSkyPos(observer *location, const char *filename, int lnum, const char *line, double *arcmin_equ, double *arcmin_hor, vsop_body_t *body);
+static int CheckSkyPos(observer *location, const char *filename, int lnum, const text_line_t *line, double *arcmin_equ, double *arcmin_hor, vsop_body_t *body);
 static int UnitTestChebyshev(void);
 static int DistancePlot(const char *name, double tt1, double tt2);
 static int ImproveVsopApsides(vsop_model_t *model);
 static int DeltaTimePlot(const char *outFileName);
 static int TopFileInfo(const char *filename, const char *name);
+static int PlutoSeries(const char *millenniaText, const char *arcminText, const char *outFileName);
 static int ValidateTop2013(void);
 static int Diff(const char *filename1, const char *filename2, int *nlines);
 static int GenerateGalEqjTestData(const char *outFileName);
+static int EphCalc(const char *filename, int count, const char *jdlist[]);
+static int UnitTestEphSeek(void);
 
 #define MOON_PERIGEE        0.00238
 #define MERCURY_APHELION    0.466697
@@ -173,9 +227,21 @@ int main(int argc, const char *argv[])
     if (argc == 4 && !strcmp(argv[1], "topinfo"))
         return TopFileInfo(argv[2], argv[3]);
 
+    if (argc == 5 && !strcmp(argv[1], "plutoseries"))
+        return PlutoSeries(argv[2], argv[3], argv[4]);
+
     if (argc == 3 && !strcmp(argv[1], "galeqj"))
         return GenerateGalEqjTestData(argv[2]);
 
+    if (argc == 4 && !strcmp(argv[1], "ephbin"))
+        return EphWriteBinary(argv[2], argv[3]);
+
+    if (argc >= 4 && !strcmp(argv[1], "ephcalc"))
+        return EphCalc(argv[2], argc-3, argv+3);
+
+    if (argc == 2 && !strcmp(argv[1], "ephseek"))
+        return UnitTestEphSeek();
+
     return PrintUsage();
 }
 
@@ -215,10 +281,26 @@ static int PrintUsage(void)
         "generate topinfo filename planet\n"
         "    Prints summary info about the TOP2013 file.\n"
         "\n"
+        "generate plutoseries millennia arcmin outfile.txt\n"
+        "    Write the fewest TOP2013 terms for Pluto that stay within\n"
+        "    arcmin of the full theory for the given number of millennia\n"
+        "    before and after the year 2000, for Astronomy_PlutoSeriesLoad.\n"
+        "\n"
         "generate galeqj outfile.txt\n"
         "    Generate test data to validate conversion between\n"
         "    galatic coordinates (GAL) and equatorial J2000 (EQJ).\n"
         "\n"
+        "generate ephbin infile.txt outfile.bin\n"
+        "    Convert a text Chebyshev ephemeris file into the binary,\n"
+        "    indexed format read by Astronomy_EphemFileOpen.\n"
+        "\n"
+        "generate ephcalc infile.txt jd [jd ...]\n"
+        "    Print the position vector at each Julian date,\n"
+        "    evaluated from a text Chebyshev ephemeris file.\n"
+        "\n"
+        "generate ephseek\n"
+        "    Run unit test on indexed seeking in text Chebyshev ephemeris files.\n"
+        "\n"
     );
 
     return 1;
@@ -361,14 +443,20 @@ static int SearchVsop(int body)
     double winner_threshold = 0.0;
     double winner_arcmin = -1.0;
     vsop_model_t model;
+    vsop_reference_t ref;
+
+    memset(&ref, 0, sizeof(ref));
 
     error = LoadVsopFile(&model, body);
     if (error) goto fail;
 
+    error = LoadVsopReference(&ref, body);
+    if (error) goto fail;
+
     while (thresh_hi / thresh_lo > 1.000001)
     {
         threshold = sqrt(thresh_lo * thresh_hi);
-        error = TestVsopModel(&model, body, threshold, &max_arcmin, &trunc_terms);
+        error = TestVsopModel(&model, &ref, threshold, &max_arcmin, &trunc_terms);
         if (error) goto fail;
 
         if (max_arcmin >= arcmin_limit)
@@ -407,6 +495,7 @@ static int SearchVsop(int body)
     fflush(stdout);
 
 fail:
+    FreeVsopReference(&ref);
     VsopFreeModel(&model);
     return error;
 }
@@ -419,51 +508,266 @@ static int SaveVsopFile(const vsop_model_t *model)
     return VsopWriteTrunc(model, filename);
 }
 
-static int TestVsopModel(vsop_model_t *model, int body, double threshold, double *max_arcmin, int *trunc_terms)
+static void VsopReferenceWorker(void *item)
 {
-    int error;
-    double jdStart, jdStop, jd, jdDelta;
-    double vpos[VSOP_MAX_COORDS];
-    double npos[3];
-    double arcmin;
+    vsop_reference_work_t *work = item;
+    vsop_reference_t *ref = work->ref;
+    double jd, jed[2], evel[3];
+    int i;
 
-    *max_arcmin = -1.0;
-    *trunc_terms = -1;
+    for (i = work->start; i < work->stop; ++i)
+    {
+        /* Adding whole days to a half-integer Julian date is exact, so threads agree with a serial loop. */
+        jd = ref->jd[i] = ref->jdStart + i;
+        if (ref->body == BODY_EMB)
+        {
+            work->error = NovasEarth(jd, ref->npos[i]);
+            if (work->error) return;
+        }
+        else
+        {
+            work->error = NovasBodyPos(jd, ref->body, ref->npos[i]);
+            if (work->error) return;
+            jed[0] = jd;
+            jed[1] = 0.0;
+            work->error = state(jed, BODY_EMB, ref->epos[i], evel);
+            if (work->error) return;
+        }
+    }
+}
+
+static int LoadVsopReference(vsop_reference_t *ref, int body)
+{
+    int error, t, nthreads;
+    double jd;
+    vsop_reference_work_t work[MAX_WORKER_THREADS];
+
+    memset(ref, 0, sizeof(*ref));
 
     if (body < 0 || body > 7)
     {
-        fprintf(stderr, "TestVsopFile: Invalid body %d\n", body);
+        fprintf(stderr, "LoadVsopReference: Invalid body %d\n", body);
         error = 1;
         goto fail;
     }
 
-    jdStart = julian_date(MIN_YEAR, 1, 1, 0.0);
-    jdStop = julian_date(MAX_YEAR, 1, 1, 0.0);
-    jdDelta = 1.0;
+    ref->body = body;
+    ref->jdStart = julian_date(MIN_YEAR, 1, 1, 0.0);
+    ref->jdStop = julian_date(MAX_YEAR, 1, 1, 0.0);
+
+    for (jd = ref->jdStart; jd <= ref->jdStop; jd += 1.0)
+        ++ref->count;
+
+    ref->jd = calloc((size_t)ref->count, sizeof(ref->jd[0]));
+    ref->npos = calloc((size_t)ref->count, sizeof(ref->npos[0]));
+    ref->epos = calloc((size_t)ref->count, sizeof(ref->epos[0]));
+    if (ref->jd == NULL || ref->npos == NULL || ref->epos == NULL)
+        FAIL("LoadVsopReference: out of memory for %d samples\n", ref->count);
+
+    /*
+        The NOVAS ephemeris reader is thread-safe only when
+        it has memory-mapped the ephemeris file.
+        Otherwise the samples are calculated serially.
+    */
+    nthreads = (EPHMAP != NULL) ? WorkerThreadCount() : 1;
+    for (t = 0; t < nthreads; ++t)
+    {
+        work[t].ref = ref;
+        work[t].start = (int)(((long)ref->count * t) / nthreads);
+        work[t].stop  = (int)(((long)ref->count * (t+1)) / nthreads);
+        work[t].error = 0;
+    }
 
-    error = VsopTruncate(model, jdStart - T0, jdStop - T0, threshold);
+    error = RunWorkers(nthreads, work, sizeof(work[0]), VsopReferenceWorker);
     if (error) goto fail;
-    *trunc_terms = VsopTermCount(model);
 
-    for (jd = jdStart; jd <= jdStop; jd += jdDelta)
+    for (t = 0; t < nthreads; ++t)
+        if (work[t].error)
+            FAIL("LoadVsopReference: error %d calculating samples for body %d\n", work[t].error, body);
+
+fail:
+    if (error) FreeVsopReference(ref);
+    return error;
+}
+
+static void FreeVsopReference(vsop_reference_t *ref)
+{
+    free(ref->jd);
+    free(ref->npos);
+    free(ref->epos);
+    memset(ref, 0, sizeof(*ref));
+}
+
+static void VsopTestWorker(void *item)
+{
+    vsop_test_work_t *work = item;
+    const vsop_reference_t *ref = work->ref;
+    double vpos[VSOP_MAX_COORDS];
+    double arcmin;
+    int i;
+
+    work->max_arcmin = -1.0;
+    for (i = work->start; i < work->stop; ++i)
     {
-        VsopCalcPos(model, jd - T0, vpos);
-        if (body == 2)
-            error = NovasEarth(jd, npos);
+        VsopCalcPos(work->model, ref->jd[i] - T0, vpos);
+        if (ref->body == BODY_EMB)
+            arcmin = EmbArcminError(ref->npos[i], vpos);
         else
-            error = NovasBodyPos(jd, body, npos);
-        if (error) goto fail;
-        error = PositionArcminError(body, jd, npos, vpos, &arcmin);
-        if (error) goto fail;
-        if (arcmin > *max_arcmin) *max_arcmin = arcmin;
+            arcmin = ArcminSeenFrom(ref->npos[i], vpos, ref->epos[i]);
+        if (arcmin > work->max_arcmin) work->max_arcmin = arcmin;
     }
+}
 
-    error = 0;
+static int TestVsopModel(vsop_model_t *model, const vsop_reference_t *ref, double threshold, double *max_arcmin, int *trunc_terms)
+{
+    int error, t, nthreads;
+    vsop_test_work_t work[MAX_WORKER_THREADS];
+
+    *max_arcmin = -1.0;
+    *trunc_terms = -1;
+
+    error = VsopTruncate(model, ref->jdStart - T0, ref->jdStop - T0, threshold);
+    if (error) goto fail;
+    *trunc_terms = VsopTermCount(model);
+
+    /* Each thread finds the largest error over a contiguous range of the sample dates. */
+    nthreads = WorkerThreadCount();
+    for (t = 0; t < nthreads; ++t)
+    {
+        work[t].model = model;
+        work[t].ref = ref;
+        work[t].start = (int)(((long)ref->count * t) / nthreads);
+        work[t].stop  = (int)(((long)ref->count * (t+1)) / nthreads);
+    }
+
+    error = RunWorkers(nthreads, work, sizeof(work[0]), VsopTestWorker);
+    if (error) goto fail;
+
+    for (t = 0; t < nthreads; ++t)
+        if (work[t].max_arcmin > *max_arcmin)
+            *max_arcmin = work[t].max_arcmin;
 
 fail:
     return error;
 }
 
+/*
+    Returns the number of threads for parallel calculations.
+    The environment variable GENERATE_THREADS overrides
+    the default of one thread per CPU core.
+*/
+static int WorkerThreadCount(void)
+{
+    const char *text;
+    int count = 0;
+
+    text = getenv("GENERATE_THREADS");
+    if (text != NULL)
+        count = atoi(text);
+
+    if (count < 1)
+    {
+#ifdef _WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        count = (int)info.dwNumberOfProcessors;
+#else
+        count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    }
+
+    if (count < 1)
+        count = 1;
+
+    if (count > MAX_WORKER_THREADS)
+        count = MAX_WORKER_THREADS;
+
+    return count;
+}
+
+typedef struct
+{
+    void (*func)(void *item);
+    void *item;
+}
+worker_t;
+
+#ifdef _WIN32
+static DWORD WINAPI WorkerThread(LPVOID arg)
+{
+    worker_t *worker = arg;
+    worker->func(worker->item);
+    return 0;
+}
+#else
+static void *WorkerThread(void *arg)
+{
+    worker_t *worker = arg;
+    worker->func(worker->item);
+    return NULL;
+}
+#endif
+
+/*
+    Calls func once for each of the count items in the array,
+    each in its own thread. The calling thread handles the first item.
+*/
+static int RunWorkers(int count, void *items, size_t item_size, void (*func)(void *item))
+{
+    int error = 0;
+    int i, nstarted;
+    worker_t worker[MAX_WORKER_THREADS];
+#ifdef _WIN32
+    HANDLE thread[MAX_WORKER_THREADS];
+#else
+    pthread_t thread[MAX_WORKER_THREADS];
+#endif
+
+    if (count < 1 || count > MAX_WORKER_THREADS)
+    {
+        fprintf(stderr, "RunWorkers: invalid count = %d\n", count);
+        return 1;
+    }
+
+    for (i = 0; i < count; ++i)
+    {
+        worker[i].func = func;
+        worker[i].item = (char *)items + (i * item_size);
+    }
+
+    for (nstarted = 1; nstarted < count; ++nstarted)
+    {
+#ifdef _WIN32
+        thread[nstarted] = CreateThread(NULL, 0, WorkerThread, &worker[nstarted], 0, NULL);
+        if (thread[nstarted] == NULL)
+#else
+        if (pthread_create(&thread[nstarted], NULL, WorkerThread, &worker[nstarted]))
+#endif
+        {
+            fprintf(stderr, "RunWorkers: could not start thread %d\n", nstarted);
+            error = 1;
+            break;
+        }
+    }
+
+    /* Do the first item on this thread, and any items whose threads could not be started. */
+    func(worker[0].item);
+    for (i = nstarted; i < count; ++i)
+        func(worker[i].item);
+
+    for (i = 1; i < nstarted; ++i)
+    {
+#ifdef _WIN32
+        WaitForSingleObject(thread[i], INFINITE);
+        CloseHandle(thread[i]);
+#else
+        pthread_join(thread[i], NULL);
+#endif
+    }
+
+    return error;
+}
+
 static int TermContribution(const vsop_term_t *term, int sindex, double *contrib)
 {
     switch (sindex)
@@ -860,7 +1164,7 @@ fail:
 static int PositionArcminError(int body, double jd, const double a[3], const double b[3], double *arcmin)
 {
     int error, k;
-    double diff, sum, au;
+    double diff;
     double epos[3], evel[3], jed[2];
     VectorType adiff, bdiff;
 
@@ -931,17 +1235,7 @@ static int PositionArcminError(int body, double jd, const double a[3], const dou
             The worst case error is for Venus when it is closest to the Earth.
             We approximate that worst case distance by EARTH_PERIHELION - VENUS_APHELION.
         */
-        diff = a[0] - b[0];
-        sum = diff*diff;
-
-        diff = a[1] - b[1];
-        sum += diff*diff;
-
-        diff = a[2] - b[2];
-        sum += diff*diff;
-
-        au = sqrt(sum);
-        *arcmin = (RAD2DEG * 60.0) * (au / (EARTH_PERIHELION - VENUS_APHELION));
+        *arcmin = EmbArcminError(a, b);
         return 0;
     }
 
@@ -968,18 +1262,47 @@ static int PositionArcminError(int body, double jd, const double a[3], const dou
     }
 
 calc:
-    adiff.t = jd;   /* doesn't matter, but I don't like leaving undefined memory */
+    *arcmin = ArcminSeenFrom(a, b, epos);
+    return 0;
+}
+
+/*
+    The worst-case angular error, in arcminutes, that an error in the
+    Earth's position causes in the observed position of another planet.
+*/
+static double EmbArcminError(const double a[3], const double b[3])
+{
+    double diff, sum, au;
+
+    diff = a[0] - b[0];
+    sum = diff*diff;
+
+    diff = a[1] - b[1];
+    sum += diff*diff;
+
+    diff = a[2] - b[2];
+    sum += diff*diff;
+
+    au = sqrt(sum);
+    return (RAD2DEG * 60.0) * (au / (EARTH_PERIHELION - VENUS_APHELION));
+}
+
+/* The angle in arcminutes between positions a and b as seen from epos. */
+static double ArcminSeenFrom(const double a[3], const double b[3], const double epos[3])
+{
+    VectorType adiff, bdiff;
+
+    adiff.t = 0.0;  /* doesn't matter, but I don't like leaving undefined memory */
     adiff.v[0] = a[0] - epos[0];
     adiff.v[1] = a[1] - epos[1];
     adiff.v[2] = a[2] - epos[2];
 
-    bdiff.t = jd;   /* doesn't matter, but I don't like leaving undefined memory */
+    bdiff.t = 0.0;  /* doesn't matter, but I don't like leaving undefined memory */
     bdiff.v[0] = b[0] - epos[0];
     bdiff.v[1] = b[1] - epos[1];
     bdiff.v[2] = b[2] - epos[2];
 
-    *arcmin = (RAD2DEG * 60.0) * AngleBetween(adiff, bdiff);
-    return 0;
+    return (RAD2DEG * 60.0) * AngleBetween(adiff, bdiff);
 }
 
 static double VectorLength(const double v[3])
@@ -987,12 +1310,12 @@ static double VectorLength(const double v[3])
     return sqrt(v[0]*v[0] + v[1]*v[1] + v[2]*v[2]);
 }
 
-static int ParseObserver(const char *filename, int lnum, const char *line, observer *location)
+static int ParseObserver(const char *filename, int lnum, const text_line_t *line, observer *location)
 {
     int error;
     on_surface surface;
 
-    if (3 != sscanf(line, "o %lf %lf %lf", &surface.latitude, &surface.longitude, &surface.height))
+    if (3 != TextScan(line, 0, "o %lf %lf %lf", &surface.latitude, &surface.longitude, &surface.height))
     {
         fprintf(stderr, "ParseObserver: Invalid format on line %d of file %s\n", lnum, filename);
         return 1;
@@ -1046,7 +1369,7 @@ static double LongitudeOffset(double diff)
     return offset;
 }
 
-static int CheckEcliptic(const char *filename, int lnum, const char *line, double *arcmin, vsop_body_t *outbody)
+static int CheckEcliptic(const char *filename, int lnum, const text_line_t *line, double *arcmin, vsop_body_t *outbody)
 {
     int error;
     vsop_body_t body;
@@ -1062,7 +1385,7 @@ static int CheckEcliptic(const char *filename, int lnum, const char *line, doubl
     *outbody = VSOP_INVALID_BODY;
 
     /* Example line: "e Jupiter opp <tt> <au>" */
-    if (4 != sscanf(line, "e %9[A-Za-z] %9[a-z] %lf %lf", name, event, &tt, &dist))
+    if (4 != TextScan(line, 0, "e %9[A-Za-z] %9[a-z] %lf %lf", name, event, &tt, &dist))
     {
         fprintf(stderr, "CheckEcliptic: Invalid format on line %d of file %s\n", lnum, filename);
         return 1;
@@ -1137,7 +1460,7 @@ fail:
     return error;
 }
 
-static int CheckTestVector(const char *filename, int lnum, const char *line, double *arcmin, vsop_body_t *outbody)
+static int CheckTestVector(const char *filename, int lnum, const text_line_t *line, double *arcmin, vsop_body_t *outbody)
 {
     int error;
     vsop_body_t body;
@@ -1148,7 +1471,7 @@ static int CheckTestVector(const char *filename, int lnum, const char *line, dou
     *outbody = VSOP_INVALID_BODY;
     *arcmin = 99999.0;
 
-    if (5 != sscanf(line, "v %9[A-Za-z] %lf %lf %lf %lf", name, &tt, &xpos[0], &xpos[1], &xpos[2]))
+    if (5 != TextScan(line, 0, "v %9[A-Za-z] %lf %lf %lf %lf", name, &tt, &xpos[0], &xpos[1], &xpos[2]))
     {
         fprintf(stderr, "CheckTestVector: Invalid format on line %d of file %s\n", lnum, filename);
         return 1;
@@ -1188,7 +1511,7 @@ static int CheckTestVector(const char *filename, int lnum, const char *line, dou
     return 0;   /* success */
 }
 
-static int CheckSkyPos(observer *location, const char *filename, int lnum, const char *line, double *arcmin_equ, double *arcmin_hor, vsop_body_t *outbody)
+static int CheckSkyPos(observer *location, const char *filename, int lnum, const text_line_t *line, double *arcmin_equ, double *arcmin_hor, vsop_body_t *outbody)
 {
     int body, error, bodyIndex;
     char name[10];
@@ -1204,7 +1527,7 @@ static int CheckSkyPos(observer *location, const char *filename, int lnum, const
     *outbody = VSOP_INVALID_BODY;
     *arcmin_equ = *arcmin_hor = 99999.0;
 
-    if (8 != sscanf(line, "s %9[A-Za-z] %lf %lf %lf %lf %lf %lf %lf", name, &tt, &ut, &ra, &dec, &dist, &azimuth, &altitude))
+    if (8 != TextScan(line, 0, "s %9[A-Za-z] %lf %lf %lf %lf %lf %lf %lf", name, &tt, &ut, &ra, &dec, &dist, &azimuth, &altitude))
     {
         fprintf(stderr, "CheckSkyPos: Invalid format on line %d of file %s\n", lnum, filename);
         return 1;
@@ -1404,13 +1727,14 @@ static int CheckTestOutput(const char *filename)
 {
     int error, lnum;
     vsop_body_t body;
-    FILE *infile = NULL;
-    char line[300];
+    text_file_t infile;
+    text_line_t line;
     double arcmin_helio, arcmin_eclip, arcmin_equ, arcmin_hor;
     error_bundle_t bundle[VSOP_BODY_LIMIT];
     error_stat_t tally;
     observer location;
 
+    memset(&infile, 0, sizeof(infile));
     memset(&location, 0, sizeof(observer));
     memset(bundle, 0, sizeof(bundle));
     memset(&tally, 0, sizeof(tally));
@@ -1419,8 +1743,7 @@ static int CheckTestOutput(const char *filename)
 
     /* Check input file that contains lines of test output like this: */
     /* v Jupiter 2458455.2291666665 -2.0544644667646907 -4.271606485974493 -1.899398554516329 */
-    infile = fopen(filename, "rt");
-    if (infile == NULL)
+    if (TextFileOpen(&infile, filename))
     {
         fprintf(stderr, "CheckTestOutput: Cannot open file: %s\n", filename);
         error = 1;
@@ -1428,10 +1751,10 @@ static int CheckTestOutput(const char *filename)
     }
 
     lnum = 0;
-    while (fgets(line, sizeof(line), infile))
+    while (TextFileReadLine(&infile, &line))
     {
-        ++lnum;
-        switch (line[0])
+        lnum = infile.lnum;
+        switch ((line.text < line.end) ? line.text[0] : '\0')
         {
         case '#':   /* ignore debug output */
         case 'j':   /* ignore Jupiter moons calculations: for diff testing only */
@@ -1441,22 +1764,22 @@ static int CheckTestOutput(const char *filename)
 
         case 'o':
             /* The observer used for all future sky position calculations */
-            CHECK(ParseObserver(filename, lnum, line, &location));
+            CHECK(ParseObserver(filename, lnum, &line, &location));
             break;
 
         case 'v':   /* heliocentric cartesian vector represented in J2000 equatorial plane */
-            CHECK(CheckTestVector(filename, lnum, line, &arcmin_helio, &body));
+            CHECK(CheckTestVector(filename, lnum, &line, &arcmin_helio, &body));
             UpdateErrorStats(&bundle[body].helio, arcmin_helio);
             break;
 
         case 's':   /* sky coordinates: RA, DEC, distance */
-            CHECK(CheckSkyPos(&location, filename, lnum, line, &arcmin_equ, &arcmin_hor, &body));
+            CHECK(CheckSkyPos(&location, filename, lnum, &line, &arcmin_equ, &arcmin_hor, &body));
             UpdateErrorStats(&bundle[body].equ, arcmin_equ);
             UpdateErrorStats(&bundle[body].hor, arcmin_hor);
             break;
 
         case 'e':
-            CHECK(CheckEcliptic(filename, lnum, line, &arcmin_eclip, &body));
+            CHECK(CheckEcliptic(filename, lnum, &line, &arcmin_eclip, &body));
             UpdateErrorStats(&bundle[body].eclip, arcmin_eclip);
             break;
 
@@ -1495,7 +1818,7 @@ static int CheckTestOutput(const char *filename)
 
 fail:
     ephem_close();
-    if (infile != NULL) fclose(infile);
+    TextFileClose(&infile);
     return error;
 }
 
@@ -1839,6 +2162,111 @@ fail:
     return error;
 }
 
+#define PLUTO_SERIES_SAMPLES  1001
+
+static int PlutoSeriesError(
+    const top_model_t *model,
+    int nsamples,
+    const double tt[],
+    const top_rectangular_t correct[],
+    double *max_arcmin)
+{
+    int error, i;
+    top_rectangular_t equ;
+    double dx, dy, dz, arcmin;
+
+    *max_arcmin = 0.0;
+    for (i = 0; i < nsamples; ++i)
+    {
+        CHECK(TopPosition(model, tt[i], &equ));
+        dx = equ.x - correct[i].x;
+        dy = equ.y - correct[i].y;
+        dz = equ.z - correct[i].z;
+        arcmin = 60.0 * RAD2DEG * sqrt(dx*dx + dy*dy + dz*dz) / ErrorRadius[BODY_PLUTO];
+        if (arcmin > *max_arcmin)
+            *max_arcmin = arcmin;
+    }
+fail:
+    return error;
+}
+
+
+static int PlutoSeries(const char *millenniaText, const char *arcminText, const char *outFileName)
+{
+    int error = 1;
+    int i, f, iter, term_count;
+    double millennia, arcmin, lo, hi, mid, max_arcmin;
+    double *tt = NULL;
+    top_rectangular_t *correct = NULL;
+    top_model_t model, copy;
+    top_contrib_map_t map;
+    top_direction_t dir;
+
+    TopInitModel(&model);
+    TopInitModel(&copy);
+    TopInitContribMap(&map);
+
+    if (1 != sscanf(millenniaText, "%lf", &millennia) || !isfinite(millennia) || millennia <= 0.0 || millennia > 10.0)
+        FAIL("PlutoSeries: invalid number of millennia '%s'\n", millenniaText);
+
+    if (1 != sscanf(arcminText, "%lf", &arcmin) || !isfinite(arcmin) || arcmin <= 0.0)
+        FAIL("PlutoSeries: invalid arcminute threshold '%s'\n", arcminText);
+
+    CHECK(TopLoadModel(&model, TopDataFileName, BODY_PLUTO + 1));
+    CHECK(TopCloneModel(&copy, &model));
+    CHECK(TopMakeContribMap(&map, &model, millennia));
+
+    /* The full model's positions, which every truncated model is compared against. */
+    tt = calloc(PLUTO_SERIES_SAMPLES, sizeof(tt[0]));
+    correct = calloc(PLUTO_SERIES_SAMPLES, sizeof(correct[0]));
+    if (tt == NULL || correct == NULL)
+        FAIL("PlutoSeries: out of memory\n");
+
+    for (i = 0; i < PLUTO_SERIES_SAMPLES; ++i)
+    {
+        tt[i] = 365250.0 * millennia * (2.0*i/(PLUTO_SERIES_SAMPLES - 1.0) - 1.0);
+        CHECK(TopPosition(&model, tt[i], &correct[i]));
+    }
+
+    /*
+        Keep the same fraction of the most significant terms for every elliptical element,
+        and bisect for the smallest fraction whose error is within the threshold.
+        The fraction 1 keeps every term, which has no error.
+    */
+    for (f = 0; f < TOP_NCOORDS; ++f)
+        dir.x[f] = map.list[f].nterms;
+
+    lo = 0.0;
+    hi = 1.0;
+    for (iter = 0; iter < 30; ++iter)
+    {
+        mid = (lo + hi) / 2.0;
+        CHECK(TopSetDistance(&copy, &map, &term_count, &model, mid, &dir));
+        CHECK(PlutoSeriesError(&copy, PLUTO_SERIES_SAMPLES, tt, correct, &max_arcmin));
+        DEBUG("PlutoSeries: fraction=%0.9lf terms=%d arcmin=%0.6lf\n", mid, term_count, max_arcmin);
+        if (max_arcmin <= arcmin)
+            hi = mid;
+        else
+            lo = mid;
+    }
+
+    CHECK(TopSetDistance(&copy, &map, &term_count, &model, hi, &dir));
+    CHECK(PlutoSeriesError(&copy, PLUTO_SERIES_SAMPLES, tt, correct, &max_arcmin));
+    CHECK(TopSaveModel(&copy, outFileName));
+    printf("PlutoSeries: wrote %d of %d terms to %s; max error = %0.6lf arcmin over %lg millennia.\n",
+        TopTermCount(&copy), TopTermCount(&model), outFileName, max_arcmin, millennia);
+
+    error = 0;
+fail:
+    free(tt);
+    free(correct);
+    TopFreeContribMap(&map);
+    TopFreeModel(&copy);
+    TopFreeModel(&model);
+    return error;
+}
+
+
 /*------------------------------------------------------------------------------------------------*/
 
 static int ParseDate(const char *text, double *tt)
@@ -2207,3 +2635,205 @@ fail:
 }
 
 /*------------------------------------------------------------------------------------------------*/
+
+static int EphCalc(const char *filename, int count, const char *jdlist[])
+{
+    int error, i;
+    eph_file_reader_t reader;
+    double jd, pos[3];
+
+    error = EphFileOpen(&reader, filename);
+    if (error)
+    {
+        fprintf(stderr, "EphCalc: error %d opening file: %s\n", error, filename);
+        return error;
+    }
+
+    for (i = 0; i < count; ++i)
+    {
+        if (1 != sscanf(jdlist[i], "%lf", &jd))
+        {
+            fprintf(stderr, "EphCalc: invalid Julian date '%s'\n", jdlist[i]);
+            error = 1;
+            goto fail;
+        }
+
+        error = EphEvaluate(&reader, jd, pos);
+        if (error)
+        {
+            fprintf(stderr, "EphCalc: error %d evaluating jd=%lf in file %s\n", error, jd, filename);
+            goto fail;
+        }
+
+        printf("%0.6lf %23.16le %23.16le %23.16le\n", jd, pos[0], pos[1], pos[2]);
+    }
+
+fail:
+    EphFileClose(&reader);
+    return error;
+}
+
+#define EPHSEEK_NRECORDS    40
+#define EPHSEEK_GAP_RECORD  25
+
+static double EphSeekStart(int i)
+{
+    /* Records are 4 days long and contiguous, except for a 1-day gap before EPHSEEK_GAP_RECORD. */
+    return 2451545.0 + 4.0*i + ((i >= EPHSEEK_GAP_RECORD) ? 1.0 : 0.0);
+}
+
+static int WriteEphSeekFile(const char *filename, int overlap)
+{
+    FILE *outfile;
+    int i, k;
+
+    outfile = fopen(filename, "wt");
+    if (outfile == NULL)
+    {
+        fprintf(stderr, "WriteEphSeekFile: Cannot open output file: %s\n", filename);
+        return 1;
+    }
+
+    fprintf(outfile, "body=3\n\n");
+    for (i = 0; i < EPHSEEK_NRECORDS; ++i)
+    {
+        /* When asked, make the last record overlap the one before it. */
+        fprintf(outfile, "%0.1lf 4.0 3\n", EphSeekStart(i) - ((overlap && i+1 == EPHSEEK_NRECORDS) ? 2.0 : 0.0));
+        for (k = 0; k < 3; ++k)
+            fprintf(outfile, "%d.0 %d.5 %d.25\n", i+k, 100*i-k, i*(k+1));
+    }
+
+    fclose(outfile);
+    return 0;
+}
+
+static int UnitTestEphSeek(void)
+{
+    const char *filename = "temp/ephseek.txt";
+    int error, i, k, step;
+    eph_file_reader_t reader;
+    eph_record_t records[EPHSEEK_NRECORDS];
+    eph_record_t record;
+    double jd, pos[3], expected[3];
+
+    memset(&reader, 0, sizeof(reader));
+
+    error = WriteEphSeekFile(filename, 0);
+    if (error)
+        return error;
+
+    /* Read every record sequentially, the way callers did before EphSeek existed. */
+    error = EphFileOpen(&reader, filename);
+    if (error)
+    {
+        fprintf(stderr, "UnitTestEphSeek: error %d opening file: %s\n", error, filename);
+        return error;
+    }
+
+    for (i = 0; i < EPHSEEK_NRECORDS; ++i)
+    {
+        if (!EphReadRecord(&reader, &records[i]))
+        {
+            fprintf(stderr, "UnitTestEphSeek: error %d reading record %d\n", records[i].error, i);
+            error = 1;
+            goto fail;
+        }
+    }
+
+    /*
+        Visit the records in a scrambled order: 7 and EPHSEEK_NRECORDS have no common factor,
+        so stepping by 7 modulo EPHSEEK_NRECORDS jumps forward and backward through the file,
+        visiting each record three times: at its start, middle, and end.
+        Each seek must load the same record
+        the sequential pass found, and evaluate it the same way.
+    */
+    for (step = 0; step < 3*EPHSEEK_NRECORDS; ++step)
+    {
+        i = (7 * step) % EPHSEEK_NRECORDS;
+        jd = records[i].jdStart + records[i].jdDelta * ((step % 3) / 2.0);
+
+        error = EphEvaluate(&reader, jd, pos);
+        if (error)
+        {
+            fprintf(stderr, "UnitTestEphSeek: error %d evaluating record %d at jd=%lf\n", error, i, jd);
+            goto fail;
+        }
+
+        /* A time on the boundary between two contiguous records may come from either one. */
+        if (reader.record.jdStart != records[i].jdStart && !(step % 3 == 2 && i+1 < EPHSEEK_NRECORDS && reader.record.jdStart == records[i+1].jdStart))
+        {
+            fprintf(stderr, "UnitTestEphSeek: jd=%lf loaded record starting at %lf, expected %lf\n", jd, reader.record.jdStart, records[i].jdStart);
+            error = 1;
+            goto fail;
+        }
+
+        k = (reader.record.jdStart == records[i].jdStart) ? i : i+1;
+        if (memcmp(&reader.record, &records[k], sizeof(eph_record_t)))
+        {
+            fprintf(stderr, "UnitTestEphSeek: record %d read by EphSeek does not match the sequential read.\n", k);
+            error = 1;
+            goto fail;
+        }
+
+        ChebApprox(records[k].numpoly, 3, records[k].coeff, ChebScale(records[k].jdStart, records[k].jdStart + records[k].jdDelta, jd), expected);
+        if (memcmp(pos, expected, sizeof(pos)))
+        {
+            fprintf(stderr, "UnitTestEphSeek: EphEvaluate returned the wrong position at jd=%lf\n", jd);
+            error = 1;
+            goto fail;
+        }
+
+        /* After a seek, EphReadRecord must continue with the following record. */
+        if (k+1 < EPHSEEK_NRECORDS && step % 5 == 0)
+        {
+            if (!EphReadRecord(&reader, &record) || memcmp(&record, &records[k+1], sizeof(eph_record_t)))
+            {
+                fprintf(stderr, "UnitTestEphSeek: EphReadRecord did not continue with record %d after seeking to record %d\n", k+1, k);
+                error = 1;
+                goto fail;
+            }
+        }
+    }
+
+    /* Times before the first record, in the gap, and after the last record are out of range. */
+    jd = EphSeekStart(EPHSEEK_GAP_RECORD) - 0.5;
+    if (EPH_ERROR_RANGE != (error = EphSeek(&reader, records[0].jdStart - 0.001)) ||
+        EPH_ERROR_RANGE != (error = EphSeek(&reader, jd)) ||
+        EPH_ERROR_RANGE != (error = EphSeek(&reader, records[EPHSEEK_NRECORDS-1].jdStart + 4.001)))
+    {
+        fprintf(stderr, "UnitTestEphSeek: expected EPH_ERROR_RANGE, but got %d\n", error);
+        error = 1;
+        goto fail;
+    }
+
+    EphFileClose(&reader);
+
+    /* A file whose records overlap must fail the same way every time, without leaving a partial index. */
+    error = WriteEphSeekFile(filename, 1);
+    if (error)
+        return error;
+
+    error = EphFileOpen(&reader, filename);
+    if (error)
+    {
+        fprintf(stderr, "UnitTestEphSeek: error %d opening file: %s\n", error, filename);
+        return error;
+    }
+
+    for (k = 0; k < 2; ++k)
+    {
+        error = EphSeek(&reader, records[0].jdStart);
+        if (error != EPH_ERROR_ORDER || reader.nindex != 0)
+        {
+            fprintf(stderr, "UnitTestEphSeek: overlapping records: attempt %d returned error=%d, nindex=%d\n", k, error, reader.nindex);
+            error = 1;
+            goto fail;
+        }
+    }
+
+    printf("UnitTestEphSeek: PASS\n");
+    error = 0;
+fail:
+    EphFileClose(&reader);
+    return error;
+}
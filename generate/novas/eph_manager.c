@@ -14,6 +14,21 @@
    #include "eph_manager.h"
 #endif
 
+#ifdef _WIN32
+   #include <windows.h>
+#else
+   #include <fcntl.h>
+   #include <sys/mman.h>
+   #include <sys/stat.h>
+   #include <unistd.h>
+#endif
+
+static void map_ephemeris (char *ephem_name);
+static void unmap_ephemeris (void);
+static void interpolate_r (const double *buf, const double *t,
+                           long int ncf, long int na,
+                           double *position, double *velocity);
+
 /*
    Define global variables
 */
@@ -34,6 +49,19 @@ double *BUFFER;
 
 FILE *EPHFILE = NULL;
 
+/*
+   When the ephemeris file can be memory-mapped, EPHMAP points to its
+   contents and 'state' reads records directly from the mapping.
+*/
+
+const unsigned char *EPHMAP = NULL;
+long int EPHMAP_SIZE = 0;
+
+#ifdef _WIN32
+static HANDLE EPHMAP_FILE = INVALID_HANDLE_VALUE;
+static HANDLE EPHMAP_VIEW = NULL;
+#endif
+
 /********ephem_open */
 
 short int ephem_open (char *ephem_name,
@@ -251,6 +279,13 @@ short int ephem_open (char *ephem_name,
 
       BUFFER = (double *) calloc (RECORD_LENGTH / 8, sizeof(double));
 
+/*
+   Map the whole file into memory if possible. Otherwise 'state'
+   reads each record into BUFFER as it is needed.
+*/
+
+      map_ephemeris (ephem_name);
+
       *de_number = (short int) denum;
       *jd_begin = SS[0];
       *jd_end = SS[1];
@@ -325,9 +360,117 @@ short int ephem_close (void)
       BUFFER = NULL;
    }
 
+   unmap_ephemeris ();
+
    return error;
 }
 
+/********map_ephemeris */
+
+static void map_ephemeris (char *ephem_name)
+/*
+------------------------------------------------------------------------
+
+   PURPOSE:
+      This function maps the ephemeris file opened by 'ephem_open'
+      into memory, read-only. If the file cannot be mapped, EPHMAP
+      remains NULL and the records are read with 'fread'.
+
+   GLOBALS
+   USED:
+      EPHMAP            eph_manager.h
+      EPHMAP_SIZE       eph_manager.h
+
+   NOTES:
+      1. Added for Astronomy Engine, so that 'state' does not copy
+         each record, and can be called from multiple threads.
+
+------------------------------------------------------------------------
+*/
+{
+#ifdef _WIN32
+   LARGE_INTEGER size;
+
+   EPHMAP_FILE = CreateFileA (ephem_name, GENERIC_READ, FILE_SHARE_READ,
+      NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+   if (EPHMAP_FILE == INVALID_HANDLE_VALUE)
+      return;
+
+   if (GetFileSizeEx (EPHMAP_FILE, &size) && size.QuadPart > 0 &&
+       size.QuadPart <= 0x7fffffffL)
+   {
+      EPHMAP_VIEW = CreateFileMappingA (EPHMAP_FILE, NULL, PAGE_READONLY,
+         0, 0, NULL);
+      if (EPHMAP_VIEW != NULL)
+      {
+         EPHMAP = (const unsigned char *) MapViewOfFile (EPHMAP_VIEW,
+            FILE_MAP_READ, 0, 0, 0);
+         if (EPHMAP != NULL)
+         {
+            EPHMAP_SIZE = (long int) size.QuadPart;
+            return;
+         }
+      }
+   }
+
+   unmap_ephemeris ();
+#else
+   int fd;
+   struct stat st;
+   void *addr;
+
+   fd = open (ephem_name, O_RDONLY);
+   if (fd < 0)
+      return;
+
+   if (fstat (fd, &st) == 0 && st.st_size > 0 &&
+       (unsigned long) st.st_size <= (unsigned long) 0x7fffffffL)
+   {
+      addr = mmap (NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+      if (addr != MAP_FAILED)
+      {
+         EPHMAP = (const unsigned char *) addr;
+         EPHMAP_SIZE = (long int) st.st_size;
+      }
+   }
+
+/*
+   The mapping remains valid after the descriptor is closed.
+*/
+
+   close (fd);
+#endif
+}
+
+/********unmap_ephemeris */
+
+static void unmap_ephemeris (void)
+/*
+------------------------------------------------------------------------
+
+   PURPOSE:
+      This function releases the mapping made by 'map_ephemeris'.
+
+------------------------------------------------------------------------
+*/
+{
+#ifdef _WIN32
+   if (EPHMAP != NULL)
+      UnmapViewOfFile (EPHMAP);
+   if (EPHMAP_VIEW != NULL)
+      CloseHandle (EPHMAP_VIEW);
+   if (EPHMAP_FILE != INVALID_HANDLE_VALUE)
+      CloseHandle (EPHMAP_FILE);
+   EPHMAP_VIEW = NULL;
+   EPHMAP_FILE = INVALID_HANDLE_VALUE;
+#else
+   if (EPHMAP != NULL)
+      munmap ((void *) EPHMAP, (size_t) EPHMAP_SIZE);
+#endif
+   EPHMAP = NULL;
+   EPHMAP_SIZE = 0;
+}
+
 /********planet_ephemeris */
 
 short int planet_ephemeris (double tjd[2], short int target,
@@ -671,6 +814,8 @@ short int state (double *jed, short int target,
    USED:
       KM                eph_manager.h
       EPHFILE           eph_manager.h
+      EPHMAP            eph_manager.h
+      EPHMAP_SIZE       eph_manager.h
       IPT               eph_manager.h
       BUFFER            eph_manager.h
       NRL               eph_manager.h
@@ -762,6 +907,30 @@ short int state (double *jed, short int target,
       nr -= 2;
    t[0] = ((jd[0] - ((double) (nr-3) * SS[2] + SS[0])) + jd[3]) / SS[2];
 
+/*
+   If the file is mapped, interpolate directly from the mapped record.
+   This path uses no global buffers, so it is safe to call from
+   multiple threads at once.
+*/
+
+   if (EPHMAP != NULL)
+   {
+      rec = (nr - 1) * RECORD_LENGTH;
+      if (rec < 0 || rec + RECORD_LENGTH > EPHMAP_SIZE)
+         return 1;
+
+      interpolate_r ((const double *) (EPHMAP + rec) + (IPT[0][target]-1),
+         t, IPT[1][target], IPT[2][target], target_pos, target_vel);
+
+      for (i = 0; i < 3; i++)
+      {
+         target_pos[i] *= aufac;
+         target_vel[i] *= aufac;
+      }
+
+      return 0;
+   }
+
 /*
    Read correct record if it is not already in memory.
 */
@@ -957,6 +1126,71 @@ void interpolate (double *buf, double *t, long int ncf, long int na,
    return;
 }
 
+/********interpolate_r */
+
+static void interpolate_r (const double *buf, const double *t,
+                           long int ncf, long int na,
+                           double *position, double *velocity)
+/*
+------------------------------------------------------------------------
+
+   PURPOSE:
+      A reentrant version of 'interpolate' that keeps the Chebyshev
+      polynomial values in local arrays instead of the globals PC and
+      VC. The results are identical to those of 'interpolate'.
+
+   NOTES:
+      1. Added for Astronomy Engine, for calling 'state' from multiple
+         threads when the ephemeris file is memory-mapped.
+
+------------------------------------------------------------------------
+*/
+{
+   long int i, j, k, l;
+
+   double dna, dt1, temp, tc, twot, vfac, pc[18], vc[18];
+
+   dna = (double) na;
+   dt1 = (double) ((long int) t[0]);
+   temp = dna * t[0];
+   l = (long int) (temp - dt1);
+   tc = 2.0 * (fmod (temp, 1.0) + dt1) - 1.0;
+   twot = tc + tc;
+
+   pc[0] = 1.0;
+   pc[1] = tc;
+   for (i = 2; i < ncf; i++)
+      pc[i] = twot * pc[i-1] - pc[i-2];
+
+   for (i = 0; i < 3; i++)
+   {
+      position[i] = 0.0;
+      for (j = ncf-1; j >= 0; j--)
+      {
+         k = j + (i * ncf) + (l * (3 * ncf));
+         position[i] += pc[j] * buf[k];
+      }
+   }
+
+   vfac = (2.0 * dna) / t[1];
+   vc[0] = 0.0;
+   vc[1] = 1.0;
+   vc[2] = 2.0 * twot;
+   for (i = 3; i < ncf; i++)
+      vc[i] = twot * vc[i-1] + pc[i-1] + pc[i-1] - vc[i-2];
+
+   for (i = 0; i < 3; i++)
+   {
+      velocity[i] = 0.0;
+      for (j = ncf-1; j > 0; j--)
+      {
+         k = j + (i * ncf) + (l * (3 * ncf));
+         velocity[i] += vc[j] * buf[k];
+      }
+      velocity[i] *= vfac;
+   }
+}
+
 /********split */
 
 void split (double tt,
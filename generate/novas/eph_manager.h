@@ -44,6 +44,8 @@ extern double SS[3], JPLAU, PC[18], VC[18], TWOT, EM_RATIO;
 extern double *BUFFER;
 
 extern FILE *EPHFILE;
+extern const unsigned char *EPHMAP;
+extern long int EPHMAP_SIZE;
 
 /*
    Function prototypes
@@ -0,0 +1,429 @@
+/*
+    MIT License
+
+    Copyright (c) 2019-2023 Don Cross <cosinekitty@gmail.com>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <ctype.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include "textfile.h"
+
+static int ReadWholeFile(text_file_t *file)
+{
+    FILE *infile;
+    long length;
+    int error = 1;
+
+    infile = fopen(file->filename, "rb");
+    if (infile == NULL)
+        return 1;
+
+    if (fseek(infile, 0, SEEK_END) || (length = ftell(infile)) < 0 || fseek(infile, 0, SEEK_SET))
+        goto fail;
+
+    file->size = (size_t)length;
+    file->data = malloc(file->size + 1);
+    if (file->data == NULL)
+        goto fail;
+
+    if (file->size != fread(file->data, 1, file->size, infile))
+        goto fail;
+
+    error = 0;
+fail:
+    fclose(infile);
+    return error;
+}
+
+/*
+    Opens a text file for reading with TextFileReadLine.
+    Returns 0 on success, or nonzero if the file cannot be opened or read.
+    Whether or not it succeeds, the caller must call TextFileClose.
+*/
+int TextFileOpen(text_file_t *file, const char *filename)
+{
+    memset(file, 0, sizeof(text_file_t));
+    file->filename = filename;
+
+#ifndef _WIN32
+    {
+        struct stat st;
+        int fd = open(filename, O_RDONLY);
+        if (fd < 0)
+            return 1;
+
+        if (0 == fstat(fd, &st) && st.st_size > 0)
+        {
+            void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED)
+            {
+                file->data = map;
+                file->size = (size_t)st.st_size;
+                file->mapped = 1;
+                madvise(map, file->size, MADV_SEQUENTIAL);
+            }
+        }
+        close(fd);
+        if (file->mapped)
+            return 0;
+    }
+#endif
+
+    /* Empty files cannot be mapped, and some platforms have no mmap. */
+    return ReadWholeFile(file);
+}
+
+/*
+    Finds the next line in the file.
+    Returns 1 if a line was found, or 0 at the end of the file.
+    The line does not include its end-of-line characters ("\n" or "\r\n").
+*/
+int TextFileReadLine(text_file_t *file, text_line_t *line)
+{
+    const char *start, *stop, *eoln;
+
+    if (file->offset >= file->size)
+        return 0;
+
+    start = file->data + file->offset;
+    stop = file->data + file->size;
+    eoln = memchr(start, '\n', (size_t)(stop - start));
+    if (eoln == NULL)
+    {
+        file->offset = file->size;
+        eoln = stop;
+    }
+    else
+    {
+        file->offset = (size_t)(eoln - file->data) + 1;
+    }
+
+    if (eoln > start && eoln[-1] == '\r')
+        --eoln;
+
+    line->text = start;
+    line->end = eoln;
+    ++file->lnum;
+    return 1;
+}
+
+void TextFileClose(text_file_t *file)
+{
+    if (file->data != NULL)
+    {
+#ifndef _WIN32
+        if (file->mapped)
+            munmap(file->data, file->size);
+        else
+#endif
+            free(file->data);
+    }
+    memset(file, 0, sizeof(text_file_t));
+}
+
+size_t TextLineLength(const text_line_t *line)
+{
+    return (size_t)(line->end - line->text);
+}
+
+int TextLineStartsWith(const text_line_t *line, const char *prefix)
+{
+    size_t length = strlen(prefix);
+    return TextLineLength(line) >= length && !memcmp(line->text, prefix, length);
+}
+
+static const double Pow10[] =
+{
+    1.0e+00, 1.0e+01, 1.0e+02, 1.0e+03, 1.0e+04, 1.0e+05, 1.0e+06, 1.0e+07,
+    1.0e+08, 1.0e+09, 1.0e+10, 1.0e+11, 1.0e+12, 1.0e+13, 1.0e+14, 1.0e+15,
+    1.0e+16, 1.0e+17, 1.0e+18, 1.0e+19, 1.0e+20, 1.0e+21, 1.0e+22
+};
+
+#define MAX_EXACT_POWER     22
+#define MAX_EXACT_MANTISSA  ((uint64_t)1 << 53)
+
+static const char *SlowParseDouble(const char *text, const char *end, double *value)
+{
+    char buffer[400];
+    char *next;
+    size_t length = (size_t)(end - text);
+
+    if (length >= sizeof(buffer))
+        length = sizeof(buffer) - 1;
+    memcpy(buffer, text, length);
+    buffer[length] = '\0';
+    *value = strtod(buffer, &next);
+    return (next == buffer) ? NULL : text + (next - buffer);
+}
+
+/*
+    Parses a floating point number starting at text, without reading past end,
+    like strtod does for a '\0'-terminated string.
+    Returns a pointer to the first character after the number,
+    or NULL if there is no number at text.
+
+    Most numbers in our data files have at most 19 significant digits
+    and a small power of 10. When the digits fit exactly in a double,
+    one multiplication or division by an exact power of 10 gives the
+    correctly rounded result. All other numbers are handed to strtod,
+    so the result is always the same as strtod's.
+*/
+const char *TextParseDouble(const char *text, const char *end, double *value)
+{
+    const char *p = text;
+    const char *mark;
+    uint64_t mantissa = 0;
+    int ndigits = 0;        /* significant digits accumulated in mantissa */
+    int inexact = 0;        /* nonzero digits were left out of mantissa */
+    int any = 0;            /* any digits at all */
+    int negative = 0;
+    int exponent = 0;
+    int e, esign;
+    double x;
+
+    if (p < end && (*p == '+' || *p == '-'))
+        negative = (*p++ == '-');
+
+    for (; p < end && isdigit((unsigned char)*p); ++p)
+    {
+        any = 1;
+        if (ndigits < 19)
+        {
+            mantissa = 10*mantissa + (uint64_t)(*p - '0');
+            if (mantissa != 0)
+                ++ndigits;
+        }
+        else
+        {
+            ++exponent;
+            if (*p != '0')
+                inexact = 1;
+        }
+    }
+
+    if (p < end && *p == '.')
+    {
+        for (++p; p < end && isdigit((unsigned char)*p); ++p)
+        {
+            any = 1;
+            if (ndigits < 19)
+            {
+                mantissa = 10*mantissa + (uint64_t)(*p - '0');
+                if (mantissa != 0)
+                    ++ndigits;
+                --exponent;
+            }
+            else if (*p != '0')
+            {
+                inexact = 1;
+            }
+        }
+    }
+
+    if (!any)
+        return SlowParseDouble(text, end, value);   /* "inf", "nan", or not a number */
+
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        mark = p++;
+        esign = 1;
+        if (p < end && (*p == '+' || *p == '-'))
+            esign = (*p++ == '-') ? -1 : +1;
+
+        if (p < end && isdigit((unsigned char)*p))
+        {
+            for (e = 0; p < end && isdigit((unsigned char)*p); ++p)
+                if (e < 100000)
+                    e = 10*e + (*p - '0');
+            exponent += esign * e;
+        }
+        else
+        {
+            p = mark;   /* "1e" or "1e+" : the number ends before the 'e' */
+        }
+    }
+
+    if (inexact || mantissa > MAX_EXACT_MANTISSA || exponent < -MAX_EXACT_POWER || exponent > MAX_EXACT_POWER)
+        return SlowParseDouble(text, end, value);
+
+    x = (double)mantissa;
+    if (exponent < 0)
+        x /= Pow10[-exponent];
+    else
+        x *= Pow10[exponent];
+
+    *value = negative ? -x : x;
+    return p;
+}
+
+static const char *SkipSpace(const char *p, const char *end)
+{
+    while (p < end && isspace((unsigned char)*p))
+        ++p;
+    return p;
+}
+
+/* Matches character c against a scanf-style set like "A-Za-z" that ends at stop. */
+static int InScanSet(const char *set, const char *stop, char c)
+{
+    int negate = 0;
+    int found = 0;
+
+    if (set < stop && *set == '^')
+    {
+        negate = 1;
+        ++set;
+    }
+
+    for (; set < stop; ++set)
+    {
+        if (set+2 < stop && set[1] == '-')
+        {
+            if (c >= set[0] && c <= set[2])
+                found = 1;
+            set += 2;
+        }
+        else if (c == *set)
+        {
+            found = 1;
+        }
+    }
+
+    return found ^ negate;
+}
+
+/*
+    Parses the line, starting offset characters into it, like sscanf would.
+    Supports whitespace and literal characters in the format,
+    and the conversions %lf, %d, %Ns, and %N[set].
+    Returns the number of values stored.
+*/
+int TextScan(const text_line_t *line, size_t offset, const char *format, ...)
+{
+    va_list args;
+    const char *p = line->text + offset;
+    const char *end = line->end;
+    const char *f = format;
+    const char *next;
+    const char *set, *stop;
+    char *text;
+    long n;
+    int count = 0;
+    int width, negative;
+
+    if (p > end)
+        return 0;
+
+    va_start(args, format);
+    while (*f != '\0')
+    {
+        if (isspace((unsigned char)*f))
+        {
+            p = SkipSpace(p, end);
+            ++f;
+            continue;
+        }
+
+        if (*f != '%')
+        {
+            if (p >= end || *p != *f)
+                break;
+            ++p;
+            ++f;
+            continue;
+        }
+
+        ++f;
+        width = 0;
+        while (isdigit((unsigned char)*f))
+            width = 10*width + (*f++ - '0');
+
+        if (f[0] == 'l' && f[1] == 'f')
+        {
+            f += 2;
+            p = SkipSpace(p, end);
+            next = TextParseDouble(p, end, va_arg(args, double *));
+            if (next == NULL)
+                break;
+            p = next;
+        }
+        else if (*f == 'd')
+        {
+            ++f;
+            p = SkipSpace(p, end);
+            negative = 0;
+            if (p < end && (*p == '+' || *p == '-'))
+                negative = (*p++ == '-');
+            if (p >= end || !isdigit((unsigned char)*p))
+                break;
+            for (n = 0; p < end && isdigit((unsigned char)*p); ++p)
+                n = 10*n + (*p - '0');
+            *va_arg(args, int *) = (int)(negative ? -n : n);
+        }
+        else if (*f == 's' || *f == '[')
+        {
+            /* The caller's buffer must hold width characters plus a terminating '\0'. */
+            set = stop = NULL;
+            if (*f == '[')
+            {
+                set = f+1;
+                stop = strchr(set, ']');
+                if (stop == NULL)
+                    break;
+                f = stop + 1;
+            }
+            else
+            {
+                ++f;
+                p = SkipSpace(p, end);
+            }
+            text = va_arg(args, char *);
+            if (width == 0)
+                width = 1000000;
+            for (n = 0; n < width && p < end; ++n, ++p)
+            {
+                if (set != NULL ? !InScanSet(set, stop, *p) : isspace((unsigned char)*p))
+                    break;
+                text[n] = *p;
+            }
+            text[n] = '\0';
+            if (n == 0)
+                break;
+        }
+        else
+        {
+            break;      /* unsupported conversion */
+        }
+        ++count;
+    }
+    va_end(args);
+    return count;
+}
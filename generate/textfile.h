@@ -0,0 +1,64 @@
+/*
+    MIT License
+
+    Copyright (c) 2019-2023 Don Cross <cosinekitty@gmail.com>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+#ifndef __DDC_TEXTFILE_H
+#define __DDC_TEXTFILE_H
+
+#include <stddef.h>
+
+/*
+    Reads large text data files, such as JPL Horizons output and the
+    reference files in this directory, without copying them line by line.
+    The whole file is memory-mapped where possible, or otherwise read into
+    memory at once, and each line is returned as a pointer range into it.
+*/
+
+typedef struct
+{
+    const char *text;       /* first character of the line: NOT terminated by '\0' */
+    const char *end;        /* one past the last character, not counting the end-of-line */
+}
+text_line_t;
+
+typedef struct
+{
+    const char *filename;
+    char *data;
+    size_t size;
+    size_t offset;          /* where the next line begins */
+    int lnum;               /* 1-based number of the line most recently read */
+    int mapped;             /* nonzero if data is memory-mapped rather than allocated */
+}
+text_file_t;
+
+int  TextFileOpen(text_file_t *file, const char *filename);
+int  TextFileReadLine(text_file_t *file, text_line_t *line);
+void TextFileClose(text_file_t *file);
+
+size_t TextLineLength(const text_line_t *line);
+int TextLineStartsWith(const text_line_t *line, const char *prefix);
+
+const char *TextParseDouble(const char *text, const char *end, double *value);
+int TextScan(const text_line_t *line, size_t offset, const char *format, ...);
+
+#endif /* __DDC_TEXTFILE_H */
@@ -262,7 +262,9 @@ typedef enum
     ASTRO_FAIL_APSIS,               /**< Special-case logic for finding Neptune/Pluto apsis failed. */
     ASTRO_BUFFER_TOO_SMALL,         /**< A provided buffer's size is too small to receive the requested data. */
     ASTRO_OUT_OF_MEMORY,            /**< An attempt to allocate memory failed. */
-    ASTRO_INCONSISTENT_TIMES        /**< The provided initial state vectors did not have matching times. */
+    ASTRO_INCONSISTENT_TIMES,       /**< The provided initial state vectors did not have matching times. */
+    ASTRO_FILE_ERROR,               /**< A file could not be opened or read. */
+    ASTRO_BAD_FILE_FORMAT           /**< The contents of a file were not in the expected format. */
 }
 astro_status_t;
 
@@ -528,6 +530,97 @@ typedef struct
 }
 astro_rotation_t;
 
+/**
+ * @brief A Cartesian vector without a status or time, for storing large arrays compactly.
+ *
+ * Functions like #Astronomy_HelioVectorTerse use this type to hold many results
+ * densely, with a single status for the whole batch.
+ */
+typedef struct
+{
+    double x;   /**< The Cartesian x-coordinate of the vector. */
+    double y;   /**< The Cartesian y-coordinate of the vector. */
+    double z;   /**< The Cartesian z-coordinate of the vector. */
+}
+astro_terse_vector_t;
+
+/**
+ * @brief A position and velocity without a status or time, for storing large arrays compactly.
+ *
+ * See #Astronomy_HelioStateTerse.
+ */
+typedef struct
+{
+    astro_terse_vector_t r;     /**< Position vector. */
+    astro_terse_vector_t v;     /**< Velocity vector. */
+}
+astro_terse_state_t;
+
+/**
+ * @brief Spherical coordinates without a status, for storing large arrays compactly.
+ *
+ * See #Astronomy_SphereFromVectorsTerse.
+ */
+typedef struct
+{
+    double lat;     /**< The latitude angle: -90..+90 degrees. */
+    double lon;     /**< The longitude angle: 0..360 degrees. */
+    double dist;    /**< Distance in AU. */
+}
+astro_terse_spherical_t;
+
+/**
+ * @brief A rotation matrix in single precision, for fast display calculations.
+ *
+ * See #Astronomy_RotationFloat.
+ */
+typedef struct
+{
+    float rot[3][3];        /**< A 3x3 rotation matrix, in the same layout as #astro_rotation_t. */
+}
+astro_rotation_float_t;
+
+/**
+ * @brief Holds single precision vectors as separate arrays of coordinates.
+ *
+ * Used by #Astronomy_RotateVectorsFloat. The caller owns the arrays;
+ * each must have room for as many values as there are vectors.
+ */
+typedef struct
+{
+    float *x;       /**< Array of x-coordinates. */
+    float *y;       /**< Array of y-coordinates. */
+    float *z;       /**< Array of z-coordinates. */
+}
+astro_float_vectors_t;
+
+/**
+ * @brief Quantities that depend only on time, shared by many position calculations.
+ *
+ * Calculating the positions of several bodies, or the same body for several observers,
+ * at the same moment repeats work that depends only on the time: the Earth's
+ * heliocentric position, precession, nutation, and sidereal time.
+ * An `astro_frame_t` holds the results of that work, so it can be done once
+ * by #Astronomy_MakeFrame and reused by #Astronomy_GeoVectorFrame,
+ * #Astronomy_EquatorFrame, and #Astronomy_HorizonFrame.
+ */
+typedef struct
+{
+    astro_status_t       status;    /**< `ASTRO_SUCCESS` if this struct is valid; otherwise an error code. */
+    astro_time_t         time;      /**< The time the frame was calculated for. */
+    astro_state_vector_t earth;     /**< The heliocentric position and velocity of the Earth in EQJ coordinates. */
+    astro_rotation_t     eqj_eqd;   /**< Rotation from J2000 mean equator (EQJ) to true equator of date (EQD). */
+    astro_rotation_t     eqd_eqj;   /**< Rotation from true equator of date (EQD) to J2000 mean equator (EQJ). */
+    double               gast;      /**< Greenwich apparent sidereal time in sidereal hours. */
+    double               mobl;      /**< Mean obliquity of the ecliptic in degrees. */
+    double               tobl;      /**< True obliquity of the ecliptic in degrees. */
+    double               dpsi;      /**< Nutation in longitude in arcseconds. */
+    double               deps;      /**< Nutation in obliquity in arcseconds. */
+    astro_rotation_t     prec;      /**< For internal use only. */
+    astro_rotation_t     nut;       /**< For internal use only. */
+}
+astro_frame_t;
+
 /**
  * @brief Selects whether to correct for atmospheric refraction, and if so, how.
  */
@@ -549,6 +642,78 @@ typedef struct
 }
 astro_search_result_t;
 
+/**
+ * @brief Counters that describe how much work searches have done.
+ *
+ * Pass a pointer to a zeroed instance of this struct to #Astronomy_SetSearchStats
+ * to have the searches performed by the calling thread add to these counters.
+ * Reset the struct to zero between searches to measure a single search.
+ */
+typedef struct
+{
+    long searches;              /**< The number of calls to #Astronomy_Search, including those made internally by other searches. */
+    long failures;              /**< The number of those calls that did not succeed. */
+    long func_calls;            /**< The total number of times #Astronomy_Search called its `func` parameter. */
+    long iterations;            /**< The total number of iterations of the #Astronomy_Search loop. */
+    long quad_steps;            /**< Iterations that converged or narrowed the window using quadratic interpolation. */
+    long bisections;            /**< Iterations that fell back to bisecting the window. */
+    int  max_iterations;        /**< The largest number of iterations used by a single search. */
+    long ascent_calls;          /**< The number of recursive calls made while bracketing rise, set, and altitude events. */
+    long ascent_func_calls;     /**< The number of altitude evaluations made while bracketing those events. */
+    int  max_ascent_depth;      /**< The deepest recursion reached while bracketing those events. */
+}
+astro_search_stats_t;
+
+/**
+ * @brief Identifies an internal calculation measured when Astronomy Engine is built with `ASTRO_PROFILE`.
+ *
+ * Each value names the internal function whose calls and time are counted.
+ * See #Astronomy_ProfileSnapshot.
+ */
+typedef enum
+{
+    ASTRO_PROFILE_CALC_MOON,            /**< Geocentric Moon position, from the Moon cache or from CalcMoonExact. */
+    ASTRO_PROFILE_CALC_MOON_EXACT,      /**< The full lunar theory series. */
+    ASTRO_PROFILE_CALC_MOON_BATCH,      /**< The full lunar theory series for a batch of times. */
+    ASTRO_PROFILE_VSOP_COORDS,          /**< VSOP87 series for one planet at one time. */
+    ASTRO_PROFILE_VSOP_COORDS_BATCH,    /**< VSOP87 series for one planet at a batch of times. */
+    ASTRO_PROFILE_NUTATION_ANGLES,      /**< IAU 2000B nutation series. */
+    ASTRO_PROFILE_NUTATION_MATRIX,      /**< Nutation matrix calculation, when not found in the frame cache. */
+    ASTRO_PROFILE_NUTATION_ROT,         /**< Every request for a nutation rotation. */
+    ASTRO_PROFILE_PRECESSION_MATRIX,    /**< Precession matrix calculation, when not found in the frame cache. */
+    ASTRO_PROFILE_PRECESSION_ROT,       /**< Every request for a precession rotation. */
+    ASTRO_PROFILE_TERRA,                /**< Observer position and velocity relative to the Earth's center. */
+    ASTRO_PROFILE_PLUTO_SEGMENT,        /**< Calculation of a new Pluto gravity simulation segment. */
+    ASTRO_PROFILE_COUNT                 /**< The number of profiled calculations; not a valid identifier. */
+}
+astro_profile_id_t;
+
+/**
+ * @brief The call count and elapsed time for one profiled calculation.
+ *
+ * Ticks come from the processor's cycle or timestamp counter where one is available,
+ * and from `clock()` otherwise. Their length depends on the platform,
+ * so compare tick counts with each other rather than converting them to seconds.
+ */
+typedef struct
+{
+    unsigned long long calls;   /**< The number of times the calculation was performed. */
+    unsigned long long ticks;   /**< The total time spent in those calculations, including nested profiled calculations. */
+}
+astro_profile_counter_t;
+
+/**
+ * @brief A snapshot of the calling thread's profiling counters.
+ *
+ * Returned by #Astronomy_ProfileSnapshot.
+ */
+typedef struct
+{
+    int enabled;                                        /**< 1 if Astronomy Engine was built with `ASTRO_PROFILE`; otherwise 0 and all counters are zero. */
+    astro_profile_counter_t counter[ASTRO_PROFILE_COUNT];  /**< Counters indexed by #astro_profile_id_t. */
+}
+astro_profile_t;
+
 /**
  * @brief
  *      The dates and times of changes of season for a given calendar year.
@@ -616,6 +781,25 @@ astro_func_result_t;
  */
 typedef astro_func_result_t (* astro_search_func_t) (void *context, astro_time_t time);
 
+/**
+ * @brief Selects the root-finding algorithm used by #Astronomy_SearchEx.
+ */
+typedef enum
+{
+    SEARCH_QUADRATIC,       /**< Bisection combined with quadratic interpolation. This is the default. */
+    SEARCH_CHANDRUPATLA     /**< Chandrupatla's method, which usually needs fewer function evaluations per root. */
+}
+astro_search_method_t;
+
+/**
+ * @brief The progress of a search that is waiting for function values from its caller.
+ *
+ * This is an opaque data type that holds the internal state of a search
+ * started by #Astronomy_SearchStateInit, so that many searches can be
+ * interleaved and their function values calculated together.
+ */
+typedef struct astro_search_state_s astro_search_state_t;
+
 /**
  * @brief A pointer to a function that calculates Delta T.
  *
@@ -632,8 +816,30 @@ typedef double (* astro_deltat_func) (double ut);
 
 double Astronomy_DeltaT_EspenakMeeus(double ut);
 double Astronomy_DeltaT_JplHorizons(double ut);
+double Astronomy_DeltaT_Table(double ut);
+
+astro_status_t Astronomy_DeltaTTableLoadFile(const char *filename);
+astro_status_t Astronomy_DeltaTTableLoadBuffer(const char *text, size_t length);
+void Astronomy_DeltaTTableFree(void);
 
 void Astronomy_SetDeltaTFunction(astro_deltat_func func);
+astro_status_t Astronomy_SetFrameInterpolation(double stepDays);
+
+/**
+ * @brief Selects how many terms of the planetary models to calculate.
+ *
+ * See #Astronomy_SetPlanetPrecision for the accuracy of each choice.
+ */
+typedef enum
+{
+    PLANET_PRECISION_FULL,          /**< Calculate every term. This is the default. */
+    PLANET_PRECISION_ARCMINUTE,     /**< Skip the terms that affect positions by much less than an arcminute. */
+    PLANET_PRECISION_LOW            /**< Calculate only the largest terms, for positions accurate to a few arcminutes. */
+}
+astro_planet_precision_t;
+
+astro_status_t Astronomy_SetPlanetPrecision(astro_planet_precision_t precision);
+int Astronomy_PlanetTermCount(astro_body_t body, astro_planet_precision_t precision);
 
 /**
  * @brief Indicates whether a body (especially Mercury or Venus) is best seen in the morning or evening.
@@ -675,6 +881,41 @@ typedef struct
 }
 astro_hour_angle_t;
 
+/**
+ * @brief The kinds of events reported by #Astronomy_Almanac.
+ *
+ * These values are bit flags. Combine them with the `|` operator
+ * to request more than one kind of event from #Astronomy_Almanac.
+ */
+typedef enum
+{
+    ALMANAC_RISE        = 0x01,     /**< The top of the body appears above the horizon. */
+    ALMANAC_SET         = 0x02,     /**< The top of the body disappears below the horizon. */
+    ALMANAC_CULMINATION = 0x04,     /**< The body crosses the observer's meridian (hour angle 0). */
+    ALMANAC_DAWN        = 0x08,     /**< The center of the body ascends through the twilight altitude. */
+    ALMANAC_DUSK        = 0x10      /**< The center of the body descends through the twilight altitude. */
+}
+astro_almanac_kind_t;
+
+/**
+ * @brief An event reported by #Astronomy_Almanac.
+ */
+typedef struct
+{
+    astro_almanac_kind_t    kind;   /**< The kind of event that occurred. */
+    astro_time_t            time;   /**< The date and time of the event. */
+    astro_horizon_t         hor;    /**< For `ALMANAC_CULMINATION`, the apparent coordinates of the body at culmination. For other kinds, all fields are NAN. */
+}
+astro_almanac_event_t;
+
+/**
+ * @brief A callback function that receives events from #Astronomy_Almanac.
+ *
+ * The callback returns 0 to keep receiving events, or any other value
+ * to make #Astronomy_Almanac stop early.
+ */
+typedef int (* astro_almanac_func_t) (void *context, const astro_almanac_event_t *event);
+
 /**
  * @brief Information about the brightness and illuminated shape of a celestial body.
  *
@@ -1045,6 +1286,36 @@ typedef struct
 }
 astro_libration_t;
 
+/**
+ * @brief Selects the information calculated by #Astronomy_MoonGeometry.
+ *
+ * These values are bit flags. Combine them with the `|` operator
+ * to request more than one kind of information.
+ */
+typedef enum
+{
+    MOON_GEOMETRY_VECTOR        = 0x01,     /**< The geocentric EQJ vector, as returned by #Astronomy_GeoMoon. */
+    MOON_GEOMETRY_ECLIPTIC      = 0x02,     /**< The ecliptic coordinates of date, as returned by #Astronomy_EclipticGeoMoon. */
+    MOON_GEOMETRY_LIBRATION     = 0x04,     /**< The libration angles and apparent diameter, as returned by #Astronomy_Libration. */
+    MOON_GEOMETRY_ILLUMINATION  = 0x08,     /**< The magnitude and phase, as returned by #Astronomy_Illumination. */
+    MOON_GEOMETRY_ALL           = 0x0f      /**< All of the above. */
+}
+astro_moon_geometry_flag_t;
+
+/**
+ * @brief Information about the Moon at one time, returned by #Astronomy_MoonGeometry.
+ */
+typedef struct
+{
+    astro_status_t      status;     /**< `ASTRO_SUCCESS` if the requested fields are valid; otherwise an error code. */
+    astro_time_t        time;       /**< The date and time of the calculation. */
+    astro_vector_t      vec;        /**< For `MOON_GEOMETRY_VECTOR`, the Moon's geocentric position in EQJ coordinates. */
+    astro_spherical_t   ecliptic;   /**< For `MOON_GEOMETRY_ECLIPTIC`, the Moon's geocentric ecliptic coordinates of date (ECT). */
+    astro_libration_t   libration;  /**< For `MOON_GEOMETRY_LIBRATION`, the libration angles, distance, and apparent diameter. */
+    astro_illum_t       illum;      /**< For `MOON_GEOMETRY_ILLUMINATION`, the Moon's magnitude and phase. */
+}
+astro_moon_geometry_t;
+
 /**
  * @brief Information about a body's rotation axis at a given time.
  *
@@ -1107,6 +1378,83 @@ typedef struct
 }
 astro_jupiter_moons_t;
 
+/**
+ * @brief Holds the positions and velocities of one body at many times, as separate arrays.
+ *
+ * Batch functions like #Astronomy_JupiterMoonsBatch use this struct to store
+ * a series of state vectors as a structure of arrays, which is convenient
+ * for code that scans one component across many times.
+ * The caller owns the arrays; each must have room for as many values
+ * as there are times in the batch.
+ */
+typedef struct
+{
+    double *x;      /**< Array of x-coordinates of position. */
+    double *y;      /**< Array of y-coordinates of position. */
+    double *z;      /**< Array of z-coordinates of position. */
+    double *vx;     /**< Array of x-components of velocity. */
+    double *vy;     /**< Array of y-components of velocity. */
+    double *vz;     /**< Array of z-components of velocity. */
+}
+astro_state_arrays_t;
+
+/**
+ * @brief Holds the state vectors of all 5 Lagrange points of a pair of co-orbiting bodies.
+ *
+ * Returned by #Astronomy_LagrangePoints and #Astronomy_LagrangePointsBatch.
+ * The `status` field should be checked for `ASTRO_SUCCESS` before using the state vectors.
+ */
+typedef struct
+{
+    astro_status_t status;          /**< `ASTRO_SUCCESS` if the calculation succeeded, or an error code otherwise. */
+    astro_state_vector_t point[5];  /**< The state vectors of L1 through L5, in that order, with respect to the major body's center. */
+}
+astro_lagrange_points_t;
+
+/**
+ * @brief The number of bodies reported by #Astronomy_SolarSystemSnapshot: `BODY_MERCURY` through `BODY_SSB`.
+ */
+#define SNAPSHOT_NUM_BODIES     13
+
+/**
+ * @brief Selects a body in the `bodyMask` parameter of #Astronomy_SolarSystemSnapshot.
+ */
+#define SNAPSHOT_BODY(body)     (1u << (body))
+
+/**
+ * @brief Selects all bodies in the `bodyMask` parameter of #Astronomy_SolarSystemSnapshot.
+ */
+#define SNAPSHOT_ALL_BODIES     ((1u << SNAPSHOT_NUM_BODIES) - 1u)
+
+/**
+ * @brief Heliocentric, barycentric, and geocentric states of one body at one time.
+ *
+ * #Astronomy_SolarSystemSnapshot fills in an array of these, one for each body.
+ */
+typedef struct
+{
+    astro_state_vector_t helio;     /**< Position and velocity relative to the center of the Sun. */
+    astro_state_vector_t bary;      /**< Position and velocity relative to the Solar System Barycenter. */
+    astro_state_vector_t geo;       /**< Geometric position and velocity relative to the center of the Earth. */
+}
+astro_body_snapshot_t;
+
+/**
+ * @brief Remembers recent light travel time solutions to speed up the next one.
+ *
+ * Functions like #Astronomy_CorrectLightTravelEx use this struct to start
+ * the light travel time solver from a prediction based on previous solutions.
+ * To start with no previous solutions, set `count` to 0,
+ * for example by zero-initializing the struct.
+ */
+typedef struct
+{
+    int     count;      /**< The number of previous solutions remembered: 0, 1, or 2. */
+    double  ut[2];      /**< The observation times of the previous solutions, oldest first. */
+    double  days[2];    /**< The light travel times of the previous solutions, in days. */
+}
+astro_light_time_t;
+
 
 /**
  * @brief  Indicates whether a crossing through the ecliptic plane is ascending or descending.
@@ -1143,10 +1491,204 @@ astro_node_event_t;
  */
 typedef struct astro_grav_sim_s astro_grav_sim_t;
 
+/**
+ * @brief Selects the numerical method used by a gravity simulator.
+ *
+ * See #Astronomy_GravSimInitEx.
+ */
+typedef enum
+{
+    GRAVSIM_MEAN_ACCELERATION,  /**< Second-order steps using the mean of the accelerations at both ends. This is the default. */
+    GRAVSIM_HERMITE             /**< Fourth-order Hermite predictor-corrector steps using accelerations and jerks, with optional automatic substeps. */
+}
+astro_gravsim_integrator_t;
+
+/**
+ * @brief Sun and planet states shared by gravity simulators that advance through the same times.
+ *
+ * This is an opaque data type. See #Astronomy_GravSimEphemCreate and #Astronomy_GravSimSetEphem.
+ */
+typedef struct astro_grav_ephem_s astro_grav_ephem_t;
+
+/**
+ * @brief A unit of work that can run on any thread: processes the items `first` through `first+count-1`.
+ */
+typedef void (* astro_work_func_t) (void *workContext, int first, int count);
+
+/**
+ * @brief A caller-supplied function that runs `work` over the items 0 through `count-1`, possibly on multiple threads.
+ *
+ * See #Astronomy_GravSimSetParallel.
+ */
+typedef void (* astro_parallel_func_t) (void *context, int count, astro_work_func_t work, void *workContext);
+
+/**
+ * @brief A data type used for calculating positions at uniformly spaced times.
+ *
+ * This is an opaque data type that holds the internal state of
+ * an incremental evaluator of the periodic series used to calculate
+ * planet positions and the positions of Jupiter's moons.
+ * See #Astronomy_HelioStepperInit and #Astronomy_JupiterMoonsStepperInit.
+ */
+typedef struct astro_stepper_s astro_stepper_t;
+
+/**
+ * @brief A data type used for producing uniformly spaced times.
+ *
+ * This is an opaque data type that holds the internal state of
+ * an iterator over equally spaced times, whose nutation angles and
+ * sidereal time are filled in incrementally.
+ * See #Astronomy_TimeStepperInit.
+ */
+typedef struct astro_time_stepper_s astro_time_stepper_t;
+
+/**
+ * @brief A data type used for tracking one body for one observer at a high rate.
+ *
+ * This is an opaque data type that holds exact positions of a body calculated
+ * occasionally, and the polynomials that interpolate between them.
+ * See #Astronomy_TrackerInit.
+ */
+typedef struct astro_tracker_s astro_tracker_t;
+
+/**
+ * @brief A data type used for finding a body's rise or set times one after another.
+ *
+ * This is an opaque data type that remembers the previous events,
+ * so that it can predict where the next one will be.
+ * See #Astronomy_RiseSetSequenceInit.
+ */
+typedef struct astro_rise_set_sequence_s astro_rise_set_sequence_t;
+
+/**
+ * @brief A binary ephemeris file opened for random access by time.
+ *
+ * This is an opaque data type that refers to a memory-mapped file
+ * of piecewise Chebyshev approximations of a body's position.
+ * See #Astronomy_EphemFileOpen.
+ */
+typedef struct astro_ephem_file_s astro_ephem_file_t;
+
+/**
+ * @brief A set of Astronomy Engine settings and caches.
+ *
+ * This is an opaque data type that holds the Delta T model, user-defined stars,
+ * and internal caches used by Astronomy Engine functions.
+ * Threads can use separate contexts to run independent configurations
+ * without sharing or locking. See #Astronomy_ContextCreate.
+ */
+typedef struct astro_context_s astro_context_t;
+
+/**
+ * @brief A catalog of any number of stars.
+ *
+ * This is an opaque data type that holds the positions and proper motions
+ * of stars in parallel arrays, for calculating positions and events
+ * for all the stars at once. See #Astronomy_StarCatalogCreate.
+ */
+typedef struct astro_star_catalog_s astro_star_catalog_t;
+
+/**
+ * @brief A caller-supplied function that allocates `size` bytes of memory.
+ *
+ * Must return memory aligned for any type, like `malloc`, or NULL if the memory is not available.
+ * See #astro_allocator_t.
+ */
+typedef void * (* astro_alloc_func_t) (void *context, size_t size);
+
+/**
+ * @brief A caller-supplied function that releases memory returned by the matching #astro_alloc_func_t.
+ */
+typedef void (* astro_free_func_t) (void *context, void *ptr);
+
+/**
+ * @brief Functions that Astronomy Engine uses to allocate and release dynamic memory.
+ *
+ * See #Astronomy_ContextSetAllocator.
+ */
+typedef struct
+{
+    astro_alloc_func_t  alloc;      /**< Allocates memory. */
+    astro_free_func_t   free;       /**< Releases memory, or NULL if memory is released some other way, as with an arena. */
+    void               *context;    /**< An arbitrary pointer passed to `alloc` and `free`. */
+}
+astro_allocator_t;
+
+/**
+ * @brief A memory pool that releases all of its allocations at once.
+ *
+ * This is an opaque data type. See #Astronomy_ArenaCreate.
+ */
+typedef struct astro_arena_s astro_arena_t;
+
+/**
+ * @brief The VSOP87 series for one planet, stored as flat arrays.
+ *
+ * The three formulas are, in order, the planet's heliocentric ecliptic longitude,
+ * latitude, and distance. Each formula is a list of series, and series `s` of a formula
+ * is multiplied by the `s`th power of the time in millennia since J2000.
+ * Every term of every series is stored in the arrays `amplitude`, `phase`, and `frequency`,
+ * and `series_start` tells where each series begins in them.
+ * To evaluate the model in another memory space, such as a GPU, copy those four arrays
+ * along with `formula_start`, then call #Astronomy_KernelVsop or an equivalent kernel there.
+ *
+ * Created by #Astronomy_VsopTableInit and released by #Astronomy_VsopTableFree.
+ */
+typedef struct
+{
+    int                 nterms;             /**< The total number of terms in all the series. */
+    int                 nseries;            /**< The total number of series in all three formulas. */
+    int                 formula_start[4];   /**< Series `formula_start[k]` through `formula_start[k+1]-1` belong to formula `k`. */
+    int                *series_start;       /**< `nseries+1` offsets: terms `series_start[s]` through `series_start[s+1]-1` belong to series `s`. */
+    double             *amplitude;          /**< The amplitude of each term. */
+    double             *phase;              /**< The phase of each term [radians]. */
+    double             *frequency;          /**< The frequency of each term [radians per millennium]. */
+    astro_allocator_t   allocator;          /**< The allocator that owns the arrays. */
+}
+astro_vsop_table_t;
+
+/**
+ * @brief The point masses whose gravity is summed by #Astronomy_KernelAccelerations.
+ *
+ * All arrays have `count` elements. The caller owns them.
+ */
+typedef struct
+{
+    int             count;      /**< The number of gravitating bodies. */
+    const double   *gm;         /**< The product of the gravitational constant and each body's mass [au^3/day^2]. */
+    const double   *x;          /**< The x-coordinate of each body [au]. */
+    const double   *y;          /**< The y-coordinate of each body [au]. */
+    const double   *z;          /**< The z-coordinate of each body [au]. */
+}
+astro_gravity_field_t;
+
 
 /*---------- functions ----------*/
 
 void Astronomy_Reset(void);
+
+astro_status_t Astronomy_ContextCreate(astro_context_t **ctxOut);
+void Astronomy_ContextFree(astro_context_t *ctx);
+astro_context_t *Astronomy_SetThreadContext(astro_context_t *ctx);
+void Astronomy_ContextSetAllocator(astro_context_t *ctx, const astro_allocator_t *allocator);
+astro_status_t Astronomy_ArenaCreate(astro_arena_t **arenaOut, size_t blockSize);
+astro_allocator_t Astronomy_ArenaAllocator(astro_arena_t *arena);
+size_t Astronomy_ArenaBytesUsed(const astro_arena_t *arena);
+void Astronomy_ArenaReset(astro_arena_t *arena);
+void Astronomy_ArenaFree(astro_arena_t *arena);
+astro_time_t Astronomy_MakeTimeCtx(astro_context_t *ctx, int year, int month, int day, int hour, int minute, double second);
+astro_time_t Astronomy_TimeFromDaysCtx(astro_context_t *ctx, double ut);
+astro_vector_t Astronomy_HelioVectorCtx(astro_context_t *ctx, astro_body_t body, astro_time_t time);
+astro_vector_t Astronomy_GeoVectorCtx(astro_context_t *ctx, astro_body_t body, astro_time_t time, astro_aberration_t aberration);
+astro_equatorial_t Astronomy_EquatorCtx(
+    astro_context_t *ctx,
+    astro_body_t body,
+    astro_time_t *time,
+    astro_observer_t observer,
+    astro_equator_date_t equdate,
+    astro_aberration_t aberration
+);
+astro_constellation_t Astronomy_ConstellationCtx(astro_context_t *ctx, double ra, double dec);
 double Astronomy_VectorLength(astro_vector_t vector);
 astro_angle_result_t Astronomy_AngleBetween(astro_vector_t a, astro_vector_t b);
 const char *Astronomy_BodyName(astro_body_t body);
@@ -1157,20 +1699,97 @@ astro_time_t Astronomy_MakeTime(int year, int month, int day, int hour, int minu
 astro_time_t Astronomy_TimeFromUtc(astro_utc_t utc);
 astro_utc_t  Astronomy_UtcFromTime(astro_time_t time);
 astro_status_t Astronomy_FormatTime(astro_time_t time, astro_time_format_t format, char *text, size_t size);
+astro_status_t Astronomy_FormatTimeBatch(const astro_time_t *times, size_t count, astro_time_format_t format, char *text);
+astro_status_t Astronomy_ParseTime(const char *text, astro_time_t *time);
+astro_status_t Astronomy_ParseTimeBatch(const char * const *texts, size_t count, astro_time_t *times);
 astro_time_t Astronomy_TimeFromDays(double ut);
 astro_time_t Astronomy_TerrestrialTime(double tt);
 astro_time_t Astronomy_AddDays(astro_time_t time, double days);
 double Astronomy_SiderealTime(astro_time_t *time);
+
+astro_status_t Astronomy_TimeStepperInit(
+    astro_time_stepper_t **stepperOut,
+    astro_time_t startTime,
+    double stepDays,
+    int resyncSteps
+);
+
+astro_time_t Astronomy_TimeStepperNext(astro_time_stepper_t *stepper);
+void Astronomy_TimeStepperFree(astro_time_stepper_t *stepper);
 astro_func_result_t Astronomy_HelioDistance(astro_body_t body, astro_time_t time);
 astro_vector_t Astronomy_HelioVector(astro_body_t body, astro_time_t time);
+astro_status_t Astronomy_HelioVectorBatch(astro_body_t body, const astro_time_t *times, size_t n, astro_vector_t *out);
+astro_status_t Astronomy_HelioVectorTerse(astro_body_t body, const astro_time_t *times, size_t n, astro_terse_vector_t *out);
+astro_status_t Astronomy_HelioStateTerse(astro_body_t body, const astro_time_t *times, size_t n, astro_terse_state_t *out);
+
+astro_status_t Astronomy_HelioStepperInit(
+    astro_stepper_t **stepperOut,
+    astro_body_t body,
+    astro_time_t startTime,
+    double stepDays,
+    int resyncSteps
+);
+
+astro_status_t Astronomy_JupiterMoonsStepperInit(
+    astro_stepper_t **stepperOut,
+    astro_time_t startTime,
+    double stepDays,
+    int resyncSteps
+);
+
+astro_status_t Astronomy_EphemerisCacheInit(
+    astro_body_t body,
+    astro_time_t startTime,
+    astro_time_t stopTime,
+    double toleranceKm
+);
+
+void Astronomy_EphemerisCacheFree(astro_body_t body);
+astro_status_t Astronomy_MoonCacheInit(astro_time_t startTime, astro_time_t stopTime, double toleranceKm);
+void Astronomy_MoonCacheFree(void);
+
+astro_status_t Astronomy_PlutoCacheWarm(astro_time_t startTime, astro_time_t stopTime);
+astro_status_t Astronomy_PlutoCacheSave(const char *filename);
+astro_status_t Astronomy_PlutoCacheLoad(const char *filename);
+
+/**
+ * @brief Selects how Pluto's position is calculated.
+ *
+ * See #Astronomy_SetPlutoModel.
+ */
+typedef enum
+{
+    PLUTO_MODEL_INTEGRATOR,         /**< Interpolate a gravity simulation anchored to Pluto's state table. This is the default. */
+    PLUTO_MODEL_SERIES_OUTSIDE,     /**< Use the series loaded by #Astronomy_PlutoSeriesLoad outside the years 0000..4000. */
+    PLUTO_MODEL_SERIES              /**< Use the series loaded by #Astronomy_PlutoSeriesLoad at all times. */
+}
+astro_pluto_model_t;
+
+astro_status_t Astronomy_PlutoSeriesLoad(const char *filename);
+void Astronomy_PlutoSeriesFree(void);
+astro_status_t Astronomy_SetPlutoModel(astro_pluto_model_t model);
+
+astro_status_t Astronomy_EphemFileOpen(astro_ephem_file_t **fileOut, const char *filename);
+astro_vector_t Astronomy_EphemFileVector(const astro_ephem_file_t *file, astro_time_t time);
+void Astronomy_EphemFileClose(astro_ephem_file_t *file);
+
+astro_vector_t Astronomy_HelioStepperNext(astro_stepper_t *stepper);
+astro_jupiter_moons_t Astronomy_JupiterMoonsStepperNext(astro_stepper_t *stepper);
+astro_time_t Astronomy_StepperTime(astro_stepper_t *stepper);
+void Astronomy_StepperFree(astro_stepper_t *stepper);
+
 astro_vector_t Astronomy_GeoVector(astro_body_t body, astro_time_t time, astro_aberration_t aberration);
+astro_vector_t Astronomy_GeoVectorEx(astro_body_t body, astro_time_t time, astro_aberration_t aberration, astro_light_time_t *lightTime);
 astro_vector_t Astronomy_GeoMoon(astro_time_t time);
+astro_status_t Astronomy_GeoMoonBatch(const astro_time_t *times, size_t n, astro_vector_t *out);
 astro_spherical_t Astronomy_EclipticGeoMoon(astro_time_t time);
 astro_state_vector_t Astronomy_GeoMoonState(astro_time_t time);
 astro_state_vector_t Astronomy_GeoEmbState(astro_time_t time);
 astro_libration_t Astronomy_Libration(astro_time_t time);
+astro_moon_geometry_t Astronomy_MoonGeometry(astro_time_t time, unsigned flags);
 astro_state_vector_t Astronomy_BaryState(astro_body_t body, astro_time_t time);
 astro_state_vector_t Astronomy_HelioState(astro_body_t body, astro_time_t time);
+astro_status_t Astronomy_SolarSystemSnapshot(astro_time_t time, unsigned bodyMask, astro_body_snapshot_t *out);
 
 double Astronomy_MassProduct(astro_body_t body);
 double Astronomy_PlanetOrbitalPeriod(astro_body_t body);
@@ -1190,7 +1809,22 @@ astro_state_vector_t Astronomy_LagrangePointFast(
     double minor_mass
 );
 
+astro_lagrange_points_t Astronomy_LagrangePoints(
+    astro_time_t time,
+    astro_body_t major_body,
+    astro_body_t minor_body
+);
+
+astro_status_t Astronomy_LagrangePointsBatch(
+    const astro_time_t *times,
+    size_t n,
+    astro_body_t major_body,
+    astro_body_t minor_body,
+    astro_lagrange_points_t *points
+);
+
 astro_jupiter_moons_t Astronomy_JupiterMoons(astro_time_t time);
+astro_status_t Astronomy_JupiterMoonsBatch(const astro_time_t *times, size_t n, const astro_state_arrays_t *moons);
 
 astro_equatorial_t Astronomy_Equator(
     astro_body_t body,
@@ -1212,8 +1846,30 @@ astro_state_vector_t Astronomy_ObserverState(
     astro_equator_date_t equdate
 );
 
+astro_status_t Astronomy_ObserverGrid(
+    astro_time_t *time,
+    const double *latitudes,
+    size_t nlat,
+    const double *longitudes,
+    size_t nlon,
+    double height,
+    astro_equator_date_t equdate,
+    astro_vector_t *vectors,
+    astro_rotation_t *rotations
+);
+
 astro_observer_t Astronomy_VectorObserver(astro_vector_t *vector, astro_equator_date_t equdate);
 
+astro_status_t Astronomy_VectorObserverBatch(
+    astro_time_t *time,
+    astro_equator_date_t equdate,
+    size_t n,
+    const double *x,
+    const double *y,
+    const double *z,
+    astro_observer_t *observers
+);
+
 double Astronomy_ObserverGravity(double latitude, double height);
 
 astro_ecliptic_t Astronomy_SunPosition(astro_time_t time);
@@ -1227,9 +1883,62 @@ astro_horizon_t Astronomy_Horizon(
     double dec,
     astro_refraction_t refraction);
 
+astro_frame_t Astronomy_MakeFrame(astro_time_t time);
+astro_vector_t Astronomy_GeoVectorFrame(astro_body_t body, const astro_frame_t *frame, astro_aberration_t aberration);
+
+astro_equatorial_t Astronomy_EquatorFrame(
+    astro_body_t body,
+    const astro_frame_t *frame,
+    astro_observer_t observer,
+    astro_equator_date_t equdate,
+    astro_aberration_t aberration
+);
+
+astro_horizon_t Astronomy_HorizonFrame(
+    const astro_frame_t *frame,
+    astro_observer_t observer,
+    double ra,
+    double dec,
+    astro_refraction_t refraction);
+
+astro_status_t Astronomy_TrackerInit(
+    astro_tracker_t **trackerOut,
+    astro_body_t body,
+    astro_observer_t observer,
+    astro_refraction_t refraction,
+    double refreshSeconds);
+
+astro_status_t Astronomy_TrackerUpdate(
+    astro_tracker_t *tracker,
+    astro_time_t time,
+    astro_equatorial_t *equ,
+    astro_horizon_t *hor);
+
+void Astronomy_TrackerFree(astro_tracker_t *tracker);
+
 astro_angle_result_t Astronomy_AngleFromSun(astro_body_t body, astro_time_t time);
 astro_elongation_t Astronomy_Elongation(astro_body_t body, astro_time_t time);
 astro_elongation_t Astronomy_SearchMaxElongation(astro_body_t body, astro_time_t startTime);
+
+astro_status_t Astronomy_ElongationCatalog(
+    astro_body_t body,
+    astro_time_t startTime,
+    astro_time_t stopTime,
+    astro_elongation_t *events,
+    size_t capacity,
+    size_t *count
+);
+
+astro_status_t Astronomy_ElongationCatalogParallel(
+    astro_body_t body,
+    astro_time_t startTime,
+    astro_time_t stopTime,
+    astro_parallel_func_t parallel,
+    void *context,
+    astro_elongation_t *events,
+    size_t capacity,
+    size_t *count
+);
 astro_angle_result_t Astronomy_PairLongitude(astro_body_t body1, astro_body_t body2, astro_time_t time);
 
 /** @cond DOXYGEN_SKIP */
@@ -1246,12 +1955,69 @@ astro_lunar_eclipse_t Astronomy_SearchLunarEclipse(astro_time_t startTime);
 astro_lunar_eclipse_t Astronomy_NextLunarEclipse(astro_time_t prevEclipseTime);
 astro_global_solar_eclipse_t Astronomy_SearchGlobalSolarEclipse(astro_time_t startTime);
 astro_global_solar_eclipse_t Astronomy_NextGlobalSolarEclipse(astro_time_t prevEclipseTime);
+astro_status_t Astronomy_LunarEclipseCatalog(
+    astro_time_t startTime,
+    astro_time_t stopTime,
+    astro_lunar_eclipse_t *eclipses,
+    size_t capacity,
+    size_t *count);
+astro_status_t Astronomy_GlobalSolarEclipseCatalog(
+    astro_time_t startTime,
+    astro_time_t stopTime,
+    astro_global_solar_eclipse_t *eclipses,
+    size_t capacity,
+    size_t *count);
+astro_status_t Astronomy_LunarEclipseCatalogParallel(
+    astro_time_t startTime,
+    astro_time_t stopTime,
+    astro_parallel_func_t parallel,
+    void *context,
+    astro_lunar_eclipse_t *eclipses,
+    size_t capacity,
+    size_t *count);
+astro_status_t Astronomy_GlobalSolarEclipseCatalogParallel(
+    astro_time_t startTime,
+    astro_time_t stopTime,
+    astro_parallel_func_t parallel,
+    void *context,
+    astro_global_solar_eclipse_t *eclipses,
+    size_t capacity,
+    size_t *count);
 astro_local_solar_eclipse_t Astronomy_SearchLocalSolarEclipse(astro_time_t startTime, astro_observer_t observer);
 astro_local_solar_eclipse_t Astronomy_NextLocalSolarEclipse(astro_time_t prevEclipseTime, astro_observer_t observer);
+astro_status_t Astronomy_LocalSolarEclipseBatch(
+    astro_time_t eclipseTime,
+    const astro_observer_t *observers,
+    size_t count,
+    astro_local_solar_eclipse_t *results);
 astro_transit_t Astronomy_SearchTransit(astro_body_t body, astro_time_t startTime);
 astro_transit_t Astronomy_NextTransit(astro_body_t body, astro_time_t prevTransitTime);
+
+astro_status_t Astronomy_TransitCatalog(
+    astro_body_t body,
+    astro_time_t startTime,
+    astro_time_t stopTime,
+    astro_transit_t *transits,
+    size_t capacity,
+    size_t *count
+);
+
+astro_status_t Astronomy_TransitCatalogParallel(
+    astro_body_t body,
+    astro_time_t startTime,
+    astro_time_t stopTime,
+    astro_parallel_func_t parallel,
+    void *context,
+    astro_transit_t *transits,
+    size_t capacity,
+    size_t *count
+);
 astro_node_event_t Astronomy_SearchMoonNode(astro_time_t startTime);
 astro_node_event_t Astronomy_NextMoonNode(astro_node_event_t prevNode);
+astro_status_t Astronomy_LunarEventCacheInit(astro_time_t startTime, astro_time_t stopTime);
+astro_status_t Astronomy_LunarEventCacheSave(const char *filename);
+astro_status_t Astronomy_LunarEventCacheLoad(const char *filename);
+void Astronomy_LunarEventCacheFree(void);
 
 astro_search_result_t Astronomy_Search(
     astro_search_func_t func,
@@ -1260,6 +2026,32 @@ astro_search_result_t Astronomy_Search(
     astro_time_t t2,
     double dt_tolerance_seconds);
 
+astro_search_result_t Astronomy_SearchEx(
+    astro_search_func_t func,
+    void *context,
+    astro_time_t t1,
+    astro_time_t t2,
+    double dt_tolerance_seconds,
+    astro_search_method_t method);
+
+astro_status_t Astronomy_SearchStateInit(
+    astro_search_state_t **stateOut,
+    astro_time_t t1,
+    astro_time_t t2,
+    double dt_tolerance_seconds,
+    astro_search_method_t method);
+
+int Astronomy_SearchStatePending(const astro_search_state_t *state, astro_time_t *time);
+astro_status_t Astronomy_SearchStateResume(astro_search_state_t *state, astro_func_result_t value);
+astro_search_result_t Astronomy_SearchStateResult(const astro_search_state_t *state);
+void Astronomy_SearchStateFree(astro_search_state_t *state);
+
+astro_status_t Astronomy_SetSearchMethod(astro_search_method_t method);
+astro_search_stats_t *Astronomy_SetSearchStats(astro_search_stats_t *stats);
+astro_profile_t Astronomy_ProfileSnapshot(void);
+void Astronomy_ProfileReset(void);
+const char *Astronomy_ProfileName(astro_profile_id_t id);
+
 astro_search_result_t Astronomy_SearchSunLongitude(
     double targetLon,
     astro_time_t startTime,
@@ -1272,6 +2064,15 @@ astro_hour_angle_t Astronomy_SearchHourAngleEx(
     astro_time_t startTime,
     int direction);
 
+astro_status_t Astronomy_SearchHourAngleBatch(
+    const astro_body_t *bodies,
+    size_t count,
+    astro_observer_t observer,
+    double hourAngle,
+    astro_time_t startTime,
+    int direction,
+    astro_hour_angle_t *results);
+
 astro_func_result_t Astronomy_HourAngle(
     astro_body_t body,
     astro_time_t *time,
@@ -1292,6 +2093,68 @@ astro_search_result_t Astronomy_SearchRiseSet(
     astro_time_t startTime,
     double limitDays);
 
+astro_status_t Astronomy_SearchRiseSetBatch(
+    astro_body_t body,
+    const astro_observer_t *observers,
+    size_t count,
+    astro_direction_t direction,
+    astro_time_t startTime,
+    double limitDays,
+    astro_search_result_t *results);
+
+astro_status_t Astronomy_RiseSetSequenceInit(
+    astro_rise_set_sequence_t **sequenceOut,
+    astro_body_t body,
+    astro_observer_t observer,
+    astro_direction_t direction,
+    astro_time_t startTime);
+
+astro_search_result_t Astronomy_RiseSetSequenceNext(astro_rise_set_sequence_t *sequence, double limitDays);
+void Astronomy_RiseSetSequenceFree(astro_rise_set_sequence_t *sequence);
+
+astro_status_t Astronomy_StarCatalogCreate(
+    astro_star_catalog_t **catalogOut,
+    size_t count,
+    const double *ra,
+    const double *dec,
+    const double *distanceLightYears,
+    const double *pmRa,
+    const double *pmDec);
+
+void Astronomy_StarCatalogFree(astro_star_catalog_t *catalog);
+size_t Astronomy_StarCatalogCount(const astro_star_catalog_t *catalog);
+
+astro_status_t Astronomy_StarCatalogEquator(
+    const astro_star_catalog_t *catalog,
+    astro_time_t *time,
+    astro_observer_t observer,
+    astro_equator_date_t equdate,
+    astro_aberration_t aberration,
+    astro_equatorial_t *results);
+
+astro_status_t Astronomy_StarCatalogHorizon(
+    const astro_star_catalog_t *catalog,
+    astro_time_t *time,
+    astro_observer_t observer,
+    astro_refraction_t refraction,
+    astro_horizon_t *results);
+
+astro_status_t Astronomy_StarCatalogSearchRiseSet(
+    const astro_star_catalog_t *catalog,
+    astro_observer_t observer,
+    astro_direction_t direction,
+    astro_time_t startTime,
+    double limitDays,
+    astro_search_result_t *results);
+
+astro_status_t Astronomy_StarCatalogSearchHourAngle(
+    const astro_star_catalog_t *catalog,
+    astro_observer_t observer,
+    double hourAngle,
+    astro_time_t startTime,
+    int direction,
+    astro_hour_angle_t *results);
+
 astro_search_result_t Astronomy_SearchAltitude(
     astro_body_t body,
     astro_observer_t observer,
@@ -1300,10 +2163,32 @@ astro_search_result_t Astronomy_SearchAltitude(
     double limitDays,
     double altitude);
 
+astro_status_t Astronomy_Almanac(
+    astro_body_t body,
+    astro_observer_t observer,
+    astro_time_t startTime,
+    double limitDays,
+    int kinds,
+    double twilightAltitude,
+    astro_almanac_func_t func,
+    void *context);
+
+astro_status_t Astronomy_SearchTwilight(
+    astro_observer_t observer,
+    astro_time_t startTime,
+    double limitDays,
+    const double *altitudes,
+    size_t count,
+    astro_search_result_t *dawn,
+    astro_search_result_t *dusk);
+
 astro_axis_t Astronomy_RotationAxis(astro_body_t body, astro_time_t *time);
 
 astro_seasons_t Astronomy_Seasons(int year);
+astro_status_t Astronomy_SeasonsCacheWarm(int firstYear, int lastYear);
 astro_illum_t Astronomy_Illumination(astro_body_t body, astro_time_t time);
+astro_status_t Astronomy_IlluminationBatch(astro_body_t body, const astro_time_t *times, size_t count, astro_illum_t *results);
+astro_status_t Astronomy_IlluminationBodies(const astro_body_t *bodies, size_t count, astro_time_t time, astro_illum_t *results);
 astro_illum_t Astronomy_SearchPeakMagnitude(astro_body_t body, astro_time_t startTime);
 astro_apsis_t Astronomy_SearchLunarApsis(astro_time_t startTime);
 astro_apsis_t Astronomy_NextLunarApsis(astro_apsis_t apsis);
@@ -1321,6 +2206,37 @@ astro_vector_t Astronomy_VectorFromHorizon(astro_spherical_t sphere, astro_time_
 astro_spherical_t Astronomy_HorizonFromVector(astro_vector_t vector, astro_refraction_t refraction);
 astro_vector_t Astronomy_RotateVector(astro_rotation_t rotation, astro_vector_t vector);
 astro_state_vector_t Astronomy_RotateState(astro_rotation_t rotation, astro_state_vector_t state);
+astro_status_t Astronomy_RotateVectorsTerse(
+    const astro_rotation_t *rotation,
+    size_t n,
+    const astro_terse_vector_t *in,
+    astro_terse_vector_t *out);
+
+astro_status_t Astronomy_SphereFromVectorsTerse(size_t n, const astro_terse_vector_t *in, astro_terse_spherical_t *out);
+
+astro_status_t Astronomy_RotationFloat(astro_rotation_t rotation, astro_rotation_float_t *out);
+
+astro_status_t Astronomy_RotateVectorsFloat(
+    const astro_rotation_float_t *rotation,
+    size_t n,
+    const astro_float_vectors_t *in,
+    const astro_float_vectors_t *out);
+
+astro_status_t Astronomy_HorizonFloat(
+    const astro_rotation_float_t *rotation,
+    size_t n,
+    const float *ra,
+    const float *dec,
+    float *azimuth,
+    float *altitude);
+
+astro_status_t Astronomy_HorizonVectorsFloat(
+    const astro_rotation_float_t *rotation,
+    size_t n,
+    const astro_float_vectors_t *in,
+    astro_refraction_t refraction,
+    float *azimuth,
+    float *altitude);
 
 astro_rotation_t Astronomy_Rotation_EQD_EQJ(astro_time_t *time);
 astro_rotation_t Astronomy_Rotation_EQD_ECL(astro_time_t *time);
@@ -1345,6 +2261,11 @@ double Astronomy_Refraction(astro_refraction_t refraction, double altitude);
 double Astronomy_InverseRefraction(astro_refraction_t refraction, double bent_altitude);
 
 astro_constellation_t Astronomy_Constellation(double ra, double dec);
+astro_status_t Astronomy_ConstellationBatch(
+    const double *ra,
+    const double *dec,
+    size_t count,
+    astro_constellation_t *results);
 
 astro_status_t Astronomy_GravSimInit(
     astro_grav_sim_t **simOut,
@@ -1354,6 +2275,16 @@ astro_status_t Astronomy_GravSimInit(
     const astro_state_vector_t *bodyStateArray
 );
 
+astro_status_t Astronomy_GravSimInitEx(
+    astro_grav_sim_t **simOut,
+    astro_body_t originBody,
+    astro_time_t time,
+    int numBodies,
+    const astro_state_vector_t *bodyStateArray,
+    astro_gravsim_integrator_t integrator,
+    double stepFactor
+);
+
 astro_status_t Astronomy_GravSimUpdate(
     astro_grav_sim_t *sim,
     astro_time_t time,
@@ -1370,6 +2301,14 @@ astro_time_t Astronomy_GravSimTime(astro_grav_sim_t *sim);
 int Astronomy_GravSimNumBodies(astro_grav_sim_t *sim);
 astro_body_t Astronomy_GravSimOrigin(astro_grav_sim_t *sim);
 void Astronomy_GravSimSwap(astro_grav_sim_t *sim);
+void Astronomy_GravSimSetParallel(astro_grav_sim_t *sim, astro_parallel_func_t parallel, void *context);
+void Astronomy_GravSimSetEphem(astro_grav_sim_t *sim, astro_grav_ephem_t *ephem);
+astro_status_t Astronomy_GravSimClone(astro_grav_sim_t **cloneOut, const astro_grav_sim_t *sim);
+size_t Astronomy_GravSimSnapshotSize(const astro_grav_sim_t *sim);
+astro_status_t Astronomy_GravSimSnapshot(const astro_grav_sim_t *sim, void *buffer, size_t size);
+astro_status_t Astronomy_GravSimRestore(astro_grav_sim_t **simOut, const void *buffer, size_t size);
+astro_status_t Astronomy_GravSimEphemCreate(astro_grav_ephem_t **ephemOut, int capacity);
+void Astronomy_GravSimEphemFree(astro_grav_ephem_t *ephem);
 void Astronomy_GravSimFree(astro_grav_sim_t *sim);
 
 /**
@@ -1390,6 +2329,13 @@ astro_vector_t Astronomy_CorrectLightTravel(
     astro_time_t time
 );
 
+astro_vector_t Astronomy_CorrectLightTravelEx(
+    void *context,
+    astro_position_func_t func,
+    astro_time_t time,
+    astro_light_time_t *lightTime
+);
+
 astro_vector_t Astronomy_BackdatePosition(
     astro_time_t time,
     astro_body_t observerBody,
@@ -1397,6 +2343,14 @@ astro_vector_t Astronomy_BackdatePosition(
     astro_aberration_t aberration
 );
 
+astro_vector_t Astronomy_BackdatePositionEx(
+    astro_time_t time,
+    astro_body_t observerBody,
+    astro_body_t targetBody,
+    astro_aberration_t aberration,
+    astro_light_time_t *lightTime
+);
+
 astro_status_t Astronomy_DefineStar(
     astro_body_t body,
     double ra,
@@ -1404,6 +2358,48 @@ astro_status_t Astronomy_DefineStar(
     double distanceLightYears
 );
 
+astro_status_t Astronomy_VsopTableInit(astro_vsop_table_t *table, astro_body_t body);
+void Astronomy_VsopTableFree(astro_vsop_table_t *table);
+
+astro_status_t Astronomy_KernelVsop(
+    const astro_vsop_table_t *table,
+    size_t n,
+    const double *tt,
+    double *x,
+    double *y,
+    double *z
+);
+
+astro_status_t Astronomy_KernelMoon(
+    size_t n,
+    const double *tt,
+    double *lon,
+    double *lat,
+    double *dist
+);
+
+astro_status_t Astronomy_KernelRotate(
+    const astro_rotation_t *rotation,
+    size_t n,
+    const double *x,
+    const double *y,
+    const double *z,
+    double *rx,
+    double *ry,
+    double *rz
+);
+
+astro_status_t Astronomy_KernelAccelerations(
+    const astro_gravity_field_t *field,
+    size_t n,
+    const double *x,
+    const double *y,
+    const double *z,
+    double *ax,
+    double *ay,
+    double *az
+);
+
 #ifdef __cplusplus
 }
 #endif
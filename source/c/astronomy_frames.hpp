@@ -0,0 +1,404 @@
+/*
+    Astronomy Engine for C/C++.
+    https://github.com/cosinekitty/astronomy
+
+    MIT License
+
+    Copyright (c) 2019-2023 Don Cross <cosinekitty@gmail.com>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+/*
+    astronomy_frames.hpp  -  optional C++17 layer over astronomy.h
+
+    Vectors and rotation matrices are tagged with the coordinate frame
+    they belong to, so that using a rotation on a vector in the wrong frame,
+    or combining two rotations whose frames do not meet, is a compile error.
+
+        Frame tag   Orientation
+        ---------   -----------------------------------------------
+        EQJ         equator of J2000
+        ECL         mean ecliptic of J2000
+        EQD         true equator of date
+        ECT         true ecliptic of date
+        HOR         horizontal (observer's local horizon)
+        GAL         galactic (IAU 1958)
+
+    Rotation<To, From> converts vectors in frame `From` to frame `To`.
+    Rotations combine right to left, like matrices: if `a` is a
+    Rotation<ECL, EQJ> and `b` is a Rotation<GAL, ECL>, then `b * a`
+    is a Rotation<GAL, EQJ> that performs `a` first and then `b`.
+
+    The rotations among EQJ, ECL, and GAL do not depend on time.
+    ConstantRotation<To, From>() returns them, and any chain of them,
+    as constexpr data, so the product is folded by the compiler:
+
+        constexpr auto ecl_gal = astronomy::ConstantRotation<astronomy::GAL, astronomy::ECL>();
+
+    The other rotations depend on time (and HOR on the observer).
+    MakeRotation calls the C functions once, checks the status once,
+    and returns a plain matrix that can then be used in an inner loop
+    with no status or time fields to carry along:
+
+        astronomy::Rotation<astronomy::HOR, astronomy::EQJ> rot;
+        if (ASTRO_SUCCESS == astronomy::MakeRotation(rot, &time, observer))
+            astronomy::Rotate(rot, count, input, output);
+*/
+
+#ifndef __ASTRONOMY_FRAMES_HPP
+#define __ASTRONOMY_FRAMES_HPP
+
+#if !defined(__cplusplus) || (__cplusplus < 201703L && !(defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+#error "astronomy_frames.hpp requires C++17 or later."
+#endif
+
+#include <stddef.h>
+#include "astronomy.h"
+
+namespace astronomy
+{
+    /**
+     * @brief Identifies the orientation of a coordinate frame.
+     */
+    enum FrameTag
+    {
+        EQJ,    /**< equator of J2000 */
+        ECL,    /**< mean ecliptic of J2000 */
+        EQD,    /**< true equator of date */
+        ECT,    /**< true ecliptic of date */
+        HOR,    /**< horizontal coordinates for an observer */
+        GAL     /**< galactic coordinates (IAU 1958) */
+    };
+
+    /**
+     * @brief An empty type that names a coordinate frame, for use in overloads.
+     */
+    template <FrameTag F>
+    struct Frame
+    {
+        static constexpr FrameTag tag = F;
+    };
+
+    /**
+     * @brief A Cartesian vector whose orientation is the frame `F`.
+     *
+     * The layout is the same as #astro_terse_vector_t.
+     */
+    template <FrameTag F>
+    struct Vector
+    {
+        double x;
+        double y;
+        double z;
+
+        static constexpr Vector FromC(const astro_terse_vector_t &v)
+        {
+            return Vector { v.x, v.y, v.z };
+        }
+
+        static constexpr Vector FromC(const astro_vector_t &v)
+        {
+            return Vector { v.x, v.y, v.z };
+        }
+
+        constexpr astro_terse_vector_t ToC() const
+        {
+            return astro_terse_vector_t { x, y, z };
+        }
+    };
+
+    /**
+     * @brief A rotation matrix that converts vectors in frame `From` to frame `To`.
+     *
+     * The elements of `rot` have the same meaning as in #astro_rotation_t,
+     * but there is no status field: a Rotation is always valid.
+     */
+    template <FrameTag To, FrameTag From>
+    struct Rotation
+    {
+        double rot[3][3];
+
+        /** @brief Converts to the C structure, with status ASTRO_SUCCESS. */
+        astro_rotation_t ToC() const
+        {
+            astro_rotation_t r;
+            int i, j;
+
+            r.status = ASTRO_SUCCESS;
+            for (i = 0; i < 3; ++i)
+                for (j = 0; j < 3; ++j)
+                    r.rot[i][j] = rot[i][j];
+            return r;
+        }
+
+        /** @brief The rotation in the reverse direction. */
+        constexpr Rotation<From, To> Inverse() const
+        {
+            return Rotation<From, To> {{
+                { rot[0][0], rot[1][0], rot[2][0] },
+                { rot[0][1], rot[1][1], rot[2][1] },
+                { rot[0][2], rot[1][2], rot[2][2] }
+            }};
+        }
+    };
+
+    /**
+     * @brief Combines two rotations: `b * a` performs `a` first and then `b`.
+     *
+     * The arithmetic is the same as #Astronomy_CombineRotation(a, b).
+     */
+    template <FrameTag To, FrameTag Mid1, FrameTag Mid2, FrameTag From>
+    constexpr Rotation<To, From> operator * (const Rotation<To, Mid1> &b, const Rotation<Mid2, From> &a)
+    {
+        static_assert(Mid1 == Mid2, "Cannot combine rotations: the output frame of the first does not match the input frame of the second.");
+        Rotation<To, From> c {};
+
+        for (int i = 0; i < 3; ++i)
+            for (int j = 0; j < 3; ++j)
+                c.rot[i][j] = b.rot[0][j]*a.rot[i][0] + b.rot[1][j]*a.rot[i][1] + b.rot[2][j]*a.rot[i][2];
+        return c;
+    }
+
+    /**
+     * @brief Applies a rotation to a vector in the rotation's input frame.
+     *
+     * The arithmetic is the same as #Astronomy_RotateVector.
+     */
+    template <FrameTag To, FrameTag From, FrameTag F>
+    constexpr Vector<To> operator * (const Rotation<To, From> &r, const Vector<F> &v)
+    {
+        static_assert(F == From, "Cannot rotate vector: it is not in the input frame of the rotation.");
+        return Vector<To> {
+            r.rot[0][0]*v.x + r.rot[1][0]*v.y + r.rot[2][0]*v.z,
+            r.rot[0][1]*v.x + r.rot[1][1]*v.y + r.rot[2][1]*v.z,
+            r.rot[0][2]*v.x + r.rot[1][2]*v.y + r.rot[2][2]*v.z
+        };
+    }
+
+    /**
+     * @brief Applies one rotation to an array of vectors.
+     *
+     * `input` and `output` may be the same array. The matrix is copied
+     * to local storage first, so the compiler can keep it in registers
+     * even though it cannot prove the arrays do not overlap the matrix.
+     */
+    template <FrameTag To, FrameTag From>
+    void Rotate(const Rotation<To, From> &rotation, size_t count, const Vector<From> *input, Vector<To> *output)
+    {
+        const Rotation<To, From> r = rotation;
+        size_t i;
+
+        for (i = 0; i < count; ++i)
+        {
+            const Vector<From> v = input[i];
+            output[i] = r * v;
+        }
+    }
+
+    namespace detail
+    {
+        inline constexpr Rotation<EQJ, EQJ> IdentityEQJ {{
+            { 1.0, 0.0, 0.0 },
+            { 0.0, 1.0, 0.0 },
+            { 0.0, 0.0, 1.0 }
+        }};
+
+        /* Same values as Astronomy_Rotation_EQJ_ECL. */
+        inline constexpr Rotation<ECL, EQJ> EQJ_ECL {{
+            { 1.0,  0.0,                 0.0                },
+            { 0.0, +0.9174821430670688, -0.3977769691083922 },
+            { 0.0, +0.3977769691083922, +0.9174821430670688 }
+        }};
+
+        /* Same values as Astronomy_Rotation_EQJ_GAL. */
+        inline constexpr Rotation<GAL, EQJ> EQJ_GAL {{
+            { -0.0548624779711344, +0.4941095946388765, -0.8676668813529025 },
+            { -0.8734572784246782, -0.4447938112296831, -0.1980677870294097 },
+            { -0.4838000529948520, +0.7470034631630423, +0.4559861124470794 }
+        }};
+
+        constexpr bool IsConstant(FrameTag f)
+        {
+            return f == EQJ || f == ECL || f == GAL;
+        }
+
+        template <FrameTag To>
+        constexpr Rotation<To, EQJ> FromEQJ()
+        {
+            static_assert(IsConstant(To), "Only EQJ, ECL, and GAL are related by constant rotations.");
+            if constexpr (To == ECL)
+                return EQJ_ECL;
+            else if constexpr (To == GAL)
+                return EQJ_GAL;
+            else
+                return IdentityEQJ;
+        }
+
+        /*
+            Direct<To, From>::Get calls the C function for the rotation From -> To,
+            if Astronomy Engine has one. Other pairs go through EQJ.
+        */
+        template <FrameTag To, FrameTag From>
+        struct Direct
+        {
+            static constexpr bool exists = false;
+        };
+
+#define ASTRO_FRAME_DIRECT(to, from, call)                                          \
+        template <> struct Direct<to, from>                                         \
+        {                                                                           \
+            static constexpr bool exists = true;                                    \
+            static astro_rotation_t Get(astro_time_t *time, astro_observer_t observer) \
+            {                                                                       \
+                (void)time;                                                         \
+                (void)observer;                                                     \
+                return call;                                                        \
+            }                                                                       \
+        };
+
+        ASTRO_FRAME_DIRECT(ECL, EQJ, Astronomy_Rotation_EQJ_ECL())
+        ASTRO_FRAME_DIRECT(EQJ, ECL, Astronomy_Rotation_ECL_EQJ())
+        ASTRO_FRAME_DIRECT(GAL, EQJ, Astronomy_Rotation_EQJ_GAL())
+        ASTRO_FRAME_DIRECT(EQJ, GAL, Astronomy_Rotation_GAL_EQJ())
+        ASTRO_FRAME_DIRECT(EQD, EQJ, Astronomy_Rotation_EQJ_EQD(time))
+        ASTRO_FRAME_DIRECT(EQJ, EQD, Astronomy_Rotation_EQD_EQJ(time))
+        ASTRO_FRAME_DIRECT(ECT, EQJ, Astronomy_Rotation_EQJ_ECT(time))
+        ASTRO_FRAME_DIRECT(EQJ, ECT, Astronomy_Rotation_ECT_EQJ(time))
+        ASTRO_FRAME_DIRECT(ECT, EQD, Astronomy_Rotation_EQD_ECT(time))
+        ASTRO_FRAME_DIRECT(EQD, ECT, Astronomy_Rotation_ECT_EQD(time))
+        ASTRO_FRAME_DIRECT(ECL, EQD, Astronomy_Rotation_EQD_ECL(time))
+        ASTRO_FRAME_DIRECT(EQD, ECL, Astronomy_Rotation_ECL_EQD(time))
+        ASTRO_FRAME_DIRECT(HOR, EQJ, Astronomy_Rotation_EQJ_HOR(time, observer))
+        ASTRO_FRAME_DIRECT(EQJ, HOR, Astronomy_Rotation_HOR_EQJ(time, observer))
+        ASTRO_FRAME_DIRECT(HOR, EQD, Astronomy_Rotation_EQD_HOR(time, observer))
+        ASTRO_FRAME_DIRECT(EQD, HOR, Astronomy_Rotation_HOR_EQD(time, observer))
+        ASTRO_FRAME_DIRECT(HOR, ECL, Astronomy_Rotation_ECL_HOR(time, observer))
+        ASTRO_FRAME_DIRECT(ECL, HOR, Astronomy_Rotation_HOR_ECL(time, observer))
+
+#undef ASTRO_FRAME_DIRECT
+
+        template <FrameTag To, FrameTag From>
+        astro_status_t Copy(astro_rotation_t r, Rotation<To, From> &out)
+        {
+            int i, j;
+
+            if (r.status != ASTRO_SUCCESS)
+                return r.status;
+
+            for (i = 0; i < 3; ++i)
+                for (j = 0; j < 3; ++j)
+                    out.rot[i][j] = r.rot[i][j];
+            return ASTRO_SUCCESS;
+        }
+
+        template <FrameTag To, FrameTag From>
+        astro_status_t Make(Rotation<To, From> &out, astro_time_t *time, astro_observer_t observer)
+        {
+            if constexpr (To == From)
+            {
+                (void)time;
+                (void)observer;
+                out = Rotation<To, From> {{ {1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0} }};
+                return ASTRO_SUCCESS;
+            }
+            else if constexpr (Direct<To, From>::exists)
+            {
+                return Copy(Direct<To, From>::Get(time, observer), out);
+            }
+            else
+            {
+                Rotation<EQJ, From> first;
+                Rotation<To, EQJ> second;
+                astro_status_t status;
+
+                status = Copy(Direct<EQJ, From>::Get(time, observer), first);
+                if (status != ASTRO_SUCCESS)
+                    return status;
+
+                status = Copy(Direct<To, EQJ>::Get(time, observer), second);
+                if (status != ASTRO_SUCCESS)
+                    return status;
+
+                out = second * first;
+                return ASTRO_SUCCESS;
+            }
+        }
+    }
+
+    /**
+     * @brief Returns a rotation among EQJ, ECL, and GAL as a compile-time constant.
+     *
+     * Any pair of these frames is allowed. Pairs that Astronomy Engine
+     * does not provide directly are combined through EQJ at compile time.
+     * Asking for a rotation that involves EQD, ECT, or HOR is a compile error,
+     * because those depend on time; use #MakeRotation for them.
+     */
+    template <FrameTag To, FrameTag From>
+    constexpr Rotation<To, From> ConstantRotation()
+    {
+        static_assert(detail::IsConstant(From), "ConstantRotation: the input frame depends on time; use MakeRotation.");
+        static_assert(detail::IsConstant(To), "ConstantRotation: the output frame depends on time; use MakeRotation.");
+        if constexpr (From == EQJ)
+            return detail::FromEQJ<To>();
+        else if constexpr (To == EQJ)
+            return detail::FromEQJ<From>().Inverse();
+        else
+            return detail::FromEQJ<To>() * detail::FromEQJ<From>().Inverse();
+    }
+
+    /**
+     * @brief Calculates the rotation from frame `From` to frame `To` at a given time and place.
+     *
+     * Pairs of frames that Astronomy Engine does not provide directly are combined
+     * through EQJ. The C function status is checked once here, so the resulting
+     * matrix can be used in loops without any further checks.
+     *
+     * @param out
+     *      On success, receives the rotation matrix.
+     * @param time
+     *      The time at which to calculate the rotation. Ignored by rotations
+     *      among EQJ, ECL, and GAL.
+     * @param observer
+     *      The location of the observer. Used only by rotations involving HOR.
+     *
+     * @return
+     *      `ASTRO_SUCCESS`, or the error status from the underlying C function.
+     */
+    template <FrameTag To, FrameTag From>
+    astro_status_t MakeRotation(Rotation<To, From> &out, astro_time_t *time, astro_observer_t observer)
+    {
+        return detail::Make(out, time, observer);
+    }
+
+    /**
+     * @brief Calculates a time-dependent rotation that does not involve an observer.
+     *
+     * Same as the three-argument overload, but rejects HOR at compile time.
+     */
+    template <FrameTag To, FrameTag From>
+    astro_status_t MakeRotation(Rotation<To, From> &out, astro_time_t *time)
+    {
+        static_assert(To != HOR && From != HOR, "MakeRotation: rotations involving HOR need an observer.");
+        astro_observer_t nowhere = { 0.0, 0.0, 0.0 };
+        return detail::Make(out, time, nowhere);
+    }
+}
+
+#endif /* __ASTRONOMY_FRAMES_HPP */
@@ -5601,8 +5601,8 @@ function FindAscent(
     // Imagine you have to "drive" from a1 to 0, then back to a2.
     // You can't go faster than max_deriv_alt. If you can't reach 0 in half the time,
     // you certainly don't have time to reach 0, turn around, and still make your way
-    // back up to a2 (which is at least as far from 0 than a1 is) in the time interval dt.
-    // Therefore, the time threshold is half the time interval, or dt/2.
+    // back up to a2 (which is at least as far from 0 than a1 is) in the whole interval [t1, t2].
+    // Here dt is the whole interval, so the time threshold is dt/2.
     if (da > max_deriv_alt*(dt / 2)) {
         // Prune: the altitude cannot change fast enough to reach zero.
         return null;